@@ -28,6 +28,14 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 #include "BatteryManager.h"
  
+static int32_t getPackVoltageSignal(void *bms) {
+	return ((BatteryManager *) bms)->getPackVoltage();
+}
+
+static int32_t getPackCurrentSignal(void *bms) {
+	return ((BatteryManager *) bms)->getPackCurrent();
+}
+
 BatteryManager::BatteryManager() : Device() 
 {
 	packVoltage = 0;
@@ -55,6 +63,9 @@ void BatteryManager::setup() {
 #else
 #endif
 
+	SignalRegistry::getInstance()->publish(Constants::bmsVoltage, "V", 1, getPackVoltageSignal, this);
+	SignalRegistry::getInstance()->publish(Constants::bmsCurrent, "A", 1, getPackCurrentSignal, this);
+
 //TickHandler::getInstance()->detach(this);
 //TickHandler::getInstance()->attach(this, CFG_TICK_INTERVAL_MOTOR_CONTROLLER_DMOC);
 
@@ -32,6 +32,7 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include <Arduino.h>
 #include "config.h"
 #include "Device.h"
+#include "SignalRegistry.h"
 
 class BatteryManager : public Device {
 public:
@@ -102,7 +102,7 @@ void BrusaMotorController::sendControl() {
 	if (faulted) {
 		outputFrame.data.bytes[0] |= clearErrorLatch;
 	} else {
-		if ((running || speedActual > 1000) && !getDigital(1)) { // see warning about field weakening current to prevent uncontrollable regen
+		if ((controllerState == CS_ENABLED || speedActual > 1000) && !getDigital(1)) { // see warning about field weakening current to prevent uncontrollable regen
 			outputFrame.data.bytes[0] |= enablePowerStage;
 		}
 		if (running) {
@@ -112,10 +112,10 @@ void BrusaMotorController::sendControl() {
 			if (powerMode == modeSpeed) {
 				outputFrame.data.bytes[0] |= enableSpeedMode;
 				speedRequested = throttleRequested * config->speedMax / 1000;
-				torqueRequested = config->torqueMax; // positive number used for both speed directions
+				torqueRequested = torqueLimitMotor; // positive number used for both speed directions
 			} else { // torque mode
 				speedRequested = config->speedMax; // positive number used for both torque directions
-				torqueRequested = throttleRequested * config->torqueMax / 1000;
+				torqueRequested = limitTorque(throttleRequested * config->torqueMax / 1000);
 			}
 
 			// set the speed in rpm
@@ -129,7 +129,7 @@ void BrusaMotorController::sendControl() {
 	}
 
 	if (Logger::isDebug())
-		Logger::debug(BRUSA_DMC5, "requested Speed: %l rpm, requested Torque: %f Nm", speedRequested, (float)torqueRequested/10.0F);
+		LOG_DEBUG(BRUSA_DMC5, "requested Speed: %l rpm, requested Torque: %f Nm", speedRequested, (float)torqueRequested/10.0F);
 
 	CanHandler::getInstanceEV()->sendFrame(outputFrame);
 }
@@ -203,6 +203,7 @@ void BrusaMotorController::prepareOutputFrame(uint32_t id) {
  * the incoming message is processed.
  */
 void BrusaMotorController::handleCanFrame( CAN_FRAME *frame) {
+	reportActivity();
 	switch (frame->id) {
 	case CAN_ID_STATUS:
 		processStatus(frame->data.bytes);
@@ -237,7 +238,7 @@ void BrusaMotorController::processStatus(uint8_t data[]) {
 	speedActual = (int16_t)(data[7] | (data[6] << 8));
 
 	if(Logger::isDebug())
-		Logger::debug(BRUSA_DMC5, "status: %X, torque avail: %fNm, actual torque: %fNm, speed actual: %drpm", statusBitfield1, (float)torqueAvailable/100.0F, (float)torqueActual/100.0F, speedActual);
+		LOG_DEBUG(BRUSA_DMC5, "status: %X, torque avail: %fNm, actual torque: %fNm, speed actual: %drpm", statusBitfield1, (float)torqueAvailable/100.0F, (float)torqueActual/100.0F, speedActual);
 
 	ready = (statusBitfield1 & stateReady) != 0 ? true : false;
 	running = (statusBitfield1 & stateRunning) != 0 ? true : false;
@@ -245,6 +246,13 @@ void BrusaMotorController::processStatus(uint8_t data[]) {
 	warning = (statusBitfield1 & warningFlag) != 0 ? true : false;
 }
 
+/*
+ * The power stage may be enabled once the controller reports to be ready (or already running)
+ */
+bool BrusaMotorController::isControllerReady() {
+	return ready || running;
+}
+
 /*
  * Process a DMC_ACTV message which was received from the motor controller.
  *
@@ -258,7 +266,7 @@ void BrusaMotorController::processActualValues(uint8_t data[]) {
 	mechanicalPower = (int16_t)(data[7] | (data[6] << 8)) / 6.25;
 
 	if (Logger::isDebug())
-		Logger::debug(BRUSA_DMC5, "actual values: DC Volts: %fV, DC current: %fA, AC current: %fA, mechPower: %fkW", (float)dcVoltage / 10.0F, (float)dcCurrent / 10.0F, (float)acCurrent / 10.0F, (float)mechanicalPower / 10.0F);
+		LOG_DEBUG(BRUSA_DMC5, "actual values: DC Volts: %fV, DC current: %fA, AC current: %fA, mechPower: %fkW", (float)dcVoltage / 10.0F, (float)dcCurrent / 10.0F, (float)acCurrent / 10.0F, (float)mechanicalPower / 10.0F);
 }
 
 /*
@@ -273,7 +281,7 @@ void BrusaMotorController::processErrors(uint8_t data[]) {
 	statusBitfield2 = (uint32_t)(data[7] | (data[6] << 8));
 
 	if (Logger::isDebug())
-		Logger::debug(BRUSA_DMC5, "errors: %X, warning: %X", statusBitfield3, statusBitfield2);
+		LOG_DEBUG(BRUSA_DMC5, "errors: %X, warning: %X", statusBitfield3, statusBitfield2);
 }
 
 /*
@@ -287,7 +295,7 @@ void BrusaMotorController::processTorqueLimit(uint8_t data[]) {
 	limiterStateNumber = (uint8_t)data[4];
 
 	if (Logger::isDebug())
-		Logger::debug(BRUSA_DMC5, "torque limit: max positive: %fNm, min negative: %fNm", (float) maxPositiveTorque / 10.0F, (float) minNegativeTorque / 10.0F, limiterStateNumber);
+		LOG_DEBUG(BRUSA_DMC5, "torque limit: max positive: %fNm, min negative: %fNm", (float) maxPositiveTorque / 10.0F, (float) minNegativeTorque / 10.0F, limiterStateNumber);
 }
 
 /*
@@ -301,7 +309,7 @@ void BrusaMotorController::processTemperature(uint8_t data[]) {
 	temperatureSystem = (int16_t)(data[4] - 50) * 10;
 
 	if (Logger::isDebug())
-		Logger::debug(BRUSA_DMC5, "temperature: inverter: %fC, motor: %fC, system: %fC", (float)temperatureInverter / 10.0F, (float)temperatureMotor / 10.0F, (float)temperatureSystem / 10.0F);
+		LOG_DEBUG(BRUSA_DMC5, "temperature: inverter: %fC, motor: %fC, system: %fC", (float)temperatureInverter / 10.0F, (float)temperatureMotor / 10.0F, (float)temperatureSystem / 10.0F);
 }
 
 /*
@@ -339,7 +347,7 @@ void BrusaMotorController::loadConfiguration() {
 //	if (prefsHandler->checksumValid()) { //checksum is good, read in the values stored in EEPROM
 	if (false) { //TODO: use eeprom, not fixed values
 #endif
-		Logger::debug(BRUSA_DMC5, (char *)Constants::validChecksum);
+		LOG_DEBUG(BRUSA_DMC5, (char *)Constants::validChecksum);
 //		prefsHandler->read(EEMC_, &config->minimumLevel1);
 	} else { //checksum invalid. Reinitialize values and store to EEPROM
 		Logger::warn(BRUSA_DMC5, (char *)Constants::invalidChecksum);
@@ -353,9 +361,9 @@ void BrusaMotorController::loadConfiguration() {
 		config->enableOscillationLimiter = false;
 		saveConfiguration();
 	}
-	Logger::debug(BRUSA_DMC5, "Max mech power motor: %d kW, max mech power regen: %d ", config->maxMechanicalPowerMotor, config->maxMechanicalPowerRegen);
-	Logger::debug(BRUSA_DMC5, "DC limit motor: %d Volt, DC limit regen: %d Volt", config->dcVoltLimitMotor, config->dcVoltLimitRegen);
-	Logger::debug(BRUSA_DMC5, "DC limit motor: %d Amps, DC limit regen: %d Amps", config->dcCurrentLimitMotor, config->dcCurrentLimitRegen);
+	LOG_DEBUG(BRUSA_DMC5, "Max mech power motor: %d kW, max mech power regen: %d ", config->maxMechanicalPowerMotor, config->maxMechanicalPowerRegen);
+	LOG_DEBUG(BRUSA_DMC5, "DC limit motor: %d Volt, DC limit regen: %d Volt", config->dcVoltLimitMotor, config->dcVoltLimitRegen);
+	LOG_DEBUG(BRUSA_DMC5, "DC limit motor: %d Amps, DC limit regen: %d Amps", config->dcCurrentLimitMotor, config->dcCurrentLimitRegen);
 }
 
 /*
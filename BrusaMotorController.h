@@ -178,6 +178,7 @@ private:
 	void sendLimits();
 	void prepareOutputFrame(uint32_t);
 	void processStatus(uint8_t data[]);
+	bool isControllerReady();
 	void processActualValues(uint8_t data[]);
 	void processErrors(uint8_t data[]);
 	void processTorqueLimit(uint8_t data[]);
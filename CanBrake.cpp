@@ -47,6 +47,7 @@ void CanBrake::setup() {
 
 	loadConfiguration();
 	Throttle::setup();
+	publishSignals(&rawSignal);
 
 	requestFrame.length = 0x08;
 	requestFrame.rtr = 0x00;
@@ -197,7 +198,7 @@ void CanBrake::loadConfiguration() {
 #else
 	if (prefsHandler->checksumValid()) { //checksum is good, read in the values stored in EEPROM
 #endif
-		Logger::debug(CANBRAKEPEDAL, (char *)Constants::validChecksum);
+		LOG_DEBUG(CANBRAKEPEDAL, (char *)Constants::validChecksum);
 		prefsHandler->read(EETH_MIN_ONE, &config->minimumLevel1);
 		prefsHandler->read(EETH_MAX_ONE, &config->maximumLevel1);
 		prefsHandler->read(EETH_CAR_TYPE, &config->carType);
@@ -208,7 +209,7 @@ void CanBrake::loadConfiguration() {
 		config->carType = Volvo_S80_Gas;
 		saveConfiguration();
 	}
-	Logger::debug(CANBRAKEPEDAL, "T1 MIN: %l MAX: %l Type: %d", config->minimumLevel1, config->maximumLevel1, config->carType);
+	LOG_DEBUG(CANBRAKEPEDAL, "T1 MIN: %l MAX: %l Type: %d", config->minimumLevel1, config->maximumLevel1, config->carType);
 }
 
 /*
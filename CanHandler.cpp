@@ -84,6 +84,7 @@ void CanHandler::initialize() {
 	//Mailboxes are default set up initialized with one MB for TX and the rest for RX
 	//That's OK with us so no need to initialize those things there.
 
+	LoopHandler::getInstance()->attach(this, LOOP_PRIORITY_HIGH, CFG_LOOP_BUDGET_CAN, (canBusNode == CAN_BUS_EV ? "CAN0" : "CAN1"));
 	Logger::info("CAN%d init ok", (canBusNode == CAN_BUS_EV ? 0 : 1));
 }
 
@@ -118,7 +119,7 @@ void CanHandler::attach(CanObserver* observer, uint32_t id, uint32_t mask, bool
 
 	bus->setRXFilter((uint8_t)mailbox, id, mask, extended);
 
-	Logger::debug("attached CanObserver (%X) for id=%X, mask=%X, mailbox=%d", observer, id, mask, mailbox);
+	LOG_DEBUG("attached CanObserver (%X) for id=%X, mask=%X, mailbox=%d", observer, id, mask, mailbox);
 }
 
 /*
@@ -147,7 +148,7 @@ void CanHandler::detach(CanObserver* observer, uint32_t id, uint32_t mask) {
  */
 void CanHandler::logFrame(CAN_FRAME& frame) {
   if (Logger::isDebug()) {
-   Logger::debug("CAN: dlc=%X fid=%X id=%X ide=%X rtr=%X data=%X,%X,%X,%X,%X,%X,%X,%X",
+   LOG_DEBUG("CAN: dlc=%X fid=%X id=%X ide=%X rtr=%X data=%X,%X,%X,%X,%X,%X,%X,%X",
        frame.length, frame.fid, frame.id, frame.extended, frame.rtr,
        frame.data.bytes[0], frame.data.bytes[1], frame.data.bytes[2], frame.data.bytes[3],
        frame.data.bytes[4], frame.data.bytes[5], frame.data.bytes[6], frame.data.bytes[7]);
@@ -190,7 +191,7 @@ int8_t CanHandler::findFreeMailbox() {
 /*
  * If a message is available, read it and forward it to registered observers.
  */
-void CanHandler::process() {
+void CanHandler::handleLoop() {
 	static CAN_FRAME frame;
 
 	if (bus->rx_avail()) {
@@ -235,15 +236,16 @@ void CanHandler::CANIO(CAN_FRAME& frame) {
   CANioFrame.extended = 0; //standard frame
   CANioFrame.rtr = 0;  
   
-  for(int i=0;i==8;i++)
+  for(int i=0;i<NUM_OUTPUT;i++)
     {
       if(frame.data.bytes[i]==0x88)setOutput(i,true);
       if(frame.data.bytes[i]==0xFF)setOutput(i,false);
     }
   
-  for(int i=0;i==8;i++)
+  uint8_t outputs=getOutputs(); //shadow state, already includes the changes above
+  for(int i=0;i<NUM_OUTPUT;i++)
     {
-      if(getOutput(i))CANioFrame.data.bytes[i]=0x88;
+      if(outputs & (1<<i))CANioFrame.data.bytes[i]=0x88;
         else CANioFrame.data.bytes[i]=0xFF;
     }
       
@@ -266,9 +268,10 @@ void CanHandler::CANIO(CAN_FRAME& frame) {
   CANioFrame.id = CAN_DIGITAL_INPUTS;
   CANioFrame.length = 4;
   
-  for(int i=0;i==4;i++)
+  uint8_t inputs=getDigitalInputs();
+  for(int i=0;i<NUM_DIGITAL;i++)
     {
-     if (getDigital(i))CANioFrame.data.bytes[i]=0x88;
+     if (inputs & (1<<i))CANioFrame.data.bytes[i]=0x88;
        else CANioFrame.data.bytes[i]=0xff;
     }
       
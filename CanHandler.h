@@ -35,6 +35,7 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "Logger.h"
 #include "DeviceManager.h"
 #include "sys_io.h"
+#include "LoopHandler.h"
 
 class Device;
 
@@ -43,7 +44,7 @@ public:
 	virtual void handleCanFrame(CAN_FRAME *frame);
 };
 
-class CanHandler {
+class CanHandler: public LoopObserver {
 public:
 	enum CanBusNode {
 		CAN_BUS_EV, // CAN0 is intended to be connected to the EV bus (controller, charger, etc.)
@@ -53,7 +54,7 @@ public:
 	void initialize();
 	void attach(CanObserver *observer, uint32_t id, uint32_t mask, bool extended);
 	void detach(CanObserver *observer, uint32_t id, uint32_t mask);
-	void process();
+	void handleLoop();
 	void sendFrame(CAN_FRAME& frame);
   void CANIO(CAN_FRAME& frame); 
 	static CanHandler *getInstanceCar();
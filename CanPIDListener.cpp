@@ -104,6 +104,9 @@ void CanPIDListener::handleCanFrame(CAN_FRAME *frame) {
 	if ((frame->id == 0x7E0) || (frame->id == 0x7DF)) {
 		//Do some common setup for our output - we won't pull the trigger unless we need to.
 		outputFrame.id = 0x7E8; //first ECU replying - TODO: Perhaps allow this to be configured from 0x7E8 - 0x7EF
+		outputFrame.length = 8; //OBD2 responses are always padded to 8 bytes
+		outputFrame.extended = 0;
+		outputFrame.rtr = 0;
 		outputFrame.data.bytes[1] = frame->data.bytes[1] + 0x40; //to show that this is a response
 		outputFrame.data.bytes[2] = frame->data.bytes[2]; //copy standard PID
 		outputFrame.data.bytes[0] = 2;
@@ -118,9 +121,19 @@ void CanPIDListener::handleCanFrame(CAN_FRAME *frame) {
 			case 1: //show current data
 				ret = processShowData(frame, outputFrame);
 				break;
-			case 2: //show freeze frame data - not sure we'll be supporting this
-				break;
-			case 3: //show stored diagnostic codes - we can probably map our faults to some existing DTC codes or roll our own
+			case 2: //show freeze frame data
+			case 3: //show stored diagnostic codes
+				{
+					char out[8];
+					//the frame number of a mode 2 request is optional, without it the rest of the frame is padding
+					char *inData = (frame->data.bytes[0] >= 3 ? (char *) &frame->data.bytes[3] : NULL);
+					if (OBD2Handler::getInstance()->processRequest(frame->data.bytes[1], frame->data.bytes[2], inData, out)) {
+						outputFrame.data.bytes[0] = out[0] + 2;
+						for (int i = 1; i < 8; i++)
+							outputFrame.data.bytes[i] = out[i];
+						ret = true;
+					}
+				}
 				break;
 			case 4: //clear diagnostic trouble codes - If we get this frame we just clear all codes no questions asked.
 				break;
@@ -161,11 +174,13 @@ bool CanPIDListener::processShowData(CAN_FRAME* inFrame, CAN_FRAME& outFrame) {
 		return true;
 		break;
 	case 1: //Returns 32 bits but we really can only support the first byte which has bit 7 = Malfunction? Bits 0-6 = # of DTCs
+		temp = faultHandler.getFaultCount();
+		if (temp > 0x7F) temp = 0x7F;
 		outFrame.data.bytes[0] += 4;
-		outFrame.data.bytes[3] = 0; //TODO: We aren't properly keeping track of faults yet but when we do fix this. 
-		outFrame.data.bytes[3] = 0; //these next three are really related to ICE diagnostics
-		outFrame.data.bytes[3] = 0; //so ignore them.
-		outFrame.data.bytes[3] = 0;
+		outFrame.data.bytes[3] = temp ? (0x80 | temp) : 0; //MIL on if there are un-ack'd faults
+		outFrame.data.bytes[4] = 0; //these next three are really related to ICE diagnostics
+		outFrame.data.bytes[5] = 0; //so ignore them.
+		outFrame.data.bytes[6] = 0;
 		return true;
 		break;
 	case 2: //Freeze DTC
@@ -304,7 +319,7 @@ void CanPIDListener::loadConfiguration() {
 #else
 	if (prefsHandler->checksumValid()) { //checksum is good, read in the values stored in EEPROM
 #endif
-		Logger::debug(PIDLISTENER, (char *)Constants::validChecksum);
+		LOG_DEBUG(PIDLISTENER, (char *)Constants::validChecksum);
 		//prefsHandler->read(EETH_MIN_ONE, &config->minimumLevel1);
 		//prefsHandler->read(EETH_MAX_ONE, &config->maximumLevel1);
 		//prefsHandler->read(EETH_CAR_TYPE, &config->carType);
@@ -315,7 +330,7 @@ void CanPIDListener::loadConfiguration() {
 		//config->carType = Volvo_S80_Gas;
 		saveConfiguration();
 	}
-	//Logger::debug(CANACCELPEDAL, "T1 MIN: %l MAX: %l Type: %d", config->minimumLevel1, config->maximumLevel1, config->carType);
+	//LOG_DEBUG(CANACCELPEDAL, "T1 MIN: %l MAX: %l Type: %d", config->minimumLevel1, config->maximumLevel1, config->carType);
 }
 
 /*
@@ -34,6 +34,7 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "TickHandler.h"
 #include "CanHandler.h"
 #include "constants.h"
+#include "OBD2Handler.h"
 
 
 class CanPIDConfiguration : public DeviceConfiguration {
@@ -47,7 +48,6 @@ class CanPIDListener: public Device, CanObserver {
 public:
 	CanPIDListener();
 	void setup();
-	void handleTick();
 	void handleCanFrame(CAN_FRAME *frame);
 	DeviceId getId();
 
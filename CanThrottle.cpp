@@ -46,6 +46,7 @@ void CanThrottle::setup() {
 
 	loadConfiguration();
 	Throttle::setup();
+	publishSignals(&rawSignal);
 
 	requestFrame.length = 0x08;
 	requestFrame.rtr = 0x00;
@@ -168,7 +169,7 @@ void CanThrottle::loadConfiguration() {
 #else
 	if (prefsHandler->checksumValid()) { //checksum is good, read in the values stored in EEPROM
 #endif
-		Logger::debug(CANACCELPEDAL, (char *)Constants::validChecksum);
+		LOG_DEBUG(CANACCELPEDAL, (char *)Constants::validChecksum);
 		prefsHandler->read(EETH_MIN_ONE, &config->minimumLevel1);
 		prefsHandler->read(EETH_MAX_ONE, &config->maximumLevel1);
 		prefsHandler->read(EETH_CAR_TYPE, &config->carType);
@@ -179,7 +180,7 @@ void CanThrottle::loadConfiguration() {
 		config->carType = Volvo_S80_Gas;
 		saveConfiguration();
 	}
-	Logger::debug(CANACCELPEDAL, "T1 MIN: %l MAX: %l Type: %d", config->minimumLevel1, config->maximumLevel1, config->carType);
+	LOG_DEBUG(CANACCELPEDAL, "T1 MIN: %l MAX: %l Type: %d", config->minimumLevel1, config->maximumLevel1, config->carType);
 }
 
 /*
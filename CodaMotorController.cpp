@@ -42,7 +42,50 @@ template<class T> inline Print &operator <<(Print &obj, T arg) { obj.print(arg);
 
 long mss;
 extern bool runThrottle; 
-const uint8_t swizzleTable[] = { 0xAA, 0x7F, 0xFE, 0x29, 0x52, 0xA4, 0x9D, 0xEF, 0xB, 0x16, 0x2C, 0x58, 0xB0, 0x60, 0xC0, 1 };
+
+/*
+ * The security CRC XORs one swizzle value for each set bit of the 16 bit torque value:
+ * { 0xAA, 0x7F, 0xFE, 0x29, 0x52, 0xA4, 0x9D, 0xEF, 0xB, 0x16, 0x2C, 0x58, 0xB0, 0x60, 0xC0, 1 }
+ * As XOR is associative, the result for each byte of the torque value is precomputed.
+ */
+// XOR of the swizzle values for each set bit of the torque lsb (bits 0-7)
+const uint8_t codaCrcTableLow[256] = {
+	0x00, 0xAA, 0x7F, 0xD5, 0xFE, 0x54, 0x81, 0x2B, 0x29, 0x83, 0x56, 0xFC, 0xD7, 0x7D, 0xA8, 0x02,
+	0x52, 0xF8, 0x2D, 0x87, 0xAC, 0x06, 0xD3, 0x79, 0x7B, 0xD1, 0x04, 0xAE, 0x85, 0x2F, 0xFA, 0x50,
+	0xA4, 0x0E, 0xDB, 0x71, 0x5A, 0xF0, 0x25, 0x8F, 0x8D, 0x27, 0xF2, 0x58, 0x73, 0xD9, 0x0C, 0xA6,
+	0xF6, 0x5C, 0x89, 0x23, 0x08, 0xA2, 0x77, 0xDD, 0xDF, 0x75, 0xA0, 0x0A, 0x21, 0x8B, 0x5E, 0xF4,
+	0x9D, 0x37, 0xE2, 0x48, 0x63, 0xC9, 0x1C, 0xB6, 0xB4, 0x1E, 0xCB, 0x61, 0x4A, 0xE0, 0x35, 0x9F,
+	0xCF, 0x65, 0xB0, 0x1A, 0x31, 0x9B, 0x4E, 0xE4, 0xE6, 0x4C, 0x99, 0x33, 0x18, 0xB2, 0x67, 0xCD,
+	0x39, 0x93, 0x46, 0xEC, 0xC7, 0x6D, 0xB8, 0x12, 0x10, 0xBA, 0x6F, 0xC5, 0xEE, 0x44, 0x91, 0x3B,
+	0x6B, 0xC1, 0x14, 0xBE, 0x95, 0x3F, 0xEA, 0x40, 0x42, 0xE8, 0x3D, 0x97, 0xBC, 0x16, 0xC3, 0x69,
+	0xEF, 0x45, 0x90, 0x3A, 0x11, 0xBB, 0x6E, 0xC4, 0xC6, 0x6C, 0xB9, 0x13, 0x38, 0x92, 0x47, 0xED,
+	0xBD, 0x17, 0xC2, 0x68, 0x43, 0xE9, 0x3C, 0x96, 0x94, 0x3E, 0xEB, 0x41, 0x6A, 0xC0, 0x15, 0xBF,
+	0x4B, 0xE1, 0x34, 0x9E, 0xB5, 0x1F, 0xCA, 0x60, 0x62, 0xC8, 0x1D, 0xB7, 0x9C, 0x36, 0xE3, 0x49,
+	0x19, 0xB3, 0x66, 0xCC, 0xE7, 0x4D, 0x98, 0x32, 0x30, 0x9A, 0x4F, 0xE5, 0xCE, 0x64, 0xB1, 0x1B,
+	0x72, 0xD8, 0x0D, 0xA7, 0x8C, 0x26, 0xF3, 0x59, 0x5B, 0xF1, 0x24, 0x8E, 0xA5, 0x0F, 0xDA, 0x70,
+	0x20, 0x8A, 0x5F, 0xF5, 0xDE, 0x74, 0xA1, 0x0B, 0x09, 0xA3, 0x76, 0xDC, 0xF7, 0x5D, 0x88, 0x22,
+	0xD6, 0x7C, 0xA9, 0x03, 0x28, 0x82, 0x57, 0xFD, 0xFF, 0x55, 0x80, 0x2A, 0x01, 0xAB, 0x7E, 0xD4,
+	0x84, 0x2E, 0xFB, 0x51, 0x7A, 0xD0, 0x05, 0xAF, 0xAD, 0x07, 0xD2, 0x78, 0x53, 0xF9, 0x2C, 0x86
+};
+// XOR of the swizzle values for each set bit of the torque msb (bits 8-15)
+const uint8_t codaCrcTableHigh[256] = {
+	0x00, 0x0B, 0x16, 0x1D, 0x2C, 0x27, 0x3A, 0x31, 0x58, 0x53, 0x4E, 0x45, 0x74, 0x7F, 0x62, 0x69,
+	0xB0, 0xBB, 0xA6, 0xAD, 0x9C, 0x97, 0x8A, 0x81, 0xE8, 0xE3, 0xFE, 0xF5, 0xC4, 0xCF, 0xD2, 0xD9,
+	0x60, 0x6B, 0x76, 0x7D, 0x4C, 0x47, 0x5A, 0x51, 0x38, 0x33, 0x2E, 0x25, 0x14, 0x1F, 0x02, 0x09,
+	0xD0, 0xDB, 0xC6, 0xCD, 0xFC, 0xF7, 0xEA, 0xE1, 0x88, 0x83, 0x9E, 0x95, 0xA4, 0xAF, 0xB2, 0xB9,
+	0xC0, 0xCB, 0xD6, 0xDD, 0xEC, 0xE7, 0xFA, 0xF1, 0x98, 0x93, 0x8E, 0x85, 0xB4, 0xBF, 0xA2, 0xA9,
+	0x70, 0x7B, 0x66, 0x6D, 0x5C, 0x57, 0x4A, 0x41, 0x28, 0x23, 0x3E, 0x35, 0x04, 0x0F, 0x12, 0x19,
+	0xA0, 0xAB, 0xB6, 0xBD, 0x8C, 0x87, 0x9A, 0x91, 0xF8, 0xF3, 0xEE, 0xE5, 0xD4, 0xDF, 0xC2, 0xC9,
+	0x10, 0x1B, 0x06, 0x0D, 0x3C, 0x37, 0x2A, 0x21, 0x48, 0x43, 0x5E, 0x55, 0x64, 0x6F, 0x72, 0x79,
+	0x01, 0x0A, 0x17, 0x1C, 0x2D, 0x26, 0x3B, 0x30, 0x59, 0x52, 0x4F, 0x44, 0x75, 0x7E, 0x63, 0x68,
+	0xB1, 0xBA, 0xA7, 0xAC, 0x9D, 0x96, 0x8B, 0x80, 0xE9, 0xE2, 0xFF, 0xF4, 0xC5, 0xCE, 0xD3, 0xD8,
+	0x61, 0x6A, 0x77, 0x7C, 0x4D, 0x46, 0x5B, 0x50, 0x39, 0x32, 0x2F, 0x24, 0x15, 0x1E, 0x03, 0x08,
+	0xD1, 0xDA, 0xC7, 0xCC, 0xFD, 0xF6, 0xEB, 0xE0, 0x89, 0x82, 0x9F, 0x94, 0xA5, 0xAE, 0xB3, 0xB8,
+	0xC1, 0xCA, 0xD7, 0xDC, 0xED, 0xE6, 0xFB, 0xF0, 0x99, 0x92, 0x8F, 0x84, 0xB5, 0xBE, 0xA3, 0xA8,
+	0x71, 0x7A, 0x67, 0x6C, 0x5D, 0x56, 0x4B, 0x40, 0x29, 0x22, 0x3F, 0x34, 0x05, 0x0E, 0x13, 0x18,
+	0xA1, 0xAA, 0xB7, 0xBC, 0x8D, 0x86, 0x9B, 0x90, 0xF9, 0xF2, 0xEF, 0xE4, 0xD5, 0xDE, 0xC3, 0xC8,
+	0x11, 0x1A, 0x07, 0x0C, 0x3D, 0x36, 0x2B, 0x20, 0x49, 0x42, 0x5F, 0x54, 0x65, 0x6E, 0x73, 0x78
+};
 
 
 	
@@ -55,6 +98,23 @@ CodaMotorController::CodaMotorController() : MotorController()
     activityCount = 0;
     sequence=0;
     commonName = "Coda UQM Powerphase 100 Inverter";
+
+    // the constant parts of the command frames are set only once
+    frameCmd1.length = 5;
+    frameCmd1.id = 0x204;
+    frameCmd1.extended = 0; //standard frame
+    frameCmd1.rtr = 0;
+    frameCmd1.data.bytes[0] = 0x00; //First byte is always zero.
+
+    frameWatchdog.length = 8;
+    frameWatchdog.id = 0x207;
+    frameWatchdog.extended = 0; //standard frame
+    frameWatchdog.rtr = 0;
+    frameWatchdog.data.bytes[0] = 0xa5; //This is simply three given values.  The 5A appears to be
+    frameWatchdog.data.bytes[1] = 0xa5; //the important one.
+    frameWatchdog.data.bytes[2] = 0x5a;
+    for (int i = 3; i < 8; i++)
+        frameWatchdog.data.bytes[i] = 0x00;
   
 }
 
@@ -84,12 +144,13 @@ void CodaMotorController::handleCanFrame(CAN_FRAME *frame)
 	int RotorTemp, invTemp, StatorTemp;
 	int temp;
 	online = 1; //if a frame got to here then it passed the filter and must come from UQM
+	reportActivity();
 	if (!running) //if we're newly running then cancel faults if necessary.
 	{ 
 		faultHandler.cancelOngoingFault(CODAUQM, FAULT_MOTORCTRL_COMM);
 	}
     running=true;
-        Logger::debug("UQM inverter msg: %X   %X   %X   %X   %X   %X   %X   %X  %X", frame->id, frame->data.bytes[0],
+        LOG_DEBUG("UQM inverter msg: %X   %X   %X   %X   %X   %X   %X   %X  %X", frame->id, frame->data.bytes[0],
         frame->data.bytes[1],frame->data.bytes[2],frame->data.bytes[3],frame->data.bytes[4],
         frame->data.bytes[5],frame->data.bytes[6],frame->data.bytes[7]);
         
@@ -103,24 +164,24 @@ void CodaMotorController::handleCanFrame(CAN_FRAME *frame)
                 if(dcVoltage<1000){dcVoltage=1000;}//Lowest value we can display on dashboard
 	      dcCurrent = (((frame->data.bytes[5] * 256) + frame->data.bytes[4])-32128);
               speedActual = abs((((frame->data.bytes[7] * 256) + frame->data.bytes[6])-32128)/2);   
-              Logger::debug("UQM Actual Torque: %d DC Voltage: %d Amps: %d RPM: %d", torqueActual/10,dcVoltage/10,dcCurrent/10,speedActual);
+              LOG_DEBUG("UQM Actual Torque: %d DC Voltage: %d Amps: %d RPM: %d", torqueActual/10,dcVoltage/10,dcCurrent/10,speedActual);
 	      break;
 
         case 0x20A:    //System Status Message
-            Logger::debug("UQM inverter 20A System Status Message Received");
+            LOG_DEBUG("UQM inverter 20A System Status Message Received");
             break;
 
 
         case 0x20B:    //Emergency Fuel Cutback Message
-            Logger::debug("UQM inverter 20B Emergency Fuel Cutback Message Received");
+            LOG_DEBUG("UQM inverter 20B Emergency Fuel Cutback Message Received");
             break;
         
         case 0x20C:    //Reserved Message     
-            Logger::debug("UQM inverter 20C Reserved Message Received");
+            LOG_DEBUG("UQM inverter 20C Reserved Message Received");
             break;
         
         case 0x20D:    //Limited Torque Percentage Message    
-            Logger::debug("UQM inverter 20D Limited Torque Percentage Message Received");
+            LOG_DEBUG("UQM inverter 20D Limited Torque Percentage Message Received");
             break;
         
         case 0x20E:     //Temperature Feedback Message
@@ -131,11 +192,11 @@ void CodaMotorController::handleCanFrame(CAN_FRAME *frame)
 	        temperatureInverter = (invTemp-40)*10;
                 if (RotorTemp > StatorTemp) {temperatureMotor = (RotorTemp-40)*10;}
 	          else {temperatureMotor = (StatorTemp-40)*10;}		
-                Logger::debug("UQM 20E Inverter temp: %d Motor temp: %d", temperatureInverter,temperatureMotor);
+                LOG_DEBUG("UQM 20E Inverter temp: %d Motor temp: %d", temperatureInverter,temperatureMotor);
     		break;
 	
         case 0x20F:    //CAN Watchdog Status Message           
-                Logger::debug("UQM 20F CAN Watchdog status error");
+                LOG_DEBUG("UQM 20F CAN Watchdog status error");
                 warning=true;
                 running=false;
                 sendCmd2(); //If we get a Watchdog status, we need to respond with Watchdog reset
@@ -192,16 +253,9 @@ Values above 32128 are positive torque.  Values below 32128 are negative torque
 void CodaMotorController::sendCmd1() 
 {
 	CodaMotorControllerConfiguration *config = (CodaMotorControllerConfiguration *)getConfiguration();
+	CAN_FRAME &output = frameCmd1; //only bytes 1 to 4 change, the rest of the template is set up in the constructor
 	
-	CAN_FRAME output;
-	output.length = 5;
-	output.id = 0x204;
-	output.extended = 0; //standard frame
-	output.rtr = 0;
-	output.data.bytes[0] = 0x00; //First byte is always zero.
-      
-	
-      if(operationState==ENABLE)
+      if(controllerState==CS_ENABLED) //the state machine in MotorController decides when to enable
         	{ 
         	  output.data.bytes[1] = 0x80; //1000 0000
         	}
@@ -227,9 +281,8 @@ void CodaMotorController::sendCmd1()
        //Two byte torque request in 0.1NM Can be positive or negative  
       
         torqueCommand=32128; //Set our zero offset value -torque=0
-        torqueRequested = ((throttleRequested * config->torqueMax) / 1000); //Calculate torque request from throttle position x maximum torque 
-        if(speedActual<config->speedMax){torqueCommand += torqueRequested;} //If actual rpm less than max rpm, add torque command to offset
-          else {torqueCommand+= torqueRequested/2;}  //If at RPM limit, cut torque command in half.
+        torqueRequested = limitTorque((throttleRequested * config->torqueMax) / 1000); //Calculate torque request from throttle position x maximum torque, limited by the envelope (speed, power, battery current)
+        torqueCommand += torqueRequested;
         output.data.bytes[3] = (torqueCommand & 0xFF00) >> 8;  //Stow torque command in bytes 2 and 3.
         output.data.bytes[2] = (torqueCommand & 0x00FF);
         output.data.bytes[4] = genCodaCRC(output.data.bytes[1], output.data.bytes[2], output.data.bytes[3]); //Calculate security byte
@@ -237,7 +290,7 @@ void CodaMotorController::sendCmd1()
 	CanHandler::getInstanceEV()->sendFrame(output);  //Mail it.
         timestamp();
 
-        Logger::debug("Torque command: %X   %X  ControlByte: %X  LSB %X  MSB: %X  CRC: %X  %d:%d:%d.%d",output.id, output.data.bytes[0],
+        LOG_DEBUG("Torque command: %X   %X  ControlByte: %X  LSB %X  MSB: %X  CRC: %X  %d:%d:%d.%d",output.id, output.data.bytes[0],
 output.data.bytes[1],output.data.bytes[2],output.data.bytes[3],output.data.bytes[4], hours, minutes, seconds, milliseconds);
           
 }
@@ -253,23 +306,10 @@ void CodaMotorController::sendCmd2() {
 	  We send this in response to receipt of a 20F Watchdog status.
 	  */
 	
-	CAN_FRAME output;
-	output.length = 8;
-	output.id = 0x207;
-	output.extended = 0; //standard frame
-	output.data.bytes[0] = 0xa5; //This is simply three given values.  The 5A appears to be 
-        output.data.bytes[1] = 0xa5; //the important one.
-        output.data.bytes[2] = 0x5a;
-        output.data.bytes[3] = 0x00;
-        output.data.bytes[4] = 0x00;
-        output.data.bytes[5] = 0x00;
-        output.data.bytes[6] = 0x00;
-        output.data.bytes[7] = 0x00;
-	   
-	CanHandler::getInstanceEV()->sendFrame(output); 
+	CanHandler::getInstanceEV()->sendFrame(frameWatchdog); //the frame is constant, see constructor
         timestamp();
-Logger::debug("Watchdog reset: %X  %X  %X  %d:%d:%d.%d",output.data.bytes[0], output.data.bytes[1],
-output.data.bytes[2], hours, minutes, seconds, milliseconds);
+LOG_DEBUG("Watchdog reset: %X  %X  %X  %d:%d:%d.%d",frameWatchdog.data.bytes[0], frameWatchdog.data.bytes[1],
+frameWatchdog.data.bytes[2], hours, minutes, seconds, milliseconds);
   
         warning=false;
 }
@@ -302,10 +342,7 @@ void CodaMotorController::saveConfiguration() {
 
 uint8_t CodaMotorController::genCodaCRC(uint8_t cmd, uint8_t torq_lsb, uint8_t torq_msb) 
 {
-	int counter;
-	uint8_t crc;
 	uint16_t temp_torq = torq_lsb + (256 * torq_msb);
-	crc = 0x7F; //7F is the answer if bytes 3 and 4 are zero. We build up from there.
 
 	//this can be done a little more efficiently but this is clearer to read
 	if (((cmd & 0xA0) == 0xA0) || ((cmd & 0x60) == 0x60)) temp_torq += 1;
@@ -313,13 +350,9 @@ uint8_t CodaMotorController::genCodaCRC(uint8_t cmd, uint8_t torq_lsb, uint8_t t
 	//Not sure why this happens except to obfuscate the result
 	if ((temp_torq % 4) == 3) temp_torq += 4;
 
-        //increment over the bits within the torque command
-	//and applies a particular XOR for each set bit.
-	for (counter = 0; counter < 16; counter++)
-          {
-            if ((temp_torq & (1 << counter)) == (1 << counter)) crc = (byte)(crc ^ swizzleTable[counter]);
-          }
-    return (crc);
+	//7F is the answer if bytes 3 and 4 are zero. The swizzle values of all set bits
+	//are looked up per byte of the torque command.
+	return (0x7F ^ codaCrcTableLow[temp_torq & 0xFF] ^ codaCrcTableHigh[temp_torq >> 8]);
 }
 
 
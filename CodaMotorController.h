@@ -61,15 +61,19 @@ public:
 	virtual void loadConfiguration();
 	virtual void saveConfiguration();
 
+protected:
+	uint8_t genCodaCRC(uint8_t cmd, uint8_t torq_lsb, uint8_t torq_msb);
+
 private:
 	byte online; //counter for whether DMOC appears to be operating
 	byte alive;
 	int activityCount;
 	byte sequence;
         uint16_t torqueCommand;
+        CAN_FRAME frameCmd1; // command frame templates
+        CAN_FRAME frameWatchdog;
         void sendCmd1();
 	void sendCmd2();
-        uint8_t genCodaCRC(uint8_t cmd, uint8_t torq_lsb, uint8_t torq_msb);
 
 };
 
@@ -46,8 +46,8 @@ DCDCController::DCDCController() : Device()
 
 void DCDCController::handleCanFrame(CAN_FRAME *frame) 
 {
-        Logger::debug("DCDC msg: %X", frame->id);
-        Logger::debug("DCDC data: %X%X%X%X%X%X%X%X", frame->data.bytes[0],frame->data.bytes[1],frame->data.bytes[2],frame->data.bytes[3],frame->data.bytes[4],frame->data.bytes[5],frame->data.bytes[6],frame->data.bytes[7]);	
+        LOG_DEBUG("DCDC msg: %X", frame->id);
+        LOG_DEBUG("DCDC data: %X%X%X%X%X%X%X%X", frame->data.bytes[0],frame->data.bytes[1],frame->data.bytes[2],frame->data.bytes[3],frame->data.bytes[4],frame->data.bytes[5],frame->data.bytes[6],frame->data.bytes[7]);	
 }
 
 
@@ -106,7 +106,7 @@ void DCDCController::sendCmd()
           
 	CanHandler::getInstanceCar()->sendFrame(output);
         timestamp();
-        Logger::debug("Delphi DC-DC cmd: %X %X %X %X %X %X %X %X %X  %d:%d:%d.%d",output.id, output.data.bytes[0],
+        LOG_DEBUG("Delphi DC-DC cmd: %X %X %X %X %X %X %X %X %X  %d:%d:%d.%d",output.id, output.data.bytes[0],
         output.data.bytes[1],output.data.bytes[2],output.data.bytes[3],output.data.bytes[4],output.data.bytes[5],output.data.bytes[6],output.data.bytes[7], hours, minutes, seconds, milliseconds);           
 }
 
@@ -45,6 +45,8 @@ DeviceManager::DeviceManager() {
 	motorController = NULL;
 	for (int i = 0; i < CFG_DEV_MGR_MAX_DEVICES; i++)
 		devices[i] = NULL;
+	indexValid = false;
+	numDevices = 0;
 }
 
 /*
@@ -62,49 +64,111 @@ DeviceManager *DeviceManager::getInstance() {
 
 /*
  * Add the specified device to the list of registered devices
+ *
+ * Note: This is called from the constructor of Device, so the type, id and
+ * preferences of the sub-class are not available yet. That's why the device
+ * is only put into the index on the next lookup.
  */
 void DeviceManager::addDevice(Device *device) {
 	if (findDevice(device) == -1) {
 		int8_t i = findDevice(NULL);
 		if (i != -1) {
 			devices[i] = device;
+			invalidateIndex();
 		} else {
 			Logger::error("unable to register device, max number of devices reached.");
 		}
 	}
-	/*
-	switch (device->getType()) {
-	case DEVICE_THROTTLE:
-		throttle = (Throttle *) device;
-		break;
-	case DEVICE_BRAKE:
-		brake = (Throttle *) device;
-		break;
-	case DEVICE_MOTORCTRL:
-		motorController = (MotorController *) device;
-		break;
-	}
-	*/
 }
 
 /*
  * Remove the specified device from the list of registered devices
  */
 void DeviceManager::removeDevice(Device *device) {
-	int8_t i = findDevice(NULL);
-	if (i != -1)
+	int8_t i = findDevice(device);
+	if (i != -1) {
 		devices[i] = NULL;
-	switch (device->getType()) {
-	case DEVICE_THROTTLE:
-		throttle = NULL;
-		break;
-	case DEVICE_BRAKE:
-		brake = NULL;
-		break;
-	case DEVICE_MOTORCTRL:
-		motorController = NULL;
-		break;
+		invalidateIndex();
+	}
+}
+
+/*
+ * Mark the index as outdated, it is rebuilt on the next lookup.
+ * Must be called whenever the enable state of a device was changed (console,
+ * web site), so the cached accelerator, brake and motor controller follow it.
+ */
+void DeviceManager::invalidateIndex() {
+	indexValid = false;
+	throttle = NULL;
+	brake = NULL;
+	motorController = NULL;
+}
+
+/*
+ * Rebuild the index of the devices: The enabled devices are grouped by type
+ * (counting sort) so a message to a type only visits the devices of this type,
+ * all devices are sorted by id for a binary search and the accelerator, brake
+ * and motor controller are cached as they are requested on every tick.
+ */
+void DeviceManager::buildIndex() {
+	uint8_t count[DEVICE_NONE + 1];
+
+	memset(count, 0, sizeof(count));
+	numDevices = 0;
+	for (int i = 0; i < CFG_DEV_MGR_MAX_DEVICES; i++) {
+		if (devices[i] == NULL)
+			continue;
+
+		// insertion sort by id, there are only a few devices
+		DeviceId id = devices[i]->getId();
+		int j = numDevices++;
+		while (j > 0 && devicesById[j - 1]->getId() > id) {
+			devicesById[j] = devicesById[j - 1];
+			j--;
+		}
+		devicesById[j] = devices[i];
+
+		if (devices[i]->isEnabled())
+			count[devices[i]->getType()]++;
+	}
+
+	typeOffset[0] = 0;
+	for (int type = 0; type <= DEVICE_NONE; type++)
+		typeOffset[type + 1] = typeOffset[type] + count[type];
+
+	memset(count, 0, sizeof(count));
+	for (int i = 0; i < CFG_DEV_MGR_MAX_DEVICES; i++) {
+		if (devices[i] && devices[i]->isEnabled()) {
+			DeviceType type = devices[i]->getType();
+			receivers[typeOffset[type] + count[type]++] = devices[i];
+		}
+	}
+
+	throttle = (Throttle *) (typeOffset[DEVICE_THROTTLE] < typeOffset[DEVICE_THROTTLE + 1] ? receivers[typeOffset[DEVICE_THROTTLE]] : NULL);
+	brake = (Throttle *) (typeOffset[DEVICE_BRAKE] < typeOffset[DEVICE_BRAKE + 1] ? receivers[typeOffset[DEVICE_BRAKE]] : NULL);
+	motorController = (MotorController *) (typeOffset[DEVICE_MOTORCTRL] < typeOffset[DEVICE_MOTORCTRL + 1] ? receivers[typeOffset[DEVICE_MOTORCTRL]] : NULL);
+	indexValid = true;
+}
+
+/*
+ * Binary search for a registered device (enabled or not) with the given id.
+ */
+Device *DeviceManager::findDeviceById(DeviceId id) {
+	if (!indexValid)
+		buildIndex();
+
+	int low = 0, high = numDevices - 1;
+	while (low <= high) {
+		int mid = (low + high) / 2;
+		DeviceId midId = devicesById[mid]->getId();
+		if (midId == id)
+			return devicesById[mid];
+		if (midId < id)
+			low = mid + 1;
+		else
+			high = mid - 1;
 	}
+	return NULL;
 }
 
 /*Add a new tick handler to the specified device. It should
@@ -131,34 +195,38 @@ void DeviceManager::removeDevice(Device *device) {
  DeviceManager.h has a list of standard message types but you're allowed to send
  whatever you want. The standard message types are to enforce standard messages for easy
  intercommunication.
+ Only the enabled devices of the requested type are visited (see buildIndex()).
  */
 void DeviceManager::sendMessage(DeviceType devType, DeviceId devId, uint32_t msgType, void* message)
 {
-	for (int i = 0; i < CFG_DEV_MGR_MAX_DEVICES; i++)
-	{
-		if (devices[i] && devices[i]->isEnabled()) //does this object exist and is it enabled?
-		{
-			if (devType == DEVICE_ANY || devType == devices[i]->getType())
-			{
-				if (devId == INVALID || devId == devices[i]->getId())
-				{
-					Logger::debug("Sending msg to device with ID %X", devices[i]->getId());
-					devices[i]->handleMessage(msgType, message);
-				}
-			}
-		}
+	if (devId != INVALID) {
+		Device *device = findDeviceById(devId);
+		if (device && device->isEnabled() && (devType == DEVICE_ANY || devType == device->getType()))
+			device->handleMessage(msgType, message);
+		return;
 	}
-}
 
-void DeviceManager::setParameter(DeviceType deviceType, DeviceId deviceId, uint32_t msgType, char *key, char *value) {
-	char *params[] = { key, value };
-	sendMessage(deviceType, deviceId, msgType, params);
+	if (!indexValid)
+		buildIndex();
+	if (devType > DEVICE_NONE)
+		return;
+
+	uint8_t first = (devType == DEVICE_ANY ? 0 : typeOffset[devType]);
+	uint8_t last = (devType == DEVICE_ANY ? typeOffset[DEVICE_NONE + 1] : typeOffset[devType + 1]);
+
+	// copy the receivers, a receiver might add a device and cause a rebuild of the index (e.g. on MSG_STARTUP)
+	Device *targets[CFG_DEV_MGR_MAX_DEVICES];
+	uint8_t numTargets = last - first;
+	memcpy(targets, &receivers[first], numTargets * sizeof(Device *));
+	for (uint8_t i = 0; i < numTargets; i++)
+		targets[i]->handleMessage(msgType, message);
 }
 
-void DeviceManager::setParameter(DeviceType deviceType, DeviceId deviceId, uint32_t msgType, char *key, uint32_t value) {
-	char buffer[15];
-	sprintf(buffer, "%lu", value);
-	setParameter(deviceType, deviceId, msgType, key, buffer);
+/*
+ * Send a MSG_SET_PARAM via the MessageBus, the value isn't converted to a string.
+ */
+void DeviceManager::setParameter(DeviceId deviceId, const char *key, int32_t value) {
+	MessageBus::getInstance()->send(MSG_SET_PARAM, deviceId, key, value);
 }
 
 uint8_t DeviceManager::getNumThrottles() {
@@ -182,37 +250,38 @@ uint8_t DeviceManager::getNumDisplays() {
 }
 
 Throttle *DeviceManager::getAccelerator() {
-	//try to find one if nothing registered. Cache it if we find one
-	if (!throttle) throttle = (Throttle *)getDeviceByType(DEVICE_THROTTLE); 
+	if (!indexValid)
+		buildIndex();
 
 	//if there is no throttle then instantiate a dummy throttle
 	//so down range code doesn't puke
 	if (!throttle) 
 	{ 
-		Logger::debug("getAccelerator() called but there is no registered accelerator!");
+		LOG_DEBUG("getAccelerator() called but there is no registered accelerator!");
 		return 0; //NULL!
 	}
 	return throttle;
 }
 
 Throttle *DeviceManager::getBrake() {
-
-	if (!brake) brake = (Throttle *)getDeviceByType(DEVICE_BRAKE);
+	if (!indexValid)
+		buildIndex();
 
 	if (!brake) 
 	{
-		//Logger::debug("getBrake() called but there is no registered brake!");
+		//LOG_DEBUG("getBrake() called but there is no registered brake!");
 		return 0; //NULL!		
 	}
 	return brake;
 }
 
 MotorController *DeviceManager::getMotorController() {
-	if (!motorController) motorController = (MotorController *)getDeviceByType(DEVICE_MOTORCTRL);
+	if (!indexValid)
+		buildIndex();
 
 	if (!motorController) 
 	{
-		Logger::debug("getMotorController() called but there is no registered motor controller!");
+		LOG_DEBUG("getMotorController() called but there is no registered motor controller!");
 		return 0; //NULL!
 	}
 	return motorController;
@@ -225,14 +294,10 @@ but sometimes you can't help it.
 */
 Device *DeviceManager::getDeviceByID(DeviceId id)
 {
-	for (int i = 0; i < CFG_DEV_MGR_MAX_DEVICES; i++)
-	{
-		if (devices[i]) 
-		{
-			if (devices[i]->getId() == id) return devices[i];
-		}
-	}
-	Logger::debug("getDeviceByID - No device with ID: %X", (int)id);
+	Device *device = findDeviceById(id);
+	if (device)
+		return device;
+	LOG_DEBUG("getDeviceByID - No device with ID: %X", (int)id);
 	return 0; //NULL!
 }
 
@@ -242,14 +307,11 @@ a given type.
 */
 Device *DeviceManager::getDeviceByType(DeviceType type)
 {
-	for (int i = 0; i < CFG_DEV_MGR_MAX_DEVICES; i++)
-	{
-		if (devices[i] && devices[i]->isEnabled()) 
-		{
-			if (devices[i]->getType() == type) return devices[i];
-		}
-	}
-	Logger::debug("getDeviceByType - No devices of type: %X", (int)type);
+	if (!indexValid)
+		buildIndex();
+	if (type < DEVICE_NONE && typeOffset[type] < typeOffset[type + 1])
+		return receivers[typeOffset[type]];
+	LOG_DEBUG("getDeviceByType - No devices of type: %X", (int)type);
 	return 0; //NULL!
 }
 
@@ -266,15 +328,14 @@ int8_t DeviceManager::findDevice(Device *device) {
 }
 
 /*
- * Count the number of registered devices of a certain type.
+ * Count the number of enabled devices of a certain type.
  */
 uint8_t DeviceManager::countDeviceType(DeviceType deviceType) {
-	uint8_t count = 0;
-	for (int i = 0; i < CFG_DEV_MGR_MAX_DEVICES; i++) {
-		if (devices[i]->getType() == deviceType)
-			count++;
-	}
-	return count;
+	if (!indexValid)
+		buildIndex();
+	if (deviceType > DEVICE_NONE)
+		return 0;
+	return typeOffset[deviceType + 1] - typeOffset[deviceType];
 }
 
 void DeviceManager::printDeviceList() {
@@ -294,38 +355,29 @@ void DeviceManager::printDeviceList() {
 }
 
 
+/*
+ * Load all parameters and the enable state of all devices (e.g. x1031 = 255 for enabled, 0 for disabled)
+ * to the web site of the ichip. The messages are sent synchronously as there are more devices than
+ * the MessageBus can queue.
+ */
 void DeviceManager::updateWifi() {
-  
-        sendMessage(DEVICE_WIFI, ICHIP2128, MSG_CONFIG_CHANGE, NULL);  //Load all our other parameters first
-        
-        char param [2][30];  //A two element array containing id and enable state
-        char *paramPtr[2] = { &param[0][0], &param[1][0] }; //A two element array of pointers, pointing to the addresses of row 1 and row 2 of array.
-                                                            //paramPtr[0] then contains address of param row 0 element 0
-                                                            //paramPtr[1] then contains address of param row 1 element 0.
-
-	
-        for (int i = 0; i < CFG_DEV_MGR_MAX_DEVICES; i++) { //Find all devices that are enabled and load into array
-		if (devices[i] && devices[i]->isEnabled()) 
-                  {                
-                    sprintf(paramPtr[0],"x%X",devices[i]->getId());
-                    sprintf(paramPtr[1],"255");
-                 //   Logger::console(" Device: %s value %s", paramPtr[0], paramPtr[1]);
-		
-                    sendMessage(DEVICE_WIFI, ICHIP2128, MSG_SET_PARAM,  paramPtr);	//Send the array to ichip by id (ie 1031)  255 indicates enabled
-                  }
-	    }
-
-	for (int i = 0; i < CFG_DEV_MGR_MAX_DEVICES; i++) {    //Find all devices that are NOT enabled and load into array
-		if (devices[i] && !devices[i]->isEnabled()) 
-                  {    
-                    sprintf(paramPtr[0],"x%X",devices[i]->getId());
-                    sprintf(paramPtr[1],"0");
-                  // Logger::console(" Device: %s value %s", paramPtr[0], paramPtr[1]);
-		    sendMessage(DEVICE_WIFI, ICHIP2128, MSG_SET_PARAM,  paramPtr);        //Send array to ichip by id (ie 1002) 0 indicates disabled     
-                  }
-	  }
-
-       
+	char key[CFG_MSG_BUS_KEY_LENGTH];
+
+	MessageBus::getInstance()->send(MSG_CONFIG_CHANGE, ICHIP2128);  //Load all our other parameters first
+
+	for (int i = 0; i < CFG_DEV_MGR_MAX_DEVICES; i++) { //all enabled devices
+		if (devices[i] && devices[i]->isEnabled()) {
+			snprintf(key, sizeof(key), "x%X", devices[i]->getId());
+			setParameter(ICHIP2128, key, 255);
+		}
+	}
+
+	for (int i = 0; i < CFG_DEV_MGR_MAX_DEVICES; i++) { //all disabled devices
+		if (devices[i] && !devices[i]->isEnabled()) {
+			snprintf(key, sizeof(key), "x%X", devices[i]->getId());
+			setParameter(ICHIP2128, key, 0);
+		}
+	}
 }
 
 
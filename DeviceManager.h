@@ -33,6 +33,7 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "Device.h"
 #include "Sys_Messages.h"
 #include "DeviceTypes.h"
+#include "MessageBus.h"
 
 class MotorController; // cyclic reference between MotorController and DeviceManager
 
@@ -44,8 +45,7 @@ public:
 //	void addTickObserver(TickObserver *observer, uint32_t frequency);
 //	void addCanObserver(CanObserver *observer, uint32_t id, uint32_t mask, bool extended, CanHandler::CanBusNode canBus);
 	void sendMessage(DeviceType deviceType, DeviceId deviceId, uint32_t msgType, void* message);
-	void setParameter(DeviceType deviceType, DeviceId deviceId, uint32_t msgType, char *key, char *value);
-	void setParameter(DeviceType deviceType, DeviceId deviceId, uint32_t msgType, char *key, uint32_t value);
+	void setParameter(DeviceId deviceId, const char *key, int32_t value);
 	uint8_t getNumThrottles();
 	uint8_t getNumControllers();
 	uint8_t getNumBMS();
@@ -57,6 +57,7 @@ public:
 	Device *getDeviceByID(DeviceId);
 	Device *getDeviceByType(DeviceType);
 	void printDeviceList();
+	void invalidateIndex();
         void updateWifi();
        Device *updateWifiByID(DeviceId);
 
@@ -71,8 +72,17 @@ private:
 	Throttle *brake;
 	MotorController *motorController;
 
+	// index of the devices, rebuilt on the next lookup after a device was added/removed/enabled/disabled
+	bool indexValid;
+	Device *receivers[CFG_DEV_MGR_MAX_DEVICES]; // the enabled devices, grouped by type
+	uint8_t typeOffset[DEVICE_NONE + 2]; // the receivers of type t are at typeOffset[t] to typeOffset[t + 1] - 1
+	Device *devicesById[CFG_DEV_MGR_MAX_DEVICES]; // all registered devices, sorted by id
+	uint8_t numDevices;
+
 	int8_t findDevice(Device *device);
 	uint8_t countDeviceType(DeviceType deviceType);
+	void buildIndex();
+	Device *findDeviceById(DeviceId id);
 };
 
 #endif
@@ -57,6 +57,18 @@ DmocMotorController::DmocMotorController() : MotorController() {
 	activityCount = 0;
 //	maxTorque = 2000;
 	commonName = "DMOC645 Inverter";
+
+	// the constant parts of the command frames are set only once, the variable fields are patched every tick
+	initFrame(frameCmd1, 0x232);
+	patchByte(frameCmd1, 5, ON); //key state
+	initFrame(frameCmd2, 0x233);
+	patchByte(frameCmd2, 4, 0x75); //msb standby torque. -3000 offset, 0.1 scale. These bytes give a standby of 0Nm
+	patchByte(frameCmd2, 5, 0x30); //lsb
+	initFrame(frameCmd3, 0x234);
+	patchByte(frameCmd3, 5, 60); //20 degrees celsius
+#ifdef CFG_DMOC_SIMULATION
+	simulator = NULL;
+#endif
 }
 
 void DmocMotorController::setup() {
@@ -67,6 +79,13 @@ void DmocMotorController::setup() {
 	loadConfiguration();
 	MotorController::setup(); // run the parent class version of this function
 
+#ifdef CFG_DMOC_SIMULATION
+	if (simulator == NULL)
+		simulator = new DmocSimulator(((DmocMotorControllerConfiguration *) getConfiguration())->nominalVolt);
+	lastSimulationStep = micros();
+	Logger::warn(DMOC645, "simulation mode - no commands are sent to the inverter");
+#endif
+
 	// register ourselves as observer of 0x23x and 0x65x can frames
 	CanHandler::getInstanceEV()->attach(this, 0x230, 0x7f0, false);
 	CanHandler::getInstanceEV()->attach(this, 0x650, 0x7f0, false);
@@ -92,8 +111,9 @@ void DmocMotorController::handleCanFrame(CAN_FRAME *frame) {
 	int RotorTemp, invTemp, StatorTemp;
 	int temp;
 	online = true; //if a frame got to here then it passed the filter and must have been from the DMOC
+	reportActivity();
       
-        Logger::debug("DMOC CAN received: %X  %X  %X  %X  %X  %X  %X  %X  %X", frame->id,frame->data.bytes[0] ,frame->data.bytes[1],frame->data.bytes[2],frame->data.bytes[3],frame->data.bytes[4],frame->data.bytes[5],frame->data.bytes[6],frame->data.bytes[70]);
+        LOG_DEBUG(DMOC645, "DMOC CAN received: %X  %X  %X  %X  %X  %X  %X  %X  %X", frame->id,frame->data.bytes[0] ,frame->data.bytes[1],frame->data.bytes[2],frame->data.bytes[3],frame->data.bytes[4],frame->data.bytes[5],frame->data.bytes[6],frame->data.bytes[7]);
   
   
 	switch (frame->id) {
@@ -164,7 +184,7 @@ void DmocMotorController::handleCanFrame(CAN_FRAME *frame) {
 			faulted=true;
 			break;
 		}
-      Logger::debug("OpState: %d", temp);
+      LOG_DEBUG(DMOC645, "OpState: %d", temp);
 		activityCount++;
 		break;
 		
@@ -194,7 +214,7 @@ void DmocMotorController::handleTick() {
 		if (activityCount > 40) //If we are receiving regular CAN messages from DMOC, this will very quickly get to over 40. We'll limit
 								// it to 60 so if we lose communications, within 20 ticks we will decrement below this value.
 	    {
-			Logger::debug("EnableIn=%i and ReverseIn = %i" ,getEnableIn(),getReverseIn());
+			LOG_DEBUG(DMOC645, "EnableIn=%i and ReverseIn = %i" ,getEnableIn(),getReverseIn());
 			if(getEnableIn()<0)setOpState(ENABLE); //If we HAVE an enableinput 0-3, we'll let that handle opstate. Otherwise set it to ENABLE
 			if(getReverseIn()<0)setSelectedGear(DRIVE); //If we HAVE a reverse input, we'll let that determine forward/reverse.  Otherwise set it to DRIVE			   
 		}
@@ -228,54 +248,44 @@ void DmocMotorController::handleTick() {
 //Commanded RPM plus state of key and gear selector
 void DmocMotorController::sendCmd1() {
 	DmocMotorControllerConfiguration *config = (DmocMotorControllerConfiguration *)getConfiguration();
-	CAN_FRAME output;
 	OperationState newstate;
 	alive = (alive + 2) & 0x0F;
-	output.length = 8;
-	output.id = 0x232;
-	output.extended = 0; //standard frame
-	output.rtr = 0;
 
 	if (throttleRequested > 0 && operationState == ENABLE && selectedGear != NEUTRAL && powerMode == modeSpeed)
 		speedRequested = 20000 + (((long) throttleRequested * (long) config->speedMax) / 1000);
 	else
 		speedRequested = 20000;
-	output.data.bytes[0] = (speedRequested & 0xFF00) >> 8;
-	output.data.bytes[1] = (speedRequested & 0x00FF);
-	output.data.bytes[2] = 0; //not used
-	output.data.bytes[3] = 0; //not used
-	output.data.bytes[4] = 0; //not used
-	output.data.bytes[5] = ON; //key state
-
-	//handle proper state transitions
-	newstate = DISABLED;
-	if (actualState == DISABLED && (operationState == STANDBY || operationState == ENABLE))
+	patchByte(frameCmd1, 0, (speedRequested & 0xFF00) >> 8);
+	patchByte(frameCmd1, 1, (speedRequested & 0x00FF));
+
+	//the state transitions are handled by the state machine in MotorController
+	switch (controllerState) {
+	case CS_STANDBY:
 		newstate = STANDBY;
-	if ((actualState == STANDBY || actualState == ENABLE) && operationState == ENABLE)
+		break;
+	case CS_ENABLED:
 		newstate = ENABLE;
-	if (operationState == POWERDOWN)
+		break;
+	case CS_POWERDOWN:
 		newstate = POWERDOWN;
+		break;
+	default:
+		newstate = DISABLED;
+	}
 
 	if (actualState == ENABLE) {
-		output.data.bytes[6] = alive + ((byte) selectedGear << 4) + ((byte) newstate << 6); //use new automatic state system.
+		patchByte(frameCmd1, 6, alive + ((byte) selectedGear << 4) + ((byte) newstate << 6)); //use new automatic state system.
 	}
 	else { //force neutral gear until the system is enabled.
-		output.data.bytes[6] = alive + ((byte) NEUTRAL << 4) + ((byte) newstate << 6); //use new automatic state system.
+		patchByte(frameCmd1, 6, alive + ((byte) NEUTRAL << 4) + ((byte) newstate << 6)); //use new automatic state system.
 	}
 
-	output.data.bytes[7] = calcChecksum(output);
-
-	CanHandler::getInstanceEV()->sendFrame(output);
+	sendFrame(frameCmd1);
 }
 
 //Torque limits
 void DmocMotorController::sendCmd2() {
 	DmocMotorControllerConfiguration *config = (DmocMotorControllerConfiguration *)getConfiguration();
-	CAN_FRAME output;
-	output.length = 8;
-	output.id = 0x233;
-	output.extended = 0; //standard frame
-	output.rtr = 0;
 	//30000 is the base point where torque = 0
 	//MaxTorque is in tenths like it should be.
 	//Requested throttle is [-1000, 1000]
@@ -287,74 +297,61 @@ void DmocMotorController::sendCmd2() {
     torqueRequested=0;
     if (actualState == ENABLE) { //don't even try sending torque commands until the DMOC reports it is ready
         if (selectedGear == DRIVE) {
-            torqueRequested = (((long) throttleRequested * (long) config->torqueMax) / 1000L);
+            torqueRequested = limitTorque(((long) throttleRequested * (long) config->torqueMax) / 1000L);
             if (speedActual < 200 && torqueRequested < 0) torqueRequested = 0;
         }
         if (selectedGear == REVERSE) {
-            torqueRequested = (((long) throttleRequested * -1 *(long) config->torqueMax) / 1000L);//If reversed, regen becomes positive torque and positive pedal becomes regen.  Let's reverse this by reversing the sign.  In this way, we'll have gradually diminishing positive torque (in reverse, regen) followed by gradually increasing regen (positive torque in reverse.)
+            torqueRequested = limitTorque(((long) throttleRequested * -1 *(long) config->torqueMax) / 1000L);//If reversed, regen becomes positive torque and positive pedal becomes regen.  Let's reverse this by reversing the sign.  In this way, we'll have gradually diminishing positive torque (in reverse, regen) followed by gradually increasing regen (positive torque in reverse.)
             if (speedActual < 200 && torqueRequested > 0) torqueRequested = 0;
         }
     }
 
     if (powerMode == modeTorque)
     {
-        if(speedActual < config->speedMax) {
-            torqueCommand+=torqueRequested;   //If actual rpm is less than max rpm, add torque to offset
-        }
-        else {
-            torqueCommand += torqueRequested /1.3;   // else torque is reduced
-        }
-        output.data.bytes[0] = (torqueCommand & 0xFF00) >> 8;
-        output.data.bytes[1] = (torqueCommand & 0x00FF);
-        output.data.bytes[2] = output.data.bytes[0];
-        output.data.bytes[3] = output.data.bytes[1];
+        torqueCommand += torqueRequested; //the envelope already reduced the torque towards max rpm
+        patchByte(frameCmd2, 0, (torqueCommand & 0xFF00) >> 8);
+        patchByte(frameCmd2, 1, (torqueCommand & 0x00FF));
+        patchByte(frameCmd2, 2, (torqueCommand & 0xFF00) >> 8);
+        patchByte(frameCmd2, 3, (torqueCommand & 0x00FF));
     }
     else //modeSpeed
     {
-        torqueCommand += config->torqueMax;
-        output.data.bytes[0] = (torqueCommand & 0xFF00) >> 8;
-        output.data.bytes[1] = (torqueCommand & 0x00FF);
-        output.data.bytes[2] = 0x75; //zero torque
-        output.data.bytes[3] = 0x30;
+        torqueCommand += torqueLimitMotor;
+        patchByte(frameCmd2, 0, (torqueCommand & 0xFF00) >> 8);
+        patchByte(frameCmd2, 1, (torqueCommand & 0x00FF));
+        patchByte(frameCmd2, 2, 0x75); //zero torque
+        patchByte(frameCmd2, 3, 0x30);
     }
 	
 	//what the hell is standby torque? Does it keep the transmission spinning for automatics? I don't know.
-	output.data.bytes[4] = 0x75; //msb standby torque. -3000 offset, 0.1 scale. These bytes give a standby of 0Nm
-	output.data.bytes[5] = 0x30; //lsb
-	output.data.bytes[6] = alive;
-	output.data.bytes[7] = calcChecksum(output);
+	//bytes 4 and 5 (standby torque) are constant and set in the constructor
+	patchByte(frameCmd2, 6, alive);
 
-    //Logger::debug("max torque: %i", maxTorque);
+    //LOG_DEBUG("max torque: %i", maxTorque);
         
-    //Logger::debug("requested torque: %i",(((long) throttleRequested * (long) maxTorque) / 1000L));
+    //LOG_DEBUG("requested torque: %i",(((long) throttleRequested * (long) maxTorque) / 1000L));
 
-	CanHandler::getInstanceEV()->sendFrame(output);
+	sendFrame(frameCmd2);
         timestamp();
-        Logger::debug("Torque command: MSB: %X  LSB: %X  %X  %X  %X  %X  %X  CRC: %X  %d:%d:%d.%d",output.data.bytes[0],
-output.data.bytes[1],output.data.bytes[2],output.data.bytes[3],output.data.bytes[4],output.data.bytes[5],output.data.bytes[6],output.data.bytes[7], hours, minutes, seconds, milliseconds);
+        LOG_DEBUG(DMOC645, "Torque command: MSB: %X  LSB: %X  %X  %X  %X  %X  %X  CRC: %X  %d:%d:%d.%d",frameCmd2.data.bytes[0],
+frameCmd2.data.bytes[1],frameCmd2.data.bytes[2],frameCmd2.data.bytes[3],frameCmd2.data.bytes[4],frameCmd2.data.bytes[5],frameCmd2.data.bytes[6],frameCmd2.data.bytes[7], hours, minutes, seconds, milliseconds);
  
 }
 
 //Power limits plus setting ambient temp and whether to cool power train or go into limp mode
 void DmocMotorController::sendCmd3() {
-	CAN_FRAME output;
-	output.length = 8;
-	output.id = 0x234;
-	output.extended = 0; //standard frame
-	output.rtr = 0;
+	DmocMotorControllerConfiguration *config = (DmocMotorControllerConfiguration *)getConfiguration();
 
-	int regenCalc = 65000 - (MaxRegenWatts / 4);
-	int accelCalc = (MaxAccelWatts / 4);
-	output.data.bytes[0] = ((regenCalc & 0xFF00) >> 8); //msb of regen watt limit
-	output.data.bytes[1] = (regenCalc & 0xFF); //lsb
-	output.data.bytes[2] = ((accelCalc & 0xFF00) >> 8); //msb of acceleration limit
-	output.data.bytes[3] = (accelCalc & 0xFF); //lsb
-	output.data.bytes[4] = 0; //not used
-	output.data.bytes[5] = 60; //20 degrees celsius
-	output.data.bytes[6] = alive;
-	output.data.bytes[7] = calcChecksum(output);
+	// power limits in 4W steps, 0.1kW from the configuration (0 = no limit -> the maximum the DMOC accepts)
+	int regenCalc = 65000 - (config->maxRegenPower > 0 ? min(config->maxRegenPower * 25, 65000) : 65000);
+	int accelCalc = (config->maxMotorPower > 0 ? min(config->maxMotorPower * 25, 65000) : 65000);
+	patchByte(frameCmd3, 0, ((regenCalc & 0xFF00) >> 8)); //msb of regen watt limit
+	patchByte(frameCmd3, 1, (regenCalc & 0xFF)); //lsb
+	patchByte(frameCmd3, 2, ((accelCalc & 0xFF00) >> 8)); //msb of acceleration limit
+	patchByte(frameCmd3, 3, (accelCalc & 0xFF)); //lsb
+	patchByte(frameCmd3, 6, alive);
 
-	CanHandler::getInstanceEV()->sendFrame(output);
+	sendFrame(frameCmd3);
 }
 
 //challenge/response frame 1 - Really doesn't contain anything we need I dont think
@@ -373,7 +370,7 @@ void DmocMotorController::sendCmd4() {
 	output.data.bytes[6] = alive;
 	output.data.bytes[7] = calcChecksum(output);
 
-	CanHandler::getInstanceEV()->sendFrame(output);
+	sendFrame(output);
 }
 
 //Another C/R frame but this one also specifies which shifter position we're in
@@ -400,7 +397,7 @@ void DmocMotorController::sendCmd5() {
 	output.data.bytes[6] = alive;
 	output.data.bytes[7] = calcChecksum(output);
 
-	CanHandler::getInstanceEV()->sendFrame(output);
+	sendFrame(output);
 }
 
 
@@ -417,7 +414,7 @@ void DmocMotorController::setGear(Gears gear) {
 
 //this might look stupid. You might not believe this is real. It is. This is how you
 //calculate the checksum for the DMOC frames.
-byte DmocMotorController::calcChecksum(CAN_FRAME thisFrame) {
+byte DmocMotorController::calcChecksum(CAN_FRAME &thisFrame) {
 	byte cs;
 	byte i;
 	cs = thisFrame.id;
@@ -428,10 +425,99 @@ byte DmocMotorController::calcChecksum(CAN_FRAME thisFrame) {
 	return cs;
 }
 
+/*
+ * Prepare a command frame template with all data bytes zero and a valid checksum.
+ */
+void DmocMotorController::initFrame(CAN_FRAME &frame, uint32_t id) {
+	frame.length = 8;
+	frame.id = id;
+	frame.extended = 0; //standard frame
+	frame.rtr = 0;
+	for (int i = 0; i < 8; i++)
+		frame.data.bytes[i] = 0;
+	frame.data.bytes[7] = calcChecksum(frame);
+}
+
+/*
+ * Change one data byte of a command frame template. As the checksum is the
+ * negated sum of all bytes, it is updated with the difference between the old
+ * and the new value instead of summing up the whole frame again.
+ */
+void DmocMotorController::patchByte(CAN_FRAME &frame, uint8_t index, uint8_t value) {
+	frame.data.bytes[7] += frame.data.bytes[index] - value;
+	frame.data.bytes[index] = value;
+}
+
 DeviceId DmocMotorController::getId() {
 	return (DMOC645);
 }
 
+/*
+ * Send a command frame to the DMOC, or to the simulated DMOC if CFG_DMOC_SIMULATION is defined
+ */
+void DmocMotorController::sendFrame(CAN_FRAME &frame) {
+#ifdef CFG_DMOC_SIMULATION
+	if (simulator != NULL)
+		simulateFrame(frame);
+#else
+	CanHandler::getInstanceEV()->sendFrame(frame);
+#endif
+}
+
+#ifdef CFG_DMOC_SIMULATION
+/*
+ * Hand a command frame to the simulated DMOC. A 0x232 frame starts a new cycle: the
+ * simulator is advanced by the time since the last one and its status frames are
+ * processed as if they were received from the CAN bus.
+ */
+void DmocMotorController::simulateFrame(CAN_FRAME &frame) {
+	DmocSimFrame command, status[DMOC_SIM_STATUS_FRAMES];
+	CAN_FRAME reply;
+
+	if (frame.id == 0x232) {
+		uint32_t now = micros();
+		simulator->step(now - lastSimulationStep);
+		lastSimulationStep = now;
+
+		uint8_t count = simulator->getStatus(status);
+		memset(&reply, 0, sizeof(reply));
+		for (int i = 0; i < count; i++) {
+			reply.id = status[i].id;
+			reply.length = status[i].length;
+			memcpy(reply.data.bytes, status[i].data, 8);
+			handleCanFrame(&reply);
+		}
+	}
+
+	command.id = frame.id;
+	command.length = frame.length;
+	memcpy(command.data, frame.data.bytes, 8);
+	if (!simulator->processFrame(&command))
+		LOG_DEBUG(DMOC645, "DMOC simulator: rejected frame %X", frame.id);
+}
+#endif
+
+void DmocMotorController::printSimulatorStatistics() {
+#ifdef CFG_DMOC_SIMULATION
+	if (simulator != NULL) {
+		Logger::console("DMOC simulator: state %d, frames %l, rejected %l, max command interval %lms, %l command timeouts",
+				simulator->getState(), simulator->getFramesReceived(), simulator->getFramesRejected(),
+				simulator->getMaxCommandInterval(), simulator->getCommandTimeouts());
+		Logger::console("torque %dNm, speed %drpm, voltage %dV, current %dA, temperature %dC", simulator->getTorque() / 10,
+				simulator->getSpeed(), simulator->getVoltage() / 10, simulator->getCurrent() / 10, simulator->getTemperature());
+	}
+#else
+	Logger::console("DMOC simulation is not enabled (CFG_DMOC_SIMULATION)");
+#endif
+}
+
+/*
+ * The DMOC accepts the enable command once it reports to be in standby (or enabled)
+ */
+bool DmocMotorController::isControllerReady() {
+	return actualState == STANDBY || actualState == ENABLE;
+}
+
 uint32_t DmocMotorController::getTickInterval() 
 {
 	return CFG_TICK_INTERVAL_MOTOR_CONTROLLER_DMOC;
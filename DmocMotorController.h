@@ -35,6 +35,7 @@
 #include "sys_io.h"
 #include "TickHandler.h"
 #include "CanHandler.h"
+#include "DmocSimulator.h"
 
 /*
  * Class for DMOC specific configuration parameters
@@ -72,6 +73,12 @@ public:
 
 	virtual void loadConfiguration();
 	virtual void saveConfiguration();
+	void printSimulatorStatistics();
+
+protected:
+	byte calcChecksum(CAN_FRAME &thisFrame);
+	void initFrame(CAN_FRAME &frame, uint32_t id);
+	void patchByte(CAN_FRAME &frame, uint8_t index, uint8_t value);
 
 private:
 	
@@ -88,7 +95,17 @@ private:
 	void sendCmd3();
 	void sendCmd4();
 	void sendCmd5();
-	byte calcChecksum(CAN_FRAME thisFrame);
+	CAN_FRAME frameCmd1; // command frame templates, only the variable bytes are patched
+	CAN_FRAME frameCmd2;
+	CAN_FRAME frameCmd3;
+
+	bool isControllerReady();
+	void sendFrame(CAN_FRAME &frame);
+#ifdef CFG_DMOC_SIMULATION
+	DmocSimulator *simulator;
+	uint32_t lastSimulationStep; // micros() when the simulator was advanced the last time
+	void simulateFrame(CAN_FRAME &frame);
+#endif
 
 };
 
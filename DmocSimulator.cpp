@@ -0,0 +1,337 @@
+/*
+ * DmocSimulator.cpp
+ *
+ * Plant model of a DMOC645 inverter with motor and battery. It receives the command
+ * frames (0x232, 0x233, 0x234) of the DmocMotorController instead of the CAN bus,
+ * validates alive counter and checksum, simulates the operation state, torque, speed,
+ * HV bus and temperature and answers with the status frames (0x23A, 0x23B, 0x650, 0x651)
+ * which are fed directly into the driver's handleCanFrame().
+ *
+ * The model is deliberately simple (first order torque response, constant inertia and
+ * drag, internal resistance of the battery) but good enough to exercise the driver,
+ * the state machine and the dashboard on the bench.
+ *
+ Copyright (c) 2013 Collin Kidder, Michael Neuweiler, Charles Galpin
+
+ Permission is hereby granted, free of charge, to any person obtaining
+ a copy of this software and associated documentation files (the
+ "Software"), to deal in the Software without restriction, including
+ without limitation the rights to use, copy, modify, merge, publish,
+ distribute, sublicense, and/or sell copies of the Software, and to
+ permit persons to whom the Software is furnished to do so, subject to
+ the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+ */
+
+#include "DmocSimulator.h"
+#include <string.h>
+
+#define SIM_INIT_TIME		1000 // ms the inverter needs to initialize
+#define SIM_STANDBY_TIME	200 // ms to get from disabled to standby
+#define SIM_ENABLE_TIME		100 // ms to get from standby to enabled
+#define SIM_COMMAND_TIMEOUT	500 // ms without command after which the inverter disables itself
+#define SIM_TORQUE_TAU		20000 // time constant of the torque response in microseconds
+#define SIM_ACCELERATION	8 // rpm/s per Nm of torque (inertia of the vehicle)
+#define SIM_DRAG_TIME		8 // s, time constant of the speed decay due to drag
+#define SIM_RESISTANCE		10 // internal resistance of the battery in 0.01 Ohm
+#define SIM_EFFICIENCY		90 // efficiency of motor and inverter in percent
+#define SIM_AMBIENT		25 // deg C
+#define SIM_FAULT_TEMP		100 // inverter temperature (deg C) causing a fault
+#define SIM_MAX_DT		100000 // max time step of the model in microseconds, longer steps are split up
+
+DmocSimulator::DmocSimulator(uint16_t voltage) {
+	state = INITIALIZING;
+	requestedState = 0;
+	gear = 0;
+	lastAlive = 0xff;
+	torqueCommand = 0;
+	accelPower = 0;
+	regenPower = 0;
+	torque = 0;
+	speed = 0;
+	temperature = (int32_t) SIM_AMBIENT << 8;
+	openCircuitVoltage = voltage;
+	this->voltage = voltage;
+	current = 0;
+	now = 0;
+	nowMicros = 0;
+	stateTimestamp = 0;
+	lastCommand = 0;
+	commanded = false;
+	framesReceived = 0;
+	framesRejected = 0;
+	maxCommandInterval = 0;
+	commandTimeouts = 0;
+}
+
+/*
+ * Receive a command frame of the driver. The commands take effect with the next
+ * step() like the inverter samples them in its control cycle. Returns false if
+ * the frame was rejected (wrong checksum or alive counter).
+ */
+bool DmocSimulator::processFrame(const DmocSimFrame *frame) {
+	uint32_t interval;
+
+	framesReceived++;
+	if (!validate(frame)) {
+		framesRejected++;
+		return false;
+	}
+
+	switch (frame->id) {
+	case 0x232:
+		if (commanded) {
+			interval = now - lastCommand;
+			if (interval > maxCommandInterval)
+				maxCommandInterval = interval;
+		}
+		lastCommand = now;
+		commanded = true;
+		lastAlive = frame->data[6] & 0x0F;
+		gear = (frame->data[6] >> 4) & 0x03;
+		requestedState = frame->data[6] >> 6;
+		break;
+	case 0x233:
+		torqueCommand = ((frame->data[0] << 8) | frame->data[1]) - 30000;
+		break;
+	case 0x234:
+		regenPower = (65000 - ((frame->data[0] << 8) | frame->data[1])) * 4;
+		accelPower = ((frame->data[2] << 8) | frame->data[3]) * 4;
+		break;
+	}
+	return true;
+}
+
+/*
+ * Check the checksum and the alive counter: it must change with every 0x232 frame,
+ * the other frames of a cycle carry the same value.
+ */
+bool DmocSimulator::validate(const DmocSimFrame *frame) {
+	uint8_t alive = frame->data[6] & 0x0F;
+
+	if (frame->length != 8 || frame->data[7] != calcChecksum(frame))
+		return false;
+	if (frame->id == 0x232)
+		return alive != lastAlive;
+	return alive == lastAlive;
+}
+
+/*
+ * The same algorithm as the DMOC uses, implemented independently of the driver.
+ */
+uint8_t DmocSimulator::calcChecksum(const DmocSimFrame *frame) {
+	uint8_t cs = frame->id;
+
+	for (int i = 0; i < 7; i++)
+		cs += frame->data[i];
+	return (uint8_t) (256 - (uint8_t) (cs + 3));
+}
+
+void DmocSimulator::setState(SimState newState) {
+	if (state == newState)
+		return;
+	state = newState;
+	stateTimestamp = now;
+}
+
+/*
+ * Let the given time pass in the model, the caller decides where the time comes
+ * from (micros() in the firmware, the time stamps of a recording on a PC).
+ */
+void DmocSimulator::step(uint32_t dtMicros) {
+	while (dtMicros > SIM_MAX_DT) {
+		advance(SIM_MAX_DT);
+		dtMicros -= SIM_MAX_DT;
+	}
+	advance(dtMicros);
+}
+
+/*
+ * Advance the model by dt microseconds (at most SIM_MAX_DT).
+ */
+void DmocSimulator::advance(uint32_t dt) {
+	int32_t target = 0, rpm, power;
+	uint8_t request = requestedState;
+
+	nowMicros += dt;
+	now += nowMicros / 1000;
+	nowMicros %= 1000;
+
+	// without commands the inverter disables itself
+	if (!commanded || now - lastCommand > SIM_COMMAND_TIMEOUT) {
+		if (commanded && state == ENABLED)
+			commandTimeouts++;
+		request = 0;
+	}
+
+	// operation state
+	switch (state) {
+	case INITIALIZING:
+		if (now - stateTimestamp > SIM_INIT_TIME)
+			setState(DISABLED);
+		break;
+	case DISABLED:
+		if (request == 3)
+			setState(POWERDOWN);
+		else if (request > 0 && now - stateTimestamp > SIM_STANDBY_TIME)
+			setState(STANDBY);
+		break;
+	case STANDBY:
+		if (request == 0)
+			setState(DISABLED);
+		else if (request == 3)
+			setState(POWERDOWN);
+		else if (request == 2 && now - stateTimestamp > SIM_ENABLE_TIME)
+			setState(ENABLED);
+		break;
+	case ENABLED:
+		if (request != 2)
+			setState(request == 3 ? POWERDOWN : (request == 1 ? STANDBY : DISABLED));
+		break;
+	case POWERDOWN:
+		if (request != 3)
+			setState(DISABLED);
+		break;
+	case FAULT:
+		if (request == 0 && (temperature >> 8) < SIM_FAULT_TEMP - 20)
+			setState(DISABLED);
+		break;
+	}
+	if (state != FAULT && (temperature >> 8) > SIM_FAULT_TEMP)
+		setState(FAULT);
+
+	// torque, limited by the power limits of 0x234
+	rpm = speed >> 8;
+	if (rpm < 0)
+		rpm = -rpm;
+	if (state == ENABLED && gear != 0) {
+		target = torqueCommand;
+		power = ((target > 0) == (speed >= 0) ? accelPower : regenPower);
+		if (rpm > 100 && power > 0) {
+			int32_t limit = (int64_t) power * 95493 / (rpm * 1000); // 0.1Nm
+			if (target > limit)
+				target = limit;
+			else if (target < -limit)
+				target = -limit;
+		}
+	}
+	torque += ((int64_t) ((target << 8) - torque) * dt) / (dt + SIM_TORQUE_TAU);
+
+	// speed with inertia and drag
+	speed += ((int64_t) torque * SIM_ACCELERATION / 10 - speed / SIM_DRAG_TIME) * dt / 1000000;
+
+	// electrical power, battery current and voltage
+	power = (int64_t) (torque >> 8) * (speed >> 8) * 10472 / 1000000; // mechanical power in W (2 * PI / 60 / 10)
+	power = (power > 0 ? power * 100 / SIM_EFFICIENCY : power * SIM_EFFICIENCY / 100);
+	current = (voltage > 0 ? power * 100 / voltage : 0);
+	voltage = openCircuitVoltage - current * SIM_RESISTANCE / 100;
+
+	// inverter temperature: heating with the square of the current, cooling towards ambient
+	temperature += ((int64_t) current * current * 256 / 4000000 - (temperature - (SIM_AMBIENT << 8)) / 60) * (int64_t) dt / 1000000;
+}
+
+/*
+ * Write the status frames the inverter sends in every cycle (0x23A, 0x23B, 0x650,
+ * 0x651) into frames (DMOC_SIM_STATUS_FRAMES entries). Returns the number of frames.
+ */
+uint8_t DmocSimulator::getStatus(DmocSimFrame *frames) {
+	uint16_t value;
+	int32_t temp = (temperature >> 8) + 40;
+
+	temp = (temp < 0 ? 0 : (temp > 255 ? 255 : temp));
+	for (int i = 0; i < DMOC_SIM_STATUS_FRAMES; i++) {
+		frames[i].length = 8;
+		memset(frames[i].data, 0, 8);
+	}
+
+	frames[0].id = 0x23A; // torque report
+	value = (torque >> 8) + 30000;
+	frames[0].data[0] = value >> 8;
+	frames[0].data[1] = value & 0xFF;
+
+	frames[1].id = 0x23B; // speed and operation status
+	value = (speed >> 8) + 20000;
+	frames[1].data[0] = value >> 8;
+	frames[1].data[1] = value & 0xFF;
+	frames[1].data[6] = state << 4;
+
+	frames[2].id = 0x650; // HV bus status
+	frames[2].data[0] = voltage >> 8;
+	frames[2].data[1] = voltage & 0xFF;
+	value = current + 5000;
+	frames[2].data[2] = value >> 8;
+	frames[2].data[3] = value & 0xFF;
+
+	frames[3].id = 0x651; // temperatures (rotor, inverter, stator)
+	frames[3].data[0] = temp;
+	frames[3].data[1] = temp;
+	frames[3].data[2] = temp;
+
+	return DMOC_SIM_STATUS_FRAMES;
+}
+
+DmocSimulator::SimState DmocSimulator::getState() {
+	return state;
+}
+
+/*
+ * Actual torque in 0.1Nm
+ */
+int16_t DmocSimulator::getTorque() {
+	return torque >> 8;
+}
+
+/*
+ * Actual speed in rpm
+ */
+int16_t DmocSimulator::getSpeed() {
+	return speed >> 8;
+}
+
+/*
+ * Pack voltage in 0.1V
+ */
+uint16_t DmocSimulator::getVoltage() {
+	return voltage;
+}
+
+/*
+ * Pack current in 0.1A, positive = discharging
+ */
+int16_t DmocSimulator::getCurrent() {
+	return current;
+}
+
+/*
+ * Inverter temperature in deg C
+ */
+int16_t DmocSimulator::getTemperature() {
+	return temperature >> 8;
+}
+
+uint32_t DmocSimulator::getFramesReceived() {
+	return framesReceived;
+}
+
+uint32_t DmocSimulator::getFramesRejected() {
+	return framesRejected;
+}
+
+uint32_t DmocSimulator::getMaxCommandInterval() {
+	return maxCommandInterval;
+}
+
+uint32_t DmocSimulator::getCommandTimeouts() {
+	return commandTimeouts;
+}
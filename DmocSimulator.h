@@ -0,0 +1,106 @@
+/*
+ * DmocSimulator.h
+ *
+ * Plant model of a DMOC645 inverter with motor and battery for bench testing the
+ * DmocMotorController without an inverter (see CFG_DMOC_SIMULATION in config.h).
+ *
+ * The model doesn't use the Arduino core or the CAN library: the frames are passed
+ * as DmocSimFrame and the time only advances with step(). So the same code runs in
+ * the firmware and on a PC (see util/dmocsim, which replays recorded command frames).
+ *
+ Copyright (c) 2013 Collin Kidder, Michael Neuweiler, Charles Galpin
+
+ Permission is hereby granted, free of charge, to any person obtaining
+ a copy of this software and associated documentation files (the
+ "Software"), to deal in the Software without restriction, including
+ without limitation the rights to use, copy, modify, merge, publish,
+ distribute, sublicense, and/or sell copies of the Software, and to
+ permit persons to whom the Software is furnished to do so, subject to
+ the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+ */
+
+#ifndef DMOCSIMULATOR_H_
+#define DMOCSIMULATOR_H_
+
+#include <stdint.h>
+
+#define DMOC_SIM_STATUS_FRAMES 4 // number of frames written by getStatus()
+
+/*
+ * A CAN frame as the simulator sees it, independent of the CAN library
+ */
+struct DmocSimFrame {
+	uint32_t id;
+	uint8_t length;
+	uint8_t data[8];
+};
+
+class DmocSimulator {
+public:
+	// operation states as reported in frame 0x23B
+	enum SimState {
+		INITIALIZING = 0,
+		DISABLED = 1,
+		STANDBY = 2,
+		ENABLED = 3,
+		POWERDOWN = 4,
+		FAULT = 5
+	};
+
+	DmocSimulator(uint16_t voltage);
+	bool processFrame(const DmocSimFrame *frame);
+	void step(uint32_t dtMicros);
+	uint8_t getStatus(DmocSimFrame *frames);
+
+	SimState getState();
+	int16_t getTorque();
+	int16_t getSpeed();
+	uint16_t getVoltage();
+	int16_t getCurrent();
+	int16_t getTemperature();
+	uint32_t getFramesReceived();
+	uint32_t getFramesRejected();
+	uint32_t getMaxCommandInterval();
+	uint32_t getCommandTimeouts();
+
+private:
+	void advance(uint32_t dt);
+	bool validate(const DmocSimFrame *frame);
+	uint8_t calcChecksum(const DmocSimFrame *frame);
+	void setState(SimState newState);
+
+	SimState state;
+	uint8_t requestedState; // state requested in 0x232 (0=disabled, 1=standby, 2=enable, 3=powerdown)
+	uint8_t gear; // gear requested in 0x232 (0=neutral, 1=drive, 2=reverse)
+	uint8_t lastAlive; // alive counter of the last 0x232 frame
+	int16_t torqueCommand; // torque requested in 0x233 (0.1Nm)
+	uint32_t accelPower, regenPower; // power limits from 0x234 (W)
+	int32_t torque; // actual torque in 1/256 * 0.1Nm
+	int32_t speed; // actual speed in 1/256 rpm
+	int32_t temperature; // inverter temperature in 1/256 deg C
+	uint16_t openCircuitVoltage; // pack voltage without load (0.1V)
+	uint16_t voltage; // pack voltage (0.1V)
+	int16_t current; // pack current (0.1A, positive = discharging)
+	uint32_t now; // simulated time in ms since the start
+	uint32_t nowMicros; // microseconds of the simulated time which don't make up a full ms yet
+	uint32_t stateTimestamp; // time when the current state was entered (ms)
+	uint32_t lastCommand; // time of the last valid 0x232 frame (ms)
+	bool commanded; // a valid 0x232 frame was received
+	uint32_t framesReceived, framesRejected; // statistics
+	uint32_t maxCommandInterval; // longest time between two 0x232 frames in ms (the DMOC expects at least two per second)
+	uint32_t commandTimeouts; // how often the inverter disabled itself because the commands stopped
+};
+
+#endif /* DMOCSIMULATOR_H_ */
@@ -72,30 +72,36 @@ String ELM327Processor::processELMCmd(char *cmd) {
 	else { //if no AT then assume it is a PID request. This takes the form of four bytes which form the alpha hex digit encoding for two bytes
 		//there should be four or six characters here forming the ascii representation of the PID request. Easiest for now is to turn the ascii into
 		//a 16 bit number and mask off to get the bytes
-		if (strlen(cmd) == 4) {
+		size_t length = strlen(cmd);
+		if (length == 4 || length == 2 || length == 6) { //two characters for requests without PID like mode 3, six for mode 2 with frame number
 			uint32_t valu = strtol((char *) cmd, NULL, 16); //the pid format is always in hex
+			char frameNumber = 0;
+			if (length == 2) valu <<= 8;
+			if (length == 6) {
+				frameNumber = (char)(valu & 0xFF);
+				valu >>= 8;
+			}
 			uint8_t pidnum = (uint8_t)(valu & 0xFF);
 			uint8_t mode = (uint8_t)((valu >> 8) & 0xFF);
-			Logger::debug(ELM327EMU, "Mode: %i, PID: %i", mode, pidnum);
-			char out[7];
+			LOG_DEBUG(ELM327EMU, "Mode: %i, PID: %i", mode, pidnum);
+			char out[8];
 			char buff[10];
-			if (obd2Handler->processRequest(mode, pidnum, NULL, out)) {
+			if (obd2Handler->processRequest(mode, pidnum, (length == 6 ? &frameNumber : NULL), out)) {
 				if (bHeader) {
 					retString.concat("7E8");
 					out[0] += 2; //not sending only data bits but mode and pid too
 					for (int i = 0; i <= out[0]; i++) {
-						sprintf(buff, "%02X", out[i]);
+						sprintf(buff, "%02X", (uint8_t) out[i]);
 						retString.concat(buff);
 					}
 				}
 				else {
-					mode += 0x40;
-					sprintf(buff, "%02X", mode);
+					sprintf(buff, "%02X", (uint8_t) out[1]); //response mode
 					retString.concat(buff);
-					sprintf(buff, "%02X", pidnum);
+					sprintf(buff, "%02X", (uint8_t) out[2]); //pid (or # of DTCs for mode 3)
 					retString.concat(buff);
 					for (int i = 1; i <= out[0]; i++) {
-						sprintf(buff, "%02X", out[i+2]);
+						sprintf(buff, "%02X", (uint8_t) out[i+2]);
 						retString.concat(buff);
 					}
 				}
@@ -76,6 +76,7 @@ void ELM327Emu::setup() {
 	//this isn't a wifi link but the timer interval can be the same
 	//because it serves a similar function and has similar timing requirements
 	TickHandler::getInstance()->attach(this, CFG_TICK_INTERVAL_WIFI);
+	LoopHandler::getInstance()->attach(this, LOOP_PRIORITY_NORMAL, CFG_LOOP_BUDGET_ELM327, "ELM327");
 }
 
 /*
@@ -85,7 +86,7 @@ void ELM327Emu::sendCmd(String cmd) {
 	serialInterface->write("AT");
 	serialInterface->print(cmd);
 	serialInterface->write(13);
-	loop(); // parse the response
+	handleLoop(); // parse the response
 }
 
 /*
@@ -120,7 +121,7 @@ void ELM327Emu::handleMessage(uint32_t messageType, void* message) {
  * But, for now just echo stuff to our serial port for debugging
  */
 
-void ELM327Emu::loop() {
+void ELM327Emu::handleLoop() {
 	int incoming;
 	while (serialInterface->available()) {
 		incoming = serialInterface->read();
@@ -130,7 +131,7 @@ void ELM327Emu::loop() {
 				ibWritePtr = 0; //reset the write pointer
 				
 				if (Logger::isDebug())
-					Logger::debug(ELM327EMU, incomingBuffer);
+					LOG_DEBUG(ELM327EMU, "%s", incomingBuffer);
 				processCmd();
 					
 			} else { // add more characters
@@ -153,7 +154,7 @@ void ELM327Emu::processCmd() {
 	if (Logger::isDebug()) {
 		char buff[30];
 		retString.toCharArray(buff, 30);
-		Logger::debug(ELM327EMU, buff);
+		LOG_DEBUG(ELM327EMU, "%s", buff);
 	}
 	
 }
@@ -170,7 +171,7 @@ void ELM327Emu::loadConfiguration() {
 	ELM327Configuration *config = (ELM327Configuration *)getConfiguration();
 
 	if (prefsHandler->checksumValid()) { //checksum is good, read in the values stored in EEPROM
-		Logger::debug(ELM327EMU, "Valid checksum so using stored elm327 emulator config values");
+		LOG_DEBUG(ELM327EMU, "Valid checksum so using stored elm327 emulator config values");
 		//TODO: implement processing of config params for WIFI
 //		prefsHandler->read(EESYS_WIFI0_SSID, &config->ssid);
 	}
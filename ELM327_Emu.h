@@ -57,6 +57,7 @@ AT RV (adapter voltage) - Send something like 14.4V
 #include "Sys_Messages.h"
 #include "DeviceTypes.h"
 #include "ELM327Processor.h"
+#include "LoopHandler.h"
 
 extern PrefHandler *sysPrefs;
 
@@ -67,7 +68,7 @@ class ELM327Configuration : public DeviceConfiguration {
 public:
 };
 
-class ELM327Emu : public Device {
+class ELM327Emu : public Device, LoopObserver {
     public:
     
     ELM327Emu();
@@ -77,7 +78,7 @@ class ELM327Emu : public Device {
     void handleMessage(uint32_t messageType, void* message);
 	DeviceType getType();
     DeviceId getId();
-    void loop();
+    void handleLoop();
 	void sendCmd(String cmd);
 
 	void loadConfiguration();
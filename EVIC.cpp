@@ -71,10 +71,7 @@ void EVIC::setup() {
         
       tickCounter = 0;
        testMode=0;
-       AHf=AH;
        SOC=0;
-       SOCf=0.001;
-       milliAH=0.00;
        DCV=0;
        DCA=0;
        TEMPM=0;
@@ -82,7 +79,7 @@ void EVIC::setup() {
        CellHi=63;
        Cello=60;
       
-       elapsedtime=timemark = timemark2=millis();
+       timemark=millis();
 	rpm=0;  //Increment all our test variables each time
         
 	TickHandler::getInstance()->attach(this, CFG_TICK_INTERVAL_EVIC);
@@ -94,7 +91,7 @@ void EVIC::setup() {
 void EVIC::handleCanFrame(CAN_FRAME *frame) 
 {
 	
-        Logger::debug("EVIC received msg: %X   %X   %X   %X   %X   %X   %X   %X  %X", frame->id, frame->data.bytes[0],
+        LOG_DEBUG("EVIC received msg: %X   %X   %X   %X   %X   %X   %X   %X  %X", frame->id, frame->data.bytes[0],
         frame->data.bytes[1],frame->data.bytes[2],frame->data.bytes[3],frame->data.bytes[4],
         frame->data.bytes[5],frame->data.bytes[6],frame->data.bytes[7]);
         
@@ -111,7 +108,7 @@ void EVIC::handleCanFrame(CAN_FRAME *frame)
               SOC=frame->data.bytes[7];
             
              
-    Logger::debug("JLD404 DC Voltage: %d Amps: %d AH: %d Capacity: %d SOC: %d", dcVoltage,dcCurrent,AH,capacity,SOC);
+    LOG_DEBUG("JLD404 DC Voltage: %d Amps: %d AH: %d Capacity: %d SOC: %d", dcVoltage,dcCurrent,AH,capacity,SOC);
 	      timemark=millis();  //We'll use this to indicate how long since we received from a 505.
           break;
 
@@ -135,7 +132,7 @@ void EVIC::handleCanFrame(CAN_FRAME *frame)
          
              
             
-     Logger::debug("JLD505 Message Received Power output: %d kiloWatt-Hours: %d ", Power/10,kWh/10);
+     LOG_DEBUG("JLD505 Message Received Power output: %d kiloWatt-Hours: %d ", Power/10,kWh/10);
              timemark=millis();
           break;
 	}
@@ -199,7 +196,7 @@ void EVIC::sendTestCmdCurtis()
       
       timestamp();
 
-      Logger::debug("EVIC Message: %X  %X %X %X %X %X %X %X %X  %d:%d:%d.%d",output.id, output.data.bytes[0],
+      LOG_DEBUG("EVIC Message: %X  %X %X %X %X %X %X %X %X  %d:%d:%d.%d",output.id, output.data.bytes[0],
 output.data.bytes[1],output.data.bytes[2],output.data.bytes[3],output.data.bytes[4],output.data.bytes[5],output.data.bytes[6],output.data.bytes[7], hours, minutes, seconds, milliseconds);
           
 }
@@ -225,7 +222,7 @@ output.fid=0;
 	CanHandler::getInstanceCar()->sendFrame(output);  //Mail it.
         timestamp();
 
-        Logger::debug("Orion Message1: %X  %X %X %X %X %X %X %X %X  %d:%d:%d.%d",output.id, output.data.bytes[0],
+        LOG_DEBUG("Orion Message1: %X  %X %X %X %X %X %X %X %X  %d:%d:%d.%d",output.id, output.data.bytes[0],
 output.data.bytes[1],output.data.bytes[2],output.data.bytes[3],output.data.bytes[4],output.data.bytes[5],output.data.bytes[6],output.data.bytes[7], hours, minutes, seconds, milliseconds);
 
 	//CAN_FRAME output;
@@ -246,7 +243,7 @@ output.data.bytes[1],output.data.bytes[2],output.data.bytes[3],output.data.bytes
     CanHandler::getInstanceCar()->sendFrame(output);  //Mail it.
     timestamp();
 
-    Logger::debug("Orion Message2: %X  %X %X %X %X %X %X %X %X  %d:%d:%d.%d",output.id, output.data.bytes[0],
+    LOG_DEBUG("Orion Message2: %X  %X %X %X %X %X %X %X %X  %d:%d:%d.%d",output.id, output.data.bytes[0],
 output.data.bytes[1],output.data.bytes[2],output.data.bytes[3],output.data.bytes[4],output.data.bytes[5],output.data.bytes[6],output.data.bytes[7], hours, minutes, seconds, milliseconds);
           
 }
@@ -279,15 +276,13 @@ void EVIC::sendCmdCurtis()
             
       CanHandler::getInstanceCar()->sendFrame(output);  //Mail it. 
       timestamp();
-      Logger::debug("EVIC Message: %X  %X %X %X %X %X %X %X %X  %d:%d:%d.%d",output.id, output.data.bytes[0],
+      LOG_DEBUG("EVIC Message: %X  %X %X %X %X %X %X %X %X  %d:%d:%d.%d",output.id, output.data.bytes[0],
 output.data.bytes[1],output.data.bytes[2],output.data.bytes[3],output.data.bytes[4],output.data.bytes[5],output.data.bytes[6],output.data.bytes[7], hours, minutes, seconds, milliseconds);
           
 }
 
 void EVIC::sendCmdOrion() 
 {
-    elapsedtime = (millis() - timemark2);  
-    timemark2=millis();
     
   if(millis()-timemark>2000) // Checks to see how long its been since JLD505 message was received.  
   //If more than 2 seconds, we'll use MotorController values and calculate what we need.
@@ -297,25 +292,14 @@ void EVIC::sendCmdOrion()
       dcVoltage=(motorController->getDcVoltage());
         
           //dcVoltage=3320; //Test value
-          Logger::debug("DC Voltage: %i Nominal Voltage: %i  Capacity: %i",dcVoltage/10,nominalVolt/10,capacity);
+          LOG_DEBUG("DC Voltage: %i Nominal Voltage: %i  Capacity: %i",dcVoltage/10,nominalVolt/10,capacity);
  
-      if(!(dcVoltage<nominalVolt))
-        {
-          AHf=0.0; //If our reported voltage exceeds nominalVolt value, reset our amp hours to zero
-          saveConfiguration();
-        }  
-         
-         //dcCurrent=500;         //Test value
-            
-   Logger::debug("ElapsedTimeE: %d current %d",elapsedtime,(dcCurrent/10));
-   
-        AHf+= ((elapsedtime*dcCurrent/10.0)/360000); //One zero less in divisor so we have tenths in the eventual 16 bit word
-        Logger::debug("Accumulated AMPERE-HOURS: %f capacity %i",AHf/10,capacity);
-        SOCf=(((capacity-AHf/10)/capacity)*100);
-        SOC=round(SOCf);
-        AH=round(AHf);  //convert floating point to uint16_t
+        //ampere hours and state of charge are integrated by the energy meter (which also resets them when the battery is full)
+        EnergyMeter *energyMeter = EnergyMeter::getInstance();
+        AH = max(energyMeter->getCharge(), 0) / 100; //in tenths of an ampere-hour
+        SOC = energyMeter->getSOC();
       
-    Logger::debug("STATE OF CHARGE: %i AH: %f",SOC,AH/10.0);
+    LOG_DEBUG("STATE OF CHARGE: %i AH: %f",SOC,AH/10.0);
        
     }	
     //Provisional calculation from motorcontroller values is complete.  Or else we skipped all that anyway.
@@ -337,7 +321,7 @@ void EVIC::sendCmdOrion()
              
 	CanHandler::getInstanceCar()->sendFrame(output);  //Mail it.
         timestamp();
-Logger::debug("Orion Message1: %X  %X %X %X %X %X %X %X %X  %d:%d:%d.%d",output.id, output.data.bytes[0],
+LOG_DEBUG("Orion Message1: %X  %X %X %X %X %X %X %X %X  %d:%d:%d.%d",output.id, output.data.bytes[0],
 output.data.bytes[1],output.data.bytes[2],output.data.bytes[3],output.data.bytes[4],output.data.bytes[5],output.data.bytes[6],output.data.bytes[7], hours, minutes, seconds, milliseconds);
 
 	//Assemble our 650 frame output;
@@ -360,7 +344,7 @@ output.data.bytes[1],output.data.bytes[2],output.data.bytes[3],output.data.bytes
       
     CanHandler::getInstanceCar()->sendFrame(output);  //Mail it.
     timestamp();
-    Logger::debug("Orion Message2: %X  %X %X %X %X %X %X %X %X  %d:%d:%d.%d",output.id, output.data.bytes[0],
+    LOG_DEBUG("Orion Message2: %X  %X %X %X %X %X %X %X %X  %d:%d:%d.%d",output.id, output.data.bytes[0],
 output.data.bytes[1],output.data.bytes[2],output.data.bytes[3],output.data.bytes[4],output.data.bytes[5],output.data.bytes[6],output.data.bytes[7], hours, minutes, seconds, milliseconds);
           
 }
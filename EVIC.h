@@ -41,6 +41,7 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "DeviceManager.h"
 #include "Sys_Messages.h"
 #include "DeviceTypes.h"
+#include "EnergyMeter.h"
 
 extern PrefHandler *sysPrefs;
 
@@ -86,7 +87,6 @@ class EVIC: public Device, CanObserver {
     uint8_t getCello();
     
         unsigned long timemark;
-	unsigned long timemark2;
 	int16_t torqueActual;
 	int16_t speedActual;
 	int16_t dcVoltage;
@@ -113,14 +113,10 @@ class EVIC: public Device, CanObserver {
     void sendCmdCurtis();
     void sendCmdOrion(); 
 
-        double AHf;
-        double milliAH;
-        float  SOCf;
         int milliseconds  ;
         int seconds;
         int minutes;
         int hours ;
-  	unsigned long elapsedtime;
         int16_t DCV;
         int16_t DCA;
         int8_t TEMPM;
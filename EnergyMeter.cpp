@@ -0,0 +1,234 @@
+/*
+ * EnergyMeter.cpp - Integrates the DC voltage and current of the high voltage system
+ * into consumed / regenerated energy (Wh) and charge (Ah) and estimates the state
+ * of charge by coulomb counting.
+ *
+ * All sources of voltage and current (motor controller, etc.) feed the samples
+ * via addSample(), all consumers (dashboard, EVIC, etc.) read the results from here.
+ *
+Copyright (c) 2013-14 Collin Kidder, Michael Neuweiler, Charles Galpin
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+ */
+
+#include "EnergyMeter.h"
+
+#define ENERGY_PER_WH	720000000000LL // 2 * 3600s * 100 (0.01W) * 1000000us
+#define CHARGE_PER_MAH	72000000LL // 2 * 3.6s * 10 (0.1A) * 1000000us
+
+extern PrefHandler *sysPrefs;
+
+EnergyMeter *EnergyMeter::instance = NULL;
+
+static int32_t getEnergySignal(void *energyMeter) {
+	return ((EnergyMeter *) energyMeter)->getEnergy() / 100; // in 0.1kWh
+}
+
+static int32_t getSOCSignal(void *energyMeter) {
+	return ((EnergyMeter *) energyMeter)->getSOC();
+}
+
+EnergyMeter::EnergyMeter() {
+	dischargedEnergy = 0;
+	chargedEnergy = 0;
+	dischargedCharge = 0;
+	chargedCharge = 0;
+	lastVoltage = 0;
+	lastCurrent = 0;
+	lastTimestamp = 0;
+	hasSample = false;
+	capacity = 0;
+	fullVoltage = 0;
+	lastSave = 0;
+	savedEnergy = 0;
+	savedCharge = 0;
+	load();
+
+	SignalRegistry::getInstance()->publish(Constants::kiloWattHours, "kWh", 1, getEnergySignal, this);
+	SignalRegistry::getInstance()->publish(Constants::stateOfCharge, "%", 0, getSOCSignal, this);
+}
+
+EnergyMeter *EnergyMeter::getInstance() {
+	if (instance == NULL)
+		instance = new EnergyMeter();
+	return instance;
+}
+
+/*
+ * Add a measurement of the DC voltage (0.1V) and current (0.1A, positive when
+ * discharging). The energy and charge since the previous sample are integrated
+ * with the trapezoidal rule using the actual time between the samples.
+ * If the voltage exceeds the full voltage while not charging, the meter is reset.
+ */
+void EnergyMeter::addSample(uint16_t voltage, int16_t current) {
+	uint32_t now = micros();
+
+	if (hasSample) {
+		uint32_t dt = now - lastTimestamp;
+		if (dt > CFG_ENERGY_MAX_DT)
+			dt = CFG_ENERGY_MAX_DT; // don't extrapolate the last values over a long gap
+
+		int64_t charge = (int64_t) (lastCurrent + current) * dt;
+		int64_t energy = ((int64_t) lastVoltage * lastCurrent + (int64_t) voltage * current) * dt;
+
+		if (charge >= 0)
+			dischargedCharge += charge;
+		else
+			chargedCharge -= charge;
+		if (energy >= 0)
+			dischargedEnergy += energy;
+		else
+			chargedEnergy -= energy;
+	}
+	lastVoltage = voltage;
+	lastCurrent = current;
+	lastTimestamp = now;
+	hasSample = true;
+
+	if (fullVoltage > 0 && voltage > fullVoltage && current >= 0 && (dischargedCharge > 0 || chargedCharge > 0))
+		reset();
+}
+
+/*
+ * Battery is full, start counting from zero.
+ */
+void EnergyMeter::reset() {
+	dischargedEnergy = 0;
+	chargedEnergy = 0;
+	dischargedCharge = 0;
+	chargedCharge = 0;
+	lastSave = 0; // make sure it's saved immediately
+	save();
+	LOG_DEBUG("energy meter reset");
+}
+
+/*
+ * Store the net energy and charge in the EEPROM, but only if they changed
+ * and not more often than every CFG_ENERGY_SAVE_INTERVAL milliseconds (unless reset).
+ */
+void EnergyMeter::save() {
+	uint32_t energy = getDischargedEnergy(), charge = getDischargedCharge();
+
+	if (lastSave != 0 && millis() - lastSave < CFG_ENERGY_SAVE_INTERVAL)
+		return;
+	lastSave = millis();
+	if (energy == savedEnergy && charge == savedCharge)
+		return;
+
+	sysPrefs->write(EESYS_ENERGY_DISCHARGED, energy);
+	sysPrefs->write(EESYS_ENERGY_CHARGED, getChargedEnergy());
+	sysPrefs->write(EESYS_CHARGE_DISCHARGED, charge);
+	sysPrefs->write(EESYS_CHARGE_CHARGED, getChargedCharge());
+	sysPrefs->saveChecksum();
+	savedEnergy = energy;
+	savedCharge = charge;
+}
+
+void EnergyMeter::load() {
+	uint32_t value;
+
+	if (sysPrefs->read(EESYS_ENERGY_DISCHARGED, &value) && value != 0xFFFFFFFF)
+		dischargedEnergy = value * ENERGY_PER_WH;
+	if (sysPrefs->read(EESYS_ENERGY_CHARGED, &value) && value != 0xFFFFFFFF)
+		chargedEnergy = value * ENERGY_PER_WH;
+	if (sysPrefs->read(EESYS_CHARGE_DISCHARGED, &value) && value != 0xFFFFFFFF)
+		dischargedCharge = value * CHARGE_PER_MAH;
+	if (sysPrefs->read(EESYS_CHARGE_CHARGED, &value) && value != 0xFFFFFFFF)
+		chargedCharge = value * CHARGE_PER_MAH;
+	savedEnergy = getDischargedEnergy();
+	savedCharge = getDischargedCharge();
+}
+
+/*
+ * Energy taken from the battery in Wh
+ */
+uint32_t EnergyMeter::getDischargedEnergy() {
+	return dischargedEnergy / ENERGY_PER_WH;
+}
+
+/*
+ * Energy fed into the battery (regen) in Wh
+ */
+uint32_t EnergyMeter::getChargedEnergy() {
+	return chargedEnergy / ENERGY_PER_WH;
+}
+
+/*
+ * Net energy used since the battery was full in Wh
+ */
+int32_t EnergyMeter::getEnergy() {
+	return (dischargedEnergy - chargedEnergy) / ENERGY_PER_WH;
+}
+
+/*
+ * Set the net energy used in Wh (e.g. to correct the meter manually)
+ */
+void EnergyMeter::setEnergy(uint32_t energy) {
+	dischargedEnergy = energy * ENERGY_PER_WH;
+	chargedEnergy = 0;
+	lastSave = 0;
+	save();
+}
+
+/*
+ * Charge taken from the battery in mAh
+ */
+uint32_t EnergyMeter::getDischargedCharge() {
+	return dischargedCharge / CHARGE_PER_MAH;
+}
+
+/*
+ * Charge fed into the battery (regen) in mAh
+ */
+uint32_t EnergyMeter::getChargedCharge() {
+	return chargedCharge / CHARGE_PER_MAH;
+}
+
+/*
+ * Net charge used since the battery was full in mAh
+ */
+int32_t EnergyMeter::getCharge() {
+	return (dischargedCharge - chargedCharge) / CHARGE_PER_MAH;
+}
+
+/*
+ * State of charge in percent (0-100) based on the net charge used and the
+ * capacity of the battery. Returns 0 if no capacity is set.
+ */
+uint8_t EnergyMeter::getSOC() {
+	if (capacity == 0)
+		return 0;
+	return constrain(100 - getCharge() / ((int32_t) capacity * 10), 0, 100);
+}
+
+/*
+ * Set the capacity of the battery in Ah (0 = unknown)
+ */
+void EnergyMeter::setCapacity(uint16_t capacity) {
+	this->capacity = capacity;
+}
+
+/*
+ * Set the voltage (0.1V) which indicates a fully charged battery (0 = never reset)
+ */
+void EnergyMeter::setFullVoltage(uint16_t voltage) {
+	fullVoltage = voltage;
+}
@@ -0,0 +1,77 @@
+/*
+ * EnergyMeter.h - Integrates the DC voltage and current of the high voltage system
+ * into consumed / regenerated energy (Wh) and charge (Ah) and estimates the state
+ * of charge by coulomb counting.
+ *
+Copyright (c) 2013-14 Collin Kidder, Michael Neuweiler, Charles Galpin
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+ */
+
+#ifndef ENERGYMETER_H_
+#define ENERGYMETER_H_
+
+#include <Arduino.h>
+#include "config.h"
+#include "eeprom_layout.h"
+#include "PrefHandler.h"
+#include "Logger.h"
+#include "SignalRegistry.h"
+
+class EnergyMeter {
+public:
+	static EnergyMeter *getInstance();
+	void addSample(uint16_t voltage, int16_t current);
+	void reset();
+	void save();
+
+	uint32_t getDischargedEnergy();
+	uint32_t getChargedEnergy();
+	int32_t getEnergy();
+	void setEnergy(uint32_t energy);
+	uint32_t getDischargedCharge();
+	uint32_t getChargedCharge();
+	int32_t getCharge();
+	uint8_t getSOC();
+	void setCapacity(uint16_t capacity);
+	void setFullVoltage(uint16_t voltage);
+
+private:
+	EnergyMeter(); //it's not right to try to directly instantiate this class
+	void load();
+
+	static EnergyMeter *instance;
+	// accumulators in fixed point: twice the trapezoid area, current in 0.1A * us and power in 0.01W * us
+	int64_t dischargedEnergy;
+	int64_t chargedEnergy;
+	int64_t dischargedCharge;
+	int64_t chargedCharge;
+	uint16_t lastVoltage; // voltage of the previous sample in 0.1V
+	int16_t lastCurrent; // current of the previous sample in 0.1A, positive = discharging
+	uint32_t lastTimestamp; // time of the previous sample in microseconds
+	bool hasSample; // false until the first sample arrived
+	uint16_t capacity; // battery capacity in Ah (0 = no state of charge)
+	uint16_t fullVoltage; // pack voltage (0.1V) above which the battery is considered fully charged (0 = never)
+	uint32_t lastSave; // time of the last save in ms
+	uint32_t savedEnergy, savedCharge; // values which were stored at the last save
+};
+
+#endif /* ENERGYMETER_H_ */
@@ -26,9 +26,23 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 #include "FaultHandler.h"
 #include "eeprom_layout.h"
+#include "DeviceManager.h"
+#include "MotorController.h"
+
+#define FAULT_LOG_VALID		0xB4 //current format
+#define FAULT_LOG_VALID_V1	0xB2 //format without occurrence count and freeze frames
+#define FAULT_LOG_VALID_V2	0xB3 //format without freeze frames
+
+#if CFG_FAULT_INDEX_SIZE <= CFG_FAULT_HISTORY_SIZE
+#error "CFG_FAULT_INDEX_SIZE has to be larger than CFG_FAULT_HISTORY_SIZE"
+#endif
 
   FaultHandler::FaultHandler()
   {
+	  dirtyFaults = 0;
+	  dirtyPointers = false;
+	  dirtyFreezeFrames = 0;
+	  freezeWritePointer = 0;
   }
 
   void FaultHandler::setup() 
@@ -39,72 +53,329 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 	  loadFromEEPROM();
 
-	  //Use the heartbeat interval because it's slow and already exists so we can piggyback on the interrupt
-	  //so as to not create more timers than necessary.
-	  TickHandler::getInstance()->attach(this, CFG_TICK_INTERVAL_HEARTBEAT);
+	  //The interval is shared with other devices so we don't create more timers than necessary.
+	  //It also limits how long a new fault may wait in RAM before it is committed.
+	  TickHandler::getInstance()->attach(this, CFG_TICK_INTERVAL_FAULT_HANDLER);
   }
 
 
-  //Every tick update the global time and save it to EEPROM (delayed saving)
+  //Every tick update the global time and save it to EEPROM (delayed saving). Also commit changed fault records.
   void FaultHandler::handleTick() 
   {
 	  globalTime = baseTime + (millis() / 100);
 	  memCache->Write(EE_FAULT_LOG + EEFAULT_RUNTIME, globalTime);
+	  commit();
+  }
+
+  /*
+   * Fault records are only changed in RAM and marked dirty. Once per tick the changed records are copied
+   * to the memory cache and their pages fully aged so MemCache writes them with its next ticks (one page per
+   * tick). This way a flapping input costs a few RAM writes instead of a synchronous page write per flap.
+   */
+  void FaultHandler::commit()
+  {
+	  if (dirtyFaults == 0 && !dirtyPointers && dirtyFreezeFrames == 0)
+		  return;
+
+	  for (int i = 0; i < CFG_FAULT_HISTORY_SIZE; i++)
+	  {
+		  if (dirtyFaults & ((uint64_t)1 << i))
+		  {
+			  uint32_t address = EE_FAULT_LOG + EEFAULT_FAULTS_START + sizeof(FAULT) * i;
+			  memCache->Write(address, &faultList[i], sizeof(FAULT));
+			  memCache->AgeFullyAddress(address);
+			  memCache->AgeFullyAddress(address + sizeof(FAULT) - 1); //the record may span two pages
+		  }
+	  }
+	  dirtyFaults = 0;
+
+	  for (int i = 0; i < CFG_FREEZE_FRAME_COUNT; i++)
+	  {
+		  if (dirtyFreezeFrames & (1 << i))
+		  {
+			  uint32_t address = EE_FAULT_LOG + EEFAULT_FREEZE_START + sizeof(FREEZE_FRAME) * i;
+			  memCache->Write(address, &freezeFrames[i], sizeof(FREEZE_FRAME));
+			  memCache->AgeFullyAddress(address);
+			  memCache->AgeFullyAddress(address + sizeof(FREEZE_FRAME) - 1);
+		  }
+	  }
+	  dirtyFreezeFrames = 0;
+
+	  if (dirtyPointers)
+	  {
+		  memCache->Write(EE_FAULT_LOG + EEFAULT_READPTR, faultReadPointer);
+		  memCache->Write(EE_FAULT_LOG + EEFAULT_WRITEPTR, faultWritePointer);
+		  memCache->Write(EE_FAULT_LOG + EEFAULT_FREEZE_WRITEPTR, freezeWritePointer);
+		  memCache->AgeFullyAddress(EE_FAULT_LOG + EEFAULT_WRITEPTR);
+		  dirtyPointers = false;
+	  }
   }
 
   uint16_t FaultHandler::raiseFault(uint16_t device, uint16_t code, bool ongoing = false) 
   {
-	  bool incPtr = false;
 	  globalTime = baseTime + (millis() / 100);
 
-	  //first try to see if this fault is already registered as ongoing. If so don't update the time but set ongoing status if necessary
-	  bool found = false;
-      for (int j = 0; j < CFG_FAULT_HISTORY_SIZE; j++)
+	  int slot = findFault(device, code);
+	  if (slot != -1)
+	  {
+		  //the fault is already registered as ongoing. Don't update the time but set ongoing status if necessary
+		  if (faultList[slot].ongoing)
+		  {
+			  if (!ongoing)
+				  setFaultOngoing(slot, false);
+			  return slot;
+		  }
+
+		  //the fault was already logged and not acknowledged yet, count it there instead of filling the history with repeats
+		  if (!faultList[slot].ack)
+		  {
+			  if (faultList[slot].occurrences < 255)
+				  faultList[slot].occurrences++;
+			  if (ongoing)
+				  setFaultOngoing(slot, true);
+			  else
+				  writeFaultToEEPROM(slot);
+			  LOG_DEBUG(FAULTSYS, "Fault %x raised again by device %x (%i times)", code, device, faultList[slot].occurrences);
+			  return slot;
+		  }
+	  }
+
+	  //register a new one. The oldest entry gets overwritten so drop it from the index first
+	  slot = faultWritePointer;
+	  if (faultList[slot].ongoing)
 	  {
-         if (faultList[j].ongoing && faultList[j].device == device && faultList[j].faultCode == code) 
-	     {
-		    found = true;
-			//faultList[j].timeStamp = globalTime;
-		    faultList[j].ongoing = ongoing;
-		    break; //quit searching
-		 }
+		  faultList[slot].ongoing = false;
+		  ongoingCount--;
 	  }
+	  unindexFault(slot);
+	  faultList[slot].timeStamp = globalTime;
+	  faultList[slot].ack = false;
+	  faultList[slot].device = device;
+	  faultList[slot].faultCode = code;
+	  faultList[slot].ongoing = ongoing;
+	  faultList[slot].occurrences = 1;
+	  if (ongoing)
+		  ongoingCount++;
+	  indexFault(slot);
+
+	  //stage the record, it is committed with the next tick
+	  writeFaultToEEPROM(slot);
+	  faultWritePointer = (faultWritePointer + 1) % CFG_FAULT_HISTORY_SIZE;
+	  captureFreezeFrame(device, code);
+	  dirtyPointers = true;
+	  //Also announce fault on the console
+	  Logger::error(FAULTSYS, "Fault %x raised by device %x at uptime %i", code, device, globalTime);
+	  return slot;
+  }
+
+  //Called on every tick of devices whose input is fine, so the usual case (nothing ongoing) has to be quick
+  void FaultHandler::cancelOngoingFault(uint16_t device, uint16_t code)
+  {
+	  if (ongoingCount == 0)
+		  return;
+
+	  int slot = findOngoingFault(device, code);
+	  if (slot != -1)
+		  setFaultOngoing(slot, false);
+  }
 
-	  //nothing ongoing to register a new one
-	  if (!found)
+  /*
+   * The most recent record of every fault in the history is kept in a small open addressed hash table (linear
+   * probing) keyed by device and fault code, so raising, counting and cancelling a fault don't have to scan the
+   * whole fault history. An ongoing fault is always the most recent record of its key because raising it again
+   * finds that record first. faultList stays the persistent record, the index is rebuilt from it at start up.
+   * The table is larger than the history, so it never fills up and lookups always end at an empty entry.
+   */
+  uint8_t FaultHandler::indexHash(uint16_t device, uint16_t code)
+  {
+	  return (device ^ (device >> 8) ^ (code * 7)) & (CFG_FAULT_INDEX_SIZE - 1);
+  }
+
+  //Take a snapshot of the motor controller state for a new fault. Only copies values, no calculations.
+  void FaultHandler::captureFreezeFrame(uint16_t device, uint16_t code)
+  {
+	  FREEZE_FRAME *frame = &freezeFrames[freezeWritePointer];
+	  MotorController *motorController = DeviceManager::getInstance()->getMotorController();
+
+	  memset(frame, 0, sizeof(FREEZE_FRAME));
+	  frame->timeStamp = globalTime;
+	  frame->device = device;
+	  frame->faultCode = code;
+	  if (motorController)
 	  {
-		  faultList[faultWritePointer].timeStamp = globalTime;
-		  faultList[faultWritePointer].ack = false;
-		  faultList[faultWritePointer].device = device;
-		  faultList[faultWritePointer].faultCode = code;
-		  faultList[faultWritePointer].ongoing = ongoing;
-		  incPtr = true;
+		  frame->throttle = motorController->getThrottle();
+		  frame->torqueRequested = motorController->getTorqueRequested();
+		  frame->torqueActual = motorController->getTorqueActual();
+		  frame->speedActual = motorController->getSpeedActual();
+		  frame->dcVoltage = motorController->getDcVoltage();
+		  frame->dcCurrent = motorController->getDcCurrent();
+		  frame->temperatureMotor = motorController->getTemperatureMotor();
+		  frame->temperatureInverter = motorController->getTemperatureInverter();
+		  frame->gear = motorController->getSelectedGear();
+		  frame->opState = motorController->getOpState();
 	  }
+	  dirtyFreezeFrames |= (1 << freezeWritePointer);
+	  freezeWritePointer = (freezeWritePointer + 1) % CFG_FREEZE_FRAME_COUNT;
+  }
 
-	  //write back to EEPROM cache
-	  memCache->Write(EE_FAULT_LOG + EEFAULT_FAULTS_START + sizeof(FAULT) * faultWritePointer, &faultList[faultWritePointer], sizeof(FAULT));
+  bool FaultHandler::getFreezeFrame(uint8_t which, FREEZE_FRAME *outFrame)
+  {
+	  if (which >= CFG_FREEZE_FRAME_COUNT)
+		  return false;
+	  FREEZE_FRAME *frame = &freezeFrames[(freezeWritePointer + CFG_FREEZE_FRAME_COUNT - 1 - which) % CFG_FREEZE_FRAME_COUNT];
+	  if (frame->faultCode == FAULT_NONE)
+		  return false; //slot never used
+	  *outFrame = *frame;
+	  return true;
+  }
 
-	  if (incPtr) 
+  uint8_t FaultHandler::getFaultCodes(uint16_t *codes, uint8_t max)
+  {
+	  uint8_t count = 0;
+	  for (int i = 1; i <= CFG_FAULT_HISTORY_SIZE && count < max; i++)
 	  {
-		  //Cause the memory caching system to immediately write the page but only if incPtr is set (only if this is a new fault)
-		  memCache->InvalidateAddress(EE_FAULT_LOG + EEFAULT_FAULTS_START + sizeof(FAULT)* faultWritePointer);
-		  faultWritePointer = (faultWritePointer + 1) % CFG_FAULT_HISTORY_SIZE;
-		  memCache->Write(EE_FAULT_LOG + EEFAULT_WRITEPTR , faultWritePointer);
-		  //Cause the page to be immediately fully aged so that it is written very soon.
-		  memCache->AgeFullyAddress(EE_FAULT_LOG + EEFAULT_WRITEPTR);	  
-		  //Also announce fault on the console
-	      Logger::error(FAULTSYS, "Fault %x raised by device %x at uptime %i", code, device, globalTime);
+		  int j = (faultWritePointer + CFG_FAULT_HISTORY_SIZE - i) % CFG_FAULT_HISTORY_SIZE;
+		  if (faultList[j].ack == false && faultList[j].device != 0xFFFF)
+			  codes[count++] = faultList[j].faultCode;
 	  }
+	  return count;
   }
 
-  void FaultHandler::cancelOngoingFault(uint16_t device, uint16_t code)
+  //returns the slot of the most recent record of a fault or -1 if it's not in the history
+  int FaultHandler::findFault(uint16_t device, uint16_t code)
   {
-	  for (int i = 0; i < CFG_FAULT_HISTORY_SIZE; i++) 
+	  uint8_t pos = indexHash(device, code);
+	  for (int i = 0; i < CFG_FAULT_INDEX_SIZE && faultIndex[pos].slot != FAULT_INDEX_EMPTY; i++)
 	  {
-		  if (faultList[i].ongoing && faultList[i].device == device && faultList[i].faultCode == code)
+		  if (faultIndex[pos].device == device && faultIndex[pos].faultCode == code)
+			  return faultIndex[pos].slot;
+		  pos = (pos + 1) & (CFG_FAULT_INDEX_SIZE - 1);
+	  }
+	  return -1;
+  }
+
+  //returns the slot in faultList of the ongoing fault or -1 if there is none
+  int FaultHandler::findOngoingFault(uint16_t device, uint16_t code)
+  {
+	  int slot = findFault(device, code);
+	  return (slot != -1 && faultList[slot].ongoing) ? slot : -1;
+  }
+
+  //make slot the most recent record of its fault
+  void FaultHandler::indexFault(uint16_t slot)
+  {
+	  uint8_t pos = indexHash(faultList[slot].device, faultList[slot].faultCode);
+	  int i;
+	  for (i = 0; i < CFG_FAULT_INDEX_SIZE && faultIndex[pos].slot != FAULT_INDEX_EMPTY; i++)
+	  {
+		  if (faultIndex[pos].device == faultList[slot].device && faultIndex[pos].faultCode == faultList[slot].faultCode)
+			  break;
+		  pos = (pos + 1) & (CFG_FAULT_INDEX_SIZE - 1);
+	  }
+	  if (i == CFG_FAULT_INDEX_SIZE)
+		  return; //can't happen as the index is larger than the history
+	  faultIndex[pos].device = faultList[slot].device;
+	  faultIndex[pos].faultCode = faultList[slot].faultCode;
+	  faultIndex[pos].slot = slot;
+  }
+
+  //remove the entry pointing to slot (if the slot is the most recent record of its fault) and move following
+  //entries of the probe chain up so no tombstones are needed
+  void FaultHandler::unindexFault(uint16_t slot)
+  {
+	  uint8_t pos = indexHash(faultList[slot].device, faultList[slot].faultCode);
+	  int i;
+	  for (i = 0; i < CFG_FAULT_INDEX_SIZE && faultIndex[pos].slot != slot; i++)
+	  {
+		  if (faultIndex[pos].slot == FAULT_INDEX_EMPTY)
+			  return;
+		  pos = (pos + 1) & (CFG_FAULT_INDEX_SIZE - 1);
+	  }
+	  if (i == CFG_FAULT_INDEX_SIZE)
+		  return;
+
+	  faultIndex[pos].slot = FAULT_INDEX_EMPTY;
+
+	  uint8_t next = (pos + 1) & (CFG_FAULT_INDEX_SIZE - 1);
+	  while (faultIndex[next].slot != FAULT_INDEX_EMPTY)
+	  {
+		  uint8_t home = indexHash(faultIndex[next].device, faultIndex[next].faultCode);
+		  //move the entry into the hole unless its home lies cyclically between the hole and its position
+		  if (((next - home) & (CFG_FAULT_INDEX_SIZE - 1)) >= ((next - pos) & (CFG_FAULT_INDEX_SIZE - 1)))
 		  {
-			  setFaultOngoing(i, false);
+			  faultIndex[pos] = faultIndex[next];
+			  faultIndex[next].slot = FAULT_INDEX_EMPTY;
+			  pos = next;
 		  }
+		  next = (next + 1) & (CFG_FAULT_INDEX_SIZE - 1);
+	  }
+  }
+
+  /*
+   * Every entry has to be reachable from its home position without passing an empty entry and has to point
+   * to a record with the same key. Every record has to be found through the index, either directly or as
+   * an older record of the same fault, and only the most recent record of a fault may be ongoing.
+   */
+  bool FaultHandler::checkIndex()
+  {
+	  for (int pos = 0; pos < CFG_FAULT_INDEX_SIZE; pos++)
+	  {
+		  FAULT_INDEX *entry = &faultIndex[pos];
+		  if (entry->slot == FAULT_INDEX_EMPTY)
+			  continue;
+		  if (entry->slot >= CFG_FAULT_HISTORY_SIZE || faultList[entry->slot].device != entry->device
+				  || faultList[entry->slot].faultCode != entry->faultCode)
+			  return false;
+		  if (findFault(entry->device, entry->faultCode) != entry->slot) //unreachable or a duplicate key
+			  return false;
+	  }
+
+	  uint8_t ongoing = 0;
+	  for (int i = 0; i < CFG_FAULT_HISTORY_SIZE; i++)
+	  {
+		  if (faultList[i].device == 0xFFFF)
+			  continue;
+		  int last = findFault(faultList[i].device, faultList[i].faultCode);
+		  if (last == -1)
+			  return false;
+		  //the age of a record is its distance to the write pointer
+		  if ((i - faultWritePointer + CFG_FAULT_HISTORY_SIZE) % CFG_FAULT_HISTORY_SIZE
+				  > (last - faultWritePointer + CFG_FAULT_HISTORY_SIZE) % CFG_FAULT_HISTORY_SIZE)
+			  return false;
+		  if (faultList[i].ongoing)
+		  {
+			  if (last != i)
+				  return false;
+			  ongoing++;
+		  }
+	  }
+	  return (ongoing == ongoingCount);
+  }
+
+  void FaultHandler::buildFaultIndex()
+  {
+	  for (int i = 0; i < CFG_FAULT_INDEX_SIZE; i++)
+		  faultIndex[i].slot = FAULT_INDEX_EMPTY;
+	  ongoingCount = 0;
+
+	  //from the oldest to the newest record so the index ends up pointing to the most recent one of each fault
+	  for (int i = 0; i < CFG_FAULT_HISTORY_SIZE; i++)
+	  {
+		  int slot = (faultWritePointer + i) % CFG_FAULT_HISTORY_SIZE;
+		  if (faultList[slot].device == 0xFFFF)
+		  {
+			  faultList[slot].ongoing = false;
+			  continue;
+		  }
+		  int older = findFault(faultList[slot].device, faultList[slot].faultCode);
+		  if (older != -1 && faultList[older].ongoing)
+		  {
+			  faultList[older].ongoing = false; //duplicate from an older log, one ongoing entry per fault is enough
+			  ongoingCount--;
+		  }
+		  indexFault(slot);
+		  if (faultList[slot].ongoing)
+			  ongoingCount++;
 	  }
   }
 
@@ -127,7 +398,7 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
   {
 	  uint8_t validByte;
 	  memCache->Read(EE_FAULT_LOG, &validByte);
-	  if (validByte == 0xB2) //magic byte value for a valid fault cache
+	  if (validByte == FAULT_LOG_VALID || validByte == FAULT_LOG_VALID_V1 || validByte == FAULT_LOG_VALID_V2) //magic byte value for a valid fault cache
 	  {
 		  memCache->Read(EE_FAULT_LOG + EEFAULT_READPTR, &faultReadPointer);
 		  memCache->Read(EE_FAULT_LOG + EEFAULT_WRITEPTR, &faultWritePointer);
@@ -137,10 +408,29 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 		  {
 			  memCache->Read(EE_FAULT_LOG + EEFAULT_FAULTS_START + sizeof(FAULT) * i, &faultList[i], sizeof(FAULT));
 		  }
+		  if (validByte == FAULT_LOG_VALID)
+		  {
+			  memCache->Read(EE_FAULT_LOG + EEFAULT_FREEZE_WRITEPTR, &freezeWritePointer);
+			  if (freezeWritePointer >= CFG_FREEZE_FRAME_COUNT)
+				  freezeWritePointer = 0;
+			  for (int i = 0; i < CFG_FREEZE_FRAME_COUNT; i++)
+				  memCache->Read(EE_FAULT_LOG + EEFAULT_FREEZE_START + sizeof(FREEZE_FRAME) * i, &freezeFrames[i], sizeof(FREEZE_FRAME));
+		  }
+		  else //older format, there are no freeze frames yet
+		  {
+			  memset(freezeFrames, 0, sizeof(freezeFrames));
+			  freezeWritePointer = 0;
+			  if (validByte == FAULT_LOG_VALID_V1) //the occurrence count was padding before, start counting now
+				  for (int i = 0; i < CFG_FAULT_HISTORY_SIZE; i++)
+					  faultList[i].occurrences = (faultList[i].device == 0xFFFF) ? 0 : 1;
+			  validByte = FAULT_LOG_VALID;
+			  memCache->Write(EE_FAULT_LOG, validByte);
+			  saveToEEPROM();
+		  }
 	  }
 	  else //reinitialize the fault cache storage
 	  {
-		  validByte = 0xB2;
+		  validByte = FAULT_LOG_VALID;
 		  memCache->Write(EE_FAULT_LOG, validByte);
 		  memCache->Write(EE_FAULT_LOG + EEFAULT_READPTR, (uint16_t)0);
 		  memCache->Write(EE_FAULT_LOG + EEFAULT_WRITEPTR, (uint16_t)0);
@@ -153,12 +443,16 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 		  tempFault.faultCode = 0xFFFF;
 		  tempFault.ongoing = false;
 		  tempFault.timeStamp = 0;
+		  tempFault.occurrences = 0;
 		  for (int i = 0; i < CFG_FAULT_HISTORY_SIZE; i++) 
 		  {
 			  faultList[i] = tempFault;
 		  }
+		  memset(freezeFrames, 0, sizeof(freezeFrames));
+		  freezeWritePointer = 0;
 		  saveToEEPROM();
 	  }
+	  buildFaultIndex();
   }
 
   void FaultHandler::saveToEEPROM() 
@@ -170,13 +464,19 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 	{
 		memCache->Write(EE_FAULT_LOG + EEFAULT_FAULTS_START + sizeof(FAULT) * i, &faultList[i], sizeof(FAULT));
 	}
+	memCache->Write(EE_FAULT_LOG + EEFAULT_FREEZE_WRITEPTR, freezeWritePointer);
+	for (int i = 0; i < CFG_FREEZE_FRAME_COUNT; i++) 
+	{
+		memCache->Write(EE_FAULT_LOG + EEFAULT_FREEZE_START + sizeof(FREEZE_FRAME) * i, &freezeFrames[i], sizeof(FREEZE_FRAME));
+	}
   }
 
+  //mark a fault record for the next commit()
   void FaultHandler::writeFaultToEEPROM(int faultnum)
   {
-	  if (faultnum > 0 && faultnum < CFG_FAULT_HISTORY_SIZE) 
+	  if (faultnum >= 0 && faultnum < CFG_FAULT_HISTORY_SIZE) 
 	  {
-		memCache->Write(EE_FAULT_LOG + EEFAULT_FAULTS_START + sizeof(FAULT) * faultnum, &faultList[faultnum], sizeof(FAULT));
+		dirtyFaults |= ((uint64_t)1 << faultnum);
 	  }
   }
 
@@ -187,7 +487,7 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 	{
 		j = (faultReadPointer + i + 1) % CFG_FAULT_HISTORY_SIZE;
 		if (faultList[j].ack == false) {
-			fault = &faultList[j];
+			*fault = faultList[j];
 			faultReadPointer = j;
 			return true;
 		}
@@ -197,8 +497,8 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
   bool FaultHandler::getFault(uint16_t fault, FAULT *outFault)
   {
-	  if (fault > 0 && fault < CFG_FAULT_HISTORY_SIZE) {
-		  outFault = &faultList[fault];
+	  if (fault < CFG_FAULT_HISTORY_SIZE) {
+		  *outFault = faultList[fault];
 		  return true;
 	  }
 	  return false;
@@ -210,16 +510,30 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 	  {
 		  faultList[fault].ack = 1;
 		  writeFaultToEEPROM(fault);
+		  return fault;
 	  }
+	  return 0xFFFF;
   }
 
   uint16_t FaultHandler::setFaultOngoing(uint16_t fault, bool ongoing)
   {
-	  if (fault > 0 && fault < CFG_FAULT_HISTORY_SIZE) 
+	  if (fault < CFG_FAULT_HISTORY_SIZE) 
 	  {
-		  faultList[fault].ongoing = ongoing;
+		  //only the most recent record of a fault may be ongoing, the index wouldn't find an older one
+		  if (ongoing && findFault(faultList[fault].device, faultList[fault].faultCode) != fault)
+			  return 0xFFFF;
+		  if (faultList[fault].ongoing != ongoing)
+		  {
+			  faultList[fault].ongoing = ongoing;
+			  if (ongoing)
+				  ongoingCount++;
+			  else
+				  ongoingCount--;
+		  }
 		  writeFaultToEEPROM(fault);
+		  return fault;
 	  }
+	  return 0xFFFF;
   }
 
   FaultHandler faultHandler;
@@ -48,7 +48,34 @@ typedef struct {
   uint16_t faultCode; //set by the device itself. There is a universal list of codes
   uint8_t ack : 1; ////whether this fault has been acknowledged or not 1 = ack'd 
   uint8_t ongoing : 1; //whether fault still seems to be happening currently 1 = still going on
-} FAULT; //should be 9 bytes because the bottom two are bit fields in a single byte
+  uint8_t occurrences; //how often the fault was raised again before it was acknowledged (saturates at 255)
+} FAULT; //10 bytes of data, uses the padding so sizeof(FAULT) is unchanged
+
+//snapshot of the drive train taken when a new fault is raised (OBD2 freeze frame)
+typedef struct {
+  uint32_t timeStamp; //same time base as FAULT.timeStamp
+  uint16_t device; //fault which caused the snapshot
+  uint16_t faultCode;
+  int16_t throttle; //throttle level requested from motor controller (-1000 to 1000)
+  int16_t torqueRequested; //0.1 Nm
+  int16_t torqueActual; //0.1 Nm
+  int16_t speedActual; //rpm
+  uint16_t dcVoltage; //0.1 V
+  int16_t dcCurrent; //0.1 A
+  int16_t temperatureMotor; //0.1 degree C
+  int16_t temperatureInverter; //0.1 degree C
+  uint8_t gear; //MotorController::Gears
+  uint8_t opState; //MotorController::OperationState
+} FREEZE_FRAME;
+
+//entry of the fault index. Maps (device, code) to the slot of the most recent record of the fault in the history
+typedef struct {
+  uint16_t device;
+  uint16_t faultCode;
+  uint8_t slot; //FAULT_INDEX_EMPTY if unused
+} FAULT_INDEX;
+
+#define FAULT_INDEX_EMPTY 0xFF
 
 
 class FaultHandler : public TickObserver {
@@ -59,8 +86,12 @@ class FaultHandler : public TickObserver {
   bool getNextFault(FAULT*); //get the next un-ack'd fault. Will also get first fault if the first call and you forgot to call getFirstFault
   bool getFault(uint16_t fault, FAULT*);
   uint16_t getFaultCount();
+  uint8_t getFaultCodes(uint16_t *codes, uint8_t max); //copy the codes of up to max un-ack'd faults (newest first), returns # copied
+  bool getFreezeFrame(uint8_t which, FREEZE_FRAME*); //0 = most recent freeze frame
   void handleTick();
   void setup();
+  void commit(); //write all pending fault records to the EEPROM cache and have them flushed soon
+  bool checkIndex(); //verify the fault index against faultList (for tests and debugging)
 
   uint16_t setFaultACK(uint16_t fault); //acknowledge the fault # - returns fault # if successful (0xFFFF otherwise)
   uint16_t setFaultOngoing(uint16_t fault, bool ongoing); //set value of ongoing flag - returns fault # on success
@@ -69,10 +100,24 @@ class FaultHandler : public TickObserver {
   void loadFromEEPROM();
   void saveToEEPROM();
   void writeFaultToEEPROM(int faultnum);
+  void captureFreezeFrame(uint16_t device, uint16_t code);
+  int findFault(uint16_t device, uint16_t code);
+  int findOngoingFault(uint16_t device, uint16_t code);
+  void indexFault(uint16_t slot);
+  void unindexFault(uint16_t slot);
+  void buildFaultIndex();
+  uint8_t indexHash(uint16_t device, uint16_t code);
 
   uint16_t  faultWritePointer; //fault # we're up to for writing. Location in EEPROM is start + (fault_ptr * sizeof(FAULT))
   uint16_t  faultReadPointer;  //fault # we're at when reading.
   FAULT faultList[CFG_FAULT_HISTORY_SIZE]; //store up to 50 faults for a long history. 50*9 = 450 bytes of EEPROM
+  FAULT_INDEX faultIndex[CFG_FAULT_INDEX_SIZE]; //open addressed hash table of the most recent record of every fault in faultList
+  uint8_t ongoingCount; //number of ongoing records in faultList
+  FREEZE_FRAME freezeFrames[CFG_FREEZE_FRAME_COUNT]; //ring of snapshots, persisted after the fault list
+  uint8_t freezeWritePointer;
+  uint16_t dirtyFreezeFrames; //bit n set = freezeFrames[n] waits for the next commit()
+  uint64_t dirtyFaults; //bit n set = faultList[n] changed and waits for the next commit()
+  bool dirtyPointers; //read or write pointer changed and waits for the next commit()
   uint32_t globalTime; //how long the unit has been running in total (across all start ups).
   uint32_t baseTime; //the time loaded at system start up. millis() / 100 is added to this to get the above time
 };
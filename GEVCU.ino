@@ -68,8 +68,7 @@ PrefHandler *sysPrefs;
 MemCache *memCache;
 Heartbeat *heartbeat;
 SerialConsole *serialConsole;
-Device *wifiDevice;
-Device *btDevice;
+LoopHandler *loopHandler;
 
 
 byte i = 0;
@@ -283,6 +282,7 @@ void setup() {
 	Logger::setLoglevel((Logger::LogLevel)loglevel);
 	Logger::setLoglevel((Logger::LogLevel)1);
 	sys_early_setup();     
+	loopHandler = LoopHandler::getInstance();
 	tickHandler = TickHandler::getInstance();
 	canHandlerEV = CanHandler::getInstanceEV();
 	canHandlerCar = CanHandler::getInstanceCar();
@@ -294,34 +294,21 @@ void setup() {
 	initializeDevices();
     serialConsole = new SerialConsole(memCache, heartbeat);
 	serialConsole->printMenu();
-	wifiDevice = DeviceManager::getInstance()->getDeviceByID(ICHIP2128);
-	btDevice = DeviceManager::getInstance()->getDeviceByID(ELM327EMU);
-    DeviceManager::getInstance()->sendMessage(DEVICE_WIFI, ICHIP2128, MSG_CONFIG_CHANGE, NULL); //Load configuration variables into WiFi Web Configuration screen
+    MessageBus::getInstance()->post(MSG_CONFIG_CHANGE, ICHIP2128); //Load configuration variables into WiFi Web Configuration screen
 	Logger::info("System Ready");
+#ifdef CFG_LOG_DEFERRED
+	Logger::setDeferred(true); //from now on log messages are printed from loop() and don't stall the caller
+#endif
+	serialOutput.setBuffered(true); //console output is queued and sent from loop() in small chunks
+	loopHandler->attach(Logger::loop, LOOP_PRIORITY_LOW, CFG_LOOP_BUDGET_LOGGER, "logger");
 }
 
+/*
+ * Everything which has to run in the main loop (CAN, queued ticks, I/O polling,
+ * wifi, console, ...) registers itself with the LoopHandler.
+ */
 void loop() {
-
-#ifdef CFG_TIMER_USE_QUEUING
-	tickHandler->process();
-#endif
-
-	// check if incoming frames are available in the can buffer and process them
-	canHandlerEV->process();
-	canHandlerCar->process();
-
-	serialConsole->loop();
-	//TODO: this is dumb... shouldn't have to manually do this. Devices should be able to register loop functions
-	if ( wifiDevice != NULL ) {
-		((ICHIPWIFI*)wifiDevice)->loop();
-	}
-
-	//if (btDevice != NULL) {
-	//	((ELM327Emu*)btDevice)->loop();
-	//}
-
-	//this should still be here. It checks for a flag set during an interrupt
-	sys_io_adc_poll();
+	loopHandler->process();
 }
 
 
@@ -26,6 +26,11 @@
 
 #include "Heartbeat.h"
 
+// the values which are shown when throttle debugging is enabled
+static const char *debugSignals[] = { Constants::running, Constants::faulted, "analogIn0", "analogIn1", "analogIn2", "analogIn3",
+		Constants::digitalInputs, Constants::digitalOutputs, Constants::throttleLevel, Constants::throttle, Constants::throttleRaw2,
+		Constants::brakeLevel, Constants::brake };
+
 Heartbeat::Heartbeat() {
 	led = false;
 	throttleDebug = false;
@@ -37,8 +42,26 @@ void Heartbeat::setup() {
 	TickHandler::getInstance()->attach(this, CFG_TICK_INTERVAL_HEARTBEAT);
 }
 
+/*
+ * Print the raw throttle / brake and I/O values whenever they change (at most
+ * once per heartbeat).
+ */
 void Heartbeat::setThrottleDebug(bool debug) {
+	SignalRegistry *registry = SignalRegistry::getInstance();
+	uint16_t interval = CFG_TICK_INTERVAL_HEARTBEAT / 1000;
+
+	if (debug == throttleDebug) {
+		return;
+	}
 	throttleDebug = debug;
+
+	if (throttleDebug) {
+		for (uint8_t i = 0; i < sizeof(debugSignals) / sizeof(debugSignals[0]); i++) {
+			registry->subscribe(this, debugSignals[i], interval, 0);
+		}
+	} else {
+		registry->unsubscribe(this);
+	}
 }
 
 bool Heartbeat::getThrottleDebug() {
@@ -48,9 +71,9 @@ bool Heartbeat::getThrottleDebug() {
 void Heartbeat::handleTick() {
 	// Print a dot if no other output has been made since the last tick
 	if (Logger::getLastLogTime() < lastTickTime) {
-		SerialUSB.print('.');
+		serialOutput.print('.');
 		if ((++dotCount % 80) == 0) {
-			SerialUSB.println();
+			serialOutput.println();
 		}
 	}
 	lastTickTime = millis();
@@ -61,33 +84,11 @@ void Heartbeat::handleTick() {
 		digitalWrite(BLINK_LED, LOW);
 	}
 	led = !led;
-
-	if (throttleDebug) {
-		MotorController *motorController = DeviceManager::getInstance()->getMotorController();
-		Throttle *accelerator = DeviceManager::getInstance()->getAccelerator();
-		Throttle *brake = DeviceManager::getInstance()->getBrake();
-
-		Logger::console("");
-		if (motorController) {
-			Logger::console("Motor Controller Status->    isRunning: %T            isFaulted: %T", motorController->isRunning(), motorController->isFaulted());
-		}
-
-		Logger::console("AIN0: %d, AIN1: %d, AIN2: %d, AIN3: %d", getAnalog(0), getAnalog(1), getAnalog(2), getAnalog(3));
-        Logger::console("DIN0: %d, DIN1: %d, DIN2: %d, DIN3: %d", getDigital(0), getDigital(1), getDigital(2), getDigital(3));
-        Logger::console("DOUT0: %d, DOUT1: %d, DOUT2: %d, DOUT3: %d,DOUT4: %d, DOUT5: %d, DOUT6: %d, DOUT7: %d", getOutput(0), getOutput(1), getOutput(2), getOutput(3),getOutput(4), getOutput(5), getOutput(6), getOutput(7));
-
-		if (accelerator) {
-			Logger::console("Is throttle currently faulted: %T                 Throttle level: %i", accelerator->isFaulted(), accelerator->getLevel());
-			RawSignalData *rawSignal = accelerator->acquireRawSignal();
-			Logger::console("Throttle rawSignal1: %d, rawSignal2: %d", rawSignal->input1, rawSignal->input2);
-		}
-		if (brake) {
-			Logger::console("Brake Output Level: %i", brake->getLevel());
-			RawSignalData *rawSignal = brake->acquireRawSignal();
-			Logger::console("Brake rawSignal1: %d", rawSignal->input1);
-		}
-	}
 }
 
+void Heartbeat::handleSignal(uint8_t signal, int32_t value) {
+	char buffer[16];
 
-
+	Logger::console("%s: %s", SignalRegistry::getInstance()->getName(signal),
+			SignalRegistry::getInstance()->format(signal, value, buffer, sizeof(buffer)));
+}
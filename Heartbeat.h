@@ -31,12 +31,14 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "TickHandler.h"
 #include "DeviceManager.h"
 #include "sys_io.h"
+#include "SignalRegistry.h"
 
-class Heartbeat: public TickObserver {
+class Heartbeat: public TickObserver, SignalObserver {
 public:
 	Heartbeat();
 	void setup();
 	void handleTick();
+	void handleSignal(uint8_t signal, int32_t value);
         void setThrottleDebug(bool debug);
         bool getThrottleDebug();
 
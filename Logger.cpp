@@ -27,7 +27,15 @@
 #include "Logger.h"
 
 Logger::LogLevel Logger::logLevel = Logger::Info;
+Logger::LogLevel Logger::minLevel = Logger::Info;
+Logger::DeviceLogLevel Logger::deviceLevels[CFG_LOG_NUM_DEVICE_LEVELS];
 uint32_t Logger::lastLogTime = 0;
+boolean Logger::deferred = false;
+Logger::LogRecord Logger::records[CFG_LOG_BUFFER_SIZE];
+volatile uint32_t Logger::writeIndex = 0;
+uint32_t Logger::readIndex = 0;
+volatile uint32_t Logger::overruns = 0;
+uint32_t Logger::reportedOverruns = 0;
 
 /*
  * Output a debug message with a variable amount of parameters.
@@ -48,7 +56,7 @@ void Logger::debug(char *message, ...) {
  * printf() style, see Logger::log()
  */
 void Logger::debug(DeviceId deviceId, char *message, ...) {
-	if (logLevel > Debug)
+	if (minLevel > Debug || getLogLevel(deviceId) > Debug)
 		return;
 	va_list args;
 	va_start(args, message);
@@ -74,7 +82,7 @@ void Logger::info(char *message, ...) {
  * printf() style, see Logger::log()
  */
 void Logger::info(DeviceId deviceId, char *message, ...) {
-	if (logLevel > Info)
+	if (minLevel > Info || getLogLevel(deviceId) > Info)
 		return;
 	va_list args;
 	va_start(args, message);
@@ -100,7 +108,7 @@ void Logger::warn(char *message, ...) {
  * printf() style, see Logger::log()
  */
 void Logger::warn(DeviceId deviceId, char *message, ...) {
-	if (logLevel > Warn)
+	if (minLevel > Warn || getLogLevel(deviceId) > Warn)
 		return;
 	va_list args;
 	va_start(args, message);
@@ -126,7 +134,7 @@ void Logger::error(char *message, ...) {
  * printf() style, see Logger::log()
  */
 void Logger::error(DeviceId deviceId, char *message, ...) {
-	if (logLevel > Error)
+	if (minLevel > Error || getLogLevel(deviceId) > Error)
 		return;
 	va_list args;
 	va_start(args, message);
@@ -139,6 +147,8 @@ void Logger::error(DeviceId deviceId, char *message, ...) {
  * printf() style, see Logger::logMessage()
  */
 void Logger::console(char *message, ...) {
+	if (deferred)
+		flush(); // keep console output in order with queued log messages
 	va_list args;
 	va_start(args, message);
 	Logger::logMessage(message, args);
@@ -147,9 +157,38 @@ void Logger::console(char *message, ...) {
 
 /*
  * Set the log level. Any output below the specified log level will be omitted.
+ * This also removes all individual device log levels.
  */
 void Logger::setLoglevel(LogLevel level) {
 	logLevel = level;
+	for (int i = 0; i < CFG_LOG_NUM_DEVICE_LEVELS; i++)
+		deviceLevels[i].deviceId = 0;
+	updateMinLevel();
+}
+
+/*
+ * Set an individual log level for one device, e.g. to debug only the MemCache.
+ * Messages logged with this deviceId use this level instead of the global one.
+ */
+void Logger::setLoglevel(DeviceId deviceId, LogLevel level) {
+	int freeEntry = -1;
+
+	for (int i = 0; i < CFG_LOG_NUM_DEVICE_LEVELS; i++) {
+		if (deviceLevels[i].deviceId == deviceId) {
+			deviceLevels[i].level = level;
+			updateMinLevel();
+			return;
+		}
+		if (freeEntry == -1 && deviceLevels[i].deviceId == 0)
+			freeEntry = i;
+	}
+	if (freeEntry == -1) {
+		error("no room for another device log level");
+		return;
+	}
+	deviceLevels[freeEntry].deviceId = deviceId;
+	deviceLevels[freeEntry].level = level;
+	updateMinLevel();
 }
 
 /*
@@ -159,6 +198,38 @@ Logger::LogLevel Logger::getLogLevel() {
 	return logLevel;
 }
 
+/*
+ * Retrieve the log level which applies to a device (its own or the global one).
+ */
+Logger::LogLevel Logger::getLogLevel(DeviceId deviceId) {
+	for (int i = 0; i < CFG_LOG_NUM_DEVICE_LEVELS; i++) {
+		if (deviceLevels[i].deviceId == deviceId)
+			return deviceLevels[i].level;
+	}
+	return logLevel;
+}
+
+/*
+ * List the devices which have an individual log level.
+ */
+void Logger::printDeviceLogLevels() {
+	for (int i = 0; i < CFG_LOG_NUM_DEVICE_LEVELS; i++) {
+		if (deviceLevels[i].deviceId != 0)
+			console("     %X - log level %d", deviceLevels[i].deviceId, deviceLevels[i].level);
+	}
+}
+
+/*
+ * Recalculate the lowest enabled level which is checked by the LOG_xxx() macros.
+ */
+void Logger::updateMinLevel() {
+	minLevel = logLevel;
+	for (int i = 0; i < CFG_LOG_NUM_DEVICE_LEVELS; i++) {
+		if (deviceLevels[i].deviceId != 0 && deviceLevels[i].level < minLevel)
+			minLevel = deviceLevels[i].level;
+	}
+}
+
 /*
  * Return a timestamp when the last log entry was made.
  */
@@ -167,7 +238,7 @@ uint32_t Logger::getLastLogTime() {
 }
 
 /*
- * Returns if debug log level is enabled. This can be used in time critical
+ * Returns if debug log level is enabled (globally or for any device). This can be used in time critical
  * situations to prevent unnecessary string concatenation (if the message won't
  * be logged in the end).
  *
@@ -177,11 +248,66 @@ uint32_t Logger::getLastLogTime() {
  * }
  */
 boolean Logger::isDebug() {
-	return logLevel == Debug;
+	return minLevel == Debug;
 }
 
 /*
- * Output a log message (called by debug(), info(), warn(), error(), console())
+ * Enable or disable deferred logging. In deferred mode debug(), info(), warn()
+ * and error() only copy their parameters into a RAM ring buffer which takes
+ * constant time and never blocks on the USB host. The records are formatted
+ * and printed by loop(). Switching deferred mode off prints all pending records.
+ */
+void Logger::setDeferred(boolean defer) {
+	if (!defer)
+		flush();
+	deferred = defer;
+}
+
+/*
+ * Returns if log messages are queued instead of being printed immediately.
+ */
+boolean Logger::isDeferred() {
+	return deferred;
+}
+
+/*
+ * Returns the number of log messages which were dropped because the ring buffer was full.
+ */
+uint32_t Logger::getOverruns() {
+	return overruns;
+}
+
+/*
+ * Print up to CFG_LOG_DRAIN_RECORDS queued log records. To be called from the main loop.
+ */
+void Logger::loop() {
+	for (int i = 0; i < CFG_LOG_DRAIN_RECORDS; i++) {
+		LogRecord *record = &records[readIndex & (CFG_LOG_BUFFER_SIZE - 1)];
+
+		if (readIndex == writeIndex || !record->committed)
+			break; // empty or the producer is still filling in the record
+		printRecord(record);
+		record->committed = 0;
+		readIndex++;
+	}
+
+	if (overruns != reportedOverruns && readIndex == writeIndex) {
+		serialOutput.print(overruns - reportedOverruns);
+		serialOutput.println(" log messages lost (buffer overrun)");
+		reportedOverruns = overruns;
+	}
+}
+
+/*
+ * Print all queued log records.
+ */
+void Logger::flush() {
+	while (readIndex != writeIndex && records[readIndex & (CFG_LOG_BUFFER_SIZE - 1)].committed)
+		loop();
+}
+
+/*
+ * Output a log message (called by debug(), info(), warn(), error())
  *
  * Supports printf() like syntax:
  *
@@ -200,48 +326,48 @@ boolean Logger::isDebug() {
  */
 void Logger::log(DeviceId deviceId, LogLevel level, char *format, va_list args) {
 	lastLogTime = millis();
-	SerialUSB.print(lastLogTime);
-	SerialUSB.print(" - ");
+
+	if (deferred) {
+		queueMessage(deviceId, level, format, args);
+		return;
+	}
+	printHeader(lastLogTime, deviceId, level);
+	logMessage(format, args);
+}
+
+/*
+ * Print the time stamp, log level and device name which precede every log message
+ */
+void Logger::printHeader(uint32_t timeStamp, DeviceId deviceId, LogLevel level) {
+	serialOutput.print(timeStamp);
+	serialOutput.print(" - ");
 
 	switch (level) {
 	case Debug:
-		SerialUSB.print("DEBUG");
+		serialOutput.print("DEBUG");
 		break;
 	case Info:
-		SerialUSB.print("INFO");
+		serialOutput.print("INFO");
 		break;
 	case Warn:
-		SerialUSB.print("WARNING");
+		serialOutput.print("WARNING");
 		break;
 	case Error:
-		SerialUSB.print("ERROR");
+		serialOutput.print("ERROR");
+		break;
+	default:
 		break;
 	}
-	SerialUSB.print(": ");
+	serialOutput.print(": ");
 
 	if (deviceId)
 		printDeviceName(deviceId);
-
-	logMessage(format, args);
 }
 
 /*
  * Output a log message (called by log(), console())
  *
- * Supports printf() like syntax:
- *
- * %% - outputs a '%' character
- * %s - prints the next parameter as string
- * %d - prints the next parameter as decimal
- * %f - prints the next parameter as double float
- * %x - prints the next parameter as hex value
- * %X - prints the next parameter as hex value with '0x' added before
- * %b - prints the next parameter as binary value
- * %B - prints the next parameter as binary value with '0b' added before
- * %l - prints the next parameter as long
- * %c - prints the next parameter as a character
- * %t - prints the next parameter as boolean ('T' or 'F')
- * %T - prints the next parameter as boolean ('true' or 'false')
+ * Supports printf() like syntax, see Logger::log()
  */
 void Logger::logMessage(char *format, va_list args) {
 	for (; *format != 0; ++format) {
@@ -249,71 +375,157 @@ void Logger::logMessage(char *format, va_list args) {
 			++format;
 			if (*format == '\0')
 				break;
-			if (*format == '%') {
-				SerialUSB.print(*format);
-				continue;
-			}
-			if (*format == 's') {
-				register char *s = (char *) va_arg( args, int );
-				SerialUSB.print(s);
-				continue;
-			}
-			if (*format == 'd' || *format == 'i') {
-				SerialUSB.print(va_arg( args, int ), DEC);
-				continue;
-			}
-			if (*format == 'f') {
-				SerialUSB.print(va_arg( args, double ), 2);
-				continue;
-			}
-			if (*format == 'x') {
-				SerialUSB.print(va_arg( args, int ), HEX);
-				continue;
-			}
-			if (*format == 'X') {
-				SerialUSB.print("0x");
-				SerialUSB.print(va_arg( args, int ), HEX);
-				continue;
-			}
-			if (*format == 'b') {
-				SerialUSB.print(va_arg( args, int ), BIN);
-				continue;
-			}
-			if (*format == 'B') {
-				SerialUSB.print("0b");
-				SerialUSB.print(va_arg( args, int ), BIN);
-				continue;
-			}
-			if (*format == 'l') {
-				SerialUSB.print(va_arg( args, long ), DEC);
+			if (isArgument(*format)) {
+				if (*format == 'f') {
+					float value = va_arg( args, double );
+					printArgument(*format, *(uint32_t *) &value);
+				} else if (*format == 's')
+					serialOutput.print(va_arg( args, char * ));
+				else
+					printArgument(*format, va_arg( args, uint32_t ));
 				continue;
 			}
+		}
+		serialOutput.print(*format);
+	}
+	serialOutput.println();
+}
 
-			if (*format == 'c') {
-				SerialUSB.print(va_arg( args, int ));
-				continue;
-			}
-			if (*format == 't') {
-				if (va_arg( args, int ) == 1) {
-					SerialUSB.print("T");
-				} else {
-					SerialUSB.print("F");
-				}
-				continue;
-			}
-			if (*format == 'T') {
-				if (va_arg( args, int ) == 1) {
-					SerialUSB.print(Constants::trueStr);
-				} else {
-					SerialUSB.print(Constants::falseStr);
-				}
+/*
+ * Store a log message in the ring buffer (called by log() in deferred mode)
+ *
+ * A slot is reserved with an exclusive load/store on writeIndex so interrupt handlers
+ * may log too. If the buffer is full, the message is dropped and counted as overrun.
+ * Strings (%s) are copied into the record as they may not exist any more when it is printed.
+ *
+ * Only the pointer to the format is stored, so it must be a string literal (or another
+ * string which lives forever). Never pass a buffer as format, log it with "%s" instead.
+ */
+void Logger::queueMessage(DeviceId deviceId, LogLevel level, char *format, va_list args) {
+	uint32_t index;
+	LogRecord *record;
+
+	do {
+		index = __LDREXW((uint32_t *) &writeIndex);
+		if (index - readIndex >= CFG_LOG_BUFFER_SIZE) {
+			__CLREX();
+			overruns++;
+			return;
+		}
+	} while (__STREXW(index + 1, (uint32_t *) &writeIndex));
+
+	record = &records[index & (CFG_LOG_BUFFER_SIZE - 1)];
+	record->timeStamp = lastLogTime;
+	record->format = format;
+	record->deviceId = deviceId;
+	record->level = level;
+
+	uint8_t numArgs = 0, stringPos = 0;
+	for (; *format != 0 && numArgs < CFG_LOG_MAX_ARGS; ++format) {
+		if (*format != '%')
+			continue;
+		++format;
+		if (*format == '\0')
+			break;
+		if (!isArgument(*format))
+			continue;
+		if (*format == 'f') {
+			float value = va_arg( args, double );
+			record->args[numArgs++] = *(uint32_t *) &value;
+		} else if (*format == 's') {
+			char *s = va_arg( args, char * );
+			record->args[numArgs++] = stringPos;
+			while (*s && stringPos < CFG_LOG_STRING_SIZE - 1)
+				record->strings[stringPos++] = *s++;
+			record->strings[stringPos] = 0;
+			if (stringPos < CFG_LOG_STRING_SIZE - 1)
+				stringPos++;
+		} else
+			record->args[numArgs++] = va_arg( args, uint32_t );
+	}
+	record->committed = 1;
+}
+
+/*
+ * Format and print a queued log record (called by loop())
+ */
+void Logger::printRecord(LogRecord *record) {
+	uint8_t numArgs = 0;
+
+	printHeader(record->timeStamp, (DeviceId) record->deviceId, (LogLevel) record->level);
+	for (char *format = record->format; *format != 0; ++format) {
+		if (*format == '%') {
+			++format;
+			if (*format == '\0')
+				break;
+			if (isArgument(*format)) {
+				if (numArgs >= CFG_LOG_MAX_ARGS)
+					serialOutput.print('?');
+				else if (*format == 's')
+					serialOutput.print(record->strings + record->args[numArgs++]);
+				else
+					printArgument(*format, record->args[numArgs++]);
 				continue;
 			}
-
 		}
-		SerialUSB.print(*format);
+		serialOutput.print(*format);
+	}
+	serialOutput.println();
+}
+
+/*
+ * Returns if the character following a '%' consumes a parameter
+ */
+boolean Logger::isArgument(char type) {
+	switch (type) {
+	case 's': case 'd': case 'i': case 'f': case 'x': case 'X':
+	case 'b': case 'B': case 'l': case 'c': case 't': case 'T':
+		return true;
+	}
+	return false;
+}
+
+/*
+ * Print a single parameter according to its format character. All parameters are
+ * passed as 32 bit values, floats as their bit pattern. Strings are handled by the
+ * callers as a pointer doesn't fit into 32 bits on every platform (e.g. the host tests).
+ */
+void Logger::printArgument(char type, uint32_t value) {
+	switch (type) {
+	case 'd':
+	case 'i':
+		serialOutput.print((int) value, DEC);
+		break;
+	case 'f':
+		serialOutput.print(*(float *) &value, 2);
+		break;
+	case 'x':
+		serialOutput.print((int) value, HEX);
+		break;
+	case 'X':
+		serialOutput.print("0x");
+		serialOutput.print((int) value, HEX);
+		break;
+	case 'b':
+		serialOutput.print((int) value, BIN);
+		break;
+	case 'B':
+		serialOutput.print("0b");
+		serialOutput.print((int) value, BIN);
+		break;
+	case 'l':
+		serialOutput.print((long) value, DEC);
+		break;
+	case 'c':
+		serialOutput.print((int) value);
+		break;
+	case 't':
+		serialOutput.print(value == 1 ? "T" : "F");
+		break;
+	case 'T':
+		serialOutput.print(value == 1 ? Constants::trueStr : Constants::falseStr);
+		break;
 	}
-	SerialUSB.println();
 }
 
 /*
@@ -325,49 +537,51 @@ void Logger::logMessage(char *format, va_list args) {
 void Logger::printDeviceName(DeviceId deviceId) {
 	switch (deviceId) {
 	case DMOC645:
-		SerialUSB.print("DMOC645");
+		serialOutput.print("DMOC645");
 		break;
 	case BRUSA_DMC5:
-		SerialUSB.print("DMC5");
+		serialOutput.print("DMC5");
 		break;
 	case BRUSACHARGE:
-		SerialUSB.print("NLG5");
+		serialOutput.print("NLG5");
 		break;
 	case TCCHCHARGE:
-		SerialUSB.print("TCCH");
+		serialOutput.print("TCCH");
 		break;
 	case THROTTLE:
-		SerialUSB.print("THROTTLE");
+		serialOutput.print("THROTTLE");
 		break;
 	case POTACCELPEDAL:
-		SerialUSB.print("POTACCEL");
+		serialOutput.print("POTACCEL");
 		break;
 	case POTBRAKEPEDAL:
-		SerialUSB.print("POTBRAKE");
+		serialOutput.print("POTBRAKE");
 		break;
 	case CANACCELPEDAL:
-		SerialUSB.print("CANACCEL");
+		serialOutput.print("CANACCEL");
 		break;
 	case CANBRAKEPEDAL:
-		SerialUSB.print("CANBRAKE");
+		serialOutput.print("CANBRAKE");
 		break;
 	case ICHIP2128:
-		SerialUSB.print("ICHIP");
+		serialOutput.print("ICHIP");
 		break;
 	case THINKBMS:
-		SerialUSB.print("THINKBMS");
+		serialOutput.print("THINKBMS");
 		break;
 	case SYSTEM:
-		SerialUSB.print("SYSTEM");
+		serialOutput.print("SYSTEM");
 		break;
 	case HEARTBEAT:
-		SerialUSB.print("HEARTBEAT");
+		serialOutput.print("HEARTBEAT");
 		break;
 	case MEMCACHE:
-		SerialUSB.print("MEMCACHE");
+		serialOutput.print("MEMCACHE");
+		break;
+	default:
 		break;
 	}
-	SerialUSB.print(" - ");
+	serialOutput.print(" - ");
 
 }
 
@@ -31,6 +31,34 @@
 #include "config.h"
 #include "DeviceTypes.h"
 #include "constants.h"
+#include "SerialOutput.h"
+
+/*
+ * Preferred way to log from code which runs often. Statements below CFG_LOG_MIN_LEVEL
+ * are removed at compile time. The remaining ones cost a single comparison unless the
+ * level is enabled for at least one device, in which case the parameters are evaluated
+ * and the Logger function decides per device.
+ */
+#if CFG_LOG_MIN_LEVEL <= 0
+#define LOG_DEBUG(...) do { if (Logger::isEnabled(Logger::Debug)) Logger::debug(__VA_ARGS__); } while (0)
+#else
+#define LOG_DEBUG(...) do {} while (0)
+#endif
+#if CFG_LOG_MIN_LEVEL <= 1
+#define LOG_INFO(...) do { if (Logger::isEnabled(Logger::Info)) Logger::info(__VA_ARGS__); } while (0)
+#else
+#define LOG_INFO(...) do {} while (0)
+#endif
+#if CFG_LOG_MIN_LEVEL <= 2
+#define LOG_WARN(...) do { if (Logger::isEnabled(Logger::Warn)) Logger::warn(__VA_ARGS__); } while (0)
+#else
+#define LOG_WARN(...) do {} while (0)
+#endif
+#if CFG_LOG_MIN_LEVEL <= 3
+#define LOG_ERROR(...) do { if (Logger::isEnabled(Logger::Error)) Logger::error(__VA_ARGS__); } while (0)
+#else
+#define LOG_ERROR(...) do {} while (0)
+#endif
 
 class Logger {
 public:
@@ -47,16 +75,58 @@ public:
 	static void error(DeviceId, char *, ...);
 	static void console(char *, ...);
 	static void setLoglevel(LogLevel);
+	static void setLoglevel(DeviceId, LogLevel);
 	static LogLevel getLogLevel();
+	static LogLevel getLogLevel(DeviceId);
+	static void printDeviceLogLevels();
+	static inline boolean isEnabled(LogLevel level) { return level >= minLevel; }
 	static uint32_t getLastLogTime();
 	static boolean isDebug();
+	static void setDeferred(boolean);
+	static boolean isDeferred();
+	static uint32_t getOverruns();
+	static void loop();
+	static void flush();
 private:
+	/*
+	 * A log message captured in deferred mode. Only the raw parameters are stored,
+	 * the formatting is done later when the record is printed from loop().
+	 */
+	struct LogRecord {
+		uint32_t timeStamp;
+		char *format;
+		uint16_t deviceId;
+		uint8_t level;
+		volatile uint8_t committed; // set once the producer has filled in the record
+		uint32_t args[CFG_LOG_MAX_ARGS]; // int/long as is, float bits for %f, offset into strings for %s
+		char strings[CFG_LOG_STRING_SIZE];
+	};
+
+	struct DeviceLogLevel {
+		uint16_t deviceId; // 0 = unused entry
+		LogLevel level;
+	};
+
 	static LogLevel logLevel;
+	static LogLevel minLevel; // lowest level enabled globally or for any device
+	static DeviceLogLevel deviceLevels[CFG_LOG_NUM_DEVICE_LEVELS];
 	static uint32_t lastLogTime;
+	static boolean deferred;
+	static LogRecord records[CFG_LOG_BUFFER_SIZE];
+	static volatile uint32_t writeIndex;
+	static uint32_t readIndex;
+	static volatile uint32_t overruns;
+	static uint32_t reportedOverruns;
 
 	static void log(DeviceId, LogLevel, char *format, va_list);
 	static void logMessage(char *format, va_list args);
+	static void queueMessage(DeviceId, LogLevel, char *format, va_list args);
+	static void printRecord(LogRecord *record);
+	static void printHeader(uint32_t timeStamp, DeviceId, LogLevel);
+	static void printArgument(char type, uint32_t value);
+	static boolean isArgument(char type);
 	static void printDeviceName(DeviceId);
+	static void updateMinLevel();
 };
 
 #endif /* LOGGER_H_ */
@@ -0,0 +1,217 @@
+/*
+ * LoopHandler.cpp
+ *
+ * Runs the registered tasks from the main loop, see LoopHandler.h.
+ *
+Copyright (c) 2013-14 Collin Kidder, Michael Neuweiler, Charles Galpin
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+ */
+
+#include "LoopHandler.h"
+#include "Logger.h"
+
+LoopHandler *LoopHandler::instance = NULL;
+
+/*
+ * Upper limits (in us) of the buckets of the pass time histogram, the last bucket takes the rest
+ */
+static const uint32_t passLimits[LOOP_HISTOGRAM_BUCKETS - 1] = { 50, 100, 250, 500, 1000, 2500, 5000, 10000 };
+
+LoopHandler::LoopHandler() {
+	numTasks = 0;
+	numHighPriority = 0;
+	resetStatistics();
+}
+
+/*
+ * Get the singleton instance of the LoopHandler
+ */
+LoopHandler *LoopHandler::getInstance() {
+	if (instance == NULL) {
+		instance = new LoopHandler();
+	}
+	return instance;
+}
+
+/*
+ * Register an observer whose handleLoop() is called from loop(). The budget is
+ * the time in us the observer is expected to need at most per call.
+ */
+void LoopHandler::attach(LoopObserver *observer, LoopPriority priority, uint16_t budget, const char *name) {
+	add(observer, NULL, priority, budget, name);
+}
+
+/*
+ * Register a plain function (e.g. a poll function of sys_io) to be called from loop().
+ */
+void LoopHandler::attach(LoopFunction function, LoopPriority priority, uint16_t budget, const char *name) {
+	add(NULL, function, priority, budget, name);
+}
+
+void LoopHandler::add(LoopObserver *observer, LoopFunction function, LoopPriority priority, uint16_t budget, const char *name) {
+	for (int i = 0; i < numTasks; i++) {
+		if (tasks[i].observer == observer && tasks[i].function == function)
+			return; // already attached (e.g. set up a second time)
+	}
+	if (numTasks >= CFG_LOOP_NUM_TASKS) {
+		Logger::error("no free loop task slot left for %s", name);
+		return;
+	}
+
+	// keep the list sorted by priority, tasks with the same priority in the order they were attached
+	int position = numTasks;
+	while (position > 0 && tasks[position - 1].priority > priority) {
+		tasks[position] = tasks[position - 1];
+		position--;
+	}
+
+	LoopTask *task = &tasks[position];
+	task->observer = observer;
+	task->function = function;
+	task->name = name;
+	task->priority = priority;
+	task->budget = budget;
+	task->lastRun = micros();
+	task->runs = 0;
+	task->overruns = 0;
+	task->starved = 0;
+	task->maxTime = 0;
+	task->totalTime = 0;
+	numTasks++;
+	if (priority == LOOP_PRIORITY_HIGH)
+		numHighPriority++;
+}
+
+/*
+ * Remove an observer, e.g. before a device registers itself again in setup()
+ */
+void LoopHandler::detach(LoopObserver *observer) {
+	for (int i = 0; i < numTasks; i++) {
+		if (tasks[i].observer == observer) {
+			if (tasks[i].priority == LOOP_PRIORITY_HIGH)
+				numHighPriority--;
+			for (int j = i; j < numTasks - 1; j++)
+				tasks[j] = tasks[j + 1];
+			numTasks--;
+			i--;
+		}
+	}
+}
+
+/*
+ * Run one pass of all tasks. To be called from loop().
+ */
+void LoopHandler::process() {
+	uint32_t start = micros();
+	uint32_t now = runHighPriority(start);
+	bool ranOther = false;
+
+	for (int i = numHighPriority; i < numTasks; i++) {
+		LoopTask *task = &tasks[i];
+		bool starving = (now - task->lastRun) >= CFG_LOOP_STARVATION_TIME;
+
+		if (ranOther && !starving && (now - start) + task->budget > CFG_LOOP_PASS_BUDGET)
+			continue; // no time left in this pass, the task runs with the next one
+		if (starving && task->runs > 0)
+			task->starved++;
+		now = run(task, now);
+		now = runHighPriority(now); // let the latency critical tasks in between
+		ranOther = true;
+	}
+
+	uint32_t passTime = now - start;
+	int bucket = 0;
+	while (bucket < LOOP_HISTOGRAM_BUCKETS - 1 && passTime >= passLimits[bucket])
+		bucket++;
+	histogram[bucket]++;
+	if (passTime > maxPassTime)
+		maxPassTime = passTime;
+}
+
+/*
+ * Run a task and record its run time. Returns the time when it finished, so
+ * consecutive runs need only one call of micros() each.
+ */
+uint32_t LoopHandler::run(LoopTask *task, uint32_t start) {
+	if (task->observer)
+		task->observer->handleLoop();
+	else
+		task->function();
+
+	uint32_t end = micros();
+	uint32_t time = end - start;
+	task->lastRun = end;
+	task->runs++;
+	task->totalTime += time;
+	if (time > task->maxTime)
+		task->maxTime = time;
+	if (time > task->budget)
+		task->overruns++;
+	return end;
+}
+
+uint32_t LoopHandler::runHighPriority(uint32_t start) {
+	for (int i = 0; i < numHighPriority; i++)
+		start = run(&tasks[i], start);
+	return start;
+}
+
+/*
+ * Print the statistics of all tasks and the histogram of the pass times on the console
+ */
+void LoopHandler::printStatistics() {
+	static const char *priorityNames[] = { "high", "normal", "low" };
+
+	Logger::console("task        prio    budget  runs        avg     max     overruns  starved");
+	for (int i = 0; i < numTasks; i++) {
+		LoopTask *task = &tasks[i];
+		Logger::console("%s  %s  %dus  %l  %dus  %dus  %l  %l", task->name, priorityNames[task->priority], task->budget, task->runs,
+				(task->runs ? (uint32_t) (task->totalTime / task->runs) : 0), task->maxTime, task->overruns, task->starved);
+	}
+	Logger::console("loop pass times (max %dus):", maxPassTime);
+	for (int i = 0; i < LOOP_HISTOGRAM_BUCKETS; i++) {
+		if (i < LOOP_HISTOGRAM_BUCKETS - 1)
+			Logger::console("  < %dus: %l", passLimits[i], histogram[i]);
+		else
+			Logger::console(" >= %dus: %l", passLimits[i - 1], histogram[i]);
+	}
+}
+
+void LoopHandler::resetStatistics() {
+	for (int i = 0; i < numTasks; i++) {
+		tasks[i].runs = 0;
+		tasks[i].overruns = 0;
+		tasks[i].starved = 0;
+		tasks[i].maxTime = 0;
+		tasks[i].totalTime = 0;
+	}
+	for (int i = 0; i < LOOP_HISTOGRAM_BUCKETS; i++)
+		histogram[i] = 0;
+	maxPassTime = 0;
+}
+
+/*
+ * Default implementation of the LoopObserver method. Must be overwritten by every sub-class.
+ */
+void LoopObserver::handleLoop() {
+	Logger::error("LoopObserver does not implement handleLoop()");
+}
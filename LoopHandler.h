@@ -0,0 +1,101 @@
+/*
+ * LoopHandler.h
+ *
+ * Class where LoopObservers (and plain functions) register to be called from
+ * the main loop(). Each task has a priority and a time budget.
+ *
+ * High priority tasks (e.g. reading CAN frames, processing queued ticks,
+ * polling the ADC) are run at the start of every pass and again after every
+ * other task, so a long running background task delays them by at most its
+ * own run time. Normal and low priority tasks run in the order of their
+ * priority. Once a pass has used up CFG_LOOP_PASS_BUDGET, tasks whose budget
+ * doesn't fit any more are deferred to the next pass. A deferred task is run
+ * regardless of the budget if it didn't run for CFG_LOOP_STARVATION_TIME,
+ * this is counted as starvation.
+ *
+ * The run time of every task and the duration of every pass (as histogram)
+ * are recorded and can be printed on the console.
+ *
+Copyright (c) 2013-14 Collin Kidder, Michael Neuweiler, Charles Galpin
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+ */
+
+#ifndef LOOPHANDLER_H_
+#define LOOPHANDLER_H_
+
+#include <Arduino.h>
+#include "config.h"
+
+#define LOOP_HISTOGRAM_BUCKETS 9
+
+typedef void (*LoopFunction)();
+
+class LoopObserver {
+public:
+	virtual void handleLoop();
+};
+
+enum LoopPriority {
+	LOOP_PRIORITY_HIGH, // latency critical, run between all other tasks
+	LOOP_PRIORITY_NORMAL,
+	LOOP_PRIORITY_LOW // background work which may be deferred first
+};
+
+class LoopHandler {
+public:
+	static LoopHandler *getInstance();
+	void attach(LoopObserver *observer, LoopPriority priority, uint16_t budget, const char *name);
+	void attach(LoopFunction function, LoopPriority priority, uint16_t budget, const char *name);
+	void detach(LoopObserver *observer);
+	void process();
+	void printStatistics();
+	void resetStatistics();
+
+private:
+	struct LoopTask {
+		LoopObserver *observer;
+		LoopFunction function;
+		const char *name;
+		LoopPriority priority;
+		uint16_t budget; // expected max run time in us
+		uint32_t lastRun; // micros() of the last run
+		uint32_t runs;
+		uint32_t overruns; // number of runs which took longer than the budget
+		uint32_t starved; // number of runs which were forced after CFG_LOOP_STARVATION_TIME
+		uint32_t maxTime; // longest run in us
+		uint64_t totalTime; // sum of all runs in us
+	};
+
+	static LoopHandler *instance;
+	LoopTask tasks[CFG_LOOP_NUM_TASKS]; // sorted by priority
+	uint8_t numTasks;
+	uint8_t numHighPriority; // the high priority tasks are at the start of the list
+	uint32_t histogram[LOOP_HISTOGRAM_BUCKETS]; // number of passes per duration, see passLimits
+	uint32_t maxPassTime;
+
+	LoopHandler(); //it's not right to try to directly instantiate this class
+	void add(LoopObserver *observer, LoopFunction function, LoopPriority priority, uint16_t budget, const char *name);
+	uint32_t run(LoopTask *task, uint32_t start);
+	uint32_t runHighPriority(uint32_t start);
+};
+
+#endif /* LOOPHANDLER_H_ */
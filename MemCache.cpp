@@ -200,7 +200,7 @@ boolean MemCache::Write(uint32_t address, uint32_t valu)
 boolean MemCache::Write(uint32_t address, void* data, uint16_t len)
 {
   uint32_t addr;
-  uint8_t c;
+  uint8_t c = 0xFF;
   uint16_t count;
 
   for (count = 0; count < len; count++) {
@@ -261,7 +261,7 @@ boolean MemCache::Read(uint32_t address, uint32_t* valu)
 boolean MemCache::Read(uint32_t address, void* data, uint16_t len)
 {
   uint32_t addr;
-  uint8_t c;
+  uint8_t c = 0xFF;
   uint16_t count;
 
   for (count = 0; count < len; count++) {
@@ -357,7 +357,7 @@ uint8_t MemCache::cache_readpage(uint32_t addr)
   uint8_t buffer[3];
   uint8_t i2c_id;
   c = cache_findpage();
-//  Logger::debug("r");
+//  LOG_DEBUG("r");
   if (c != 0xFF) {
     buffer[0] = ((address & 0xFF00) >> 8);
     //buffer[1] = (address & 0x00FF);
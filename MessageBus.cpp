@@ -0,0 +1,264 @@
+/*
+ * MessageBus.cpp
+ *
+ * Typed messages between devices, delivered immediately or from the main loop.
+ *
+Copyright (c) 2013-14 Collin Kidder, Michael Neuweiler, Charles Galpin
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+ */
+
+#include "MessageBus.h"
+#include "Logger.h"
+
+MessageBus *MessageBus::instance = NULL;
+
+MessageBus::MessageBus() {
+	for (int i = 0; i < CFG_MSG_BUS_POOL_SIZE; i++)
+		freeMessages[i] = &pool[i];
+	numFree = CFG_MSG_BUS_POOL_SIZE;
+	queueHead = queueLength = 0;
+	numSubscriptions = 0;
+	lost = 0;
+	LoopHandler::getInstance()->attach(this, LOOP_PRIORITY_NORMAL, CFG_LOOP_BUDGET_MESSAGES, "messages");
+}
+
+/*
+ * Get the singleton instance of the MessageBus
+ */
+MessageBus *MessageBus::getInstance() {
+	if (instance == NULL) {
+		instance = new MessageBus();
+	}
+	return instance;
+}
+
+/*
+ * Register an observer for a message type. The observer receives the messages
+ * of this type which are sent to all (INVALID) or to the given id.
+ */
+void MessageBus::subscribe(MessageObserver *observer, uint32_t type, DeviceId id) {
+	for (int i = 0; i < numSubscriptions; i++) {
+		if (subscriptions[i].observer == observer && subscriptions[i].type == type)
+			return; // already subscribed (e.g. setup() was called again)
+	}
+	if (numSubscriptions >= CFG_MSG_BUS_MAX_SUBSCRIPTIONS) {
+		Logger::error("unable to subscribe to message %X, max number of subscriptions reached", type);
+		return;
+	}
+	subscriptions[numSubscriptions].observer = observer;
+	subscriptions[numSubscriptions].type = type;
+	subscriptions[numSubscriptions].id = id;
+	numSubscriptions++;
+}
+
+/*
+ * Remove all subscriptions of an observer
+ */
+void MessageBus::unsubscribe(MessageObserver *observer) {
+	for (int i = 0; i < numSubscriptions;) {
+		if (subscriptions[i].observer == observer) {
+			for (int j = i; j < numSubscriptions - 1; j++)
+				subscriptions[j] = subscriptions[j + 1];
+			numSubscriptions--;
+		} else
+			i++;
+	}
+}
+
+/*
+ * Take a message from the pool. It has to be handed back via send() or post().
+ * Returns NULL if the pool is empty.
+ */
+Message *MessageBus::allocate(uint32_t type, DeviceId receiver) {
+	Message *message = NULL;
+
+	noInterrupts(); // a tick handler might post a message too
+	if (numFree > 0)
+		message = freeMessages[--numFree];
+	else
+		lost++;
+	interrupts();
+
+	if (message) {
+		message->type = type;
+		message->receiver = receiver;
+	}
+	return message;
+}
+
+/*
+ * Return a message to the pool
+ */
+void MessageBus::release(Message *message) {
+	noInterrupts();
+	freeMessages[numFree++] = message;
+	interrupts();
+}
+
+/*
+ * Deliver a message of the pool to its receivers right now and release it.
+ */
+void MessageBus::send(Message *message) {
+	deliver(message);
+	release(message);
+}
+
+/*
+ * Queue a message of the pool, it's delivered (and released) from the main loop.
+ * The queue can hold all messages of the pool, so this never fails.
+ */
+void MessageBus::post(Message *message) {
+	noInterrupts();
+	queue[(queueHead + queueLength) % CFG_MSG_BUS_POOL_SIZE] = message;
+	queueLength++;
+	interrupts();
+}
+
+/*
+ * Send a message without payload (e.g. MSG_CONFIG_CHANGE) right now.
+ * Synchronous messages don't need the pool, they live on the stack.
+ */
+void MessageBus::send(uint32_t type, DeviceId receiver) {
+	Message message;
+
+	message.type = type;
+	message.receiver = receiver;
+	deliver(&message);
+}
+
+/*
+ * Send a message with a text (e.g. MSG_COMMAND) right now.
+ */
+void MessageBus::send(uint32_t type, DeviceId receiver, const char *text) {
+	Message message;
+
+	message.type = type;
+	message.receiver = receiver;
+	setText(&message, text);
+	deliver(&message);
+}
+
+/*
+ * Send a message with a named value (e.g. MSG_SET_PARAM) right now.
+ */
+void MessageBus::send(uint32_t type, DeviceId receiver, const char *key, int32_t value) {
+	Message message;
+
+	message.type = type;
+	message.receiver = receiver;
+	setParameter(&message, key, value);
+	deliver(&message);
+}
+
+/*
+ * Post a message without payload, returns false if the pool is empty.
+ */
+bool MessageBus::post(uint32_t type, DeviceId receiver) {
+	Message *message = allocate(type, receiver);
+
+	if (message == NULL)
+		return false;
+	post(message);
+	return true;
+}
+
+/*
+ * Post a message with a text, returns false if the pool is empty.
+ */
+bool MessageBus::post(uint32_t type, DeviceId receiver, const char *text) {
+	Message *message = allocate(type, receiver);
+
+	if (message == NULL)
+		return false;
+	setText(message, text);
+	post(message);
+	return true;
+}
+
+/*
+ * Post a message with a named value, returns false if the pool is empty.
+ */
+bool MessageBus::post(uint32_t type, DeviceId receiver, const char *key, int32_t value) {
+	Message *message = allocate(type, receiver);
+
+	if (message == NULL)
+		return false;
+	setParameter(message, key, value);
+	post(message);
+	return true;
+}
+
+/*
+ * Deliver the messages which were posted until now (called by the LoopHandler).
+ * Messages posted by the receivers are delivered in the next pass.
+ */
+void MessageBus::handleLoop() {
+	uint8_t pending = queueLength;
+
+	while (pending--) {
+		noInterrupts();
+		Message *message = queue[queueHead];
+		queueHead = (queueHead + 1) % CFG_MSG_BUS_POOL_SIZE;
+		queueLength--;
+		interrupts();
+
+		deliver(message);
+		release(message);
+	}
+
+	if (lost) {
+		Logger::warn("message pool exhausted, %d messages lost", lost);
+		lost = 0;
+	}
+}
+
+/*
+ * Call all observers which subscribed to the type of the message (and its receiver)
+ */
+void MessageBus::deliver(const Message *message) {
+	for (int i = 0; i < numSubscriptions; i++) {
+		if (subscriptions[i].type == message->type
+				&& (message->receiver == INVALID || message->receiver == subscriptions[i].id))
+			subscriptions[i].observer->handleBusMessage(message);
+	}
+}
+
+/*
+ * Copy a text into the message, it's cut off if it's too long
+ */
+void MessageBus::setText(Message *message, const char *text) {
+	strncpy(message->text, text, CFG_MSG_BUS_TEXT_LENGTH - 1);
+	message->text[CFG_MSG_BUS_TEXT_LENGTH - 1] = 0;
+}
+
+void MessageBus::setParameter(Message *message, const char *key, int32_t value) {
+	strncpy(message->parameter.key, key, CFG_MSG_BUS_KEY_LENGTH - 1);
+	message->parameter.key[CFG_MSG_BUS_KEY_LENGTH - 1] = 0;
+	message->parameter.value = value;
+}
+
+/*
+ * Default implementation of the MessageObserver method. Must be overwritten by every sub-class.
+ */
+void MessageObserver::handleBusMessage(const Message *message) {
+	Logger::error("MessageObserver does not implement handleBusMessage()");
+}
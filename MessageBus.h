@@ -0,0 +1,109 @@
+/*
+ * MessageBus.h
+ *
+ * Typed messages between devices (and other parts of the system).
+ *
+ * A message is a small struct of fixed size which is taken from a
+ * preallocated pool, so nothing is allocated at run time and the payload
+ * isn't copied on its way to the receivers. Observers subscribe to the
+ * message types they handle. A message is either delivered immediately
+ * (send) or queued and delivered from the main loop (post). Posting is
+ * safe from interrupt and tick context, the receivers then run in the
+ * main loop and not within the sender.
+ *
+Copyright (c) 2013-14 Collin Kidder, Michael Neuweiler, Charles Galpin
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+ */
+
+#ifndef MESSAGEBUS_H_
+#define MESSAGEBUS_H_
+
+#include <Arduino.h>
+#include "config.h"
+#include "DeviceTypes.h"
+#include "Sys_Messages.h"
+#include "LoopHandler.h"
+
+struct Message {
+	uint32_t type; // one of the MSG_xxx of Sys_Messages.h
+	DeviceId receiver; // the device the message is for, INVALID = all subscribers of the type
+	union {
+		struct {
+			char key[CFG_MSG_BUS_KEY_LENGTH];
+			int32_t value;
+		} parameter; // MSG_SET_PARAM
+		char text[CFG_MSG_BUS_TEXT_LENGTH]; // MSG_COMMAND
+	};
+};
+
+/*
+ * Interface for receivers of messages
+ */
+class MessageObserver {
+public:
+	virtual void handleBusMessage(const Message *message);
+};
+
+class MessageBus: public LoopObserver {
+public:
+	static MessageBus *getInstance();
+	void subscribe(MessageObserver *observer, uint32_t type, DeviceId id);
+	void unsubscribe(MessageObserver *observer);
+
+	Message *allocate(uint32_t type, DeviceId receiver);
+	void send(Message *message);
+	void post(Message *message);
+
+	void send(uint32_t type, DeviceId receiver);
+	void send(uint32_t type, DeviceId receiver, const char *text);
+	void send(uint32_t type, DeviceId receiver, const char *key, int32_t value);
+	bool post(uint32_t type, DeviceId receiver);
+	bool post(uint32_t type, DeviceId receiver, const char *text);
+	bool post(uint32_t type, DeviceId receiver, const char *key, int32_t value);
+
+	void handleLoop();
+
+private:
+	struct Subscription {
+		MessageObserver *observer;
+		uint32_t type;
+		DeviceId id; // id of the observer, receives messages to INVALID and to this id
+	};
+
+	static MessageBus *instance;
+	Message pool[CFG_MSG_BUS_POOL_SIZE];
+	Message *freeMessages[CFG_MSG_BUS_POOL_SIZE]; // stack of the unused messages in the pool
+	uint8_t numFree;
+	Message *queue[CFG_MSG_BUS_POOL_SIZE]; // posted messages waiting for delivery (can hold the whole pool)
+	volatile uint8_t queueHead, queueLength;
+	Subscription subscriptions[CFG_MSG_BUS_MAX_SUBSCRIPTIONS];
+	uint8_t numSubscriptions;
+	volatile uint32_t lost; // messages which couldn't be posted because the pool was empty
+
+	MessageBus(); //it's not right to try to directly instantiate this class
+	void deliver(const Message *message);
+	void release(Message *message);
+	static void setText(Message *message, const char *text);
+	static void setParameter(Message *message, const char *key, int32_t value);
+};
+
+#endif /* MESSAGEBUS_H_ */
@@ -28,6 +28,22 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  
 #include "MotorController.h"
  
+static int32_t getGearSignal(void *motorController) {
+	return ((MotorController *) motorController)->getSelectedGear();
+}
+
+static int32_t getPowerModeSignal(void *motorController) {
+	return ((MotorController *) motorController)->getPowerMode();
+}
+
+static int32_t getControllerStateSignal(void *motorController) {
+	return ((MotorController *) motorController)->getControllerState();
+}
+
+static int32_t getNominalVoltSignal(void *motorController) {
+	return ((MotorController *) motorController)->getnominalVolt() / 10; // the web site shows full volts
+}
+
 MotorController::MotorController() : Device() {
 	ready = false;
 	running = false;
@@ -45,11 +61,19 @@ MotorController::MotorController() : Device() {
 
 	powerMode = modeTorque;
 	throttleRequested = 0;
+	throttleSlewed = 0;
+	throttleSlewRate = 0;
+	slewTimestamp = 0;
 	speedRequested = 0;
 	speedActual = 0;
 	torqueRequested = 0;
 	torqueActual = 10;
 	torqueAvailable = 0;
+	torqueLimitMotor = 0;
+	torqueLimitRegen = 0;
+	envelopeRpmStep = 1;
+	envelopeVoltageStart = 0;
+	envelopeVoltageStep = 1;
 	mechanicalPower = 0;
 
 	selectedGear = NEUTRAL;
@@ -58,15 +82,15 @@ MotorController::MotorController() : Device() {
 	dcVoltage = 0;
 	dcCurrent = 0;
 	acCurrent = 0;
-	kiloWattHours = 0;
 	nominalVolts = 0;
 
-	donePrecharge = false;  
-        prelay = false;
+	controllerState = CS_PRECHARGE;
+	stateTimestamp = 0;
+	stateLogIndex = 0;
+	memset(stateLog, 0, sizeof(stateLog));
+	lastFrameTime = 0;
         coolflag = false;
         skipcounter=0;
-        testenableinput=0;
-        testreverseinput=0;
         premillis=0;
 
 
@@ -80,26 +104,27 @@ void MotorController::setup() {
 	statusBitfield2 = 0;
 	statusBitfield3 = 0;
 	statusBitfield4 = 0;
-        prefsHandler->read(EEMC_KILOWATTHRS, &kiloWattHours); //retrieve kilowatt hours from EEPROM
         nominalVolts=config->nominalVolt;
         capacity=config->capacity;
-        donePrecharge=false;
+        EnergyMeter::getInstance()->setCapacity(capacity);
+        EnergyMeter::getInstance()->setFullVoltage(nominalVolts); //the meter is reset when the voltage is higher than fully charged with no regen
         premillis=millis();      
 
-    if(config->prechargeR==12345)
-      {  
-	torqueActual=2;
-        dcCurrent=1501;
-        dcVoltage=3320;
-        
-      }
     Logger::console("PRELAY=%i - Current PreCharge Relay output", config->prechargeRelay);
     Logger::console("MRELAY=%i - Current Main Contactor Relay output", config->mainContactorRelay);
     Logger::console("PREDELAY=%i - Precharge delay time", config->prechargeR);
 	 
     //show our work
+    controllerState = CS_PRECHARGE;
+    stateTimestamp = millis();
+    startPrecharge();
     Logger::console("PRECHARGING...DOUT0:%d, DOUT1:%d, DOUT2:%d, DOUT3:%d,DOUT4:%d, DOUT5:%d, DOUT6:%d, DOUT7:%d", getOutput(0), getOutput(1), getOutput(2), getOutput(3),getOutput(4), getOutput(5), getOutput(6), getOutput(7));
     coolflag=false;
+
+    //get debounced edges of all inputs, enable and reverse are picked out in handleDigitalEdge() as they may be reconfigured
+    attachDigitalInput(this, (1 << NUM_DIGITAL) - 1);
+
+    publishSignals();
     
     Device::setup();
    
@@ -116,12 +141,9 @@ void MotorController::handleTick() {
      if(warning) statusBitfield1 |=1 << 10;else statusBitfield1 &= ~(1 <<10);
      if(faulted) statusBitfield1 |=1 << 9;else statusBitfield1 &= ~(1 <<9);
      
-     //Calculate killowatts and kilowatt hours 
+     //Calculate killowatts, energy and charge are integrated by the energy meter
        mechanicalPower=dcVoltage*dcCurrent/10000; //In kilowatts. DC voltage is x10
-       if (dcVoltage>nominalVolts && torqueActual>0) {kiloWattHours=1;} //If our voltage is higher than fully charged with no regen, zero our kwh meter
-       if (milliStamp>millis()) {milliStamp=0;} //In case millis rolls over to zero while running
-       kiloWattHours+=(millis()-milliStamp)*mechanicalPower;//We assume here that power is at current level since last tick and accrue in kilowattmilliseconds.
-       milliStamp=millis();              //reset our kwms timer for next check
+       EnergyMeter::getInstance()->addSample(dcVoltage, dcCurrent);
        
        
      //Throttle check
@@ -131,127 +153,407 @@ void MotorController::handleTick() {
 		throttleRequested = accelerator->getLevel();
 	if (brake && brake->getLevel() < -10 && brake->getLevel() < accelerator->getLevel()) //if the brake has been pressed it overrides the accelerator.
 		throttleRequested = brake->getLevel();
-	//Logger::debug("Throttle: %d", throttleRequested);
 
+	updateState();
+	if (controllerState != CS_ENABLED) { // precharge or power stage off: hold the ramp at zero so it starts from there once enabled
+		throttleRequested = 0;
+		throttleSlewed = 0;
+		throttleSlewRate = 0;
+	}
+	limitThrottle(throttleRequested); // smooth the request before the sub-classes turn it into torque or speed commands
+	updateEnvelope(); // torque limits for the sub-classes at the current speed and voltage
+	//LOG_DEBUG("Throttle: %d", throttleRequested);
 
-      if (!donePrecharge)checkPrecharge();
-          
 
 	if(skipcounter++ > 30)    //A very low priority loop for checks that only need to be done once per second.
 	{  
             skipcounter=0; //Reset our laptimer
               
                 
-                //Some test simulations if precharge time is set to 12345
-		if(config->prechargeR==12345)
-                  {
-		    dcVoltage--;  
-	            if (torqueActual < -500)
-                      {
-                        torqueActual=20;
-                      }
-                     else 
-                       {
-                         torqueActual=-650;
-                       }
-                        if (dcCurrent < 0)
-                      {
-                        dcCurrent=120;
-                      }
-                     else 
-                       {
-                         dcCurrent=-65;
-                       }
-                    if (temperatureInverter < config->coolOn*10)
-                      {
-                        temperatureInverter=(config->coolOn+2)*10;
-                      }
-                      else 
-                        {
-                          temperatureInverter=(config->coolOff-2)*10;
-                        }
-                
-                    if (throttleRequested < 500)
-                      {
-                        throttleRequested=500;
-                      }
-                      else 
-                      {
-                        throttleRequested=0;
-                      }
-                    if(testenableinput)
-                      {
-                        testenableinput=false;
-                      }
-                      else 
-                        {
-                          testenableinput=true;
-                        }
-                        
-                    if(testreverseinput)
-                      {
-                        testreverseinput=false;
-                      }
-                      else 
-                        {
-                          testreverseinput=true;
-                        }
-		  }	
             coolingcheck();
             checkBrakeLight();
             checkEnableInput();
             checkReverseInput();
             checkReverseLight();
           
-            //Store kilowatt hours, but only once in awhile.
-            prefsHandler->write(EEMC_KILOWATTHRS, kiloWattHours);
-	    prefsHandler->saveChecksum();
+            //Store energy and charge, the meter only writes once in awhile.
+            EnergyMeter::getInstance()->save();
 
    	}
 }
 
 
-void MotorController::checkPrecharge()
+/*
+ * Limit the rate of change (slew rate) and the change of that rate (jerk) of the
+ * requested throttle level. The configured torque/speed slew rate is converted to
+ * per mille of throttle per second, the jerk is given by the time it takes to reach
+ * the full slew rate. Before reaching the target the rate is reduced so the level
+ * doesn't overshoot. Calculated in fixed point (1/256 per mille) with the real time
+ * since the last call.
+ */
+void MotorController::limitThrottle(int16_t target) {
+	MotorControllerConfiguration *config = (MotorControllerConfiguration *) getConfiguration();
+	uint32_t now = micros();
+	uint32_t dt = now - slewTimestamp;
+	int64_t maxRate, jerk, maxChange, desiredRate, step;
+	int32_t error;
+
+	slewTimestamp = now;
+	if (dt > CFG_SLEW_MAX_DT)
+		dt = CFG_SLEW_MAX_DT;
+
+	if (powerMode == modeSpeed)
+		maxRate = (config->speedMax > 0 ? (int64_t) config->speedSlewRate * 1000 / config->speedMax : 0);
+	else
+		maxRate = (config->torqueMax > 0 ? (int64_t) config->torqueSlewRate * 1000 / config->torqueMax : 0);
+	if (maxRate == 0) { // limiter disabled
+		throttleSlewed = (int32_t) target << 8;
+		throttleSlewRate = 0;
+		throttleRequested = target;
+		return;
+	}
+	if (maxRate > 100000) // full range in 20ms, more makes no sense and would overflow below
+		maxRate = 100000;
+	maxRate <<= 8;
+
+	error = ((int32_t) target << 8) - throttleSlewed;
+	desiredRate = (error > 0 ? maxRate : (error < 0 ? -maxRate : 0));
+	if (config->slewRampTime > 0) {
+		jerk = maxRate * 1000 / config->slewRampTime;
+		// time to slow down so we arrive at the target with a rate of zero: rate^2 / (2 * jerk) >= distance
+		if ((throttleSlewRate > 0) == (error > 0) && (int64_t) throttleSlewRate * throttleSlewRate >= 2 * jerk * abs(error))
+			desiredRate = 0;
+		maxChange = jerk * dt / 1000000;
+		desiredRate = constrain(desiredRate, throttleSlewRate - maxChange, throttleSlewRate + maxChange);
+	}
+	throttleSlewRate = desiredRate;
+
+	step = (int64_t) throttleSlewRate * dt / 1000000;
+	if ((error >= 0 && step >= error) || (error <= 0 && step <= error)) { // target reached
+		throttleSlewed = (int32_t) target << 8;
+		throttleSlewRate = 0;
+	} else
+		throttleSlewed += step;
+	throttleRequested = (throttleSlewed + 128) >> 8;
+}
+
+/*
+ * Pre-calculate the torque envelope: the maximum accelerating and regen torque for
+ * a grid of speeds (0 to speedMax in equal steps plus one column above speedMax where
+ * the accelerating torque reaches zero) and DC voltages (75% to 115% of the nominal
+ * voltage). Each point is limited by torqueMax, the configured power and the battery
+ * current limit at that voltage.
+ */
+void MotorController::buildEnvelope() {
+	MotorControllerConfiguration *config = (MotorControllerConfiguration *) getConfiguration();
+
+	envelopeRpmStep = max(config->speedMax / (CFG_ENVELOPE_RPM_POINTS - 2), 1);
+	envelopeVoltageStart = config->nominalVolt * 3 / 4;
+	envelopeVoltageStep = max(config->nominalVolt * 2 / 5 / (CFG_ENVELOPE_VOLTAGE_POINTS - 1), 1);
+
+	for (int y = 0; y < CFG_ENVELOPE_VOLTAGE_POINTS; y++) {
+		uint32_t voltage = envelopeVoltageStart + y * envelopeVoltageStep;
+		for (int x = 0; x < CFG_ENVELOPE_RPM_POINTS; x++) {
+			uint32_t rpm = x * envelopeRpmStep;
+			envelopeMotor[y][x] = (x == CFG_ENVELOPE_RPM_POINTS - 1 ? 0 :
+					calculateEnvelope(rpm, config->maxMotorPower, voltage, config->maxDischargeCurrent));
+			envelopeRegen[y][x] = calculateEnvelope(rpm, config->maxRegenPower, voltage, config->maxChargeCurrent);
+		}
+	}
+}
+
+/*
+ * Max torque (0.1Nm) at a speed (rpm) with a power (0.1kW) and battery current (A)
+ * limit at a voltage (0.1V). A power or current of 0 means no limit.
+ */
+int16_t MotorController::calculateEnvelope(uint32_t rpm, uint32_t power, uint32_t voltage, uint32_t current) {
+	MotorControllerConfiguration *config = (MotorControllerConfiguration *) getConfiguration();
+	uint32_t torque;
+
+	power *= 100; // in W
+	if (current > 0 && (power == 0 || voltage * current / 10 < power))
+		power = voltage * current / 10;
+	if (power == 0 || rpm == 0)
+		return config->torqueMax;
+	torque = (uint64_t) power * 95493 / (rpm * 1000); // torque = power / (2 * PI * rpm / 60), in 0.1Nm
+	return min(torque, config->torqueMax);
+}
+
+/*
+ * Look up the torque limits for the current speed and DC voltage in the envelope
+ * using bilinear interpolation with 8 bit fractions.
+ */
+void MotorController::updateEnvelope() {
+	MotorControllerConfiguration *config = (MotorControllerConfiguration *) getConfiguration();
+	uint32_t voltage = (dcVoltage > 0 ? dcVoltage : config->nominalVolt);
+	uint32_t position;
+	uint8_t x = CFG_ENVELOPE_RPM_POINTS - 2, y = CFG_ENVELOPE_VOLTAGE_POINTS - 2;
+	uint16_t fx = 256, fy = 256;
+
+	position = (uint32_t) abs(speedActual) * 256 / envelopeRpmStep;
+	if (position < (CFG_ENVELOPE_RPM_POINTS - 1) * 256) {
+		x = position >> 8;
+		fx = position & 0xff;
+	}
+	position = (voltage > envelopeVoltageStart ? (voltage - envelopeVoltageStart) * 256 / envelopeVoltageStep : 0);
+	if (position < (CFG_ENVELOPE_VOLTAGE_POINTS - 1) * 256) {
+		y = position >> 8;
+		fy = position & 0xff;
+	}
+
+	torqueLimitMotor = interpolateEnvelope(envelopeMotor, x, fx, y, fy);
+	torqueLimitRegen = interpolateEnvelope(envelopeRegen, x, fx, y, fy);
+}
+
+int16_t MotorController::interpolateEnvelope(int16_t table[][CFG_ENVELOPE_RPM_POINTS], uint8_t x, uint16_t fx, uint8_t y, uint16_t fy) {
+	int32_t low = table[y][x] * (256 - fx) + table[y][x + 1] * fx;
+	int32_t high = table[y + 1][x] * (256 - fx) + table[y + 1][x + 1] * fx;
+
+	return (low * (256 - fy) + high * fy) >> 16;
+}
+
+/*
+ * Constrain a torque request (0.1Nm) to the envelope. Torque in the direction of the
+ * selected gear accelerates, the other direction is regen.
+ */
+int16_t MotorController::limitTorque(int16_t torque) {
+	bool accelerating = (selectedGear == REVERSE ? torque < 0 : torque > 0);
+	int16_t limit = (accelerating ? torqueLimitMotor : torqueLimitRegen);
+
+	return constrain(torque, -limit, limit);
+}
+
+//Act on enable and reverse switches as soon as the debounced edge arrives instead of waiting for the once per second checks
+void MotorController::handleDigitalEdge(uint8_t which, boolean active)
 {
-  	
-        int prechargetime=getprechargeR();
-        int contactor=getmainContactorRelay();
-        int relay=getprechargeRelay();
-          
-        if (relay>7 || relay<0 || contactor<0 || contactor>7)  //We don't have a contactor and a precharge relay
-          {
-            donePrecharge=true;         //Let's end this charade.
-            return;
-          }
-          
-	  if ((millis()-premillis)< prechargetime) //Check milliseconds since startup against our entered delay in milliseconds
-	    {           
-              if(!prelay)
-                {
-	          setOutput(contactor, 0); //Make sure main contactor off
-                  statusBitfield2 &= ~(1 << 17); //clear bitTurn off MAIN CONTACTOR annunciator
-                  statusBitfield1 &= ~(1 << contactor);//clear bitTurn off main contactor output annunciator
-                  setOutput(relay, 1); //ok.  Turn on precharge relay
-                  statusBitfield2 |=1 << 19; //set bit to turn on  PRECHARGE RELAY annunciator
-                  statusBitfield1 |=1 << relay; //set bit to turn ON precharge OUTPUT annunciator
-                  throttleRequested = 0; //Keep throttle at zero during precharge
-                  prelay=true;
-                  Logger::info("Starting precharge sequence - wait %i milliseconds", prechargetime);
-              
-                }
-            } 
-            else
-              {
-	        setOutput(contactor, 1); //Main contactor on
-	        statusBitfield2 |=1 << 17; //set bit to turn on MAIN CONTACTOR annunciator
-	        statusBitfield1 |=1 << contactor;//setbit to Turn on main contactor output annunciator
-		Logger::info("Precharge sequence complete after %i milliseconds", prechargetime);
-                Logger::info("MAIN CONTACTOR ENABLED...DOUT0:%d, DOUT1:%d, DOUT2:%d, DOUT3:%d,DOUT4:%d, DOUT5:%d, DOUT6:%d, DOUT7:%d", getOutput(0), getOutput(1), getOutput(2), getOutput(3),getOutput(4), getOutput(5), getOutput(6), getOutput(7));
-                donePrecharge=true; //Time's up.  Let's don't do ANY of this on future ticks.
-                //Generally, we leave the precharge relay on.  This doesn't hurt much in any configuration.  But when using two contactors
-                //one positive with a precharge resistor and one on the negative leg to act as precharge, we need to leave precharge on.
-	       
-            }
+  if (which == getEnableIn()) checkEnableInput();
+  if (which == getReverseIn()) checkReverseInput();
+}
+
+#define CS_CAUSE_TIMEOUT 0xff
+
+/*
+ * The transitions of the controller state machine. They are checked in this order,
+ * the first one whose source state matches (CS_ANY matches all states but CS_PRECHARGE)
+ * and whose guard returns true is taken. While the guard of a CS_ANY transition into
+ * the current state is true, the transitions below it are not checked (e.g. a fault
+ * keeps the controller faulted even if a power down is requested).
+ */
+const MotorController::StateTransition MotorController::stateTransitions[] = {
+	{ CS_PRECHARGE, CS_OFFLINE, &MotorController::isPrechargeDone },
+	{ CS_ANY, CS_OFFLINE, &MotorController::isOffline },
+	{ CS_ANY, CS_FAULTED, &MotorController::isFaulted },
+	{ CS_ANY, CS_POWERDOWN, &MotorController::isPowerDownRequested },
+	{ CS_OFFLINE, CS_DISABLED, &MotorController::isOnline },
+	{ CS_FAULTED, CS_DISABLED, &MotorController::isNotFaulted },
+	{ CS_POWERDOWN, CS_DISABLED, &MotorController::isPowerDownReleased },
+	{ CS_DISABLED, CS_STANDBY, &MotorController::isStandbyRequested },
+	{ CS_STANDBY, CS_ENABLED, &MotorController::isEnableRequested },
+	{ CS_STANDBY, CS_DISABLED, &MotorController::isDisableRequested },
+	{ CS_ENABLED, CS_DISABLED, &MotorController::isDisableRequested },
+	{ CS_ENABLED, CS_STANDBY, &MotorController::isOnlyStandbyRequested },
+	{ CS_ENABLED, CS_STANDBY, &MotorController::isControllerLost }
+};
+
+/*
+ * Entry/exit actions and timeouts of the states, in the order of ControllerState.
+ */
+const MotorController::StateDefinition MotorController::stateDefinitions[] = {
+	{ &MotorController::startPrecharge, &MotorController::finishPrecharge, 0, CS_PRECHARGE }, // CS_PRECHARGE
+	{ NULL, NULL, 0, CS_OFFLINE }, // CS_OFFLINE
+	{ NULL, NULL, 0, CS_DISABLED }, // CS_DISABLED
+	{ NULL, NULL, CFG_STATE_STANDBY_TIMEOUT, CS_DISABLED }, // CS_STANDBY
+	{ NULL, NULL, 0, CS_ENABLED }, // CS_ENABLED
+	{ NULL, NULL, 0, CS_FAULTED }, // CS_FAULTED
+	{ NULL, NULL, 0, CS_POWERDOWN } // CS_POWERDOWN
+};
+
+/*
+ * Evaluate the state machine, called every tick. At most one transition is taken per call.
+ */
+void MotorController::updateState() {
+	const StateDefinition *definition = &stateDefinitions[controllerState];
+
+	for (uint8_t i = 0; i < sizeof(stateTransitions) / sizeof(StateTransition); i++) {
+		const StateTransition *transition = &stateTransitions[i];
+		if (transition->from == controllerState || (transition->from == CS_ANY && controllerState != CS_PRECHARGE)) {
+			if ((this->*transition->guard)()) {
+				if (transition->to != controllerState)
+					changeState(transition->to, i);
+				return;
+			}
+		}
+	}
+	if (definition->timeout > 0 && timeInState() > definition->timeout)
+		changeState(definition->timeoutState, CS_CAUSE_TIMEOUT);
+}
+
+void MotorController::changeState(ControllerState state, uint8_t cause) {
+	StateLogEntry *entry = &stateLog[stateLogIndex];
+
+	if (stateDefinitions[controllerState].exit != NULL)
+		(this->*stateDefinitions[controllerState].exit)();
+
+	entry->timestamp = micros();
+	entry->from = controllerState;
+	entry->to = state;
+	entry->cause = cause;
+	stateLogIndex = (stateLogIndex + 1) % CFG_STATE_LOG_SIZE;
+	Logger::info(getId(), "state %s -> %s", getStateName(controllerState), getStateName(state));
+
+	controllerState = state;
+	stateTimestamp = millis();
+	if (stateDefinitions[state].entry != NULL)
+		(this->*stateDefinitions[state].entry)();
+}
+
+uint32_t MotorController::timeInState() {
+	return millis() - stateTimestamp;
+}
+
+MotorController::ControllerState MotorController::getControllerState() {
+	return controllerState;
+}
+
+const char *MotorController::getStateName(ControllerState state) {
+	switch (state) {
+	case CS_PRECHARGE:
+		return "precharge";
+	case CS_OFFLINE:
+		return "offline";
+	case CS_DISABLED:
+		return "disabled";
+	case CS_STANDBY:
+		return "standby";
+	case CS_ENABLED:
+		return "enabled";
+	case CS_FAULTED:
+		return "faulted";
+	case CS_POWERDOWN:
+		return "powerdown";
+	default:
+		return "unknown";
+	}
+}
+
+/*
+ * Print the last state transitions (oldest first) with the time since the previous one.
+ */
+void MotorController::printStateLog() {
+	uint32_t previous = 0;
+
+	Logger::console("state: %s (since %lms)", getStateName(controllerState), timeInState());
+	for (uint8_t i = 0; i < CFG_STATE_LOG_SIZE; i++) {
+		StateLogEntry *entry = &stateLog[(stateLogIndex + i) % CFG_STATE_LOG_SIZE];
+		if (entry->timestamp == 0)
+			continue;
+		Logger::console("%lus: %s -> %s (cause %d, +%lus)", entry->timestamp, getStateName((ControllerState) entry->from),
+				getStateName((ControllerState) entry->to), entry->cause, (previous == 0 ? 0 : entry->timestamp - previous));
+		previous = entry->timestamp;
+	}
+}
+
+/*
+ * To be called by sub-classes whenever a frame from the controller was received.
+ */
+void MotorController::reportActivity() {
+	lastFrameTime = millis();
+}
+
+/*
+ * Is the communication with the controller alive? Sub-classes may override this
+ * if they have better means to detect it.
+ */
+bool MotorController::isOnline() {
+	return lastFrameTime != 0 && millis() - lastFrameTime < CFG_STATE_OFFLINE_TIMEOUT;
+}
+
+/*
+ * Is the controller ready to enable its power stage? Sub-classes override this
+ * if the controller reports its state.
+ */
+bool MotorController::isControllerReady() {
+	return true;
+}
+
+bool MotorController::isPrechargeDone() {
+	int relay = getprechargeRelay(), contactor = getmainContactorRelay();
+
+	if (relay > 7 || relay < 0 || contactor < 0 || contactor > 7) //We don't have a contactor and a precharge relay
+		return true;
+	return timeInState() >= (uint32_t) getprechargeR();
+}
+
+bool MotorController::isOffline() {
+	return !isOnline();
+}
+
+bool MotorController::isNotFaulted() {
+	return !faulted;
+}
+
+bool MotorController::isPowerDownRequested() {
+	return operationState == POWERDOWN;
+}
+
+bool MotorController::isPowerDownReleased() {
+	return operationState != POWERDOWN;
+}
+
+bool MotorController::isStandbyRequested() {
+	return operationState == STANDBY || operationState == ENABLE;
+}
+
+bool MotorController::isEnableRequested() {
+	return operationState == ENABLE && isControllerReady();
+}
+
+bool MotorController::isOnlyStandbyRequested() {
+	return operationState == STANDBY;
+}
+
+bool MotorController::isDisableRequested() {
+	return operationState == DISABLED;
+}
+
+bool MotorController::isControllerLost() {
+	return !isControllerReady();
+}
+
+/*
+ * Entry action of CS_PRECHARGE: open the main contactor and close the precharge relay
+ */
+void MotorController::startPrecharge() {
+	int relay = getprechargeRelay(), contactor = getmainContactorRelay();
+
+	if (relay > 7 || relay < 0 || contactor < 0 || contactor > 7) //We don't have a contactor and a precharge relay
+		return;
+
+	setOutput(contactor, 0); //Make sure main contactor off
+	statusBitfield2 &= ~(1 << 17); //clear bitTurn off MAIN CONTACTOR annunciator
+	statusBitfield1 &= ~(1 << contactor);//clear bitTurn off main contactor output annunciator
+	setOutput(relay, 1); //ok.  Turn on precharge relay
+	statusBitfield2 |=1 << 19; //set bit to turn on  PRECHARGE RELAY annunciator
+	statusBitfield1 |=1 << relay; //set bit to turn ON precharge OUTPUT annunciator
+	Logger::info("Starting precharge sequence - wait %i milliseconds", getprechargeR());
+}
+
+/*
+ * Exit action of CS_PRECHARGE: close the main contactor
+ */
+void MotorController::finishPrecharge() {
+	int relay = getprechargeRelay(), contactor = getmainContactorRelay();
+
+	if (relay > 7 || relay < 0 || contactor < 0 || contactor > 7)
+		return;
+
+	setOutput(contactor, 1); //Main contactor on
+	statusBitfield2 |=1 << 17; //set bit to turn on MAIN CONTACTOR annunciator
+	statusBitfield1 |=1 << contactor;//setbit to Turn on main contactor output annunciator
+	Logger::info("Precharge sequence complete after %i milliseconds", timeInState());
+	Logger::info("MAIN CONTACTOR ENABLED...DOUT0:%d, DOUT1:%d, DOUT2:%d, DOUT3:%d,DOUT4:%d, DOUT5:%d, DOUT6:%d, DOUT7:%d", getOutput(0), getOutput(1), getOutput(2), getOutput(3),getOutput(4), getOutput(5), getOutput(6), getOutput(7));
+	//Generally, we leave the precharge relay on.  This doesn't hurt much in any configuration.  But when using two contactors
+	//one positive with a precharge resistor and one on the negative leg to act as precharge, we need to leave precharge on.
 }
 
 //This routine is used to set an optional cooling fan output to on if the current temperature 
@@ -333,7 +635,7 @@ void MotorController:: checkEnableInput()
   uint16_t enableinput=getEnableIn();
   if(enableinput >= 0 && enableinput<4) //Do we even have an enable input configured ie NOT 255.
     {
-       if((getDigital(enableinput))||testenableinput) //If it's ON let's set our opstate to ENABLE
+       if(getDigital(enableinput)) //If it's ON let's set our opstate to ENABLE
         {
           setOpState(ENABLE);
           statusBitfield2 |=1 << enableinput; //set bit to turn on ENABLE annunciator
@@ -354,7 +656,7 @@ void MotorController:: checkReverseInput()
   uint16_t reverseinput=getReverseIn();
   if(reverseinput >= 0 && reverseinput<4)  //If we don't have a Reverse Input, do nothing
     {
-    if((getDigital(reverseinput))||testreverseinput)
+    if(getDigital(reverseinput))
       {
        setSelectedGear(REVERSE); 
        statusBitfield2 |=1 << 16; //set bit to turn on REVERSE annunciator
@@ -371,6 +673,50 @@ void MotorController:: checkReverseInput()
 
 
 
+/*
+ * Make the values of the motor controller available to the consumers of the SignalRegistry
+ * (wifi, telemetry, ...). The status values are published under the name of their web site parameter.
+ */
+void MotorController::publishSignals() {
+	MotorControllerConfiguration *config = (MotorControllerConfiguration *)getConfiguration();
+	SignalRegistry *registry = SignalRegistry::getInstance();
+
+	registry->publish(Constants::torqueRequested, "Nm", 1, &torqueRequested);
+	registry->publish(Constants::torqueActual, "Nm", 1, &torqueActual);
+	registry->publish(Constants::speedRequested, "rpm", 0, &speedRequested);
+	registry->publish(Constants::speedActual, "rpm", 0, &speedActual);
+	registry->publish(Constants::dcVoltage, "V", 1, &dcVoltage);
+	registry->publish(Constants::dcCurrent, "A", 1, &dcCurrent);
+	registry->publish(Constants::acCurrent, "A", 1, &acCurrent);
+	registry->publish(Constants::mechPower, "kW", 1, &mechanicalPower);
+	registry->publish(Constants::tempMotor, "C", 1, &temperatureMotor);
+	registry->publish(Constants::tempInverter, "C", 1, &temperatureInverter);
+	registry->publish(Constants::tempSystem, "C", 1, &temperatureSystem);
+	registry->publish(Constants::running, "", 0, &running);
+	registry->publish(Constants::faulted, "", 0, &faulted);
+	registry->publish(Constants::warning, "", 0, &warning);
+	registry->publish(Constants::bitfield1, "", 0, &statusBitfield1);
+	registry->publish(Constants::bitfield2, "", 0, &statusBitfield2);
+	registry->publish(Constants::bitfield3, "", 0, &statusBitfield3);
+	registry->publish(Constants::bitfield4, "", 0, &statusBitfield4);
+	registry->publish(Constants::gear, "", 0, getGearSignal, this);
+	registry->publish(Constants::motorMode, "", 0, getPowerModeSignal, this);
+	registry->publish(Constants::controllerState, "", 0, getControllerStateSignal, this);
+	registry->publish(Constants::nominalVolt, "V", 0, getNominalVoltSignal, this);
+
+	// configuration values which are shown on the web site
+	registry->publish(Constants::prechargeR, "ms", 0, &config->prechargeR);
+	registry->publish(Constants::prechargeRelay, "", 0, &config->prechargeRelay);
+	registry->publish(Constants::mainContactorRelay, "", 0, &config->mainContactorRelay);
+	registry->publish(Constants::coolFan, "", 0, &config->coolFan);
+	registry->publish(Constants::coolOn, "C", 0, &config->coolOn);
+	registry->publish(Constants::coolOff, "C", 0, &config->coolOff);
+	registry->publish(Constants::brakeLight, "", 0, &config->brakeLight);
+	registry->publish(Constants::revLight, "", 0, &config->revLight);
+	registry->publish(Constants::enableIn, "", 0, &config->enableIn);
+	registry->publish(Constants::reverseIn, "", 0, &config->reverseIn);
+}
+
 bool MotorController::isRunning() {
 	return running;
 }
@@ -495,6 +841,14 @@ void MotorController::setSelectedGear(Gears gear) {
 }
 
 
+int16_t MotorController::getTorqueLimitMotor() {
+	return torqueLimitMotor;
+}
+
+int16_t MotorController::getTorqueLimitRegen() {
+	return torqueLimitRegen;
+}
+
 int16_t MotorController::getTorqueAvailable() {
 	return torqueAvailable;
 }
@@ -515,10 +869,6 @@ int16_t MotorController::getnominalVolt() {
 	return nominalVolts;
 }
 
-uint32_t MotorController::getKiloWattHours() {
-	return kiloWattHours;
-}
-
 int16_t MotorController::getMechanicalPower() {
 	return mechanicalPower;
 }
@@ -559,6 +909,23 @@ void MotorController::loadConfiguration() {
 		prefsHandler->read(EEMC_MAX_TORQUE, &config->torqueMax);
 		prefsHandler->read(EEMC_RPM_SLEW_RATE, &config->speedSlewRate);
 		prefsHandler->read(EEMC_TORQUE_SLEW_RATE, &config->torqueSlewRate);
+		prefsHandler->read(EEMC_SLEW_RAMP_TIME, &config->slewRampTime);
+		if (config->torqueSlewRate == 0xFFFF) // not yet stored at the new location
+			config->torqueSlewRate = TorqueSlewRateValue;
+		if (config->slewRampTime == 0xFFFF)
+			config->slewRampTime = SlewRampTimeValue;
+		prefsHandler->read(EEMC_MAX_MOTOR_POWER, &config->maxMotorPower);
+		prefsHandler->read(EEMC_MAX_REGEN_POWER, &config->maxRegenPower);
+		prefsHandler->read(EEMC_MAX_DISCHARGE_CURRENT, &config->maxDischargeCurrent);
+		prefsHandler->read(EEMC_MAX_CHARGE_CURRENT, &config->maxChargeCurrent);
+		if (config->maxMotorPower == 0xFFFF) // not yet stored
+			config->maxMotorPower = MaxMotorPowerValue;
+		if (config->maxRegenPower == 0xFFFF)
+			config->maxRegenPower = MaxRegenPowerValue;
+		if (config->maxDischargeCurrent == 0xFFFF)
+			config->maxDischargeCurrent = MaxDischargeCurrentValue;
+		if (config->maxChargeCurrent == 0xFFFF)
+			config->maxChargeCurrent = MaxChargeCurrentValue;
 		prefsHandler->read(EEMC_REVERSE_LIMIT, &config->reversePercent);
 		prefsHandler->read(EEMC_KILOWATTHRS, &config->kilowattHrs);
 		prefsHandler->read(EEMC_PRECHARGE_R, &config->prechargeR);
@@ -581,6 +948,11 @@ void MotorController::loadConfiguration() {
 		config->torqueMax = MaxTorqueValue;
 		config->speedSlewRate = RPMSlewRateValue;
 		config->torqueSlewRate = TorqueSlewRateValue;
+		config->slewRampTime = SlewRampTimeValue;
+		config->maxMotorPower = MaxMotorPowerValue;
+		config->maxRegenPower = MaxRegenPowerValue;
+		config->maxDischargeCurrent = MaxDischargeCurrentValue;
+		config->maxChargeCurrent = MaxChargeCurrentValue;
 		config->reversePercent = ReversePercent;
 		config->kilowattHrs = KilowattHrs;
 		config->prechargeR = PrechargeR;
@@ -598,6 +970,8 @@ void MotorController::loadConfiguration() {
 	}
            //DeviceManager::getInstance()->sendMessage(DEVICE_WIFI, ICHIP2128, MSG_CONFIG_CHANGE, NULL);
 
+	buildEnvelope();
+
 	Logger::info("MaxTorque: %i MaxRPM: %i", config->torqueMax, config->speedMax);
 }
 
@@ -610,6 +984,11 @@ void MotorController::saveConfiguration() {
 	prefsHandler->write(EEMC_MAX_TORQUE, config->torqueMax);
 	prefsHandler->write(EEMC_RPM_SLEW_RATE, config->speedSlewRate);
 	prefsHandler->write(EEMC_TORQUE_SLEW_RATE, config->torqueSlewRate);
+	prefsHandler->write(EEMC_SLEW_RAMP_TIME, config->slewRampTime);
+	prefsHandler->write(EEMC_MAX_MOTOR_POWER, config->maxMotorPower);
+	prefsHandler->write(EEMC_MAX_REGEN_POWER, config->maxRegenPower);
+	prefsHandler->write(EEMC_MAX_DISCHARGE_CURRENT, config->maxDischargeCurrent);
+	prefsHandler->write(EEMC_MAX_CHARGE_CURRENT, config->maxChargeCurrent);
 	prefsHandler->write(EEMC_REVERSE_LIMIT, config->reversePercent);
 	prefsHandler->write(EEMC_KILOWATTHRS, config->kilowattHrs);
 	prefsHandler->write(EEMC_PRECHARGE_R, config->prechargeR);
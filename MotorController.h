@@ -35,6 +35,8 @@
 #include "Throttle.h"
 #include "DeviceManager.h"
 #include "sys_io.h"
+#include "EnergyMeter.h"
+#include "SignalRegistry.h"
 
 #define MOTORCTL_INPUT_DRIVE_EN    3
 #define MOTORCTL_INPUT_FORWARD     4
@@ -47,6 +49,11 @@ public:
 	uint16_t torqueMax;	// maximum torque in 0.1 Nm
 	uint16_t torqueSlewRate; // for torque mode only: slew rate of torque value, 0=disabled, in 0.1Nm/sec
 	uint16_t speedSlewRate; //  for speed mode only: slew rate of speed value, 0=disabled, in rpm/sec
+	uint16_t slewRampTime; // time in ms until the full slew rate is reached (limits the jerk), 0=disabled
+	uint16_t maxMotorPower; // maximum mechanical power when accelerating in 0.1kW, 0=no limit
+	uint16_t maxRegenPower; // maximum mechanical power when regenerating in 0.1kW, 0=no limit
+	uint16_t maxDischargeCurrent; // battery discharge current limit in A, 0=no limit
+	uint16_t maxChargeCurrent; // battery charge current limit during regen in A, 0=no limit
 	uint8_t reversePercent;
 	uint16_t kilowattHrs;
 	uint16_t prechargeR; //resistance of precharge resistor in tenths of ohm
@@ -64,7 +71,7 @@ public:
         
 };
 
-class MotorController: public Device {
+class MotorController: public Device, DigitalInputObserver {
 
 public:
 	enum Gears {
@@ -86,10 +93,34 @@ public:
 		POWERDOWN = 3
 	};
 
+	/*
+	 * States of the controller state machine which is shared by all motor controllers.
+	 * All states except CS_PRECHARGE are sub-states of "powered up", CS_ANY is used
+	 * for transitions which are valid in all of them.
+	 */
+	enum ControllerState {
+		CS_PRECHARGE = 0, // waiting for the precharge to complete, main contactor is open
+		CS_OFFLINE = 1, // no communication with the controller
+		CS_DISABLED = 2, // power stage disabled
+		CS_STANDBY = 3, // power stage requested, waiting for the controller to get ready
+		CS_ENABLED = 4, // power stage enabled, torque / speed commands are applied
+		CS_FAULTED = 5, // controller reports a fault
+		CS_POWERDOWN = 6, // controller is requested to power down
+		CS_ANY = 7
+	};
+
+	struct StateLogEntry {
+		uint32_t timestamp; // micros() when the transition happened
+		uint8_t from;
+		uint8_t to;
+		uint8_t cause; // index of the transition in the table or CS_CAUSE_TIMEOUT
+	};
+
     MotorController();
 	DeviceType getType();
     void setup();
     void handleTick();
+    void handleDigitalEdge(uint8_t which, boolean active);
 	uint32_t getTickInterval();
 
 	void loadConfiguration();
@@ -100,7 +131,9 @@ public:
         void checkReverseLight();
         void checkEnableInput();
         void checkReverseInput();
-        void checkPrecharge();
+        ControllerState getControllerState();
+        static const char *getStateName(ControllerState state);
+        void printStateLog();
 
         void brakecheck();
 	bool isReady();
@@ -117,7 +150,6 @@ uint32_t statusBitfield1; // bitfield variable for use of the specific implement
 uint32_t statusBitfield2;
 uint32_t statusBitfield3;
 uint32_t statusBitfield4;
-uint32_t kiloWattHours;
 	
 
 
@@ -147,12 +179,14 @@ uint32_t kiloWattHours;
     int16_t getTorqueRequested();
     int16_t getTorqueActual();
     int16_t getTorqueAvailable();
+    int16_t getTorqueLimitMotor();
+    int16_t getTorqueLimitRegen();
+    int16_t limitTorque(int16_t torque);
     int preMillis();
    
 	uint16_t getDcVoltage();
 	int16_t getDcCurrent();
 	uint16_t getAcCurrent();
-	uint32_t getKiloWattHours();
 	int16_t getMechanicalPower();
 	int16_t getTemperatureMotor();
 	int16_t getTemperatureInverter();
@@ -174,8 +208,6 @@ protected:
 	bool faulted; // indicates a error condition is present in the controller
 	bool warning; // indicates a warning condition is present in the controller
 	bool coolflag;
-        bool testenableinput;
-         bool testreverseinput;
 
 
 	Gears selectedGear;
@@ -183,7 +215,10 @@ protected:
 	PowerMode powerMode;
         OperationState operationState; //the op state we want
 	
-	int16_t throttleRequested; // -1000 to 1000 (per mille of throttle level)
+	int16_t throttleRequested; // -1000 to 1000 (per mille of throttle level), slew rate limited
+	int32_t throttleSlewed; // slew rate limited throttle level in 1/256 per mille
+	int32_t throttleSlewRate; // current rate of change of throttleSlewed in 1/256 per mille per second
+	uint32_t slewTimestamp; // time of the last slew rate calculation in microseconds
 	int16_t speedRequested; // in rpm
 	int16_t speedActual; // in rpm
 	int16_t torqueRequested; // in 0.1 Nm
@@ -200,11 +235,65 @@ protected:
 
 	
 	
-	uint16_t prechargeTime; //time in ms that precharge should last
-	uint32_t milliStamp; //how long we have precharged so far
-	bool donePrecharge; //already completed the precharge cycle?
-	bool prelay;
 	uint32_t skipcounter;
+
+	typedef bool (MotorController::*StateGuard)();
+	typedef void (MotorController::*StateAction)();
+	struct StateTransition {
+		ControllerState from;
+		ControllerState to;
+		StateGuard guard;
+	};
+	struct StateDefinition {
+		StateAction entry; // called when the state is entered (may be NULL)
+		StateAction exit; // called when the state is left (may be NULL)
+		uint16_t timeout; // ms after which timeoutState is entered (0 = no timeout)
+		ControllerState timeoutState;
+	};
+	static const StateTransition stateTransitions[];
+	static const StateDefinition stateDefinitions[];
+
+	ControllerState controllerState; // current state of the state machine
+	uint32_t stateTimestamp; // millis() when the current state was entered
+	StateLogEntry stateLog[CFG_STATE_LOG_SIZE]; // ring buffer of the last transitions
+	uint8_t stateLogIndex; // next entry to write in stateLog
+	uint32_t lastFrameTime; // millis() when the last frame from the controller was received (see reportActivity())
+
+	void publishSignals();
+	void updateState();
+	void changeState(ControllerState state, uint8_t cause);
+	uint32_t timeInState();
+	void reportActivity();
+	virtual bool isOnline();
+	virtual bool isControllerReady();
+
+	// guards and actions of the state machine
+	bool isPrechargeDone();
+	bool isOffline();
+	bool isNotFaulted();
+	bool isPowerDownRequested();
+	bool isPowerDownReleased();
+	bool isStandbyRequested();
+	bool isEnableRequested();
+	bool isOnlyStandbyRequested();
+	bool isDisableRequested();
+	bool isControllerLost();
+	void startPrecharge();
+	void finishPrecharge();
+
+	int16_t torqueLimitMotor; // max torque (0.1Nm) when accelerating at the current speed and voltage
+	int16_t torqueLimitRegen; // max torque (0.1Nm) when regenerating at the current speed and voltage
+	int16_t envelopeMotor[CFG_ENVELOPE_VOLTAGE_POINTS][CFG_ENVELOPE_RPM_POINTS]; // max accelerating torque (0.1Nm) by voltage and speed
+	int16_t envelopeRegen[CFG_ENVELOPE_VOLTAGE_POINTS][CFG_ENVELOPE_RPM_POINTS]; // max regen torque (0.1Nm) by voltage and speed
+	uint16_t envelopeRpmStep; // speed difference between two columns
+	uint16_t envelopeVoltageStart; // voltage of the first row in 0.1V
+	uint16_t envelopeVoltageStep; // voltage difference between two rows in 0.1V
+
+	void limitThrottle(int16_t target);
+	void buildEnvelope();
+	int16_t calculateEnvelope(uint32_t rpm, uint32_t power, uint32_t voltage, uint32_t current);
+	void updateEnvelope();
+	int16_t interpolateEnvelope(int16_t table[][CFG_ENVELOPE_RPM_POINTS], uint8_t x, uint16_t fx, uint8_t y, uint16_t fy);
 };
 
 #endif
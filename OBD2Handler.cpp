@@ -49,10 +49,11 @@ OBD2Handler *OBD2Handler::getInstance() {
 /*
 Public method to process OBD2 requests. 
 	inData is whatever payload the request might need to have sent - it's OK to be NULL if this is a run of the mill PID request with no payload
-	outData should be a preallocated buffer of at least 6 bytes. The format is as follows:
+	outData should be a preallocated buffer of at least 8 bytes. The format is as follows:
 	outData[0] is the length of the data actually returned
 	outData[1] is the returned mode (input mode + 0x40) 
 	there after, the rest of the bytes are the data requested. This should be 1-5 bytes
+	(in mode 2 the first of them is the frame number, in mode 3 outData[2] is the number of DTCs)
 */
 bool OBD2Handler::processRequest(uint8_t mode, uint8_t pid, char *inData, char *outData) {
 	bool ret = false;
@@ -62,9 +63,14 @@ bool OBD2Handler::processRequest(uint8_t mode, uint8_t pid, char *inData, char *
 			outData[1] = mode + 0x40;
 			outData[2] = pid;
 			break;
-		case 2: //show freeze frame data - not sure we'll be supporting this
+		case 2: //show freeze frame data - inData[0] is the frame number if given (0 = latest)
+			ret = processFreezeFrameData(pid, inData, outData);
+			outData[1] = mode + 0x40;
+			outData[2] = pid;
 			break;
-		case 3: //show stored diagnostic codes - we can probably map our faults to some existing DTC codes or roll our own
+		case 3: //show stored diagnostic codes - our fault codes already are in DTC format
+			ret = processShowCodes(outData);
+			outData[1] = mode + 0x40;
 			break;
 		case 4: //clear diagnostic trouble codes - If we get this frame we just clear all codes no questions asked.
 			break;
@@ -98,8 +104,10 @@ bool OBD2Handler::processShowData(uint8_t pid, char *inData, char *outData) {
 		return true;
 		break;
 	case 1: //Returns 32 bits but we really can only support the first byte which has bit 7 = Malfunction? Bits 0-6 = # of DTCs
+		temp = faultHandler.getFaultCount();
+		if (temp > 0x7F) temp = 0x7F;
 		outData[0] = 4;
-		outData[3] = 0; //TODO: We aren't properly keeping track of faults yet but when we do fix this. 
+		outData[3] = temp ? (0x80 | temp) : 0; //MIL on if there are un-ack'd faults
 		outData[4] = 0; //these next three are really related to ICE diagnostics
 		outData[5] = 0; //so ignore them.
 		outData[6] = 0;
@@ -215,6 +223,69 @@ bool OBD2Handler::processShowData(uint8_t pid, char *inData, char *outData) {
 	return false;
 }
 
+//Process mode 2 requests. Answers a subset of the mode 1 PIDs from the state captured when a fault was raised.
+//Like SAE J1979 requires, the reply is PID, frame number, data - so the frame number counts as first data byte.
+bool OBD2Handler::processFreezeFrameData(uint8_t pid, char *inData, char *outData) {
+	FREEZE_FRAME frame;
+	uint8_t frameNumber = (inData ? inData[0] : 0);
+	int temp;
+
+	if (!faultHandler.getFreezeFrame(frameNumber, &frame))
+		return false;
+
+	outData[3] = frameNumber;
+	switch (pid) {
+	case 0: //pids 1-0x20 that we support - bitfield
+		outData[0] = 5;
+		outData[4] = 0b01001000; //pids 2 and 5
+		outData[5] = 0b00010000; //pid 0x0C
+		outData[6] = 0b10000000; //pid 0x11
+		outData[7] = 0b00000000;
+		return true;
+	case 2: //DTC which caused the freeze frame
+		outData[0] = 3;
+		outData[4] = (uint8_t)(frame.faultCode >> 8);
+		outData[5] = (uint8_t)(frame.faultCode & 0xFF);
+		return true;
+	case 5: //Engine Coolant Temp (A - 40) = Degrees Centigrade
+		temp = frame.temperatureInverter / 10;
+		if (temp < -40) temp = -40;
+		if (temp > 215) temp = 215;
+		outData[0] = 2;
+		outData[4] = (uint8_t)(temp + 40);
+		return true;
+	case 0xC: //Engine RPM (A * 256 + B) / 4
+		temp = frame.speedActual * 4;
+		outData[0] = 3;
+		outData[4] = (uint8_t)(temp / 256);
+		outData[5] = (uint8_t)(temp);
+		return true;
+	case 0x11: //Throttle position (A * 100 / 255) - Percentage
+		temp = frame.throttle / 10;
+		if (temp < 0) temp = 0;
+		outData[0] = 2;
+		outData[4] = (uint8_t)((255 * temp) / 100);
+		return true;
+	}
+	return false;
+}
+
+//Process mode 3 requests. outData[2] is the number of DTCs, followed by the newest of them (2 bytes each).
+//The reply has to fit into a single CAN frame (multi-frame ISO-TP replies aren't supported), so only the
+//newest OBD2_MAX_DTCS codes are sent, the number tells the tester how many there are in total.
+bool OBD2Handler::processShowCodes(char *outData) {
+	uint16_t codes[OBD2_MAX_DTCS];
+	uint8_t count = faultHandler.getFaultCodes(codes, OBD2_MAX_DTCS);
+
+	outData[0] = count * 2;
+	outData[2] = faultHandler.getFaultCount();
+	for (int i = 0; i < count; i++) {
+		outData[3 + i * 2] = (uint8_t)(codes[i] >> 8);
+		outData[4 + i * 2] = (uint8_t)(codes[i] & 0xFF);
+	}
+	return true;
+}
+
 bool OBD2Handler::processShowCustomData(uint16_t pid, char *inData, char *outData) {
 	switch (pid) {
 	}
@@ -36,6 +36,9 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "TickHandler.h"
 #include "CanHandler.h"
 #include "constants.h"
+#include "FaultHandler.h"
+
+#define OBD2_MAX_DTCS 2 // number of DTCs in a mode 3 reply (mode, count and two DTCs fill a single CAN frame)
 
 class OBD2Handler {
 public:
@@ -48,6 +51,8 @@ private:
 	OBD2Handler(); //it's not right to try to directly instantiate this class
 	bool processShowData(uint8_t pid, char *inData, char *outData);
 	bool processShowCustomData(uint16_t pid, char *inData, char *outData);
+	bool processFreezeFrameData(uint8_t pid, char *inData, char *outData);
+	bool processShowCodes(char *outData);
 
 	static OBD2Handler *instance;
 	MotorController* motorController;
@@ -0,0 +1,212 @@
+/*
+ * ParameterTable.cpp
+ *
+ * The table of configuration parameters shared by the serial console and the
+ * wifi module, see ParameterTable.h.
+ *
+ Copyright (c) 2013 Collin Kidder, Michael Neuweiler, Charles Galpin
+
+ Permission is hereby granted, free of charge, to any person obtaining
+ a copy of this software and associated documentation files (the
+ "Software"), to deal in the Software without restriction, including
+ without limitation the rights to use, copy, modify, merge, publish,
+ distribute, sublicense, and/or sell copies of the Software, and to
+ permit persons to whom the Software is furnished to do so, subject to
+ the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+ */
+
+#include "ParameterTable.h"
+#include "constants.h"
+#include "eeprom_layout.h"
+#include "MotorController.h"
+#include "PotThrottle.h"
+#include "PrefHandler.h"
+#include "Logger.h"
+
+extern PrefHandler *sysPrefs;
+
+/*
+ * Store the value in a field of the configuration class C if it fits into the type T
+ */
+template<class C, class T, T C::*field> bool assignField(DeviceConfiguration *config, int32_t value) {
+	if (value < 0 || (uint32_t) value > (T) ~0)
+		return false;
+	((C *) config)->*field = value;
+	return true;
+}
+
+#define FIELD(C, T, f) &assignField<C, T, &C::f>
+
+static bool setLogLevel(DeviceConfiguration *config, int32_t value) {
+	Logger::setLoglevel((Logger::LogLevel) value);
+	sysPrefs->write(EESYS_LOG_LEVEL, (uint8_t) value);
+	sysPrefs->saveChecksum();
+	return true;
+}
+
+/*
+ * The parameters sorted by name (case insensitive). Keep it sorted when adding
+ * entries, the lookup relies on it.
+ */
+static const Parameter parameters[] = {
+	{ "B1ADC", PARAM_BRAKE, FIELD(PotThrottleConfiguration, uint8_t, AdcPin1), 1, 0, "Brake ADC Pin" },
+	{ "B1MN", PARAM_BRAKE, FIELD(PotThrottleConfiguration, uint16_t, minimumLevel1), 1, 0, "Brake Min" },
+	{ "B1MX", PARAM_BRAKE, FIELD(PotThrottleConfiguration, uint16_t, maximumLevel1), 1, 0, "Brake Max" },
+	{ "BMAXR", PARAM_BRAKE, FIELD(ThrottleConfiguration, uint8_t, maximumRegen), 1, 0, "Max Brake Regen" },
+	{ "BMINR", PARAM_BRAKE, FIELD(ThrottleConfiguration, uint8_t, minimumRegen), 1, 0, "Min Brake Regen" },
+	{ Constants::brakeLight, PARAM_MOTOR, FIELD(MotorControllerConfiguration, uint8_t, brakeLight), 1, 0, "Brake Light Output" },
+	{ "BRAKELT", PARAM_MOTOR, FIELD(MotorControllerConfiguration, uint8_t, brakeLight), 1, 0, "Brake Light Output" },
+	{ Constants::brakeMax, PARAM_BRAKE, FIELD(PotThrottleConfiguration, uint16_t, maximumLevel1), 1, 0, "Brake Max" },
+	{ Constants::brakeMaxRegen, PARAM_BRAKE, FIELD(ThrottleConfiguration, uint8_t, maximumRegen), 1, 0, "Max Brake Regen" },
+	{ Constants::brakeMin, PARAM_BRAKE, FIELD(PotThrottleConfiguration, uint16_t, minimumLevel1), 1, 0, "Brake Min" },
+	{ Constants::brakeMinRegen, PARAM_BRAKE, FIELD(ThrottleConfiguration, uint8_t, minimumRegen), 1, 0, "Min Brake Regen" },
+	{ "CAPACITY", PARAM_MOTOR, FIELD(MotorControllerConfiguration, uint8_t, capacity), 1, 0, "Battery Pack Capacity" },
+	{ Constants::coolFan, PARAM_MOTOR, FIELD(MotorControllerConfiguration, uint8_t, coolFan), 1, 0, "Cooling Fan Output" },
+	{ Constants::coolOff, PARAM_MOTOR, FIELD(MotorControllerConfiguration, uint8_t, coolOff), 1, 200, "Cooling Fan OFF Temperature" },
+	{ Constants::coolOn, PARAM_MOTOR, FIELD(MotorControllerConfiguration, uint8_t, coolOn), 1, 200, "Cooling Fan ON Temperature" },
+	{ Constants::enableIn, PARAM_MOTOR, FIELD(MotorControllerConfiguration, uint8_t, enableIn), 1, 0, "Motor Enable Input" },
+	{ Constants::logLevel, PARAM_SYSTEM, setLogLevel, 1, 4, "Log Level" },
+	{ Constants::mainContactorRelay, PARAM_MOTOR, FIELD(MotorControllerConfiguration, uint8_t, mainContactorRelay), 1, 0, "Main Contactor Relay Output" },
+	{ "MAXCHG", PARAM_MOTOR, FIELD(MotorControllerConfiguration, uint16_t, maxChargeCurrent), 1, 0, "Max Charge Current" },
+	{ "MAXDCHG", PARAM_MOTOR, FIELD(MotorControllerConfiguration, uint16_t, maxDischargeCurrent), 1, 0, "Max Discharge Current" },
+	{ "MOTPWR", PARAM_MOTOR, FIELD(MotorControllerConfiguration, uint16_t, maxMotorPower), 1, 0, "Max Motor Power" },
+	{ "MRELAY", PARAM_MOTOR, FIELD(MotorControllerConfiguration, uint8_t, mainContactorRelay), 1, 0, "Main Contactor Relay Output" },
+	{ Constants::nominalVolt, PARAM_MOTOR, FIELD(MotorControllerConfiguration, uint16_t, nominalVolt), 10, 0, "Fully Charged Voltage" },
+	{ "NOMV", PARAM_MOTOR, FIELD(MotorControllerConfiguration, uint16_t, nominalVolt), 10, 0, "Fully Charged Voltage" },
+	{ Constants::numThrottlePots, PARAM_ACCELERATOR, FIELD(PotThrottleConfiguration, uint8_t, numberPotMeters), 1, 0, "# of Throttle Pots" },
+	{ "PREC", PARAM_MOTOR, FIELD(MotorControllerConfiguration, uint16_t, kilowattHrs), 1, 0, "Precharge Capacitance" },
+	{ Constants::prechargeR, PARAM_MOTOR, FIELD(MotorControllerConfiguration, uint16_t, prechargeR), 1, 0, "Precharge Time Delay" },
+	{ Constants::prechargeRelay, PARAM_MOTOR, FIELD(MotorControllerConfiguration, uint8_t, prechargeRelay), 1, 0, "Precharge Relay Output" },
+	{ "PREDELAY", PARAM_MOTOR, FIELD(MotorControllerConfiguration, uint16_t, prechargeR), 1, 0, "Precharge Time Delay" },
+	{ "PRELAY", PARAM_MOTOR, FIELD(MotorControllerConfiguration, uint8_t, prechargeRelay), 1, 0, "Precharge Relay Output" },
+	{ "REGENPWR", PARAM_MOTOR, FIELD(MotorControllerConfiguration, uint16_t, maxRegenPower), 1, 0, "Max Regen Power" },
+	{ Constants::reverseIn, PARAM_MOTOR, FIELD(MotorControllerConfiguration, uint8_t, reverseIn), 1, 0, "Motor Reverse Input" },
+	{ "REVIN", PARAM_MOTOR, FIELD(MotorControllerConfiguration, uint8_t, reverseIn), 1, 0, "Motor Reverse Input" },
+	{ Constants::revLight, PARAM_MOTOR, FIELD(MotorControllerConfiguration, uint8_t, revLight), 1, 0, "Reverse Light Output" },
+	{ "REVLIM", PARAM_MOTOR, FIELD(MotorControllerConfiguration, uint8_t, reversePercent), 1, 0, "Reverse Limit" },
+	{ "REVLT", PARAM_MOTOR, FIELD(MotorControllerConfiguration, uint8_t, revLight), 1, 0, "Reverse Light Output" },
+	{ "RPM", PARAM_MOTOR, FIELD(MotorControllerConfiguration, uint16_t, speedMax), 1, 0, "RPM Limit" },
+	{ "RPMSLEW", PARAM_MOTOR, FIELD(MotorControllerConfiguration, uint16_t, speedSlewRate), 1, 0, "Speed Slew Rate" },
+	{ "SLEWRAMP", PARAM_MOTOR, FIELD(MotorControllerConfiguration, uint16_t, slewRampTime), 1, 0, "Slew Ramp Time" },
+	{ Constants::speedMax, PARAM_MOTOR, FIELD(MotorControllerConfiguration, uint16_t, speedMax), 1, 0, "RPM Limit" },
+	{ "T1ADC", PARAM_ACCELERATOR, FIELD(PotThrottleConfiguration, uint8_t, AdcPin1), 1, 0, "Throttle1 ADC Pin" },
+	{ "T1MN", PARAM_ACCELERATOR, FIELD(PotThrottleConfiguration, uint16_t, minimumLevel1), 1, 0, "Throttle1 Min" },
+	{ "T1MX", PARAM_ACCELERATOR, FIELD(PotThrottleConfiguration, uint16_t, maximumLevel1), 1, 0, "Throttle1 Max" },
+	{ "T2ADC", PARAM_ACCELERATOR, FIELD(PotThrottleConfiguration, uint8_t, AdcPin2), 1, 0, "Throttle2 ADC Pin" },
+	{ "T2MN", PARAM_ACCELERATOR, FIELD(PotThrottleConfiguration, uint16_t, minimumLevel2), 1, 0, "Throttle2 Min" },
+	{ "T2MX", PARAM_ACCELERATOR, FIELD(PotThrottleConfiguration, uint16_t, maximumLevel2), 1, 0, "Throttle2 Max" },
+	{ "TCREEP", PARAM_ACCELERATOR, FIELD(ThrottleConfiguration, uint8_t, creep), 1, 0, "Throttle Creep Strength" },
+	{ "TFWD", PARAM_ACCELERATOR, FIELD(ThrottleConfiguration, uint16_t, positionForwardMotionStart), 1, 0, "Throttle Forward Start" },
+	{ Constants::throttleCreep, PARAM_ACCELERATOR, FIELD(ThrottleConfiguration, uint8_t, creep), 1, 0, "Throttle Creep Strength" },
+	{ Constants::throttleFwd, PARAM_ACCELERATOR, FIELD(ThrottleConfiguration, uint16_t, positionForwardMotionStart), 10, 0, "Throttle Forward Start" },
+	{ Constants::throttleMap, PARAM_ACCELERATOR, FIELD(ThrottleConfiguration, uint16_t, positionHalfPower), 10, 0, "Throttle MAP Point" },
+	{ Constants::throttleMax1, PARAM_ACCELERATOR, FIELD(PotThrottleConfiguration, uint16_t, maximumLevel1), 1, 0, "Throttle1 Max" },
+	{ Constants::throttleMax2, PARAM_ACCELERATOR, FIELD(PotThrottleConfiguration, uint16_t, maximumLevel2), 1, 0, "Throttle2 Max" },
+	{ Constants::throttleMaxRegen, PARAM_ACCELERATOR, FIELD(ThrottleConfiguration, uint8_t, maximumRegen), 1, 0, "Throttle Regen Maximum Strength" },
+	{ Constants::throttleMin1, PARAM_ACCELERATOR, FIELD(PotThrottleConfiguration, uint16_t, minimumLevel1), 1, 0, "Throttle1 Min" },
+	{ Constants::throttleMin2, PARAM_ACCELERATOR, FIELD(PotThrottleConfiguration, uint16_t, minimumLevel2), 1, 0, "Throttle2 Min" },
+	{ Constants::throttleMinRegen, PARAM_ACCELERATOR, FIELD(ThrottleConfiguration, uint8_t, minimumRegen), 1, 0, "Throttle Regen Minimum Strength" },
+	{ Constants::throttleRegenMax, PARAM_ACCELERATOR, FIELD(ThrottleConfiguration, uint16_t, positionRegenMaximum), 10, 0, "Throttle Regen Maximum" },
+	{ Constants::throttleRegenMin, PARAM_ACCELERATOR, FIELD(ThrottleConfiguration, uint16_t, positionRegenMinimum), 10, 0, "Throttle Regen Minimum" },
+	{ Constants::throttleSubType, PARAM_ACCELERATOR, FIELD(PotThrottleConfiguration, uint8_t, throttleSubType), 1, 0, "Throttle Subtype" },
+	{ "TMAP", PARAM_ACCELERATOR, FIELD(ThrottleConfiguration, uint16_t, positionHalfPower), 1, 0, "Throttle MAP Point" },
+	{ "TMAXRN", PARAM_ACCELERATOR, FIELD(ThrottleConfiguration, uint8_t, maximumRegen), 1, 0, "Throttle Regen Maximum Strength" },
+	{ "TMINRN", PARAM_ACCELERATOR, FIELD(ThrottleConfiguration, uint8_t, minimumRegen), 1, 0, "Throttle Regen Minimum Strength" },
+	{ "TORQ", PARAM_MOTOR, FIELD(MotorControllerConfiguration, uint16_t, torqueMax), 1, 0, "Torque Limit" },
+	{ Constants::torqueMax, PARAM_MOTOR, FIELD(MotorControllerConfiguration, uint16_t, torqueMax), 10, 0, "Torque Limit" },
+	{ "TPOT", PARAM_ACCELERATOR, FIELD(PotThrottleConfiguration, uint8_t, numberPotMeters), 1, 0, "# of Throttle Pots" },
+	{ "TRGNMAX", PARAM_ACCELERATOR, FIELD(ThrottleConfiguration, uint16_t, positionRegenMaximum), 1, 0, "Throttle Regen Maximum" },
+	{ "TRGNMIN", PARAM_ACCELERATOR, FIELD(ThrottleConfiguration, uint16_t, positionRegenMinimum), 1, 0, "Throttle Regen Minimum" },
+	{ "TSLEW", PARAM_MOTOR, FIELD(MotorControllerConfiguration, uint16_t, torqueSlewRate), 1, 0, "Torque Slew Rate" },
+	{ "TTYPE", PARAM_ACCELERATOR, FIELD(PotThrottleConfiguration, uint8_t, throttleSubType), 1, 0, "Throttle Subtype" },
+};
+
+#define NUM_PARAMETERS (sizeof(parameters) / sizeof(parameters[0]))
+
+/*
+ * Look up a parameter by its name (case insensitive) with a binary search,
+ * returns NULL if there's no such parameter.
+ */
+const Parameter *ParameterTable::find(const char *name) {
+	int low = 0, high = NUM_PARAMETERS - 1;
+
+	while (low <= high) {
+		int middle = (low + high) / 2;
+		int result = strcasecmp(name, parameters[middle].name);
+		if (result == 0)
+			return &parameters[middle];
+		if (result < 0)
+			high = middle - 1;
+		else
+			low = middle + 1;
+	}
+	return NULL;
+}
+
+/*
+ * Returns the number of parameters in the table
+ */
+uint8_t ParameterTable::getCount() {
+	return NUM_PARAMETERS;
+}
+
+/*
+ * Returns the parameter at the given position (sorted by name), NULL if the index is too big
+ */
+const Parameter *ParameterTable::get(uint8_t index) {
+	return (index < NUM_PARAMETERS ? &parameters[index] : NULL);
+}
+
+/*
+ * Set a parameter to the given value (in the unit of the front end, it is
+ * multiplied with the parameter's scale) and save the configuration of the device.
+ */
+ParameterResult ParameterTable::set(const Parameter *parameter, int32_t value) {
+	Device *device = NULL;
+	DeviceConfiguration *config = NULL;
+
+	if (parameter == NULL)
+		return PARAM_UNKNOWN;
+
+	switch (parameter->target) {
+	case PARAM_ACCELERATOR:
+		device = DeviceManager::getInstance()->getAccelerator();
+		break;
+	case PARAM_BRAKE:
+		device = DeviceManager::getInstance()->getBrake();
+		break;
+	case PARAM_MOTOR:
+		device = DeviceManager::getInstance()->getMotorController();
+		break;
+	case PARAM_SYSTEM:
+		break;
+	}
+	if (parameter->target != PARAM_SYSTEM) {
+		if (device == NULL || (config = device->getConfiguration()) == NULL)
+			return PARAM_NO_DEVICE;
+	}
+
+	if (value < 0 || value > 0x7FFFFFFF / parameter->scale)
+		return PARAM_OUT_OF_RANGE;
+	value *= parameter->scale;
+	if (parameter->maximum != 0 && value > parameter->maximum)
+		return PARAM_OUT_OF_RANGE;
+	if (!parameter->setter(config, value))
+		return PARAM_OUT_OF_RANGE;
+
+	if (device)
+		device->saveConfiguration();
+	return PARAM_OK;
+}
@@ -0,0 +1,80 @@
+/*
+ * ParameterTable.h - The configuration parameters which can be changed via
+ * the serial console and the web site of the wifi module.
+ *
+ * Both front ends look up the name in one table which is sorted by name
+ * (case insensitive) so a binary search finds it without string objects or
+ * long if/else chains. Each entry knows the device it belongs to and how to
+ * store the value in the configuration of that device. The console names
+ * (e.g. "TORQ") and the names of the web site (e.g. "torqueMax") are both in
+ * the table, so both front ends accept all parameters. Note that some values
+ * are entered in different units (e.g. Nm on the web site, 0.1Nm on the console).
+ *
+ Copyright (c) 2013 Collin Kidder, Michael Neuweiler, Charles Galpin
+
+ Permission is hereby granted, free of charge, to any person obtaining
+ a copy of this software and associated documentation files (the
+ "Software"), to deal in the Software without restriction, including
+ without limitation the rights to use, copy, modify, merge, publish,
+ distribute, sublicense, and/or sell copies of the Software, and to
+ permit persons to whom the Software is furnished to do so, subject to
+ the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+ */
+
+#ifndef PARAMETERTABLE_H_
+#define PARAMETERTABLE_H_
+
+#include <Arduino.h>
+#include "config.h"
+#include "DeviceManager.h"
+
+enum ParameterTarget {
+	PARAM_ACCELERATOR,
+	PARAM_BRAKE,
+	PARAM_MOTOR,
+	PARAM_SYSTEM // not stored in a device configuration
+};
+
+enum ParameterResult {
+	PARAM_OK,
+	PARAM_UNKNOWN, // no parameter with this name
+	PARAM_NO_DEVICE, // the device of the parameter is not available
+	PARAM_OUT_OF_RANGE // the value doesn't fit into the parameter
+};
+
+/*
+ * Stores the value in the configuration (NULL for PARAM_SYSTEM),
+ * returns false if the value is out of range.
+ */
+typedef bool (*ParameterSetter)(DeviceConfiguration *config, int32_t value);
+
+struct Parameter {
+	const char *name;
+	ParameterTarget target;
+	ParameterSetter setter;
+	uint8_t scale; // the entered value is multiplied by this before it is stored (e.g. 10 if entered in V but stored in 0.1V)
+	uint16_t maximum; // max value to store, 0 = limited by the type of the field only
+	const char *description; // shown on the console
+};
+
+class ParameterTable {
+public:
+	static const Parameter *find(const char *name);
+	static ParameterResult set(const Parameter *parameter, int32_t value);
+	static uint8_t getCount();
+	static const Parameter *get(uint8_t index);
+};
+
+#endif /* PARAMETERTABLE_H_ */
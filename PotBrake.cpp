@@ -44,6 +44,7 @@ void PotBrake::setup() {
 	Logger::info("add device: PotBrake (id: %X, %X)", POTBRAKEPEDAL, this);	
 
 	Throttle::setup(); //call base class
+	publishSignals(&rawSignal);
 
 	//set digital ports to inputs and pull them up all inputs currently active low
 	//pinMode(THROTTLE_INPUT_BRAKELIGHT, INPUT_PULLUP); //Brake light switch
@@ -130,7 +131,7 @@ int16_t PotBrake::mapPedalPosition(int16_t pedalPosition) {
 	range = config->maximumRegen - config->minimumRegen;
 	brakeLevel = -10 * range * pedalPosition / 1000;
 	brakeLevel -= 10 * config->minimumRegen;
-	//Logger::debug(POTBRAKEPEDAL, "level: %d", level);
+	//LOG_DEBUG(POTBRAKEPEDAL, "level: %d", level);
 
 	return brakeLevel;
 }
@@ -171,8 +172,8 @@ void PotBrake::loadConfiguration() {
 		prefsHandler->read(EETH_MIN_BRAKE_REGEN, &config->minimumRegen);
 		prefsHandler->read(EETH_ADC_1, &config->AdcPin1);
           config->AdcPin1 = 2;
-		Logger::debug(POTBRAKEPEDAL, "BRAKE MIN: %l MAX: %l", config->minimumLevel1, config->maximumLevel1);
-		Logger::debug(POTBRAKEPEDAL, "Min: %l MaxRegen: %l", config->minimumRegen, config->maximumRegen);
+		LOG_DEBUG(POTBRAKEPEDAL, "BRAKE MIN: %l MAX: %l", config->minimumLevel1, config->maximumLevel1);
+		LOG_DEBUG(POTBRAKEPEDAL, "Min: %l MaxRegen: %l", config->minimumRegen, config->maximumRegen);
 	} else { //checksum invalid. Reinitialize values and store to EEPROM
 
 		//these four values are ADC values
@@ -45,6 +45,7 @@ void PotThrottle::setup() {
 	loadConfiguration();
 
 	Throttle::setup(); //call base class
+	publishSignals(&rawSignal);
 
 	//set digital ports to inputs and pull them up all inputs currently active low
 	//pinMode(THROTTLE_INPUT_BRAKELIGHT, INPUT_PULLUP); //Brake light switch
@@ -64,10 +65,14 @@ void PotThrottle::handleTick() {
  */
 RawSignalData *PotThrottle::acquireRawSignal() {
 	PotThrottleConfiguration *config = (PotThrottleConfiguration *) getConfiguration();
+	ADC_SNAPSHOT snapshot;
+
 	sys_io_adc_poll();
 
-	rawSignal.input1 = getAnalog(config->AdcPin1);
-	rawSignal.input2 = getAnalog(config->AdcPin2);
+	// take both inputs from the same DMA window so the mismatch check compares the same instant
+	getAnalogSnapshot(&snapshot);
+	rawSignal.input1 = snapshot.values[config->AdcPin1 < NUM_ANALOG ? config->AdcPin1 : 0];
+	rawSignal.input2 = snapshot.values[config->AdcPin2 < NUM_ANALOG ? config->AdcPin2 : 0];
 	return &rawSignal;
 }
 
@@ -226,7 +231,7 @@ void PotThrottle::loadConfiguration() {
 #else
 	if (prefsHandler->checksumValid()) { //checksum is good, read in the values stored in EEPROM
 #endif
-		Logger::debug(POTACCELPEDAL, (char *)Constants::validChecksum);
+		LOG_DEBUG(POTACCELPEDAL, (char *)Constants::validChecksum);
 		prefsHandler->read(EETH_MIN_ONE, &config->minimumLevel1);
 		prefsHandler->read(EETH_MAX_ONE, &config->maximumLevel1);
 		prefsHandler->read(EETH_MIN_TWO, &config->minimumLevel2);
@@ -241,7 +246,7 @@ void PotThrottle::loadConfiguration() {
 		// will both be zero.  We really should refuse to operate in this condition and force
 		// calibration, but for now at least allow calibration to work by setting numThrottlePots = 2
 		if (config->numberPotMeters == 0 && config->throttleSubType == 0) {
-			Logger::debug(POTACCELPEDAL, "THROTTLE APPEARS TO NEED CALIBRATION/DETECTION - choose 'z' on the serial console menu");
+			LOG_DEBUG(POTACCELPEDAL, "THROTTLE APPEARS TO NEED CALIBRATION/DETECTION - choose 'z' on the serial console menu");
 			config->numberPotMeters = 2;
 		}
 	} else { //checksum invalid. Reinitialize values and store to EEPROM
@@ -258,8 +263,8 @@ void PotThrottle::loadConfiguration() {
 
 		saveConfiguration();
 	}
-	Logger::debug(POTACCELPEDAL, "# of pots: %d       subtype: %d", config->numberPotMeters, config->throttleSubType);
-	Logger::debug(POTACCELPEDAL, "T1 MIN: %l MAX: %l      T2 MIN: %l MAX: %l", config->minimumLevel1, config->maximumLevel1, config->minimumLevel2,
+	LOG_DEBUG(POTACCELPEDAL, "# of pots: %d       subtype: %d", config->numberPotMeters, config->throttleSubType);
+	LOG_DEBUG(POTACCELPEDAL, "T1 MIN: %l MAX: %l      T2 MIN: %l MAX: %l", config->minimumLevel1, config->maximumLevel1, config->minimumLevel2,
 			config->maximumLevel2);
 }
 
@@ -45,6 +45,7 @@ void PrefHandler::setEnabledStatus(bool en)
 
 	enabled = en;
 
+	memCache->Read(EE_DEVICE_TABLE + (2 * position), &id);
 	if (enabled) {
 		id |= 0x8000; //set enabled bit
 	}
@@ -63,7 +64,7 @@ void PrefHandler::initDevTable()
   memCache->Read(EE_DEVICE_TABLE, &id);
   if (id == 0xDEAD) return;
 
-  Logger::debug("Initializing EEPROM device table");
+  LOG_DEBUG("Initializing EEPROM device table");
 
   //initialize table with zeros
   id = 0;
@@ -128,14 +129,14 @@ bool PrefHandler::setDeviceStatus(uint16_t device, bool enabled)
 	for (int x = 1; x < 64; x++) {
 		memCache->Read(EE_DEVICE_TABLE + (2 * x), &id);
 		if ((id & 0x7FFF) == (device & 0x7FFF)) {
-			Logger::debug("Found a device record to edit");
+			LOG_DEBUG("Found a device record to edit");
 			if (enabled) {
 				id |= 0x8000;
 			}
 			else {
 				id &= 0x7FFF;
 			}
-			Logger::debug("ID to write: %X", id);
+			LOG_DEBUG("ID to write: %X", id);
 			memCache->Write(EE_DEVICE_TABLE + (2 * x), id);
 			return true;
 		}
@@ -46,10 +46,11 @@ void SerialConsole::init() {
 	state = STATE_ROOT_MENU;
         loopcount=0;
         cancel=false;
+	LoopHandler::getInstance()->attach(this, LOOP_PRIORITY_NORMAL, CFG_LOOP_BUDGET_CONSOLE, "console");
       
 }
 
-void SerialConsole::loop() {
+void SerialConsole::handleLoop() {
   if(!cancel)
     {
       if(loopcount++==350000){
@@ -59,7 +60,7 @@ void SerialConsole::loop() {
         }
     } 
   if (handlingEvent == false) {
-	if (SerialUSB.available()) {
+	while (SerialUSB.available()) {
         	serialEvent();
 		}
 	}
@@ -72,54 +73,76 @@ void SerialConsole::printMenu() {
 	ICHIPWIFI *wifi = (ICHIPWIFI*) DeviceManager::getInstance()->getDeviceByType(DEVICE_WIFI);
 
 	//Show build # here as well in case people are using the native port and don't get to see the start up messages
-	SerialUSB.print("Build number: ");
-	SerialUSB.println(CFG_BUILD_NUM);
+	serialOutput.print("Build number: ");
+	serialOutput.println(CFG_BUILD_NUM);
 	if (motorController) {
-		SerialUSB.println(
+		serialOutput.println(
 			"Motor Controller Status: isRunning: " + String(motorController->isRunning()) + " isFaulted: " + String(motorController->isFaulted()));
 	}
-	SerialUSB.println("System Menu:");
-	SerialUSB.println();
-	SerialUSB.println("Enable line endings of some sort (LF, CR, CRLF)");
-	SerialUSB.println();
-	SerialUSB.println("Short Commands:");
-	SerialUSB.println("h = help (displays this message)");
+	serialOutput.println("System Menu:");
+	serialOutput.println();
+	serialOutput.println("Enable line endings of some sort (LF, CR, CRLF)");
+	serialOutput.println();
+	serialOutput.println("Short Commands:");
+	serialOutput.println("h = help (displays this message)");
 	if (heartbeat != NULL) {
-		SerialUSB.println("L = show raw analog/digital input/output values (toggle)");
+		serialOutput.println("L = show raw analog/digital input/output values (toggle)");
 	}
-	SerialUSB.println("K = set all outputs high");
-	SerialUSB.println("J = set all outputs low");
-	//SerialUSB.println("U,I = test EEPROM routines");
-	SerialUSB.println("E = dump system eeprom values");
-	SerialUSB.println("z = detect throttle min/max, num throttles and subtype");
-	SerialUSB.println("Z = save throttle values");
-	SerialUSB.println("b = detect brake min/max");
-	SerialUSB.println("B = save brake values");
-	SerialUSB.println("p = enable wifi passthrough (reboot required to resume normal operation)");
-	SerialUSB.println("S = show possible device IDs");
-	SerialUSB.println("w = GEVCU 4.2 reset wifi to factory defaults, setup GEVCU ad-hoc network");
-	SerialUSB.println("W = GEVCU 5.2 reset wifi to factory defaults, setup GEVCU as Access Point");
-	SerialUSB.println("s = Scan WiFi for nearby access points");
-	SerialUSB.println();
-	SerialUSB.println("Config Commands (enter command=newvalue). Current values shown in parenthesis:");
-    SerialUSB.println();
+	serialOutput.println("K = set all outputs high");
+	serialOutput.println("J = set all outputs low");
+	//serialOutput.println("U,I = test EEPROM routines");
+	serialOutput.println("E = dump system eeprom values");
+	serialOutput.println("z = detect throttle min/max, num throttles and subtype");
+	serialOutput.println("Z = save throttle values");
+	serialOutput.println("b = detect brake min/max");
+	serialOutput.println("B = save brake values");
+	serialOutput.println("p = enable wifi passthrough (reboot required to resume normal operation)");
+	serialOutput.println("S = show possible device IDs");
+	serialOutput.println("M = show motor controller state and last state transitions");
+	serialOutput.println("w = GEVCU 4.2 reset wifi to factory defaults, setup GEVCU ad-hoc network");
+	serialOutput.println("W = GEVCU 5.2 reset wifi to factory defaults, setup GEVCU as Access Point");
+	serialOutput.println("s = Scan WiFi for nearby access points");
+	serialOutput.println("i = show wifi communication statistics");
+	serialOutput.println("v = show all published signals with their current value");
+	serialOutput.println("T = show run times of the loop tasks and the loop time histogram (resets them)");
+	serialOutput.println();
+	serialOutput.println("Config Commands (enter command=newvalue). Current values shown in parenthesis:");
+    serialOutput.println();
     Logger::console("LOGLEVEL=%i - set log level (0=debug, 1=info, 2=warn, 3=error, 4=off)", Logger::getLogLevel());
+    Logger::console("LOGLEVEL=<device id>,<level> - set log level of a single device (e.g. LOGLEVEL=0x1000,1 to silence the debug output of the DMOC645)");
+    Logger::printDeviceLogLevels();
    
 	uint8_t systype;
 	sysPrefs->read(EESYS_SYSTEM_TYPE, &systype);
 	Logger::console("SYSTYPE=%i - Set board revision (Dued=2, GEVCU3=3, GEVCU4=4)", systype);
 
+	uint32_t telemetryAddress;
+	uint16_t telemetryPort, telemetryInterval;
+	sysPrefs->read(EESYS_TELEMETRY_IPADDR, &telemetryAddress);
+	sysPrefs->read(EESYS_TELEMETRY_PORT, &telemetryPort);
+	sysPrefs->read(EESYS_TELEMETRY_INTERVAL, &telemetryInterval);
+	Logger::console("TELEMETRY=%d.%d.%d.%d:%d - IP address and port of the telemetry receiver (0 = off)", telemetryAddress & 0xFF,
+			(telemetryAddress >> 8) & 0xFF, (telemetryAddress >> 16) & 0xFF, telemetryAddress >> 24, telemetryPort);
+	Logger::console("TELRATE=%i - ms between two telemetry records", telemetryInterval);
+
 	DeviceManager::getInstance()->printDeviceList();
 
 	if (motorController && motorController->getConfiguration()) {
 		MotorControllerConfiguration *config = (MotorControllerConfiguration *) motorController->getConfiguration();
                   
-         SerialUSB.println();
-         SerialUSB.println("MOTOR CONTROLS");
-         SerialUSB.println();
+         serialOutput.println();
+         serialOutput.println("MOTOR CONTROLS");
+         serialOutput.println();
 		Logger::console("TORQ=%i - Set torque upper limit (tenths of a Nm)", config->torqueMax);
 		Logger::console("RPM=%i - Set maximum RPM", config->speedMax);
 		Logger::console("REVLIM=%i - How much torque to allow in reverse (Tenths of a percent)", config->reversePercent);
+		Logger::console("TSLEW=%i - Torque slew rate (tenths of a Nm per second, 0=disabled)", config->torqueSlewRate);
+		Logger::console("RPMSLEW=%i - Speed slew rate (rpm per second, 0=disabled)", config->speedSlewRate);
+		Logger::console("SLEWRAMP=%i - Time to reach the full slew rate, limits jerk (ms, 0=disabled)", config->slewRampTime);
+		Logger::console("MOTPWR=%i - Maximum power when accelerating (tenths of a kW, 0=no limit)", config->maxMotorPower);
+		Logger::console("REGENPWR=%i - Maximum power when regenerating (tenths of a kW, 0=no limit)", config->maxRegenPower);
+		Logger::console("MAXDCHG=%i - Battery discharge current limit (A, 0=no limit)", config->maxDischargeCurrent);
+		Logger::console("MAXCHG=%i - Battery charge current limit for regen (A, 0=no limit)", config->maxChargeCurrent);
                             
 	        Logger::console("COOLFAN=%i - Digital output to turn on cooling fan(0-7, 255 for none)", config->coolFan);
                 Logger::console("COOLON=%i - Inverter temperature C to turn cooling on", config->coolOn);
@@ -134,9 +157,9 @@ void SerialConsole::printMenu() {
 
 	if (accelerator && accelerator->getConfiguration()) {
 		PotThrottleConfiguration *config = (PotThrottleConfiguration *) accelerator->getConfiguration();
-         SerialUSB.println();
-         SerialUSB.println("THROTTLE CONTROLS");
-         SerialUSB.println();
+         serialOutput.println();
+         serialOutput.println("THROTTLE CONTROLS");
+         serialOutput.println();
 	
 		Logger::console("TPOT=%i - Number of pots to use (1 or 2)", config->numberPotMeters);
 		Logger::console("TTYPE=%i - Set throttle subtype (1=std linear, 2=inverse)", config->throttleSubType);
@@ -153,13 +176,16 @@ void SerialConsole::printMenu() {
 		Logger::console("TMINRN=%i - Percent of full torque to use for min throttle regen", config->minimumRegen);
 		Logger::console("TMAXRN=%i - Percent of full torque to use for max throttle regen", config->maximumRegen);
 		Logger::console("TCREEP=%i - Percent of full torque to use for creep (0=disable)", config->creep);
+		Logger::console("TCURVE=%i - Throttle curve points as pos:level,... e.g. 0:0,500:200,1000:1000 (0=use settings above)", config->curvePoints);
+		for (int i = 0; i < config->curvePoints; i++)
+			Logger::console("    point %i: position %i, level %i", i, config->curvePosition[i], config->curveLevel[i]);
 	}
 
 	if (brake && brake->getConfiguration()) {
 		PotThrottleConfiguration *config = (PotThrottleConfiguration *) brake->getConfiguration();
-                SerialUSB.println();
-                SerialUSB.println("BRAKE CONTROLS");
-	        SerialUSB.println();
+                serialOutput.println();
+                serialOutput.println("BRAKE CONTROLS");
+	        serialOutput.println();
 
 		Logger::console("B1ADC=%i - Set brake ADC pin", config->AdcPin1);
 		Logger::console("B1MN=%i - Set brake min value", config->minimumLevel1);
@@ -170,16 +196,16 @@ void SerialConsole::printMenu() {
 
 	if (motorController && motorController->getConfiguration()) {
 		MotorControllerConfiguration *config = (MotorControllerConfiguration *) motorController->getConfiguration();
-                SerialUSB.println();
-                SerialUSB.println("PRECHARGE CONTROLS");
-	        SerialUSB.println();
+                serialOutput.println();
+                serialOutput.println("PRECHARGE CONTROLS");
+	        serialOutput.println();
 
 		Logger::console("PREDELAY=%i - Precharge delay time in milliseconds ", config->prechargeR);
 	        Logger::console("PRELAY=%i - Which output to use for precharge contactor (255 to disable)", config->prechargeRelay);
 		Logger::console("MRELAY=%i - Which output to use for main contactor (255 to disable)", config->mainContactorRelay);
-                SerialUSB.println();
-                SerialUSB.println("WIRELESS LAN COMMANDS");
-	        SerialUSB.println();
+                serialOutput.println();
+                serialOutput.println("WIRELESS LAN COMMANDS");
+	        serialOutput.println();
                 Logger::console("WIREACH=anycommand - sends ATi+anycommand to WiReach Module");
                 Logger::console("SSID=anyname - sets broadcast ID to anyname");
                 Logger::console("IP=192.168.3.10 - sets IP of website to whatever IP is entered");
@@ -187,14 +213,14 @@ void SerialConsole::printMenu() {
                 Logger::console("CHANNEL=4 - sets website wireless channel - 1 to 11");
                 Logger::console("SECURITY=password - sets website wireless connection security for WPA2-AES and password");
              
-                SerialUSB.println();
-                SerialUSB.println("OTHER");
-	        SerialUSB.println();
+                serialOutput.println();
+                serialOutput.println("OTHER");
+	        serialOutput.println();
 
 		Logger::console("NOMV=%i - Fully charged pack voltage that automatically resets kWh counter", config->nominalVolt/10);
             	Logger::console("CAPACITY=%i - capacity of battery pack in ampere-hours", config->capacity);
            
-                Logger::console("kWh=%d - kiloWatt Hours of energy used", config->kilowattHrs/3600000);
+                Logger::console("kWh=%d - kiloWatt Hours of energy used", EnergyMeter::getInstance()->getEnergy() / 1000);
 		Logger::console("OUTPUT=<0-7> - toggles state of specified digital output");
                 Logger::console("NUKE=1 - Resets all device settings in EEPROM. You have been warned.");
 	}
@@ -207,6 +233,8 @@ void SerialConsole::printMenu() {
  This is no longer going to be a simple single character console.
  Now the system can handle up to 80 input characters. Commands are submitted
  by sending line ending (LF, CR, or both)
+ All characters which are available are read in one pass of loop(), the
+ output is queued in serialOutput so a command never waits for the host.
  */
 void SerialConsole::serialEvent() {
 	int incoming;
@@ -238,352 +266,279 @@ void SerialConsole::handleConsoleCmd() {
 	handlingEvent = false;
 }
 
-/*For simplicity the configuration setting code uses four characters for each configuration choice. This makes things easier for
- comparison purposes.
+/*
+ * Commands which are only available on the console. Sorted by name, the
+ * lookup relies on it. All other parameters are looked up in the ParameterTable
+ * which is shared with the wifi module.
+ */
+const SerialConsole::ConsoleCommand SerialConsole::commands[] = {
+	{ "CHANNEL", &SerialConsole::setChannel },
+	{ "DISABLE", &SerialConsole::disableDevice },
+	{ "ENABLE", &SerialConsole::enableDevice },
+	{ "IP", &SerialConsole::setIpAddress },
+	{ "KWH", &SerialConsole::setEnergy },
+	{ "LOGLEVEL", &SerialConsole::setLogLevel },
+	{ "NUKE", &SerialConsole::nukeDevices },
+	{ "OUTPUT", &SerialConsole::toggleOutput },
+	{ "PWD", &SerialConsole::setPassword },
+	{ "SECURITY", &SerialConsole::setSecurity },
+	{ "SSID", &SerialConsole::setSsid },
+	{ "SYSTYPE", &SerialConsole::setSystemType },
+	{ "TCURVE", &SerialConsole::setThrottleCurve },
+	{ "TELEMETRY", &SerialConsole::setTelemetry },
+	{ "TELRATE", &SerialConsole::setTelemetryRate },
+	{ "WIREACH", &SerialConsole::sendWifiCommand }
+};
+
+#define NUM_COMMANDS (sizeof(commands) / sizeof(commands[0]))
+
+/*
+ * Look up a console command by its name (case insensitive), returns NULL if not found
+ */
+const SerialConsole::ConsoleCommand *SerialConsole::findCommand(const char *name) {
+	int low = 0, high = NUM_COMMANDS - 1;
+
+	while (low <= high) {
+		int middle = (low + high) / 2;
+		int result = strcasecmp(name, commands[middle].name);
+		if (result == 0)
+			return &commands[middle];
+		if (result < 0)
+			high = middle - 1;
+		else
+			low = middle + 1;
+	}
+	return NULL;
+}
+
+/*
+ * Handle a configuration line in the form of NAME=value. The name is first
+ * looked up in the console commands and then in the shared parameter table.
  */
 void SerialConsole::handleConfigCmd() {
-	PotThrottleConfiguration *acceleratorConfig = NULL;
-	PotThrottleConfiguration *brakeConfig = NULL;
-	MotorControllerConfiguration *motorConfig = NULL;
-       
-	Throttle *accelerator = DeviceManager::getInstance()->getAccelerator();
-	Throttle *brake = DeviceManager::getInstance()->getBrake();
-	MotorController *motorController = DeviceManager::getInstance()->getMotorController();
-    	int i;
-	int newValue;
 	bool updateWifi = true;
 
-	//Logger::debug("Cmd size: %i", ptrBuffer);
-	if (ptrBuffer < 6)
-		return; //4 digit command, =, value is at least 6 characters
 	cmdBuffer[ptrBuffer] = 0; //make sure to null terminate
-	String cmdString = String();
-	unsigned char whichEntry = '0';
-	i = 0;
-
-	while (cmdBuffer[i] != '=' && i < ptrBuffer) {
-	 cmdString.concat(String(cmdBuffer[i++]));
-	}
-	i++; //skip the =
-	if (i >= ptrBuffer)
-	{
+	char *value = strchr(cmdBuffer, '=');
+	if (value == NULL || value[1] == 0) {
 		Logger::console("Command needs a value..ie TORQ=3000");
 		Logger::console("");
 		return; //or, we could use this to display the parameter instead of setting
 	}
-
-	if (accelerator)
-		acceleratorConfig = (PotThrottleConfiguration *) accelerator->getConfiguration();
-	if (brake)
-		brakeConfig = (PotThrottleConfiguration *) brake->getConfiguration();
-	if (motorController)
-		motorConfig = (MotorControllerConfiguration *) motorController->getConfiguration();
+	*value++ = 0; // split the line into name and value
 
 	// strtol() is able to parse also hex values (e.g. a string "0xCAFE"), useful for enable/disable by device id
-	newValue = strtol((char *) (cmdBuffer + i), NULL, 0);
-
-	cmdString.toUpperCase();
-	if (cmdString == String("TORQ") && motorConfig) {
-		Logger::console("Setting Torque Limit to %i", newValue);
-		motorConfig->torqueMax = newValue;
-		motorController->saveConfiguration();
-	} else if (cmdString == String("RPM") && motorConfig) {
-		Logger::console("Setting RPM Limit to %i", newValue);
-		motorConfig->speedMax = newValue;
-		motorController->saveConfiguration();
-	} else if (cmdString == String("REVLIM") && motorConfig) {
-		Logger::console("Setting Reverse Limit to %i", newValue);
-		motorConfig->reversePercent = newValue;
-		motorController->saveConfiguration();
-	} else if (cmdString == String("TPOT") && acceleratorConfig) {
-		Logger::console("Setting # of Throttle Pots to %i", newValue);
-		acceleratorConfig->numberPotMeters = newValue;
-		accelerator->saveConfiguration();
-	} else if (cmdString == String("TTYPE") && acceleratorConfig) {
-		Logger::console("Setting Throttle Subtype to %i", newValue);
-		acceleratorConfig->throttleSubType = newValue;
-		accelerator->saveConfiguration();
-	} else if (cmdString == String("T1ADC") && acceleratorConfig) {
-		Logger::console("Setting Throttle1 ADC pin to %i", newValue);
-		acceleratorConfig->AdcPin1 = newValue;
-		accelerator->saveConfiguration();
-	} else if (cmdString == String("T1MN") && acceleratorConfig) {
-		Logger::console("Setting Throttle1 Min to %i", newValue);
-		acceleratorConfig->minimumLevel1 = newValue;
-		accelerator->saveConfiguration();
-	} else if (cmdString == String("T1MX") && acceleratorConfig) {
-		Logger::console("Setting Throttle1 Max to %i", newValue);
-		acceleratorConfig->maximumLevel1 = newValue;
-		accelerator->saveConfiguration();
-	}
-	else if (cmdString == String("T2ADC") && acceleratorConfig) {
-		Logger::console("Setting Throttle2 ADC pin to %i", newValue);
-		acceleratorConfig->AdcPin2 = newValue;
-		accelerator->saveConfiguration();
-	} else if (cmdString == String("T2MN") && acceleratorConfig) {
-		Logger::console("Setting Throttle2 Min to %i", newValue);
-		acceleratorConfig->minimumLevel2 = newValue;
-		accelerator->saveConfiguration();
-	} else if (cmdString == String("T2MX") && acceleratorConfig) {
-		Logger::console("Setting Throttle2 Max to %i", newValue);
-		acceleratorConfig->maximumLevel2 = newValue;
-		accelerator->saveConfiguration();
-	} else if (cmdString == String("TRGNMAX") && acceleratorConfig) {
-		Logger::console("Setting Throttle Regen maximum to %i", newValue);
-		acceleratorConfig->positionRegenMaximum = newValue;
-		accelerator->saveConfiguration();
-	} else if (cmdString == String("TRGNMIN") && acceleratorConfig) {
-		Logger::console("Setting Throttle Regen minimum to %i", newValue);
-		acceleratorConfig->positionRegenMinimum = newValue;
-		accelerator->saveConfiguration();
-	} else if (cmdString == String("TFWD") && acceleratorConfig) {
-		Logger::console("Setting Throttle Forward Start to %i", newValue);
-		acceleratorConfig->positionForwardMotionStart = newValue;
-		accelerator->saveConfiguration();
-	} else if (cmdString == String("TMAP") && acceleratorConfig) {
-		Logger::console("Setting Throttle MAP Point to %i", newValue);
-		acceleratorConfig->positionHalfPower = newValue;
-		accelerator->saveConfiguration();
-	} else if (cmdString == String("TMINRN") && acceleratorConfig) {
-		Logger::console("Setting Throttle Regen Minimum Strength to %i", newValue);
-		acceleratorConfig->minimumRegen = newValue;
-		accelerator->saveConfiguration();
-	} else if (cmdString == String("TMAXRN") && acceleratorConfig) {
-		Logger::console("Setting Throttle Regen Maximum Strength to %i", newValue);
-		acceleratorConfig->maximumRegen = newValue;
-		accelerator->saveConfiguration();
-	} else if (cmdString == String("TCREEP") && acceleratorConfig) {
-		Logger::console("Setting Throttle Creep Strength to %i", newValue);
-		acceleratorConfig->creep = newValue;
-		accelerator->saveConfiguration();
-	} else if (cmdString == String("BMAXR") && brakeConfig) {
-		Logger::console("Setting Max Brake Regen to %i", newValue);
-		brakeConfig->maximumRegen = newValue;
-		brake->saveConfiguration();
-	} else if (cmdString == String("BMINR") && brakeConfig) {
-		Logger::console("Setting Min Brake Regen to %i", newValue);
-		brakeConfig->minimumRegen = newValue;
-		brake->saveConfiguration();
-	}
-	else if (cmdString == String("B1ADC") && acceleratorConfig) {
-		Logger::console("Setting Brake ADC pin to %i", newValue);
-		brakeConfig->AdcPin1 = newValue;
-		accelerator->saveConfiguration();
-	} else if (cmdString == String("B1MX") && brakeConfig) {
-		Logger::console("Setting Brake Max to %i", newValue);
-		brakeConfig->maximumLevel1 = newValue;
-		brake->saveConfiguration();
-	} else if (cmdString == String("B1MN") && brakeConfig) {
-		Logger::console("Setting Brake Min to %i", newValue);
-		brakeConfig->minimumLevel1 = newValue;
-		brake->saveConfiguration();
-	} else if (cmdString == String("PREC") && motorConfig) {
-		Logger::console("Setting Precharge Capacitance to %i", newValue);
-		motorConfig->kilowattHrs = newValue;
-		motorController->saveConfiguration();
-	} else if (cmdString == String("PREDELAY") && motorConfig) {
-		Logger::console("Setting Precharge Time Delay to %i milliseconds", newValue);
-		motorConfig->prechargeR = newValue;
-		motorController->saveConfiguration();
-	} else if (cmdString == String("NOMV") && motorConfig) {
-		Logger::console("Setting fully charged voltage to %d vdc", newValue);
-		motorConfig->nominalVolt = newValue * 10;
-		motorController->saveConfiguration();
-        } else if (cmdString == String("BRAKELT") && motorConfig) {
-		motorConfig->brakeLight = newValue;
-		motorController->saveConfiguration();
-		Logger::console("Brake light output set to DOUT%i.",newValue);
- } else if (cmdString == String("REVLT") && motorConfig) {
-		motorConfig->revLight = newValue;
-		motorController->saveConfiguration();
-		Logger::console("Reverse light output set to DOUT%i.",newValue);
- } else if (cmdString == String("ENABLEIN") && motorConfig) {
-		motorConfig->enableIn = newValue;
-		motorController->saveConfiguration();
-		Logger::console("Motor Enable input set to DIN%i.",newValue);
- } else if (cmdString == String("REVIN") && motorConfig) {
-		motorConfig->reverseIn = newValue;
-		motorController->saveConfiguration();
-		Logger::console("Motor Reverse input set to DIN%i.",newValue);
-	} else if (cmdString == String("MRELAY") && motorConfig) {
-		Logger::console("Setting Main Contactor relay output to DOUT%i", newValue);
-		motorConfig->mainContactorRelay = newValue;
-		motorController->saveConfiguration();
-	} else if (cmdString == String("PRELAY") && motorConfig) {
-		Logger::console("Setting Precharge Relay output to DOUT%i", newValue);
-		motorConfig->prechargeRelay = newValue;
-		motorController->saveConfiguration();
-	} else if (cmdString == String("ENABLE")) {
-		if (PrefHandler::setDeviceStatus(newValue, true)) {
-			sysPrefs->forceCacheWrite(); //just in case someone takes us literally and power cycles quickly
-			Logger::console("Successfully enabled device.(%X, %d) Power cycle to activate.", newValue, newValue);
-		}
-		else {
-			Logger::console("Invalid device ID (%X, %d)", newValue, newValue);
-		}
-	} else if (cmdString == String("DISABLE")) {
-		if (PrefHandler::setDeviceStatus(newValue, false)) {
-			sysPrefs->forceCacheWrite(); //just in case someone takes us literally and power cycles quickly
-			Logger::console("Successfully disabled device. Power cycle to deactivate.");
-		}
-		else {
-			Logger::console("Invalid device ID (%X, %d)", newValue, newValue);
-		}
-	} else if (cmdString == String("SYSTYPE")) {
-		if (newValue < 5 && newValue > 0) {
-			sysPrefs->write(EESYS_SYSTEM_TYPE, (uint8_t)(newValue));
-			sysPrefs->saveChecksum();
-			sysPrefs->forceCacheWrite(); //just in case someone takes us literally and power cycles quickly
-			Logger::console("System type updated. Power cycle to apply.");
-		}
-		else Logger::console("Invalid system type. Please enter a value 1 - 4");
+	int newValue = strtol(value, NULL, 0);
 
-       
-	} else if (cmdString == String("LOGLEVEL")) {
-		switch (newValue) {
-		case 0:
-			Logger::setLoglevel(Logger::Debug);
-			Logger::console("setting loglevel to 'debug'");
-			break;
-		case 1:
-			Logger::setLoglevel(Logger::Info);
-			Logger::console("setting loglevel to 'info'");
+	const ConsoleCommand *command = findCommand(cmdBuffer);
+	if (command != NULL) {
+		updateWifi = (this->*command->handler)(value, newValue);
+	} else {
+		const Parameter *parameter = ParameterTable::find(cmdBuffer);
+		switch (ParameterTable::set(parameter, newValue)) {
+		case PARAM_OK:
+			Logger::console("Setting %s to %i", parameter->description, newValue);
 			break;
-		case 2:
-			Logger::console("setting loglevel to 'warning'");
-			Logger::setLoglevel(Logger::Warn);
+		case PARAM_NO_DEVICE:
+			Logger::console("No device available for %s", cmdBuffer);
+			updateWifi = false;
 			break;
-		case 3:
-			Logger::console("setting loglevel to 'error'");
-			Logger::setLoglevel(Logger::Error);
+		case PARAM_OUT_OF_RANGE:
+			Logger::console("Invalid value for %s: %i", parameter->description, newValue);
+			updateWifi = false;
 			break;
-		case 4:
-			Logger::console("setting loglevel to 'off'");
-			Logger::setLoglevel(Logger::Off);
+		default:
+			Logger::console("Unknown command");
+			updateWifi = false;
 			break;
 		}
-		sysPrefs->write(EESYS_LOG_LEVEL, (uint8_t)newValue);
+	}
+	// send updates to ichip wifi
+	if (updateWifi)
+		MessageBus::getInstance()->post(MSG_CONFIG_CHANGE, ICHIP2128);
+}
+
+/*
+ * The handlers of the console commands get the value as string and as number.
+ * They return true if the wifi module should be updated with the new values.
+ */
+
+bool SerialConsole::setThrottleCurve(char *value, int newValue) {
+	Throttle *accelerator = DeviceManager::getInstance()->getAccelerator();
+
+	if (accelerator == NULL) {
+		Logger::console("No accelerator available");
+		return false;
+	}
+	if (accelerator->setCurve(value)) {
+		Logger::console("Setting Throttle Curve to %i points", ((ThrottleConfiguration *) accelerator->getConfiguration())->curvePoints);
+		accelerator->saveConfiguration();
+	} else
+		Logger::console("Invalid throttle curve, use 2 to %i ascending points pos:level (pos 0-1000, level -1000-1000)", CFG_THROTTLE_CURVE_POINTS);
+	return true;
+}
+
+bool SerialConsole::enableDevice(char *value, int newValue) {
+	if (PrefHandler::setDeviceStatus(newValue, true)) {
+		sysPrefs->forceCacheWrite(); //just in case someone takes us literally and power cycles quickly
+		DeviceManager::getInstance()->invalidateIndex();
+		Logger::console("Successfully enabled device.(%X, %d) Power cycle to activate.", newValue, newValue);
+	}
+	else {
+		Logger::console("Invalid device ID (%X, %d)", newValue, newValue);
+	}
+	return true;
+}
+
+bool SerialConsole::disableDevice(char *value, int newValue) {
+	if (PrefHandler::setDeviceStatus(newValue, false)) {
+		sysPrefs->forceCacheWrite(); //just in case someone takes us literally and power cycles quickly
+		DeviceManager::getInstance()->invalidateIndex();
+		Logger::console("Successfully disabled device. Power cycle to deactivate.");
+	}
+	else {
+		Logger::console("Invalid device ID (%X, %d)", newValue, newValue);
+	}
+	return true;
+}
+
+bool SerialConsole::setTelemetry(char *value, int newValue) {
+	int a, b, c, d, port;
+
+	if (newValue == 0) {
+		sysPrefs->write(EESYS_TELEMETRY_PORT, (uint16_t) 0);
+		sysPrefs->saveChecksum();
+		Logger::console("Telemetry disabled. Power cycle to apply.");
+	} else if (sscanf(value, "%d.%d.%d.%d:%d", &a, &b, &c, &d, &port) == 5 && port > 0 && port < 65536) {
+		sysPrefs->write(EESYS_TELEMETRY_IPADDR, (uint32_t) ((a & 0xFF) | ((b & 0xFF) << 8) | ((c & 0xFF) << 16) | ((uint32_t) (d & 0xFF) << 24)));
+		sysPrefs->write(EESYS_TELEMETRY_PORT, (uint16_t) port);
 		sysPrefs->saveChecksum();
+		Logger::console("Telemetry receiver set to %d.%d.%d.%d:%d. Power cycle to apply.", a, b, c, d, port);
+	}
+	else Logger::console("Invalid value. Use TELEMETRY=<ip>:<port>, e.g. TELEMETRY=192.168.3.20:5000");
+	return true;
+}
 
-	} else if (cmdString == String("WIREACH")) {
-		DeviceManager::getInstance()->sendMessage(DEVICE_WIFI, ICHIP2128, MSG_COMMAND, (void *)(cmdBuffer + i));
-		Logger::info("sent \"AT+i%s\" to WiReach wireless LAN device", (cmdBuffer + i));
-                DeviceManager::getInstance()->sendMessage(DEVICE_WIFI, ICHIP2128, MSG_COMMAND, (void *)"DOWN");	
-		updateWifi = false;
-	} else if (cmdString == String("SSID")) {
-		String cmdString = String();
-    	        cmdString.concat("WLSI");
-   		cmdString.concat('=');
-		cmdString.concat((char *)(cmdBuffer + i));
-                Logger::info("Sent \"%s\" to WiReach wireless LAN device", (cmdString.c_str()));
-       		DeviceManager::getInstance()->sendMessage(DEVICE_WIFI, ICHIP2128, MSG_COMMAND, (void *)cmdString.c_str());
-                DeviceManager::getInstance()->sendMessage(DEVICE_WIFI, ICHIP2128, MSG_COMMAND, (void *)"DOWN");	
-		updateWifi = false;
-        } else if (cmdString == String("IP")) {
-		String cmdString = String();
-    	        cmdString.concat("DIP");
-   		cmdString.concat('=');
-		cmdString.concat((char *)(cmdBuffer + i));
-                Logger::info("Sent \"%s\" to WiReach wireless LAN device", (cmdString.c_str()));
-       		DeviceManager::getInstance()->sendMessage(DEVICE_WIFI, ICHIP2128, MSG_COMMAND, (void *)cmdString.c_str());
-                DeviceManager::getInstance()->sendMessage(DEVICE_WIFI, ICHIP2128, MSG_COMMAND, (void *)"DOWN");	
-		updateWifi = false;
- } else if (cmdString == String("CHANNEL")) {
-		String cmdString = String();
-    	        cmdString.concat("WLCH");
-   		cmdString.concat('=');
-		cmdString.concat((char *)(cmdBuffer + i));
-                Logger::info("Sent \"%s\" to WiReach wireless LAN device", (cmdString.c_str()));
-       		DeviceManager::getInstance()->sendMessage(DEVICE_WIFI, ICHIP2128, MSG_COMMAND, (void *)cmdString.c_str());
-                DeviceManager::getInstance()->sendMessage(DEVICE_WIFI, ICHIP2128, MSG_COMMAND, (void *)"DOWN");	
-		updateWifi = false;
-	} else if (cmdString == String("SECURITY")) {
-		String cmdString = String();
-    	        cmdString.concat("WLPP");
-   		cmdString.concat('=');
-		cmdString.concat((char *)(cmdBuffer + i));
-                Logger::info("Sent \"%s\" to WiReach wireless LAN device", (cmdString.c_str()));
-       		DeviceManager::getInstance()->sendMessage(DEVICE_WIFI, ICHIP2128, MSG_COMMAND, (void *)cmdString.c_str());
-                DeviceManager::getInstance()->sendMessage(DEVICE_WIFI, ICHIP2128, MSG_COMMAND, (void *)"DOWN");	
-		updateWifi = false;
-	
-   } else if (cmdString == String("PWD")) {
-		String cmdString = String();
-    	        cmdString.concat("WPWD");
-   		cmdString.concat('=');
-		cmdString.concat((char *)(cmdBuffer + i));
-                Logger::info("Sent \"%s\" to WiReach wireless LAN device", (cmdString.c_str()));
-       		DeviceManager::getInstance()->sendMessage(DEVICE_WIFI, ICHIP2128, MSG_COMMAND, (void *)cmdString.c_str());
-                DeviceManager::getInstance()->sendMessage(DEVICE_WIFI, ICHIP2128, MSG_COMMAND, (void *)"DOWN");	
-		updateWifi = false;
-	
-	} else if (cmdString == String("COOLFAN") && motorConfig) {		
-		Logger::console("Cooling fan output updated to: %i", newValue);
-        motorConfig->coolFan = newValue;
-		motorController->saveConfiguration();
-	} else if (cmdString == String("COOLON")&& motorConfig) {
-		if (newValue <= 200 && newValue >= 0) {
-			Logger::console("Cooling fan ON temperature updated to: %i degrees", newValue);
-			motorConfig->coolOn = newValue;
-			motorController->saveConfiguration();
+bool SerialConsole::setTelemetryRate(char *value, int newValue) {
+	if (newValue >= 20 && newValue <= 10000) {
+		sysPrefs->write(EESYS_TELEMETRY_INTERVAL, (uint16_t) newValue);
+		sysPrefs->saveChecksum();
+		Logger::console("Telemetry interval set to %i ms. Power cycle to apply.", newValue);
+	}
+	else Logger::console("Invalid interval. Please enter a value 20 - 10000");
+	return true;
+}
+
+bool SerialConsole::setSystemType(char *value, int newValue) {
+	if (newValue < 5 && newValue > 0) {
+		sysPrefs->write(EESYS_SYSTEM_TYPE, (uint8_t)(newValue));
+		sysPrefs->saveChecksum();
+		sysPrefs->forceCacheWrite(); //just in case someone takes us literally and power cycles quickly
+		Logger::console("System type updated. Power cycle to apply.");
+	}
+	else Logger::console("Invalid system type. Please enter a value 1 - 4");
+	return true;
+}
+
+bool SerialConsole::setLogLevel(char *value, int newValue) {
+	static const char *levelNames[] = { "debug", "info", "warning", "error", "off" };
+	char *levelStr = strchr(value, ',');
+
+	if (levelStr != NULL) { // LOGLEVEL=<device id>,<level> sets the level of a single device (not stored in EEPROM)
+		int level = strtol(levelStr + 1, NULL, 0);
+		if (newValue > 0 && level >= 0 && level <= 4) {
+			Logger::setLoglevel((DeviceId) newValue, (Logger::LogLevel) level);
+			Logger::console("setting loglevel of device %X to %i", newValue, level);
 		}
-		else Logger::console("Invalid cooling ON temperature. Please enter a value 0 - 200F");
-	} else if (cmdString == String("COOLOFF")&& motorConfig) {
-		if (newValue <= 200 && newValue >= 0) {
-			Logger::console("Cooling fan OFF temperature updated to: %i degrees", newValue);
-			motorConfig->coolOff = newValue;
-			motorController->saveConfiguration();
-	    }
-		else Logger::console("Invalid cooling OFF temperature. Please enter a value 0 - 200F");
-	} else if (cmdString == String("OUTPUT") && newValue<8) {
-                int outie = getOutput(newValue);
-                Logger::console("DOUT%d,  STATE: %d",newValue, outie);
-                if(outie)
-                  {
-                    setOutput(newValue,0);
-                    motorController->statusBitfield1 &= ~(1 << newValue);//Clear
-                  }
-                   else
-                     {
-                       setOutput(newValue,1);
-                        motorController->statusBitfield1 |=1 << newValue;//setbit to Turn on annunciator
-		      }
-                  
-             
-        Logger::console("DOUT0:%d, DOUT1:%d, DOUT2:%d, DOUT3:%d, DOUT4:%d, DOUT5:%d, DOUT6:%d, DOUT7:%d", getOutput(0), getOutput(1), getOutput(2), getOutput(3), getOutput(4), getOutput(5), getOutput(6), getOutput(7));
-	
-                } else if (cmdString == String("CAPACITY") ) {
-                  motorConfig->capacity = newValue;
-		  motorController->saveConfiguration();
-              	  Logger::console("Battery Pack Capacity set to: %d",motorConfig->capacity);
-              
-                } else if (cmdString == String("KWH") ) {
-             
-                  motorController->kiloWattHours = newValue*3600000;
-		  motorController->saveConfiguration();
-              	  Logger::console("kWh set to: %d",motorController->kiloWattHours);
-
-            
-
-              } else if (cmdString == String("NUKE")) {
-		if (newValue == 1) 
-		{   //write zero to the checksum location of every device in the table.
-			//Logger::console("Start of EEPROM Nuke");
-			uint8_t zeroVal = 0;
-			for (int j = 0; j < 64; j++) 
-			{
-				memCache->Write(EE_DEVICES_BASE + (EE_DEVICE_SIZE * j), zeroVal);
-				memCache->FlushAllPages();
-			}			
-			Logger::console("Device settings have been nuked. Reboot to reload default settings");
+		else Logger::console("Invalid value. Use LOGLEVEL=<device id>,<0-4>");
+		return false;
+	}
+	if (ParameterTable::set(ParameterTable::find(Constants::logLevel), newValue) == PARAM_OK)
+		Logger::console("setting loglevel to '%s'", levelNames[newValue]);
+	else
+		Logger::console("Invalid log level. Please enter a value 0 - 4");
+	return true;
+}
+
+/*
+ * Send a command to the WiReach module (as AT+i<command>=<value>) and let it
+ * restart to apply it. Without a command the value is sent as it is.
+ */
+bool SerialConsole::sendWifiCommand(const char *command, char *value) {
+	char buffer[sizeof(cmdBuffer) + 8];
+
+	if (command != NULL) {
+		snprintf(buffer, sizeof(buffer), "%s=%s", command, value);
+		value = buffer;
+	}
+	MessageBus::getInstance()->post(MSG_COMMAND, ICHIP2128, value);
+	Logger::info("sent \"AT+i%s\" to WiReach wireless LAN device", value);
+	MessageBus::getInstance()->post(MSG_COMMAND, ICHIP2128, "DOWN");
+	return false;
+}
+
+bool SerialConsole::sendWifiCommand(char *value, int newValue) {
+	return sendWifiCommand(NULL, value);
+}
+
+bool SerialConsole::setSsid(char *value, int newValue) {
+	return sendWifiCommand("WLSI", value);
+}
+
+bool SerialConsole::setIpAddress(char *value, int newValue) {
+	return sendWifiCommand("DIP", value);
+}
+
+bool SerialConsole::setChannel(char *value, int newValue) {
+	return sendWifiCommand("WLCH", value);
+}
+
+bool SerialConsole::setSecurity(char *value, int newValue) {
+	return sendWifiCommand("WLPP", value);
+}
+
+bool SerialConsole::setPassword(char *value, int newValue) {
+	return sendWifiCommand("WPWD", value);
+}
+
+bool SerialConsole::toggleOutput(char *value, int newValue) {
+	MotorController *motorController = DeviceManager::getInstance()->getMotorController();
+
+	if (newValue < 0 || newValue > 7) {
+		Logger::console("Invalid output. Please enter a value 0 - 7");
+		return false;
+	}
+	int outie = getOutput(newValue);
+	Logger::console("DOUT%d,  STATE: %d", newValue, outie);
+	setOutput(newValue, !outie);
+	if (motorController) {
+		if (outie)
+			motorController->statusBitfield1 &= ~(1 << newValue);//Clear
+		else
+			motorController->statusBitfield1 |= 1 << newValue;//setbit to Turn on annunciator
+	}
+	Logger::console("DOUT0:%d, DOUT1:%d, DOUT2:%d, DOUT3:%d, DOUT4:%d, DOUT5:%d, DOUT6:%d, DOUT7:%d", getOutput(0), getOutput(1), getOutput(2), getOutput(3), getOutput(4), getOutput(5), getOutput(6), getOutput(7));
+	return true;
+}
+
+bool SerialConsole::setEnergy(char *value, int newValue) {
+	EnergyMeter::getInstance()->setEnergy(newValue * 1000);
+	Logger::console("kWh set to: %d", EnergyMeter::getInstance()->getEnergy() / 1000);
+	return true;
+}
+
+bool SerialConsole::nukeDevices(char *value, int newValue) {
+	if (newValue == 1)
+	{   //write zero to the checksum location of every device in the table.
+		uint8_t zeroVal = 0;
+		for (int j = 0; j < 64; j++)
+		{
+			memCache->Write(EE_DEVICES_BASE + (EE_DEVICE_SIZE * j), zeroVal);
+			memCache->FlushAllPages();
 		}
-                } else {
-		Logger::console("Unknown command");
-		updateWifi = false;
+		Logger::console("Device settings have been nuked. Reboot to reload default settings");
 	}
-	// send updates to ichip wifi
-	if (updateWifi)
-		DeviceManager::getInstance()->sendMessage(DEVICE_WIFI, ICHIP2128, MSG_CONFIG_CHANGE, NULL);
+	return true;
 }
 
 void SerialConsole::handleShortCmd() {
@@ -591,7 +546,7 @@ void SerialConsole::handleShortCmd() {
 	MotorController* motorController = (MotorController*) DeviceManager::getInstance()->getMotorController();
 	Throttle *accelerator = DeviceManager::getInstance()->getAccelerator();
 	Throttle *brake = DeviceManager::getInstance()->getBrake();
-	DeviceManager *deviceManager = DeviceManager::getInstance();
+	MessageBus *bus = MessageBus::getInstance();
 
 	switch (cmdBuffer[0]) {
 	case 'h':
@@ -666,6 +621,7 @@ void SerialConsole::handleShortCmd() {
 	case 'p':
 		Logger::console("PASSTHROUGH MODE - All traffic Serial3 <-> SerialUSB");
 		//this never stops so basically everything dies. you will have to reboot.
+		serialOutput.setBuffered(false); // send what's queued, from now on we talk to SerialUSB directly
 		int inSerialUSB, inSerial3;
 		while (1 == 1) {
 			inSerialUSB = SerialUSB.read();
@@ -679,6 +635,25 @@ void SerialConsole::handleShortCmd() {
 		}
 		break;
 
+	case 'M':
+		if (motorController)
+			motorController->printStateLog();
+#ifdef CFG_DMOC_SIMULATION
+		if (motorController && motorController->getId() == DMOC645)
+			((DmocMotorController *) motorController)->printSimulatorStatistics();
+#endif
+		break;
+	case 'i':
+		if (DeviceManager::getInstance()->getDeviceByType(DEVICE_WIFI) != NULL)
+			((ICHIPWIFI *) DeviceManager::getInstance()->getDeviceByType(DEVICE_WIFI))->printStatistics();
+		break;
+	case 'T':
+		LoopHandler::getInstance()->printStatistics();
+		LoopHandler::getInstance()->resetStatistics();
+		break;
+	case 'v':
+		SignalRegistry::getInstance()->printSignals();
+		break;
 	case 'S':
 		//there is not really any good way (currently) to auto generate this list
 		//the information just isn't stored anywhere in code. Perhaps we might
@@ -698,44 +673,44 @@ void SerialConsole::handleShortCmd() {
 		break;
 	case 's':
 		Logger::console("Finding and listing all nearby WiFi access points");
-		deviceManager->sendMessage(DEVICE_WIFI, ICHIP2128, MSG_COMMAND, (void *)"RP20");
+		bus->post(MSG_COMMAND, ICHIP2128, "RP20");
 		break;
 	case 'W':
 		Logger::console("Resetting wifi to factory defaults and setting up GEVCU5.2 Access Point");
-	        deviceManager->sendMessage(DEVICE_WIFI, ICHIP2128, MSG_COMMAND, (void *)"FD");//Reset
+	        bus->send(MSG_COMMAND, ICHIP2128, "FD");//Reset
 		  delay(2000);
-                deviceManager->sendMessage(DEVICE_WIFI, ICHIP2128, MSG_COMMAND, (void *)"HIF=1");  //Set for RS-232 serial.
+                bus->send(MSG_COMMAND, ICHIP2128, "HIF=1");  //Set for RS-232 serial.
 		  delay(1000);
-		deviceManager->sendMessage(DEVICE_WIFI, ICHIP2128, MSG_COMMAND, (void *)"BDRA");//Auto baud rate selection
+		bus->send(MSG_COMMAND, ICHIP2128, "BDRA");//Auto baud rate selection
 		  delay(1000);
-		deviceManager->sendMessage(DEVICE_WIFI, ICHIP2128, MSG_COMMAND, (void *)"WLCH=9"); //use whichever channel an AP wants to use
+		bus->send(MSG_COMMAND, ICHIP2128, "WLCH=9"); //use whichever channel an AP wants to use
 		  delay(1000);
-		deviceManager->sendMessage(DEVICE_WIFI, ICHIP2128, MSG_COMMAND, (void *)"WLSI=GEVCU"); //set for GEVCU aS AP.
+		bus->send(MSG_COMMAND, ICHIP2128, "WLSI=GEVCU"); //set for GEVCU aS AP.
 		  delay(1000);
 
-		deviceManager->sendMessage(DEVICE_WIFI, ICHIP2128, MSG_COMMAND, (void *)"STAP=1"); //enable IP 
+		bus->send(MSG_COMMAND, ICHIP2128, "STAP=1"); //enable IP 
 		  delay(1000);
 
-		deviceManager->sendMessage(DEVICE_WIFI, ICHIP2128, MSG_COMMAND, (void *)"DIP=192.168.3.10"); //enable IP 
+		bus->send(MSG_COMMAND, ICHIP2128, "DIP=192.168.3.10"); //enable IP 
 		  delay(1000);
-		deviceManager->sendMessage(DEVICE_WIFI, ICHIP2128, MSG_COMMAND, (void *)"DPSZ=8"); //set DHCP server for 8
+		bus->send(MSG_COMMAND, ICHIP2128, "DPSZ=8"); //set DHCP server for 8
 		  delay(1000);
-		deviceManager->sendMessage(DEVICE_WIFI, ICHIP2128, MSG_COMMAND, (void *)"RPG=secret"); // set the configuration password for /ichip
+		bus->send(MSG_COMMAND, ICHIP2128, "RPG=secret"); // set the configuration password for /ichip
 		  delay(1000);
-		deviceManager->sendMessage(DEVICE_WIFI, ICHIP2128, MSG_COMMAND, (void *)"WPWD=secret"); // set the password to update config params
+		bus->send(MSG_COMMAND, ICHIP2128, "WPWD=secret"); // set the password to update config params
 		  delay(1000);
-		deviceManager->sendMessage(DEVICE_WIFI, ICHIP2128, MSG_COMMAND, (void *)"AWS=1"); //turn on web server 
+		bus->send(MSG_COMMAND, ICHIP2128, "AWS=1"); //turn on web server 
 		  delay(1000);
-		deviceManager->sendMessage(DEVICE_WIFI, ICHIP2128, MSG_COMMAND, (void *)"DOWN"); //cause a reset to allow it to come up with the settings
+		bus->send(MSG_COMMAND, ICHIP2128, "DOWN"); //cause a reset to allow it to come up with the settings
 		  delay(5000); // a 5 second delay is required for the chip to come back up ! Otherwise commands will be lost
   
-		deviceManager->sendMessage(DEVICE_WIFI, ICHIP2128, MSG_CONFIG_CHANGE, NULL); // reload configuration params as they were lost
+		bus->send(MSG_CONFIG_CHANGE, ICHIP2128); // reload configuration params as they were lost
 		Logger::console("Wifi 5.2 initialized");
 	        break;
 	case 'w':
 		Logger::console("Resetting wifi to factory defaults and setting up GEVCU4.2 Ad Hoc network");
 		resetWiReachMini();
-		deviceManager->sendMessage(DEVICE_WIFI, ICHIP2128, MSG_CONFIG_CHANGE, NULL); // reload configuration params as they were lost
+		bus->send(MSG_CONFIG_CHANGE, ICHIP2128); // reload configuration params as they were lost
                 break;
 
 	case 'X':
@@ -748,7 +723,7 @@ void SerialConsole::resetWiReachMini() {
 
   //Serial2.begin(115200);
               while (Serial2.available()) {
-		SerialUSB.write(Serial2.read());
+		serialOutput.write((uint8_t) Serial2.read());
                 }
               Serial2.println("AT+iFD");
               getResponse();
@@ -782,9 +757,9 @@ void SerialConsole::resetWiReachMini() {
 void SerialConsole::getResponse(){
       
        while (Serial2.available()) {
-		SerialUSB.write(Serial2.read());
+		serialOutput.write((uint8_t) Serial2.read());
                 }
-              SerialUSB.println();
+              serialOutput.println();
                 delay(4000);
               
 }
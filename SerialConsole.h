@@ -38,12 +38,14 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "DmocMotorController.h" //TODO: direct reference to dmoc must be removed
 #include "ThrottleDetector.h"
 #include "ichip_2128.h"
+#include "ParameterTable.h"
+#include "LoopHandler.h"
 
-class SerialConsole {
+class SerialConsole: public LoopObserver {
 public:
     SerialConsole(MemCache* memCache);
 	SerialConsole(MemCache* memCache, Heartbeat* heartbeat);
-	void loop();
+	void handleLoop();
 	void printMenu();
 
 protected:
@@ -70,6 +72,31 @@ private:
     void handleConfigCmd();
     void resetWiReachMini();
     void getResponse();
+
+	struct ConsoleCommand {
+		const char *name;
+		bool (SerialConsole::*handler)(char *value, int newValue);
+	};
+	static const ConsoleCommand commands[];
+	static const ConsoleCommand *findCommand(const char *name);
+
+	bool setThrottleCurve(char *value, int newValue);
+	bool enableDevice(char *value, int newValue);
+	bool disableDevice(char *value, int newValue);
+	bool setTelemetry(char *value, int newValue);
+	bool setTelemetryRate(char *value, int newValue);
+	bool setSystemType(char *value, int newValue);
+	bool setLogLevel(char *value, int newValue);
+	bool sendWifiCommand(const char *command, char *value);
+	bool sendWifiCommand(char *value, int newValue);
+	bool setSsid(char *value, int newValue);
+	bool setIpAddress(char *value, int newValue);
+	bool setChannel(char *value, int newValue);
+	bool setSecurity(char *value, int newValue);
+	bool setPassword(char *value, int newValue);
+	bool toggleOutput(char *value, int newValue);
+	bool setEnergy(char *value, int newValue);
+	bool nukeDevices(char *value, int newValue);
 };
 
 #endif /* SERIALCONSOLE_H_ */
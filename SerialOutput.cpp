@@ -0,0 +1,104 @@
+/*
+ * SerialOutput.cpp
+ *
+ * Ring buffer for the console output, see SerialOutput.h.
+ *
+Copyright (c) 2013-14 Collin Kidder, Michael Neuweiler, Charles Galpin
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+ */
+
+#include "SerialOutput.h"
+
+SerialOutput serialOutput;
+
+#define TX_MASK (CFG_SERIAL_TX_BUFFER_SIZE - 1)
+
+SerialOutput::SerialOutput() {
+	head = 0;
+	tail = 0;
+	buffered = false;
+}
+
+size_t SerialOutput::write(uint8_t data) {
+	return write(&data, 1);
+}
+
+/*
+ * Queue the data. Without buffering (e.g. during start-up when loop() isn't
+ * called yet) it is sent directly.
+ */
+size_t SerialOutput::write(const uint8_t *data, size_t size) {
+	if (!buffered)
+		return SerialUSB.write(data, size);
+
+	noInterrupts(); // a tick handler might print while we're in the middle of it
+	uint16_t space = CFG_SERIAL_TX_BUFFER_SIZE - (uint16_t) (head - tail);
+	if (size > space)
+		size = space; // the rest is lost
+	for (size_t i = 0; i < size; i++)
+		buffer[head++ & TX_MASK] = data[i];
+	interrupts();
+	return size;
+}
+
+/*
+ * Enable or disable the buffering. Queued data is sent before buffering is disabled.
+ */
+void SerialOutput::setBuffered(bool buffered) {
+	if (buffered) {
+		LoopHandler::getInstance()->attach(this, LOOP_PRIORITY_LOW, CFG_LOOP_BUDGET_SERIAL, "serial");
+	} else {
+		flush();
+		LoopHandler::getInstance()->detach(this);
+	}
+	this->buffered = buffered;
+}
+
+bool SerialOutput::isBuffered() {
+	return buffered;
+}
+
+/*
+ * Send up to CFG_SERIAL_TX_PER_LOOP bytes of the buffer (called by the LoopHandler).
+ * If the data isn't accepted (no host has the port open), it is dropped.
+ */
+void SerialOutput::handleLoop() {
+	uint16_t length = head - tail;
+
+	if (length == 0)
+		return;
+	if (length > CFG_SERIAL_TX_PER_LOOP)
+		length = CFG_SERIAL_TX_PER_LOOP;
+	if (length > CFG_SERIAL_TX_BUFFER_SIZE - (tail & TX_MASK))
+		length = CFG_SERIAL_TX_BUFFER_SIZE - (tail & TX_MASK); // don't wrap around, the rest is sent with the next call
+
+	size_t sent = SerialUSB.write(&buffer[tail & TX_MASK], length);
+	tail += (sent == 0 ? length : sent);
+}
+
+/*
+ * Send all buffered data, blocks until done.
+ */
+void SerialOutput::flush() {
+	while (head != tail)
+		handleLoop();
+}
@@ -0,0 +1,60 @@
+/*
+ * SerialOutput.h - Buffered output to the serial console (SerialUSB)
+ *
+ * Printing to SerialUSB blocks until the host took the data. Printing the menu
+ * or a dump of values could therefore stall the main loop for a long time if
+ * the host is slow. Once buffering is enabled, everything printed to this
+ * object is stored in a ring buffer and sent from the main loop in chunks of
+ * CFG_SERIAL_TX_PER_LOOP bytes. If no host has the port open, the data is
+ * dropped. If the buffer is full, new data is dropped.
+ *
+Copyright (c) 2013-14 Collin Kidder, Michael Neuweiler, Charles Galpin
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+ */
+
+#ifndef SERIALOUTPUT_H_
+#define SERIALOUTPUT_H_
+
+#include <Arduino.h>
+#include "config.h"
+#include "LoopHandler.h"
+
+class SerialOutput: public Print, LoopObserver {
+public:
+	SerialOutput();
+	size_t write(uint8_t);
+	size_t write(const uint8_t *buffer, size_t size);
+	void setBuffered(bool);
+	bool isBuffered();
+	void handleLoop();
+	void flush();
+
+private:
+	uint8_t buffer[CFG_SERIAL_TX_BUFFER_SIZE];
+	uint16_t head; // next position to write to
+	uint16_t tail; // next position to send
+	bool buffered;
+};
+
+extern SerialOutput serialOutput;
+
+#endif /* SERIALOUTPUT_H_ */
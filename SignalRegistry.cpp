@@ -0,0 +1,315 @@
+/*
+ * SignalRegistry.cpp
+ *
+ * Samples the published signals and notifies the subscribers about changes,
+ * see SignalRegistry.h.
+ *
+Copyright (c) 2013-14 Collin Kidder, Michael Neuweiler, Charles Galpin
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+ */
+
+#include "SignalRegistry.h"
+
+SignalRegistry *SignalRegistry::instance = NULL;
+
+static const float decimalDivisor[] = { 1.0f, 10.0f, 100.0f, 1000.0f };
+
+SignalRegistry::SignalRegistry() {
+	numSignals = 0;
+	numSubscriptions = 0;
+	TickHandler::getInstance()->attach(this, CFG_TICK_INTERVAL_SIGNALS);
+}
+
+/*
+ * Get the singleton instance of the SignalRegistry
+ */
+SignalRegistry *SignalRegistry::getInstance() {
+	if (instance == NULL) {
+		instance = new SignalRegistry();
+	}
+	return instance;
+}
+
+uint8_t SignalRegistry::publish(const char *name, const char *unit, uint8_t decimals, const bool *variable) {
+	return bind(name, unit, decimals, SIGNAL_BOOL, variable, NULL, NULL);
+}
+
+uint8_t SignalRegistry::publish(const char *name, const char *unit, uint8_t decimals, const uint8_t *variable) {
+	return bind(name, unit, decimals, SIGNAL_UINT8, variable, NULL, NULL);
+}
+
+uint8_t SignalRegistry::publish(const char *name, const char *unit, uint8_t decimals, const int16_t *variable) {
+	return bind(name, unit, decimals, SIGNAL_INT16, variable, NULL, NULL);
+}
+
+uint8_t SignalRegistry::publish(const char *name, const char *unit, uint8_t decimals, const uint16_t *variable) {
+	return bind(name, unit, decimals, SIGNAL_UINT16, variable, NULL, NULL);
+}
+
+uint8_t SignalRegistry::publish(const char *name, const char *unit, uint8_t decimals, const int32_t *variable) {
+	return bind(name, unit, decimals, SIGNAL_INT32, variable, NULL, NULL);
+}
+
+uint8_t SignalRegistry::publish(const char *name, const char *unit, uint8_t decimals, const uint32_t *variable) {
+	return bind(name, unit, decimals, SIGNAL_UINT32, variable, NULL, NULL);
+}
+
+/*
+ * Publish a signal whose value is calculated by a function, the context is
+ * handed to the getter (e.g. a pointer to the device).
+ */
+uint8_t SignalRegistry::publish(const char *name, const char *unit, uint8_t decimals, SignalGetter getter, void *context) {
+	return bind(name, unit, decimals, SIGNAL_GETTER, NULL, getter, context);
+}
+
+/*
+ * Bind a signal to its source. Publishing a name again (e.g. if a device is
+ * set up a second time) replaces the previous source.
+ */
+uint8_t SignalRegistry::bind(const char *name, const char *unit, uint8_t decimals, SignalType type, const void *variable,
+		SignalGetter getter, void *context) {
+	uint8_t index = find(name);
+
+	if (index == SIGNAL_INVALID) {
+		return SIGNAL_INVALID;
+	}
+	Signal *signal = &signals[index];
+	signal->type = SIGNAL_NONE; // the tick must not read a half initialized signal
+	signal->unit = unit;
+	signal->decimals = min(decimals, 3);
+	signal->variable = variable;
+	signal->getter = getter;
+	signal->context = context;
+	signal->type = type;
+	return index;
+}
+
+/*
+ * Look up a signal by its name. If it was not published yet, an empty entry
+ * is created so consumers can subscribe independent of the order in which
+ * the devices are set up.
+ */
+uint8_t SignalRegistry::find(const char *name) {
+	for (int i = 0; i < numSignals; i++) {
+		if (strcmp(signals[i].name, name) == 0) {
+			return i;
+		}
+	}
+	if (numSignals >= CFG_SIGNAL_MAX_SIGNALS) {
+		Logger::error("no free signal slot left for %s", name);
+		return SIGNAL_INVALID;
+	}
+
+	Signal *signal = &signals[numSignals];
+	signal->name = name;
+	signal->unit = "";
+	signal->decimals = 0;
+	signal->type = SIGNAL_NONE;
+	signal->variable = NULL;
+	signal->getter = NULL;
+	signal->context = NULL;
+	signal->value = 0;
+	signal->changed = false;
+	return numSignals++;
+}
+
+/*
+ * Register an observer for changes of a signal. The observer is notified with
+ * the current value with the next tick and afterwards whenever the value moved
+ * more than deadband away from the last notified value, but at most once
+ * every interval ms. Returns the index of the signal.
+ */
+uint8_t SignalRegistry::subscribe(SignalObserver *observer, const char *name, uint16_t interval, uint16_t deadband) {
+	uint8_t index = find(name);
+
+	if (index == SIGNAL_INVALID) {
+		return SIGNAL_INVALID;
+	}
+	if (numSubscriptions >= CFG_SIGNAL_MAX_SUBSCRIPTIONS) {
+		Logger::error("no free signal subscription left for %s", name);
+		return SIGNAL_INVALID;
+	}
+
+	SignalSubscription *subscription = &subscriptions[numSubscriptions];
+	subscription->observer = observer;
+	subscription->signal = index;
+	subscription->interval = interval;
+	subscription->deadband = deadband;
+	subscription->lastValue = 0;
+	subscription->lastTime = millis() - interval;
+	subscription->pending = true;
+	numSubscriptions++;
+	return index;
+}
+
+/*
+ * Remove all subscriptions of an observer
+ */
+void SignalRegistry::unsubscribe(SignalObserver *observer) {
+	noInterrupts(); // handleTick might iterate over the list right now
+	for (int i = numSubscriptions - 1; i >= 0; i--) {
+		if (subscriptions[i].observer == observer) {
+			subscriptions[i] = subscriptions[--numSubscriptions];
+		}
+	}
+	interrupts();
+}
+
+/*
+ * Sample all signals once and notify the subscribers of the changed ones.
+ * Subscriptions of unchanged signals are only looked at if a notification is
+ * still pending because of their interval.
+ */
+void SignalRegistry::handleTick() {
+	uint32_t now = millis();
+
+	for (int i = 0; i < numSignals; i++) {
+		Signal *signal = &signals[i];
+
+		if (signal->type == SIGNAL_NONE) {
+			continue;
+		}
+		int32_t value = read(signal);
+		signal->changed = (value != signal->value);
+		signal->value = value;
+	}
+
+	for (int i = 0; i < numSubscriptions; i++) {
+		SignalSubscription *subscription = &subscriptions[i];
+		Signal *signal = &signals[subscription->signal];
+
+		if (signal->type == SIGNAL_NONE) {
+			continue; // keep the initial notification until the signal is published
+		}
+		if (signal->changed) {
+			int32_t value = signal->value;
+			if (subscription->deadband == 0) {
+				subscription->pending |= (value != subscription->lastValue);
+			} else {
+				subscription->pending |= (distance(signal, value, subscription->lastValue) > subscription->deadband);
+			}
+		}
+		if (subscription->pending && (now - subscription->lastTime) >= subscription->interval) {
+			subscription->pending = false;
+			subscription->lastValue = signal->value;
+			subscription->lastTime = now;
+			subscription->observer->handleSignal(subscription->signal, signal->value);
+		}
+	}
+}
+
+int32_t SignalRegistry::read(Signal *signal) {
+	switch (signal->type) {
+	case SIGNAL_BOOL:
+		return *(const bool *) signal->variable;
+	case SIGNAL_UINT8:
+		return *(const uint8_t *) signal->variable;
+	case SIGNAL_INT16:
+		return *(const int16_t *) signal->variable;
+	case SIGNAL_UINT16:
+		return *(const uint16_t *) signal->variable;
+	case SIGNAL_INT32:
+	case SIGNAL_UINT32:
+		return *(const int32_t *) signal->variable;
+	case SIGNAL_GETTER:
+		return signal->getter(signal->context);
+	default:
+		return 0;
+	}
+}
+
+/*
+ * The absolute difference between two values of a signal. It is calculated in
+ * 64 bit as the difference of two int32 values may not fit into 32 bit, values
+ * of SIGNAL_UINT32 are compared unsigned.
+ */
+uint32_t SignalRegistry::distance(Signal *signal, int32_t value, int32_t lastValue) {
+	int64_t difference;
+
+	if (signal->type == SIGNAL_UINT32) {
+		difference = (int64_t) (uint32_t) value - (int64_t) (uint32_t) lastValue;
+	} else {
+		difference = (int64_t) value - (int64_t) lastValue;
+	}
+	return (uint32_t) (difference < 0 ? -difference : difference);
+}
+
+bool SignalRegistry::isPublished(uint8_t signal) {
+	return (signal < numSignals && signals[signal].type != SIGNAL_NONE);
+}
+
+const char *SignalRegistry::getName(uint8_t signal) {
+	return (signal < numSignals ? signals[signal].name : NULL);
+}
+
+/*
+ * Get the value of a signal as of the last tick (0 if it's not published)
+ */
+int32_t SignalRegistry::getValue(uint8_t signal) {
+	return (signal < numSignals ? signals[signal].value : 0);
+}
+
+/*
+ * Format a value of the signal in its unit (without the unit), e.g. 1234 of a signal
+ * with one decimal becomes "123.4". Boolean signals are formatted as "true" / "false".
+ */
+char *SignalRegistry::format(uint8_t signal, int32_t value, char *buffer, uint8_t length) {
+	if (signal >= numSignals) {
+		buffer[0] = 0;
+		return buffer;
+	}
+
+	Signal *entry = &signals[signal];
+	if (entry->type == SIGNAL_BOOL) {
+		snprintf(buffer, length, "%s", (value ? Constants::trueStr : Constants::falseStr));
+	} else if (entry->type == SIGNAL_UINT32) {
+		snprintf(buffer, length, "%lu", (unsigned long) (uint32_t) value);
+	} else if (entry->decimals == 0) {
+		snprintf(buffer, length, "%ld", (long) value);
+	} else {
+		snprintf(buffer, length, "%.*f", entry->decimals, value / decimalDivisor[entry->decimals]);
+	}
+	return buffer;
+}
+
+/*
+ * List all signals with their current value on the console
+ */
+void SignalRegistry::printSignals() {
+	char buffer[16];
+
+	for (int i = 0; i < numSignals; i++) {
+		if (signals[i].type == SIGNAL_NONE) {
+			Logger::console("%s: %s", signals[i].name, Constants::notAvailable);
+		} else {
+			Logger::console("%s: %s %s", signals[i].name, format(i, signals[i].value, buffer, sizeof(buffer)), signals[i].unit);
+		}
+	}
+	Logger::console("%d signals, %d subscriptions", numSignals, numSubscriptions);
+}
+
+/*
+ * Default implementation of the SignalObserver method. Must be overwritten by every sub-class.
+ */
+void SignalObserver::handleSignal(uint8_t signal, int32_t value) {
+	Logger::error("SignalObserver does not implement handleSignal(), signal=%d", signal);
+}
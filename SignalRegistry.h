@@ -0,0 +1,126 @@
+/*
+ * SignalRegistry.h - Central list of the values (signals) which are published
+ * by the devices, e.g. the actual torque of the motor controller or the level of
+ * the throttle.
+ *
+ * A device publishes a signal once with its name, unit and scale and either a
+ * pointer to the variable holding the value or a getter function. The registry
+ * samples all signals once per tick and detects the changes. Consumers (wifi,
+ * serial console, telemetry, ...) subscribe to the signals they are interested
+ * in with the minimum time between two updates and a deadband. They are only
+ * notified if the value moved further than the deadband from the value which
+ * was reported to them the last time.
+ *
+Copyright (c) 2013-14 Collin Kidder, Michael Neuweiler, Charles Galpin
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+ */
+
+#ifndef SIGNALREGISTRY_H_
+#define SIGNALREGISTRY_H_
+
+#include <Arduino.h>
+#include "config.h"
+#include "constants.h"
+#include "TickHandler.h"
+#include "Logger.h"
+
+#define SIGNAL_INVALID 0xFF // returned if a signal could not be found or created
+
+typedef int32_t (*SignalGetter)(void *context);
+
+enum SignalType {
+	SIGNAL_NONE, // not published (yet)
+	SIGNAL_BOOL,
+	SIGNAL_UINT8,
+	SIGNAL_INT16,
+	SIGNAL_UINT16,
+	SIGNAL_INT32,
+	SIGNAL_UINT32,
+	SIGNAL_GETTER
+};
+
+struct Signal {
+	const char *name;
+	const char *unit;
+	uint8_t decimals; // the value is in 10^-decimals of the unit (e.g. 1 = value in 0.1V)
+	SignalType type;
+	const void *variable; // the variable holding the value
+	SignalGetter getter; // or the function which returns it
+	void *context; // parameter of the getter (e.g. the device)
+	int32_t value; // value as of the last sample
+	bool changed; // the value changed with the last sample
+};
+
+/*
+ * Interface for consumers of signals
+ */
+class SignalObserver {
+public:
+	virtual void handleSignal(uint8_t signal, int32_t value);
+};
+
+struct SignalSubscription {
+	SignalObserver *observer;
+	uint8_t signal;
+	bool pending; // a change beyond the deadband is waiting for the interval to pass
+	uint16_t interval; // min time in ms between two notifications
+	uint16_t deadband; // min change since the last notification (0 = any change)
+	int32_t lastValue; // value of the last notification
+	uint32_t lastTime; // millis() of the last notification
+};
+
+class SignalRegistry: public TickObserver {
+public:
+	static SignalRegistry *getInstance();
+	uint8_t publish(const char *name, const char *unit, uint8_t decimals, const bool *variable);
+	uint8_t publish(const char *name, const char *unit, uint8_t decimals, const uint8_t *variable);
+	uint8_t publish(const char *name, const char *unit, uint8_t decimals, const int16_t *variable);
+	uint8_t publish(const char *name, const char *unit, uint8_t decimals, const uint16_t *variable);
+	uint8_t publish(const char *name, const char *unit, uint8_t decimals, const int32_t *variable);
+	uint8_t publish(const char *name, const char *unit, uint8_t decimals, const uint32_t *variable);
+	uint8_t publish(const char *name, const char *unit, uint8_t decimals, SignalGetter getter, void *context);
+	uint8_t find(const char *name);
+	uint8_t subscribe(SignalObserver *observer, const char *name, uint16_t interval, uint16_t deadband);
+	void unsubscribe(SignalObserver *observer);
+	void handleTick();
+
+	bool isPublished(uint8_t signal);
+	const char *getName(uint8_t signal);
+	int32_t getValue(uint8_t signal);
+	char *format(uint8_t signal, int32_t value, char *buffer, uint8_t length);
+	void printSignals();
+
+private:
+	SignalRegistry(); //it's not right to try to directly instantiate this class
+	uint8_t bind(const char *name, const char *unit, uint8_t decimals, SignalType type, const void *variable, SignalGetter getter,
+			void *context);
+	int32_t read(Signal *signal);
+	uint32_t distance(Signal *signal, int32_t value, int32_t lastValue);
+
+	static SignalRegistry *instance;
+	Signal signals[CFG_SIGNAL_MAX_SIGNALS];
+	uint8_t numSignals;
+	SignalSubscription subscriptions[CFG_SIGNAL_MAX_SUBSCRIPTIONS];
+	uint8_t numSubscriptions;
+};
+
+#endif /* SIGNALREGISTRY_H_ */
@@ -0,0 +1,173 @@
+/*
+ * Telemetry.cpp
+ *
+ * Encodes the values of the system into compact keyframe / delta records,
+ * see Telemetry.h for the format.
+ *
+Copyright (c) 2013-14 Collin Kidder, Michael Neuweiler, Charles Galpin
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+ */
+
+#include "Telemetry.h"
+
+static const char base64Chars[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+// name of the registry signal of each value, NULL if the value is composed of several signals in sample()
+static const char *signalNames[Telemetry::NUM_SIGNALS] = { Constants::throttleLevel, Constants::brakeLevel, Constants::torqueRequested,
+		Constants::torqueActual, Constants::speedRequested, Constants::speedActual, Constants::dcVoltage, Constants::dcCurrent,
+		Constants::acCurrent, Constants::tempMotor, Constants::tempInverter, Constants::mechPower, NULL, Constants::bmsVoltage,
+		Constants::bmsCurrent, NULL };
+
+Telemetry::Telemetry() {
+	SignalRegistry *registry = SignalRegistry::getInstance();
+
+	for (int i = 0; i < NUM_SIGNALS; i++)
+		signals[i] = (signalNames[i] ? registry->find(signalNames[i]) : SIGNAL_INVALID);
+	stateSignal = registry->find(Constants::controllerState);
+	gearSignal = registry->find(Constants::gear);
+	socSignal = registry->find(Constants::stateOfCharge);
+	inputSignal = registry->find(Constants::digitalInputs);
+	outputSignal = registry->find(Constants::digitalOutputs);
+
+	sequence = 0;
+	reset();
+}
+
+/*
+ * Start over with a keyframe, e.g. when a new connection was opened.
+ */
+void Telemetry::reset() {
+	for (int i = 0; i < NUM_SIGNALS; i++)
+		lastValues[i] = 0;
+	lastTime = 0;
+	recordsSinceKeyframe = 0;
+	keyframeRequired = true;
+}
+
+/*
+ * Collect the current values of all signals from the SignalRegistry (as of its last tick).
+ * Signals which are not published are sent as 0.
+ */
+void Telemetry::sample(int16_t *values) {
+	SignalRegistry *registry = SignalRegistry::getInstance();
+
+	for (int i = 0; i < NUM_SIGNALS; i++)
+		values[i] = registry->getValue(signals[i]);
+
+	values[STATUS] = (registry->getValue(stateSignal) & 0x0F) | ((registry->getValue(gearSignal) & 0x03) << 4)
+			| (registry->getValue(socSignal) << 8);
+	values[IO] = registry->getValue(inputSignal) | (registry->getValue(outputSignal) << 8);
+}
+
+/*
+ * Sample all signals and encode them as a keyframe or delta record into the
+ * buffer (at least TELEMETRY_RECORD_LENGTH bytes). The record is base64 encoded,
+ * terminated with a newline and a zero. Returns the length (without the zero).
+ */
+uint8_t Telemetry::encode(char *buffer) {
+	uint8_t record[2 + 4 + NUM_SIGNALS * 3]; // the largest possible record
+	int16_t values[NUM_SIGNALS];
+	uint32_t now = millis();
+	uint8_t length = 2;
+	uint8_t length64;
+
+	sample(values);
+
+	if (now - lastTime > 255 || recordsSinceKeyframe >= CFG_TELEMETRY_KEYFRAME)
+		keyframeRequired = true;
+
+	if (keyframeRequired) {
+		record[0] = (TELEMETRY_VERSION << 4) | KEYFRAME;
+		record[length++] = now & 0xFF;
+		record[length++] = (now >> 8) & 0xFF;
+		record[length++] = (now >> 16) & 0xFF;
+		record[length++] = (now >> 24) & 0xFF;
+		for (int i = 0; i < NUM_SIGNALS; i++) {
+			record[length++] = values[i] & 0xFF;
+			record[length++] = (values[i] >> 8) & 0xFF;
+		}
+		recordsSinceKeyframe = 0;
+		keyframeRequired = false;
+	} else {
+		uint16_t changed = 0;
+
+		record[0] = (TELEMETRY_VERSION << 4) | DELTA;
+		record[length++] = now - lastTime;
+		length += 2; // the bitmask is filled in below
+		for (int i = 0; i < NUM_SIGNALS; i++) {
+			if (values[i] != lastValues[i]) {
+				changed |= 1 << i;
+				length += writeVarint(&record[length], (int32_t) values[i] - lastValues[i]);
+			}
+		}
+		record[3] = changed & 0xFF;
+		record[4] = changed >> 8;
+		recordsSinceKeyframe++;
+	}
+	record[1] = sequence++;
+
+	for (int i = 0; i < NUM_SIGNALS; i++)
+		lastValues[i] = values[i];
+	lastTime = now;
+
+	length64 = encodeBase64(record, length, buffer);
+	buffer[length64++] = '\n';
+	buffer[length64] = 0;
+	return length64;
+}
+
+/*
+ * Write a signed value as zigzag encoded varint (small positive and negative
+ * values need only one byte). Returns the number of bytes written.
+ */
+uint8_t Telemetry::writeVarint(uint8_t *buffer, int32_t value) {
+	uint32_t zigzag = ((uint32_t) value << 1) ^ (uint32_t) (value >> 31);
+	uint8_t length = 0;
+
+	while (zigzag > 0x7F) {
+		buffer[length++] = (zigzag & 0x7F) | 0x80;
+		zigzag >>= 7;
+	}
+	buffer[length++] = zigzag;
+	return length;
+}
+
+/*
+ * Standard base64 encoding with padding. Returns the number of characters written.
+ */
+uint8_t Telemetry::encodeBase64(const uint8_t *data, uint8_t length, char *output) {
+	uint8_t pos = 0;
+
+	for (int i = 0; i < length; i += 3) {
+		uint32_t triple = data[i] << 16;
+		if (i + 1 < length)
+			triple |= data[i + 1] << 8;
+		if (i + 2 < length)
+			triple |= data[i + 2];
+
+		output[pos++] = base64Chars[(triple >> 18) & 0x3F];
+		output[pos++] = base64Chars[(triple >> 12) & 0x3F];
+		output[pos++] = (i + 1 < length ? base64Chars[(triple >> 6) & 0x3F] : '=');
+		output[pos++] = (i + 2 < length ? base64Chars[triple & 0x3F] : '=');
+	}
+	return pos;
+}
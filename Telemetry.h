@@ -0,0 +1,103 @@
+/*
+ * Telemetry.h - Encodes the most important values of the system into compact
+ * records which can be streamed at a high rate (e.g. over a TCP socket of the
+ * ichip) to a data logger or live dashboard.
+ *
+ * Each record is a binary structure which is base64 encoded and terminated with
+ * a newline, so the receiver can split the stream into records. The newline is
+ * part of the data of the ichip's SSND command and is counted in its length.
+ * The ichip driver only compares the "SSND%%:<socket>,<length>:" header of the
+ * echo, so the newline in the data doesn't disturb the matching of the reply.
+ * The records are laid out like this:
+ *
+ *   byte 0     : schema version (upper 4 bits) and record type (lower 4 bits)
+ *   byte 1     : sequence number, increases by one with every record
+ *   keyframe   : 4 bytes timestamp (ms, little endian), then all values as int16 (little endian)
+ *   delta      : 1 byte ms since the previous record, 2 bytes bitmask of the changed values,
+ *                then the difference to the previous value of each changed value
+ *                (zigzag encoded varint, 7 bits per byte, bit 7 = more bytes follow)
+ *
+ * A keyframe is sent every CFG_TELEMETRY_KEYFRAME records, after a reset or if
+ * the previous record is too old. If the receiver detects a gap in the sequence,
+ * it has to ignore the deltas until the next keyframe.
+ *
+Copyright (c) 2013-14 Collin Kidder, Michael Neuweiler, Charles Galpin
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+ */
+
+#ifndef TELEMETRY_H_
+#define TELEMETRY_H_
+
+#include <Arduino.h>
+#include "config.h"
+#include "SignalRegistry.h"
+
+#define TELEMETRY_VERSION		1 // increase when the list of signals or the record format changes
+#define TELEMETRY_RECORD_LENGTH	80 // max length of an encoded record incl. newline and terminating zero
+
+class Telemetry {
+public:
+	enum RecordType {
+		KEYFRAME = 0,
+		DELTA = 1
+	};
+
+	// the signals of schema version 1, the order must not change
+	enum Signal {
+		THROTTLE = 0, // throttle level in 0.1%
+		BRAKE, // brake level in 0.1%
+		TORQUE_REQUESTED, // 0.1Nm
+		TORQUE_ACTUAL, // 0.1Nm
+		SPEED_REQUESTED, // rpm
+		SPEED_ACTUAL, // rpm
+		DC_VOLTAGE, // 0.1V
+		DC_CURRENT, // 0.1A
+		AC_CURRENT, // 0.1A
+		TEMP_MOTOR, // 0.1 deg C
+		TEMP_INVERTER, // 0.1 deg C
+		MECH_POWER, // 0.1kW
+		STATUS, // bits 0-3 controller state, bits 4-5 gear, bits 8-15 state of charge in %
+		BMS_VOLTAGE, // 0.1V, 0 if no BMS
+		BMS_CURRENT, // 0.1A, 0 if no BMS
+		IO, // bits 0-3 digital inputs, bits 8-15 digital outputs
+		NUM_SIGNALS
+	};
+
+	Telemetry();
+	void reset();
+	uint8_t encode(char *buffer);
+
+private:
+	uint8_t signals[NUM_SIGNALS]; // registry index of each value
+	uint8_t stateSignal, gearSignal, socSignal, inputSignal, outputSignal; // parts of the STATUS and IO values
+	int16_t lastValues[NUM_SIGNALS];
+	uint32_t lastTime;
+	uint8_t sequence;
+	uint8_t recordsSinceKeyframe;
+	bool keyframeRequired;
+
+	void sample(int16_t *values);
+	uint8_t writeVarint(uint8_t *buffer, int32_t value);
+	uint8_t encodeBase64(const uint8_t *data, uint8_t length, char *output);
+};
+
+#endif /* TELEMETRY_H_ */
@@ -33,6 +33,37 @@
 Throttle::Throttle() : Device() {
 	level = 0;
 	status = OK;
+	levelMap = NULL;
+}
+
+/*
+ * Allocate the lookup table of mapPedalPosition() and fill it from the configuration.
+ * This is done once here so no memory is allocated in the tick handler. Brakes map
+ * the position on their own (see mapPedalPosition() of the sub-class) and don't need it.
+ */
+void Throttle::setup() {
+	Device::setup();
+
+	if (levelMap == NULL && getType() == DEVICE_THROTTLE)
+		levelMap = new int16_t[1001];
+	buildLevelMap();
+}
+
+/*
+ * Publish the level and the raw input(s) in the SignalRegistry, called by the
+ * sub-class in setup() with its raw signal structure.
+ */
+void Throttle::publishSignals(RawSignalData *rawSignal) {
+	SignalRegistry *registry = SignalRegistry::getInstance();
+
+	if (getType() == DEVICE_BRAKE) {
+		registry->publish(Constants::brakeLevel, "%", 1, &level);
+		registry->publish(Constants::brake, "", 0, &rawSignal->input1);
+	} else {
+		registry->publish(Constants::throttleLevel, "%", 1, &level);
+		registry->publish(Constants::throttle, "", 0, &rawSignal->input1);
+		registry->publish(Constants::throttleRaw2, "", 0, &rawSignal->input2);
+	}
 }
 
 /*
@@ -53,8 +84,30 @@ void Throttle::handleTick() {
 }
 
 /*
- * Maps the input throttle position (0-1000 permille) to an output level which is
- * calculated based on the throttle mapping parameters (free float, regen, acceleration,
+ * Maps the input throttle position (0-1000 permille) to an output level (-1000 to 1000).
+ * The mapping is pre-calculated for every position whenever the configuration changes
+ * so this is a single table lookup. See calculateLevel() for the actual mapping.
+ */
+int16_t Throttle::mapPedalPosition(int16_t pedalPosition) {
+	if (levelMap == NULL)
+		return calculateLevel(constrain(pedalPosition, 0, 1000)); // not set up or out of memory, do it the slow way
+	return levelMap[constrain(pedalPosition, 0, 1000)];
+}
+
+/*
+ * Fill the lookup table used by mapPedalPosition() from the current configuration.
+ * Called whenever the configuration is loaded or changed, does nothing before setup().
+ */
+void Throttle::buildLevelMap() {
+	if (levelMap == NULL)
+		return;
+	for (int16_t position = 0; position <= 1000; position++)
+		levelMap[position] = calculateLevel(position);
+}
+
+/*
+ * Calculates the output level for a throttle position (0-1000 permille) based on either
+ * the user defined curve or the throttle mapping parameters (free float, regen, acceleration,
  * 50% acceleration).
  * The output value will be in the range of -1000 to 1000. The value will be used by the
  * MotorController class to calculate commanded torque or speed. Positive numbers result in
@@ -79,10 +132,13 @@ void Throttle::handleTick() {
  * Important pre-condition (to be checked when changing parameters) :
  * 0 <= positionRegenMaximum <= positionRegenMinimum <= positionForwardMotionStart <= positionHalfPower
  */
-int16_t Throttle::mapPedalPosition(int16_t pedalPosition) {
+int16_t Throttle::calculateLevel(int16_t pedalPosition) {
 	int16_t throttleLevel, range, value;
 	ThrottleConfiguration *config = (ThrottleConfiguration *) getConfiguration();
 
+	if (config->curvePoints >= 2)
+		return interpolateCurve(pedalPosition);
+
 	throttleLevel = 0;
 
 	if (pedalPosition == 0 && config->creep > 0) {
@@ -113,7 +169,7 @@ int16_t Throttle::mapPedalPosition(int16_t pedalPosition) {
 			throttleLevel = 500 + 500 * value / range;
 		}
 	}
-	//Logger::debug("throttle level: %d", throttleLevel);
+	//LOG_DEBUG("throttle level: %d", throttleLevel);
 
 	//A bit of a kludge. Normally it isn't really possible to ever get to
 	//100% output. This next line just fudges the numbers a bit to make it
@@ -123,6 +179,77 @@ int16_t Throttle::mapPedalPosition(int16_t pedalPosition) {
 	return throttleLevel;
 }
 
+/*
+ * Linear interpolation between the points of a user defined curve. Positions
+ * before the first / after the last point get the level of that point.
+ */
+int16_t Throttle::interpolateCurve(int16_t pedalPosition) {
+	ThrottleConfiguration *config = (ThrottleConfiguration *) getConfiguration();
+	uint8_t last = config->curvePoints - 1;
+
+	if (pedalPosition <= config->curvePosition[0])
+		return config->curveLevel[0];
+	for (int i = 1; i <= last; i++) {
+		if (pedalPosition <= config->curvePosition[i]) {
+			int32_t range = config->curvePosition[i] - config->curvePosition[i - 1];
+			int32_t value = pedalPosition - config->curvePosition[i - 1];
+			return config->curveLevel[i - 1] + (config->curveLevel[i] - config->curveLevel[i - 1]) * value / range;
+		}
+	}
+	return config->curveLevel[last];
+}
+
+/*
+ * Set a user defined curve from a string of "position:level" pairs separated by commas,
+ * e.g. "0:-300,250:0,300:0,600:400,1000:1000". Positions must be ascending (0-1000),
+ * levels are -1000 to 1000. "0" removes the curve. The change is not saved.
+ * Returns false if the string is invalid (the configuration is left unchanged).
+ */
+bool Throttle::setCurve(char *points) {
+	ThrottleConfiguration *config = (ThrottleConfiguration *) getConfiguration();
+	uint16_t position[CFG_THROTTLE_CURVE_POINTS];
+	int16_t curveLevel[CFG_THROTTLE_CURVE_POINTS];
+	uint8_t count = 0;
+	long value;
+	char *next;
+
+	if (!strcmp(points, "0")) {
+		config->curvePoints = 0;
+		buildLevelMap();
+		return true;
+	}
+
+	while (*points) {
+		if (count >= CFG_THROTTLE_CURVE_POINTS)
+			return false;
+		value = strtol(points, &next, 0);
+		if (next == points || *next != ':' || value < 0 || value > 1000 || (count > 0 && value <= position[count - 1]))
+			return false;
+		position[count] = value;
+		points = next + 1;
+		value = strtol(points, &next, 0);
+		if (next == points || value < -1000 || value > 1000)
+			return false;
+		curveLevel[count] = value;
+		count++;
+		points = next;
+		if (*points == ',')
+			points++;
+		else if (*points != 0)
+			return false;
+	}
+	if (count < 2)
+		return false;
+
+	for (int i = 0; i < count; i++) {
+		config->curvePosition[i] = position[i];
+		config->curveLevel[i] = curveLevel[i];
+	}
+	config->curvePoints = count;
+	buildLevelMap();
+	return true;
+}
+
 /*
  * Make sure input level stays within margins (min/max) then map the constrained
  * level linearly to a value from 0 to 1000.
@@ -198,6 +325,18 @@ void Throttle::loadConfiguration() {
 		prefsHandler->read(EETH_CREEP, &config->creep);
 		prefsHandler->read(EETH_MIN_ACCEL_REGEN, &config->minimumRegen);
 		prefsHandler->read(EETH_MAX_ACCEL_REGEN, &config->maximumRegen);
+		prefsHandler->read(EETH_CURVE_POINTS, &config->curvePoints);
+		if (config->curvePoints > CFG_THROTTLE_CURVE_POINTS)
+			config->curvePoints = 0; // never written (older firmware)
+		for (int i = 0; i < config->curvePoints; i++) {
+			prefsHandler->read(EETH_CURVE_START + 4 * i, &config->curvePosition[i]);
+			prefsHandler->read(EETH_CURVE_START + 4 * i + 2, (uint16_t *) &config->curveLevel[i]);
+			if (config->curvePosition[i] > 1000 || config->curveLevel[i] < -1000 || config->curveLevel[i] > 1000
+					|| (i > 0 && config->curvePosition[i] <= config->curvePosition[i - 1])) {
+				Logger::warn(THROTTLE, "invalid throttle curve in EEPROM, using the throttle parameters");
+				config->curvePoints = 0;
+			}
+		}
 	} else { //checksum invalid. Reinitialize values, leave storing them to the subclasses
 		config->positionRegenMinimum = ThrottleRegenMinValue;
 		config->positionRegenMaximum = ThrottleRegenMaxValue;
@@ -206,10 +345,12 @@ void Throttle::loadConfiguration() {
 		config->creep = ThrottleCreepValue;
 		config->minimumRegen = ThrottleMinRegenValue; //percentage of minimal power to use when regen starts
 		config->maximumRegen = ThrottleMaxRegenValue; //percentage of full power to use for regen at throttle
+		config->curvePoints = 0;
 	}
-	Logger::debug(THROTTLE, "RegenMax: %l RegenMin: %l Fwd: %l Map: %l", config->positionRegenMaximum, config->positionRegenMinimum,
+	buildLevelMap();
+	LOG_DEBUG(THROTTLE, "RegenMax: %l RegenMin: %l Fwd: %l Map: %l", config->positionRegenMaximum, config->positionRegenMinimum,
 			config->positionForwardMotionStart, config->positionHalfPower);
-	Logger::debug(THROTTLE, "MinRegen: %d MaxRegen: %d", config->minimumRegen, config->maximumRegen);
+	LOG_DEBUG(THROTTLE, "MinRegen: %d MaxRegen: %d", config->minimumRegen, config->maximumRegen);
 }
 
 /*
@@ -227,7 +368,13 @@ void Throttle::saveConfiguration() {
 	prefsHandler->write(EETH_CREEP, config->creep);
 	prefsHandler->write(EETH_MIN_ACCEL_REGEN, config->minimumRegen);
 	prefsHandler->write(EETH_MAX_ACCEL_REGEN, config->maximumRegen);
+	prefsHandler->write(EETH_CURVE_POINTS, config->curvePoints);
+	for (int i = 0; i < config->curvePoints; i++) {
+		prefsHandler->write(EETH_CURVE_START + 4 * i, config->curvePosition[i]);
+		prefsHandler->write(EETH_CURVE_START + 4 * i + 2, (uint16_t) config->curveLevel[i]);
+	}
 	prefsHandler->saveChecksum();
+	buildLevelMap(); // the parameters were probably changed, re-calculate the mapping
 
 	Logger::console("Throttle configuration saved");
 }
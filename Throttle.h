@@ -35,6 +35,7 @@
 #include <Arduino.h>
 #include "config.h"
 #include "Device.h"
+#include "SignalRegistry.h"
 
 /*
  * Data structure to hold raw signal(s) of the throttle.
@@ -57,6 +58,9 @@ public:
 	uint8_t maximumRegen; // percentage of max torque allowable for regen at maximum level
 	uint8_t minimumRegen; // percentage of max torque allowable for regen at minimum level
 	uint8_t creep; // percentage of torque used for creep function (imitate creep of automatic transmission, set 0 to disable)
+	uint8_t curvePoints; // number of points of a user defined curve, replaces the parameters above if >= 2
+	uint16_t curvePosition[CFG_THROTTLE_CURVE_POINTS]; // pedal position (0-1000) of each point, ascending
+	int16_t curveLevel[CFG_THROTTLE_CURVE_POINTS]; // throttle level (-1000 to 1000) at each point
 };
 
 /*
@@ -75,6 +79,7 @@ public:
 	};
 
 	Throttle();
+	void setup();
 	virtual int16_t getLevel();
 	void handleTick();
 	virtual ThrottleStatus getStatus();
@@ -84,17 +89,23 @@ public:
 	virtual RawSignalData *acquireRawSignal();
 	void loadConfiguration();
 	void saveConfiguration();
+	bool setCurve(char *points);
 
 protected:
 	ThrottleStatus status;
+	void publishSignals(RawSignalData *rawSignal);
 	virtual bool validateSignal(RawSignalData *);
 	virtual uint16_t calculatePedalPosition(RawSignalData *);
 	virtual int16_t mapPedalPosition(int16_t);
+	int16_t calculateLevel(int16_t);
+	int16_t interpolateCurve(int16_t);
+	void buildLevelMap();
 	uint16_t normalizeAndConstrainInput(int32_t, int32_t, int32_t);
 	int32_t normalizeInput(int32_t, int32_t, int32_t);
 
 private:
 	int16_t level; // the final signed throttle level. [-1000, 1000] in permille of maximum
+	int16_t *levelMap; // level for every pedal position 0-1000, allocated in setup() and rebuilt when the configuration changes
 };
 
 #endif
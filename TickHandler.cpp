@@ -44,6 +44,7 @@ TickHandler::TickHandler() {
 	}
 #ifdef CFG_TIMER_USE_QUEUING
 	bufferHead = bufferTail = 0;
+	LoopHandler::getInstance()->attach(this, LOOP_PRIORITY_HIGH, CFG_LOOP_BUDGET_TICKS, "ticks");
 #endif
 }
 
@@ -83,7 +84,7 @@ void TickHandler::attach(TickObserver* observer, uint32_t interval) {
 		return;
 	}
 	timerEntry[timer].observer[observerIndex] = observer;
-	Logger::debug("attached TickObserver (%X) as number %d to timer %d, %dus interval", observer, observerIndex, timer, interval);
+	LOG_DEBUG("attached TickObserver (%X) as number %d to timer %d, %dus interval", observer, observerIndex, timer, interval);
 
 	switch (timer) { // restarting a timer which would already be running is no problem (see DueTimer.cpp)
 	case 0:
@@ -123,7 +124,7 @@ void TickHandler::detach(TickObserver* observer) {
 	for (int timer = 0; timer < NUM_TIMERS; timer++) {
 		for (int observerIndex = 0; observerIndex < CFG_TIMER_NUM_OBSERVERS; observerIndex++) {
 			if (timerEntry[timer].observer[observerIndex] == observer) {
-				Logger::debug("removing TickObserver (%X) as number %d from timer %d", observer, observerIndex, timer);
+				LOG_DEBUG("removing TickObserver (%X) as number %d from timer %d", observer, observerIndex, timer);
 				timerEntry[timer].observer[observerIndex] = NULL;
 			}
 		}
@@ -154,13 +155,13 @@ int TickHandler::findObserver(int timer, TickObserver *observer) {
 
 #ifdef CFG_TIMER_USE_QUEUING
 /*
- * Check if a tick is available, forward it to registered observers.
+ * Check if a tick is available, forward it to registered observers (called by the LoopHandler).
  */
-void TickHandler::process() {
+void TickHandler::handleLoop() {
 	while (bufferHead != bufferTail) {
 		tickBuffer[bufferTail]->handleTick();
 		bufferTail = (bufferTail + 1) % CFG_TIMER_BUFFER_SIZE;
-		//Logger::debug("process, bufferHead=%d bufferTail=%d", bufferHead, bufferTail);
+		//LOG_DEBUG("process, bufferHead=%d bufferTail=%d", bufferHead, bufferTail);
 	}
 }
 
@@ -180,7 +181,7 @@ void TickHandler::handleInterrupt(int timerNumber) {
 #ifdef CFG_TIMER_USE_QUEUING
 		tickBuffer[bufferHead] = timerEntry[timerNumber].observer[i];
 		bufferHead = (bufferHead + 1) % CFG_TIMER_BUFFER_SIZE;
-//Logger::debug("bufferHead=%d, bufferTail=%d, observer=%d", bufferHead, bufferTail, timerEntry[timerNumber].observer[i]);
+//LOG_DEBUG("bufferHead=%d, bufferTail=%d, observer=%d", bufferHead, bufferTail, timerEntry[timerNumber].observer[i]);
 #else
 			timerEntry[timerNumber].observer[i]->handleTick();
 #endif //CFG_TIMER_USE_QUEUING
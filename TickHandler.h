@@ -33,6 +33,7 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "config.h"
 #include <DueTimer.h>
 #include "Logger.h"
+#include "LoopHandler.h"
 
 #define NUM_TIMERS 9
 
@@ -42,7 +43,7 @@ public:
 };
 
 
-class TickHandler {
+class TickHandler: public LoopObserver {
 public:
 	static TickHandler *getInstance();
 	void attach(TickObserver *observer, uint32_t interval);
@@ -50,7 +51,7 @@ public:
 	void handleInterrupt(int timerNumber); // must be public when from the non-class functions
 #ifdef CFG_TIMER_USE_QUEUING
 	void cleanBuffer();
-	void process();
+	void handleLoop();
 #endif
 
 protected:
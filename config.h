@@ -43,7 +43,13 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  * SERIAL CONFIGURATION
  */
 #define CFG_SERIAL_SPEED 115200
+#define CFG_SERIAL_TX_BUFFER_SIZE 8192 // bytes of console output which can be queued, must hold the whole menu (must be a power of 2)
+#define CFG_SERIAL_TX_PER_LOOP 64 // max number of queued console bytes sent per loop()
+#define CFG_LOG_DEFERRED // if defined, log messages are queued once the system is up and printed from loop()
+#define CFG_LOG_DRAIN_RECORDS 2 // number of queued log records to print per loop()
+#define CFG_LOG_MIN_LEVEL 0 // LOG_xxx() statements below this level are not compiled in (0=debug, 1=info, 2=warn, 3=error)
 //#define SerialUSB Serial // re-route serial-usb output to programming port ;) comment if output should go to std usb
+//#define CFG_DMOC_SIMULATION // if defined, the DMOC645 driver talks to a simulated inverter instead of the CAN bus (for bench tests without an inverter)
 
 
 //The defines that used to be here to configure devices are gone now.
@@ -64,11 +70,48 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #define CFG_TICK_INTERVAL_MOTOR_CONTROLLER_DMOC		40000
 #define CFG_TICK_INTERVAL_MOTOR_CONTROLLER_CODAUQM	10000
 #define CFG_TICK_INTERVAL_MOTOR_CONTROLLER_BRUSA	20000
+#define CFG_ENVELOPE_RPM_POINTS		16 // number of speed columns of the torque envelope table (0 to speedMax plus one column above)
+#define CFG_ENVELOPE_VOLTAGE_POINTS		4 // number of voltage rows of the torque envelope table (75% to 115% of nominal voltage)
+#define CFG_ENERGY_MAX_DT				1000000 // max time (in microseconds) between two energy meter samples, longer gaps are treated as this
+#define CFG_ENERGY_SAVE_INTERVAL		60000 // min time (in milliseconds) between two saves of the energy meter values to EEPROM
+#define CFG_STATE_LOG_SIZE				16 // number of motor controller state transitions kept for diagnosis
+#define CFG_STATE_STANDBY_TIMEOUT		5000 // ms to wait for the motor controller to get ready before starting over
+#define CFG_STATE_OFFLINE_TIMEOUT		2000 // ms without CAN frames after which a motor controller is considered offline
+#define CFG_SLEW_MAX_DT					100000 // max time (in microseconds) between two throttle slew rate calculations, longer gaps are treated as this
 #define CFG_TICK_INTERVAL_MEM_CACHE			40000
 #define CFG_TICK_INTERVAL_BMS_THINK			500000
 #define CFG_TICK_INTERVAL_WIFI				200000
 #define CFG_TICK_INTERVAL_DCDC                          200000
 #define CFG_TICK_INTERVAL_EVIC                          100000
+#define CFG_TICK_INTERVAL_FAULT_HANDLER                 500000 // also the max delay before new fault records are committed to EEPROM
+#define CFG_TICK_INTERVAL_SIGNALS			40000 // all published signals are sampled and their subscribers notified at this rate
+#define CFG_DIO_SAMPLE_INTERVAL                         1000 // digital inputs are sampled from loop() at most this often
+#define CFG_WIFI_BUFFER_SIZE				64 // number of slots for commands queued while the iChip is busy
+#define CFG_WIFI_CMD_LENGTH				96 // max length of an iChip command (without the "AT+i" prefix) incl. terminating zero
+#define CFG_WIFI_REPLY_TIMEOUT				500 // ms to wait for a reply of the iChip before a command is repeated, doubled with every retry
+#define CFG_WIFI_MAX_RETRIES				2 // number of times a command is repeated if the iChip doesn't reply
+#define CFG_TELEMETRY_INTERVAL				50 // default ms between two telemetry records (if not configured via TELRATE)
+#define CFG_TELEMETRY_KEYFRAME				25 // max number of delta records between two telemetry keyframes
+#define CFG_TELEMETRY_RECONNECT			5000 // ms to wait before the telemetry connection is opened again
+
+/*
+ * LOOP TASKS
+ *
+ * Budgets in microseconds for the tasks which are run by the LoopHandler from loop().
+ * High priority tasks (CAN, ticks, I/O) run between every two other tasks. The others
+ * are deferred to the next pass once CFG_LOOP_PASS_BUDGET is used up.
+ */
+#define CFG_LOOP_PASS_BUDGET				1000 // time a pass of loop() may spend on normal and low priority tasks
+#define CFG_LOOP_STARVATION_TIME			100000 // a deferred task is run regardless of the budget after this time
+#define CFG_LOOP_BUDGET_TICKS				1000
+#define CFG_LOOP_BUDGET_CAN				200
+#define CFG_LOOP_BUDGET_IO				100
+#define CFG_LOOP_BUDGET_CONSOLE				500
+#define CFG_LOOP_BUDGET_WIFI				500
+#define CFG_LOOP_BUDGET_ELM327				500
+#define CFG_LOOP_BUDGET_LOGGER				500
+#define CFG_LOOP_BUDGET_SERIAL				200
+#define CFG_LOOP_BUDGET_MESSAGES			500
 
 
 /*
@@ -85,6 +128,7 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  *
  */
 #define CFG_THROTTLE_TOLERANCE  150 //the max that things can go over or under the min/max without fault - 1/10% each #
+#define CFG_DIO_DEBOUNCE_TIME	20 //default time (ms) a digital input must be stable before a change is accepted
 
 
 /*
@@ -121,6 +165,7 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #define	MaxRPMValue			6000 //DMOC will ignore this but we can use it ourselves for limiting
 #define RPMSlewRateValue	        10000 // rpm/sec the requested speed should change (speed mode)
 #define TorqueSlewRateValue	        6000 // 0.1Nm/sec the requested torque output should change (torque mode)
+#define SlewRampTimeValue		100 // ms until the full slew rate is reached (jerk limit), 0 = no jerk limit
 #define KilowattHrs			11000 //not currently used
 #define PrechargeR			3000 //millliseconds precharge
 #define NominalVolt			3300 //a reasonable figure for a lithium cell pack driving the DMOC (in tenths of a volt)
@@ -134,8 +179,10 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #define RevLight			255 //temperature to turn it off
 #define EnableIn			255//temperature to turn it off
 #define ReverseIn			255 //temperature to turn it off
-#define MaxRegenWatts	                40000 //in actual watts, there is no scale here
-#define MaxAccelWatts	                150000
+#define MaxMotorPowerValue		1500 //maximum mechanical power when accelerating (in 0.1kW)
+#define MaxRegenPowerValue		400 //maximum mechanical power when regenerating (in 0.1kW)
+#define MaxDischargeCurrentValue	0 //battery discharge current limit in A (0 = no limit)
+#define MaxChargeCurrentValue		0 //battery charge current limit (regen) in A (0 = no limit)
 #define BatteryCapacity                 100
 
 
@@ -150,7 +197,22 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #define CFG_TIMER_NUM_OBSERVERS	7 // the maximum number of supported observers per timer
 #define CFG_TIMER_USE_QUEUING	// if defined, TickHandler uses a queuing buffer instead of direct calls from interrupts
 #define CFG_TIMER_BUFFER_SIZE	100 // the size of the queuing buffer for TickHandler
+#define CFG_LOOP_NUM_TASKS	12 // maximum number of tasks run by the LoopHandler
 #define CFG_FAULT_HISTORY_SIZE	50 //number of faults to store in eeprom. A circular buffer so the last 50 faults are always stored.
+#define CFG_FAULT_INDEX_SIZE	64 //size of the hash table of the faults in the history (must be a power of 2 and larger than CFG_FAULT_HISTORY_SIZE)
+#define CFG_THROTTLE_CURVE_POINTS	8 //maximum number of points of a user defined throttle curve
+#define CFG_FREEZE_FRAME_COUNT	8 //number of freeze frames (snapshots of the drive train state when a fault was raised) to keep
+#define CFG_DIO_NUM_OBSERVERS	5 // maximum number of subscriptions to digital input edge events
+#define CFG_SIGNAL_MAX_SIGNALS	64 // maximum number of signals which can be published in the SignalRegistry
+#define CFG_SIGNAL_MAX_SUBSCRIPTIONS	64 // maximum number of subscriptions to signals of all consumers together
+#define CFG_MSG_BUS_POOL_SIZE	16 // number of messages which can be posted to the MessageBus at the same time
+#define CFG_MSG_BUS_MAX_SUBSCRIPTIONS	16 // maximum number of subscriptions to message types of all receivers together
+#define CFG_MSG_BUS_KEY_LENGTH	16 // max length of the parameter name in a message (incl. terminating 0)
+#define CFG_MSG_BUS_TEXT_LENGTH	88 // max length of the text in a message (incl. terminating 0), must hold a wifi command of the console
+#define CFG_LOG_BUFFER_SIZE	32 // number of log records the deferred logger can queue (must be a power of 2)
+#define CFG_LOG_MAX_ARGS	10 // maximum number of parameters stored per deferred log record
+#define CFG_LOG_STRING_SIZE	32 // space per deferred log record for copies of %s parameters
+#define CFG_LOG_NUM_DEVICE_LEVELS	8 // maximum number of devices with an individual log level
 
 /*
  * PIN ASSIGNMENT
@@ -92,12 +92,24 @@ namespace Constants {
 	static const char* tempInverter = "tempInverter";
 	static const char* tempSystem = "tempSystem";
 	static const char* mechPower = "mechPower";
+	static const char* dashValues = "dashValues";
 	static const char* prechargeR = "prechargeR";
         static const char* prechargeRelay = "prechargeRelay";
         static const char* mainContactorRelay = "mainContactorRelay";
 	static const char* coolFan = "coolFan";
 	static const char* coolOn = "coolOn";
 	static const char* coolOff = "coolOff";
+
+	// signals which are not shown on the web site (the status values above are published under their parameter name)
+	static const char* throttleLevel = "throttleLevel";
+	static const char* throttleRaw2 = "throttleRaw2";
+	static const char* brakeLevel = "brakeLevel";
+	static const char* controllerState = "controllerState";
+	static const char* stateOfCharge = "stateOfCharge";
+	static const char* bmsVoltage = "bmsVoltage";
+	static const char* bmsCurrent = "bmsCurrent";
+	static const char* digitalInputs = "digitalInputs";
+	static const char* digitalOutputs = "digitalOutputs";
    	static const char* validChecksum = "Valid checksum, using stored config values";
 	static const char* invalidChecksum = "Invalid checksum, using hard coded config values";
 	static const char* valueOutOfRange = "value out of range: %l";
@@ -80,7 +80,12 @@ the end of the stardard data. The below numbers are offsets from the device's ee
 #define EEMC_NOMINAL_V		35 //2 bytes - nominal system voltage to expect (in tenths of a volt)
 #define EEMC_REVERSE_LIMIT	37 //2 bytes - a percentage to knock the requested torque down by while in reverse.
 #define EEMC_RPM_SLEW_RATE	39 //2 bytes - slew rate (rpm/sec) at which speed should change (only in speed mode)
-#define EEMC_TORQUE_SLEW_RATE	41 //2 bytes - slew rate (0.1Nm/sec) at which the torque should change
+#define EEMC_TORQUE_SLEW_RATE	47 //2 bytes - slew rate (0.1Nm/sec) at which the torque should change (was 41 which overlapped with EEMC_BRAKE_LIGHT)
+#define EEMC_SLEW_RAMP_TIME	49 //2 bytes - time (ms) until the full slew rate is reached, limits the jerk (0 = disabled)
+#define EEMC_MAX_MOTOR_POWER	51 //2 bytes - maximum mechanical power when accelerating (0.1kW, 0 = no limit)
+#define EEMC_MAX_REGEN_POWER	53 //2 bytes - maximum mechanical power when regenerating (0.1kW, 0 = no limit)
+#define EEMC_MAX_DISCHARGE_CURRENT 55 //2 bytes - battery discharge current limit (A, 0 = no limit)
+#define EEMC_MAX_CHARGE_CURRENT	57 //2 bytes - battery charge current limit during regen (A, 0 = no limit)
 #define EEMC_BRAKE_LIGHT        42
 #define EEMC_REV_LIGHT		43
 #define EEMC_ENABLE_IN		44
@@ -108,6 +113,8 @@ the end of the stardard data. The below numbers are offsets from the device's ee
 #define EETH_CAR_TYPE		52 //1 byte - type of car for querying the throttle position via CAN bus
 #define EETH_ADC_1		53 //1 byte - which ADC port to use for first throttle input
 #define EETH_ADC_2		54 //1 byte - which ADC port to use for second throttle input
+#define EETH_CURVE_POINTS	56 //1 byte - number of points of a user defined throttle curve (0 = use regen/fwd/map parameters)
+#define EETH_CURVE_START	58 //CFG_THROTTLE_CURVE_POINTS * 4 bytes - pairs of pedal position (uint16, 0-1000) and level (int16, -1000 to 1000)
 
 //System Data
 #define EESYS_SYSTEM_TYPE        10  //1 byte - 1 = Old school protoboards 2 = GEVCU2/DUED 3 = GEVCU3 - Defaults to 2 if invalid or not set up
@@ -156,6 +163,13 @@ the end of the stardard data. The below numbers are offsets from the device's ee
 #define EESYS_CAN_FILTER6        252 //4 bytes - seventh canbus filter - not valid on Macchina, Mask 6 on Due
 #define EESYS_CAPACITY           256 // 1 byte - battery pack capacity in AH
 #define EESYS_AH                257 // 2 bytes - current cumulative ampere hours 
+#define EESYS_ENERGY_DISCHARGED  260 // 4 bytes - energy taken from the battery since it was full (Wh)
+#define EESYS_ENERGY_CHARGED     264 // 4 bytes - energy fed into the battery by regen since it was full (Wh)
+#define EESYS_CHARGE_DISCHARGED  268 // 4 bytes - charge taken from the battery since it was full (mAh)
+#define EESYS_CHARGE_CHARGED     272 // 4 bytes - charge fed into the battery by regen since it was full (mAh)
+#define EESYS_TELEMETRY_IPADDR   280 // 4 bytes - IP address of the host receiving the telemetry stream (0 = disabled)
+#define EESYS_TELEMETRY_PORT     284 // 2 bytes - TCP port of the host receiving the telemetry stream (0 = disabled)
+#define EESYS_TELEMETRY_INTERVAL 286 // 2 bytes - ms between two telemetry records
 
 //Allow for a few defined WIFI SSIDs that the GEVCU will try to automatically connect to. 
 #define EESYS_WIFI0_SSID	 300 //32 bytes - the SSID to create or use (prefixed with ! if create ad-hoc)
@@ -193,11 +207,13 @@ the end of the stardard data. The below numbers are offsets from the device's ee
 #define EESYS_BRAKELIGHT	660 //1 byte - 
 #define EESYS_xxxx		661 //1 byte -
 
-#define EEFAULT_VALID		0 //1 byte - Set to value of 0xB2 if fault data has been initialized
+#define EEFAULT_VALID		0 //1 byte - Set to value of 0xB4 if fault data has been initialized (0xB2/0xB3 = older formats, migrated on load)
 #define EEFAULT_READPTR		1 //2 bytes - index where reading should start (first unacknowledged fault)
 #define EEFAULT_WRITEPTR	3 //2 bytes - index where writing should occur for new faults
 #define EEFAULT_RUNTIME		5 //4 bytes - stores the number of seconds (in tenths) that the system has been turned on for - total time ever
+#define EEFAULT_FREEZE_WRITEPTR	9 //1 byte - index where the next freeze frame will be written
 #define EEFAULT_FAULTS_START	10 //a bunch of faults stored one after the other start at this location
+#define EEFAULT_FREEZE_START	640 //freeze frames captured with new faults (CFG_FREEZE_FRAME_COUNT * sizeof(FREEZE_FRAME))
 
 
 #endif
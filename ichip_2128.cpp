@@ -28,6 +28,47 @@
 
 #include "ichip_2128.h"
 
+/*
+ * The status values which are sent to the web site when they change, with the
+ * minimum time between two updates (ms) and the deadband (in the scale of the signal).
+ */
+static const struct {
+	const char *name;
+	uint16_t interval;
+	uint16_t deadband;
+} wifiSignals[] = {
+	{ Constants::running, 0, 0 },
+	{ Constants::faulted, 0, 0 },
+	{ Constants::warning, 0, 0 },
+	{ Constants::gear, 0, 0 },
+	{ Constants::motorMode, 0, 0 },
+	{ Constants::torqueRequested, 500, 5 },
+	{ Constants::speedRequested, 500, 10 },
+	{ Constants::acCurrent, 500, 5 },
+	{ Constants::brake, 500, 10 },
+	{ Constants::tempSystem, 5000, 5 },
+	{ Constants::bitfield1, 200, 0 },
+	{ Constants::bitfield2, 200, 0 },
+	{ Constants::bitfield3, 200, 0 },
+	{ Constants::bitfield4, 200, 0 },
+	{ Constants::nominalVolt, 1000, 0 },
+	{ Constants::prechargeR, 1000, 0 },
+	{ Constants::prechargeRelay, 1000, 0 },
+	{ Constants::mainContactorRelay, 1000, 0 },
+	{ Constants::coolFan, 1000, 0 },
+	{ Constants::coolOn, 1000, 0 },
+	{ Constants::coolOff, 1000, 0 },
+	{ Constants::brakeLight, 1000, 0 },
+	{ Constants::revLight, 1000, 0 },
+	{ Constants::enableIn, 1000, 0 },
+	{ Constants::reverseIn, 1000, 0 }
+};
+
+// the values of the dashValues parameter, in the order of the "names" attribute in dashboard.xml and status.xml
+static const char *dashboardValues[DASHBOARD_VALUES] = { Constants::tempMotor, Constants::tempInverter, Constants::throttle,
+		Constants::torqueActual, Constants::speedActual, Constants::dcVoltage, Constants::dcCurrent, Constants::kiloWattHours,
+		Constants::mechPower };
+
 /*
  * Constructor. Assign serial interface to use for ichip communication
  */
@@ -73,17 +114,40 @@ void ICHIPWIFI::setup() {
 	ibWritePtr = 0;
 	psWritePtr = 0;
 	psReadPtr = 0;
+	droppedCommands = 0;
 	listeningSocket = 0;
 
 	lastSentTime = millis();
+	lastSentMicros = micros();
 	lastSentState = IDLE;
-	lastSentCmd = String("");
+	lastSentCmd[0] = 0;
+	retries = 0;
+	echoes = 0;
+	replyTimeout = CFG_WIFI_REPLY_TIMEOUT;
+	staleReply = false;
+	previousCmd[0] = 0;
+	previousState = IDLE;
+	lateEchoes = 0;
+	cmdsCompleted = 0;
+	cmdsRetried = 0;
+	cmdsFailed = 0;
+	rttMin = rttMax = rttAverage = 0;
 
 	activeSockets[0] = -1;
 	activeSockets[1] = -1;
 	activeSockets[2] = -1;
 	activeSockets[3] = -1;
 
+	telemetrySocket = -1;
+	lastTelemetryTime = 0;
+	sysPrefs->read(EESYS_TELEMETRY_IPADDR, &telemetryAddress);
+	sysPrefs->read(EESYS_TELEMETRY_PORT, &telemetryPort);
+	sysPrefs->read(EESYS_TELEMETRY_INTERVAL, &telemetryInterval);
+	if (telemetryAddress == 0xFFFFFFFF || telemetryPort == 0xFFFF) // not initialized
+		telemetryPort = 0;
+	if (telemetryInterval == 0 || telemetryInterval == 0xFFFF)
+		telemetryInterval = CFG_TELEMETRY_INTERVAL;
+
 	state = IDLE;
 
 	didParamLoad = false;
@@ -91,16 +155,23 @@ void ICHIPWIFI::setup() {
 
 	serialInterface->begin(115200);
 
-	paramCache.brakeNotAvailable = true;
+	dashboardChanged = false;
+	for (int i = 0; i < DASHBOARD_VALUES; i++)
+		dashboardSignals[i] = SIGNAL_INVALID;
 
 	elmProc = new ELM327Processor();
 
 	TickHandler::getInstance()->attach(this, CFG_TICK_INTERVAL_WIFI);
+	LoopHandler::getInstance()->attach(this, LOOP_PRIORITY_NORMAL, CFG_LOOP_BUDGET_WIFI, "wifi");
 
+	MessageBus *bus = MessageBus::getInstance();
+	bus->subscribe(this, MSG_SET_PARAM, ICHIP2128);
+	bus->subscribe(this, MSG_CONFIG_CHANGE, ICHIP2128);
+	bus->subscribe(this, MSG_COMMAND, ICHIP2128);
 }
 
 //A version of sendCmd that defaults to SET_PARAM which is what most of the code used to assume.
-void ICHIPWIFI::sendCmd(String cmd) {
+void ICHIPWIFI::sendCmd(const char *cmd) {
 	sendCmd(cmd, SET_PARAM);
 }
 
@@ -108,39 +179,160 @@ void ICHIPWIFI::sendCmd(String cmd) {
  * Send a command to ichip. The "AT+i" part will be added.
  * If the comm channel is busy it buffers the command
  */
-void ICHIPWIFI::sendCmd(String cmd, ICHIP_COMM_STATE cmdstate) {
-	if (state != IDLE) { //if the comm is tied up then buffer this parameter for sending later
-		sendingBuffer[psWritePtr].cmd = cmd;
-		sendingBuffer[psWritePtr].state = cmdstate;
-		psWritePtr = (psWritePtr + 1) & 63;
-		if (Logger::isDebug()) {
-			String temp = "Buffer cmd: " + cmd;
-			Logger::debug(ICHIP2128, (char *)temp.c_str());
-		}
+void ICHIPWIFI::sendCmd(const char *cmd, ICHIP_COMM_STATE cmdstate) {
+	sendFormattedCmd(cmdstate, "%s", cmd);
+}
+
+/*
+ * Format a command (printf style) directly into the next free slot of the queue
+ * and start sending it if the comm channel is free. No memory is allocated.
+ * If the queue is full or the command too long, it is dropped and counted.
+ */
+void ICHIPWIFI::sendFormattedCmd(ICHIP_COMM_STATE cmdstate, const char *format, ...) {
+	va_list args;
+	int next = (psWritePtr + 1) % CFG_WIFI_BUFFER_SIZE;
+	int length;
+
+	if (next == psReadPtr) {
+		if ((droppedCommands++ % 16) == 0) // don't flood the log
+			Logger::warn(ICHIP2128, "command queue full, %l commands dropped", droppedCommands);
+		return;
+	}
+
+	va_start(args, format);
+	length = vsnprintf(sendingBuffer[psWritePtr].cmd, CFG_WIFI_CMD_LENGTH, format, args);
+	va_end(args);
+	if (length < 0 || length >= CFG_WIFI_CMD_LENGTH) {
+		droppedCommands++;
+		Logger::warn(ICHIP2128, "command too long, dropped");
+		return;
 	}
-	else { //otherwise, go ahead and blast away
-		serialInterface->write(Constants::ichipCommandPrefix);
-		serialInterface->print(cmd);
-		serialInterface->write(13);
-		state = cmdstate;
-		lastSentTime = millis();
-		lastSentCmd = String(cmd);
-		lastSentState = cmdstate;
-
-		if (Logger::isDebug()) {
-			String temp = "Send to ichip cmd: " + cmd;
-			Logger::debug(ICHIP2128, (char *)temp.c_str());
+	sendingBuffer[psWritePtr].state = cmdstate;
+	psWritePtr = next;
+
+	if (state == IDLE)
+		sendNextCmd();
+	else
+		LOG_DEBUG(ICHIP2128, "Buffer cmd: %s", sendingBuffer[(psWritePtr + CFG_WIFI_BUFFER_SIZE - 1) % CFG_WIFI_BUFFER_SIZE].cmd);
+}
+
+/*
+ * If the comm channel is free, take the next command from the queue and send it.
+ */
+void ICHIPWIFI::sendNextCmd() {
+	if (state != IDLE || psReadPtr == psWritePtr)
+		return;
+
+	SendBuff *entry = &sendingBuffer[psReadPtr];
+	strcpy(lastSentCmd, entry->cmd);
+	psReadPtr = (psReadPtr + 1) % CFG_WIFI_BUFFER_SIZE;
+
+	retries = 0;
+	echoes = 0;
+	replyTimeout = CFG_WIFI_REPLY_TIMEOUT;
+	transmitCmd(entry->state);
+}
+
+/*
+ * Write the command in lastSentCmd to the ichip.
+ */
+void ICHIPWIFI::transmitCmd(ICHIP_COMM_STATE cmdstate) {
+	serialInterface->write(Constants::ichipCommandPrefix);
+	serialInterface->print(lastSentCmd);
+	serialInterface->write(13);
+	state = cmdstate;
+	lastSentTime = millis();
+	lastSentMicros = micros();
+	lastSentState = cmdstate;
+
+	LOG_DEBUG(ICHIP2128, "Send to ichip: %s", lastSentCmd);
+}
+
+/*
+ * The ichip replied with "I/..." to the command in flight. Update the round
+ * trip statistics and send the next command right away to keep the link busy.
+ */
+void ICHIPWIFI::completeCmd() {
+	if (state != IDLE) {
+		uint32_t rtt = micros() - lastSentMicros;
+
+		if (cmdsCompleted == 0) {
+			rttMin = rttMax = rttAverage = rtt;
+		} else {
+			rttMin = min(rttMin, rtt);
+			rttMax = max(rttMax, rtt);
+			rttAverage = (rttAverage * 7 + rtt) / 8;
 		}
+		cmdsCompleted++;
+		finishCmd();
 	}
+	sendNextCmd();
 }
 
-void ICHIPWIFI::sendToSocket(int socket, String data) {
-	char buff[6];
-	sprintf(buff, "%03i", socket);
-	String temp = "SSND%%:" + String(buff);
-	sprintf(buff, ",%i:", data.length());
-	temp = temp + String(buff) + data;
-	sendCmd(temp, SEND_SOCKET);
+/*
+ * The command in flight is done (answered or given up). The ichip answers the commands
+ * strictly in order, but earlier transmissions of a repeated command which weren't echoed
+ * yet may still be answered. Their number is kept so these late replies are not taken
+ * for the reply of the next command, even if it is the same (e.g. WNXT or SRCV).
+ */
+void ICHIPWIFI::finishCmd() {
+	strcpy(previousCmd, lastSentCmd);
+	previousState = lastSentState;
+	lateEchoes = (echoes < retries + 1 ? retries + 1 - echoes : 0);
+	state = IDLE;
+}
+
+/*
+ * Check if a line received from the ichip is the echo of a command. The input handling
+ * drops LF and ends a line at CR, so only the part of the command up to the first CR/LF
+ * can be compared. For socket data only the "SSND%%:<socket>,<length>:" header is compared,
+ * the data may contain CR/LF anywhere (e.g. ELM327 replies, telemetry records).
+ */
+bool ICHIPWIFI::isEcho(const char *echo, const char *cmd, ICHIP_COMM_STATE cmdState) {
+	if (cmdState == SEND_SOCKET) {
+		const char *data = strchr(cmd, ',');
+		if (data && (data = strchr(data, ':')) != NULL)
+			return strncmp(echo, cmd, data - cmd + 1) == 0;
+	}
+
+	size_t length = strcspn(cmd, "\r\n");
+	return strncmp(echo, cmd, length) == 0 && echo[length] == 0;
+}
+
+/*
+ * Repeat the command in flight if the ichip didn't reply in time, waiting twice as
+ * long with every attempt. Commands which consume or send socket data or open a
+ * listener are not repeated as this would duplicate or lose data.
+ */
+void ICHIPWIFI::checkReplyTimeout() {
+	if (state == IDLE || (millis() - lastSentTime) < replyTimeout)
+		return;
+
+	if (retries < CFG_WIFI_MAX_RETRIES && (state == SET_PARAM || state == GET_PARAM || state == GET_ACTIVE_SOCKETS || state == POLL_SOCKET)) {
+		retries++;
+		cmdsRetried++;
+		replyTimeout *= 2;
+		LOG_DEBUG(ICHIP2128, "no reply to %s, retry %d", lastSentCmd, retries);
+		transmitCmd(lastSentState);
+	} else {
+		cmdsFailed++;
+		LOG_DEBUG(ICHIP2128, "no reply to %s, giving up", lastSentCmd);
+		finishCmd();
+		sendNextCmd();
+	}
+}
+
+/*
+ * Print the statistics of the ichip communication
+ */
+void ICHIPWIFI::printStatistics() {
+	Logger::console("iChip commands: %l completed, %l retried, %l failed, %l dropped, %d queued", cmdsCompleted, cmdsRetried, cmdsFailed,
+			droppedCommands, (psWritePtr - psReadPtr + CFG_WIFI_BUFFER_SIZE) % CFG_WIFI_BUFFER_SIZE);
+	Logger::console("iChip round trip time (microseconds): min %l, avg %l, max %l", rttMin, rttAverage, rttMax);
+}
+
+void ICHIPWIFI::sendToSocket(int socket, const char *data) {
+	sendFormattedCmd(SEND_SOCKET, "SSND%%%%:%03i,%i:%s", socket, strlen(data), data);
 }
 
 /*
@@ -149,14 +341,10 @@ void ICHIPWIFI::sendToSocket(int socket, String data) {
  */
 //TODO: See the processing function below for a more detailed explanation - can't send so many setParam commands in a row
 void ICHIPWIFI::handleTick() {
-        MotorController* motorController = DeviceManager::getInstance()->getMotorController();
-	Throttle *accelerator = DeviceManager::getInstance()->getAccelerator();
-	Throttle *brake = DeviceManager::getInstance()->getBrake();
+	MotorController* motorController = DeviceManager::getInstance()->getMotorController();
 	static int pollListening = 0;
 	static int pollSocket = 0;
 	uint32_t ms = millis();
-	char buff[6];
-	uint8_t brklt;
 	tickCounter++;
 
 	if (ms < 1000) return; //wait 10 seconds for things to settle before doing a thing
@@ -165,10 +353,7 @@ void ICHIPWIFI::handleTick() {
 	if (!didParamLoad && ms > 5000) {
 	    loadParameters();
                   Logger::console("Wifi Parameters loaded...");
-            paramCache.bitfield1 = motorController->getStatusBitfield1();
-		setParam(Constants::bitfield1, paramCache.bitfield1);
-	    paramCache.bitfield2 = motorController->getStatusBitfield2();
-	    setParam(Constants::bitfield2, paramCache.bitfield2);
+	    subscribeSignals();
            // DeviceManager::getInstance()->updateWifiByID(BRUSA_DMC5);
 
 	    didParamLoad = true;
@@ -184,238 +369,86 @@ void ICHIPWIFI::handleTick() {
 		pollListening++;
 		if (pollListening > 8) {
 			pollListening = 0;
-			char buff[5];
-			sprintf(buff, "%u", listeningSocket);
-			String temp = "LSST:" + String(buff);
-			sendCmd(temp, GET_ACTIVE_SOCKETS);
+			sendFormattedCmd(GET_ACTIVE_SOCKETS, "LSST:%u", listeningSocket);
 		}
 	}
 
 	//read any information waiting on active sockets
 	for (int c = 0; c < 4; c++) 
 		if (activeSockets[c] != -1) {
-			sprintf(buff, "%03i", activeSockets[c]);
-			String temp = "SRCV:" + String(buff) + ",80";
-			sendCmd(temp, GET_SOCKET);
-		}
-
-	//TODO:Testing line below. Remove it.
-	//return;
-
-
-	// make small slices so the main loop is not blocked for too long
-	if (tickCounter == 1) {
-		if (motorController) {
-			//Logger::console("Wifi tick counter 1...");
-
-			paramCache.timeRunning = ms;
-			setParam(Constants::timeRunning, getTimeRunning());
-			
-			if ( paramCache.torqueRequested != motorController->getTorqueRequested() ) {
-				paramCache.torqueRequested = motorController->getTorqueRequested();
-				setParam(Constants::torqueRequested, paramCache.torqueRequested / 10.0f, 1);
-			}
-			if ( paramCache.torqueActual != motorController->getTorqueActual() ) {
-				paramCache.torqueActual = motorController->getTorqueActual();
-				setParam(Constants::torqueActual, paramCache.torqueActual / 10.0f, 1);
-			}
-		}
-		if (accelerator) {
-            RawSignalData *rawSignal = accelerator->acquireRawSignal();
-			if ( paramCache.throttle !=  rawSignal->input1) {
-				paramCache.throttle = rawSignal->input1;
-                setParam(Constants::throttle, paramCache.throttle);
-	
-			/*if ( paramCache.throttle != accelerator->getLevel() ) {
-				paramCache.throttle = accelerator->getLevel();
-                                if (paramCache.throttle<-600){paramCache.throttle=-600;}
-				setParam(Constants::throttle, paramCache.throttle / 10.0f, 1);*/
-			}
-		}
-		if (brake) {
-            RawSignalData *rawSignal = brake->acquireRawSignal();
-			if ( paramCache.brake !=  rawSignal->input1) {
-				paramCache.brake = rawSignal->input1;
-	            paramCache.brakeNotAvailable = false;
-	            setParam(Constants::brake, paramCache.brake);
-	
-			/*if ( paramCache.brake != brake->getLevel() ) {
-				paramCache.brake = brake->getLevel();
-				paramCache.brakeNotAvailable = false;
-				setParam(Constants::brake, paramCache.brake / 10.0f, 1);*/
-			}
-		} else {
-			if ( paramCache.brakeNotAvailable == true ) {
-				paramCache.brakeNotAvailable = false; // no need to keep sending this
-				setParam(Constants::brake, Constants::notAvailable);
-			}
-		}
-	} else if (tickCounter == 2) {
-		if (motorController) {
-			//Logger::console("Wifi tick counter 2...");
-			if ( paramCache.speedRequested != motorController->getSpeedRequested() ) {
-				paramCache.speedRequested = motorController->getSpeedRequested();
-				setParam(Constants::speedRequested, paramCache.speedRequested);
-			}
-			if ( paramCache.speedActual != motorController->getSpeedActual() ) {
-				paramCache.speedActual = motorController->getSpeedActual();
-                                if (paramCache.speedActual<0) paramCache.speedActual=0;
-                                if (paramCache.speedActual>10000) paramCache.speedActual=10000;
-				setParam(Constants::speedActual, paramCache.speedActual);
-			}
-			if ( paramCache.dcVoltage != motorController->getDcVoltage() ) {
-				paramCache.dcVoltage = motorController->getDcVoltage();
-                                if(paramCache.dcVoltage<1000) paramCache.dcVoltage=1000;  //Limits of the gage display
-                                 if(paramCache.dcVoltage>4500) paramCache.dcVoltage=4500;
-                               
-				setParam(Constants::dcVoltage, paramCache.dcVoltage / 10.0f, 1);
-			}
-			if ( paramCache.dcCurrent != motorController->getDcCurrent() ) {
-				paramCache.dcCurrent = motorController->getDcCurrent();
-				setParam(Constants::dcCurrent, paramCache.dcCurrent / 10.0f, 1);
-			}
-			if ( paramCache.prechargeR != motorController->getprechargeR() ) {
-				paramCache.prechargeR = motorController->getprechargeR();
-				setParam(Constants::prechargeR, (uint16_t)paramCache.prechargeR);
-			}
-
-            if ( paramCache.prechargeRelay != motorController->getprechargeRelay() ) {
-				paramCache.prechargeRelay = motorController->getprechargeRelay();
-				setParam(Constants::prechargeRelay, (uint8_t) paramCache.prechargeRelay);
-				//Logger::console("Precharge Relay %i", paramCache.prechargeRelay);
-				//Logger::console("motorController:prechargeRelay:%d, paramCache.prechargeRelay:%d, Constants:prechargeRelay:%s", motorController->getprechargeRelay(),paramCache.prechargeRelay, Constants::prechargeRelay);
-			}
-
-            if ( paramCache.mainContactorRelay != motorController->getmainContactorRelay() ) {
-				paramCache.mainContactorRelay = motorController->getmainContactorRelay();
-				setParam(Constants::mainContactorRelay, (uint8_t) paramCache.mainContactorRelay);
-			}
-                  //DeviceManager::getInstance()->updateWifi();
-		}
-	} else if (tickCounter == 3) {
-		if (motorController) {
-			//Logger::console("Wifi tick counter 2...");
-			if ( paramCache.acCurrent != motorController->getAcCurrent() ) {
-				paramCache.acCurrent = motorController->getAcCurrent();
-				setParam(Constants::acCurrent, paramCache.acCurrent / 10.0f, 1);
-			}
-
-			//if ( paramCache.kiloWattHours != motorController->getkiloWattHours()/3600000 ) {
-				paramCache.kiloWattHours = motorController->getKiloWattHours()/3600000;
-                                if(paramCache.kiloWattHours<0)paramCache.kiloWattHours = 0;
-                                if(paramCache.kiloWattHours>300)paramCache.kiloWattHours = 300;
-                        	setParam(Constants::kiloWattHours, paramCache.kiloWattHours / 10.0f, 1);
-			//}
-                       
-            if ( paramCache.nominalVolt != motorController->getnominalVolt()/10 ){
-				paramCache.nominalVolt = motorController->getnominalVolt()/10;
-				setParam(Constants::nominalVolt, paramCache.nominalVolt);
-			}
-
-			if ( paramCache.bitfield1 != motorController->getStatusBitfield1() ) {
-				paramCache.bitfield1 = motorController->getStatusBitfield1();
-				setParam(Constants::bitfield1, paramCache.bitfield1);
-			}
-			if ( paramCache.bitfield2 != motorController->getStatusBitfield2() ) {
-				paramCache.bitfield2 = motorController->getStatusBitfield2();
-				setParam(Constants::bitfield2, paramCache.bitfield2);
-			}
-			if ( paramCache.bitfield3 != motorController->getStatusBitfield3() ) {
-				paramCache.bitfield3 = motorController->getStatusBitfield3();
-				setParam(Constants::bitfield3, paramCache.bitfield3);
-			}
-			if ( paramCache.bitfield4 != motorController->getStatusBitfield4() ) {
-				paramCache.bitfield4 = motorController->getStatusBitfield4();
-				setParam(Constants::bitfield4, paramCache.bitfield4);
-			}
-			
+			sendFormattedCmd(GET_SOCKET, "SRCV:%03i,80", activeSockets[c]);
 		}
-	} else if (tickCounter == 4) {
-		if (motorController) {
-			// Logger::console("Wifi tick counter 4...");
-			if ( paramCache.running != motorController->isRunning() ) {
-				paramCache.running = motorController->isRunning();
-				setParam(Constants::running, (paramCache.running ? Constants::trueStr : Constants::falseStr));
-			}
-			if ( paramCache.faulted != motorController->isFaulted() ) {
-				paramCache.faulted = motorController->isFaulted();
-				setParam(Constants::faulted, (paramCache.faulted ? Constants::trueStr : Constants::falseStr));
-			}
-			if ( paramCache.warning != motorController->isWarning() ) {
-				paramCache.warning = motorController->isWarning();
-				setParam(Constants::warning, (paramCache.warning ? Constants::trueStr : Constants::falseStr));
-			}
-			if ( paramCache.gear != motorController->getSelectedGear() ) {
-				paramCache.gear = motorController->getSelectedGear();
-				setParam(Constants::gear, (uint16_t)paramCache.gear);
-			}
 
-			if ( paramCache.coolFan != motorController->getCoolFan() ) {
-				paramCache.coolFan = motorController->getCoolFan();
-				setParam(Constants::coolFan, (uint8_t) paramCache.coolFan);
-			}
-
-            if ( paramCache.coolOn != motorController->getCoolOn() ) {
-				paramCache.coolOn = motorController->getCoolOn();
-				setParam(Constants::coolOn, (uint8_t) paramCache.coolOn);
-			}
+	// the frequently changing dashboard values are bundled in one parameter and sent every tick
+	if (motorController)
+		publishDashboard();
 
-            if ( paramCache.coolOff != motorController->getCoolOff() ) {
-				paramCache.coolOff = motorController->getCoolOff();
-				setParam(Constants::coolOff, (uint8_t) paramCache.coolOff);
-			}
+	// the other status values are sent by handleSignal() when they change
+	if (tickCounter > 4) {
+		setParam(Constants::timeRunning, getTimeRunning());
+		tickCounter = 0;
+		getNextParam();
+	}
+}
 
-			if ( paramCache.brakeLight != motorController->getBrakeLight() ) {
-				paramCache.brakeLight = motorController->getBrakeLight();
-				setParam(Constants::brakeLight, (uint8_t) paramCache.brakeLight);
-			}
+/*
+ * Subscribe to the status values shown on the web site. Each of them is sent
+ * as parameter with the name of the signal whenever it changes (see handleSignal()).
+ * The values of the dashboard are only flagged and sent together by publishDashboard().
+ */
+void ICHIPWIFI::subscribeSignals() {
+	SignalRegistry *registry = SignalRegistry::getInstance();
 
-			if ( paramCache.revLight != motorController->getRevLight() ) {
-				paramCache.revLight = motorController->getRevLight();
-				setParam(Constants::revLight, (uint8_t) paramCache.revLight);
-			}
+	for (uint8_t i = 0; i < sizeof(wifiSignals) / sizeof(wifiSignals[0]); i++) {
+		registry->subscribe(this, wifiSignals[i].name, wifiSignals[i].interval, wifiSignals[i].deadband);
+	}
+	for (int i = 0; i < DASHBOARD_VALUES; i++) {
+		dashboardSignals[i] = registry->subscribe(this, dashboardValues[i], 0, 0);
+	}
+	if (!registry->isPublished(registry->find(Constants::brake))) {
+		setParam(Constants::brake, Constants::notAvailable);
+	}
+}
 
-			if ( paramCache.enableIn != motorController->getEnableIn() ) {
-				paramCache.enableIn = motorController->getEnableIn();
-				setParam(Constants::enableIn, (uint8_t) paramCache.enableIn);
-			}
-			if ( paramCache.reverseIn != motorController->getReverseIn() ) {
-				paramCache.reverseIn = motorController->getReverseIn();
-				setParam(Constants::reverseIn, (uint8_t) paramCache.reverseIn);
-			}
+void ICHIPWIFI::handleSignal(uint8_t signal, int32_t value) {
+	SignalRegistry *registry = SignalRegistry::getInstance();
 
+	for (int i = 0; i < DASHBOARD_VALUES; i++) {
+		if (dashboardSignals[i] == signal) {
+			dashboardChanged = true;
+			return;
 		}
-	} else if (tickCounter > 4) {
-		if (motorController) {
-			// Logger::console("Wifi tick counter 5...");
-			if ( paramCache.tempMotor != motorController->getTemperatureMotor() ) {
-				paramCache.tempMotor = motorController->getTemperatureMotor();
-				setParam(Constants::tempMotor, paramCache.tempMotor / 10.0f, 1);
-			}
-			if ( paramCache.tempInverter != motorController->getTemperatureInverter() ) {
-				paramCache.tempInverter = motorController->getTemperatureInverter();
-				setParam(Constants::tempInverter, paramCache.tempInverter / 10.0f, 1);
-			}
-			if ( paramCache.tempSystem != motorController->getTemperatureSystem() ) {
-				paramCache.tempSystem = motorController->getTemperatureSystem();
-				setParam(Constants::tempSystem, paramCache.tempSystem / 10.0f, 1);
-			}
+	}
+	setParam(registry->getName(signal), registry->format(signal, value, buffer, sizeof(buffer)));
+}
 
-			if (paramCache.powerMode != motorController->getPowerMode() ) {
-				paramCache.powerMode = motorController->getPowerMode();
-				setParam(Constants::motorMode, (uint8_t)paramCache.powerMode);
-			}
+/*
+ * Send the values of the dashboard as one comma separated parameter instead of one
+ * command per value. The order must match the "names" attribute of the "values" element
+ * in dashboard.xml and status.xml. Nothing is sent if no value changed. If the queue
+ * isn't empty, the update is skipped so the next tick sends fresher values instead
+ * of piling up outdated ones.
+ */
+void ICHIPWIFI::publishDashboard() {
+	SignalRegistry *registry = SignalRegistry::getInstance();
 
-			//if ( paramCache.mechPower != motorController->getMechanicalPower() ) {
-				paramCache.mechPower = motorController->getMechanicalPower();
-                                if (paramCache.mechPower<-250)paramCache.mechPower=-250;
-                                if (paramCache.mechPower>1500)paramCache.mechPower=1500;
-				setParam(Constants::mechPower, paramCache.mechPower / 10.0f, 1);
-			//}
-		}
-		tickCounter = 0;
-		getNextParam();
-	}
+	if (!dashboardChanged || psReadPtr != psWritePtr)
+		return;
+	dashboardChanged = false;
+
+	int32_t tempMotor = registry->getValue(dashboardSignals[0]);
+	int32_t tempInverter = registry->getValue(dashboardSignals[1]);
+	int32_t throttle = registry->getValue(dashboardSignals[2]);
+	int32_t torqueActual = registry->getValue(dashboardSignals[3]);
+	int32_t speedActual = constrain(registry->getValue(dashboardSignals[4]), 0, 10000);
+	int32_t dcVoltage = constrain(registry->getValue(dashboardSignals[5]), 1000, 4500); //Limits of the gage display
+	int32_t dcCurrent = registry->getValue(dashboardSignals[6]);
+	int32_t kiloWattHours = constrain(registry->getValue(dashboardSignals[7]), 0, 300);
+	int32_t mechPower = constrain(registry->getValue(dashboardSignals[8]), -250, 1500);
+
+	sendFormattedCmd(SET_PARAM, "%s=\"%.1f,%.1f,%ld,%.1f,%ld,%.1f,%.1f,%.1f,%.1f\"", Constants::dashValues, tempMotor / 10.0f,
+			tempInverter / 10.0f, throttle, torqueActual / 10.0f, speedActual, dcVoltage / 10.0f, dcCurrent / 10.0f,
+			kiloWattHours / 10.0f, mechPower / 10.0f);
 }
 
 /*
@@ -433,35 +466,24 @@ char *ICHIPWIFI::getTimeRunning() {
 }
 
 /*
- * Handle a message sent by the DeviceManager.
- * Currently MSG_SET_PARAM is supported. The message should be a two element char pointer array 
- * containing the addresses of a two element char array. char *paramPtr[2] = { &param[0][0], &param[1][0] };
- * Element 0 of the base array (char param [2][20]; )should contain the name of the parameter to be changed
- * Element 1 of the base array should contain the new value to be set.   
- *
- *  sendMessage(DEVICE_WIFI, ICHIP2128, MSG_SET_PARAM,  paramPtr);	
- *    
- */
-void ICHIPWIFI::handleMessage(uint32_t messageType, void* message) {
-	Device::handleMessage(messageType, message);  //Only matters if message is MSG_STARTUP
-
-	switch (messageType) {
-  
-	case MSG_SET_PARAM:{   //Sets a single parameter to a single value
-  	        char **params = (char **)message;  //recast message as a two element array (params)		
-              // Logger::console("Received Device: %s value %s",params[0], params[1]);
-		setParam((char *)params[0], (char *)params[1]);
+ * Handle a message of the MessageBus:
+ * MSG_SET_PARAM sets a single parameter of the web site to the value of the message
+ *   bus->send(MSG_SET_PARAM, ICHIP2128, "x1031", 255);
+ * MSG_CONFIG_CHANGE loads all parameters to the web site
+ * MSG_COMMAND sends the text to the WiReach module in the form of AT+itext
+ */
+void ICHIPWIFI::handleBusMessage(const Message *message) {
+	switch (message->type) {
+	case MSG_SET_PARAM:
+		setParam(message->parameter.key, message->parameter.value);
 		break;
-	}
-	case MSG_CONFIG_CHANGE:{  //Loads all parameters to web site
+	case MSG_CONFIG_CHANGE:
 		loadParameters();
 		break;
-        }
-	case MSG_COMMAND:  //Sends a message to the WiReach module in the form of AT+imessage
-		sendCmd((char *)message);
+	case MSG_COMMAND:
+		sendCmd(message->text);
 		break;
-        }
-    
+	}
 }
 
 /*
@@ -475,76 +497,67 @@ void ICHIPWIFI::getNextParam() {
 /*
  * Try to retrieve the value of the given parameter.
  */
-void ICHIPWIFI::getParamById(String paramName) {
-	sendCmd(paramName + "?", GET_PARAM);
+void ICHIPWIFI::getParamById(const char *paramName) {
+	sendFormattedCmd(GET_PARAM, "%s?", paramName);
 }
 
 /*
  * Set a parameter to the given string value
  */
-void ICHIPWIFI::setParam(String paramName, String value) {
-      sendCmd(paramName + "=\"" + value + "\"", SET_PARAM);
+void ICHIPWIFI::setParam(const char *paramName, const char *value) {
+	sendFormattedCmd(SET_PARAM, "%s=\"%s\"", paramName, value);
 }
 
 /*
  * Set a parameter to the given int32 value
  */
-void ICHIPWIFI::setParam(String paramName, int32_t value) {
-	sprintf(buffer, "%l", value);
-	setParam(paramName, buffer);
+void ICHIPWIFI::setParam(const char *paramName, int32_t value) {
+	sendFormattedCmd(SET_PARAM, "%s=\"%ld\"", paramName, value);
 }
 
 /*
  * Set a parameter to the given uint32 value
  */
-void ICHIPWIFI::setParam(String paramName, uint32_t value) {
-	sprintf(buffer, "%lu", value);
-	setParam(paramName, buffer);
+void ICHIPWIFI::setParam(const char *paramName, uint32_t value) {
+	sendFormattedCmd(SET_PARAM, "%s=\"%lu\"", paramName, value);
 }
 
 /*
  * Set a parameter to the given sint16 value
  */
-void ICHIPWIFI::setParam(String paramName, int16_t value) {
-	sprintf(buffer, "%d", value);
-	setParam(paramName, buffer);
+void ICHIPWIFI::setParam(const char *paramName, int16_t value) {
+	sendFormattedCmd(SET_PARAM, "%s=\"%d\"", paramName, value);
 }
 
 /*
  * Set a parameter to the given uint16 value
  */
-void ICHIPWIFI::setParam(String paramName, uint16_t value) {
-	sprintf(buffer, "%d", value);
-	setParam(paramName, buffer);
+void ICHIPWIFI::setParam(const char *paramName, uint16_t value) {
+	sendFormattedCmd(SET_PARAM, "%s=\"%d\"", paramName, value);
 }
 
 /*
  * Set a parameter to the given uint8 value
  */
-void ICHIPWIFI::setParam(String paramName, uint8_t value) {
-	sprintf(buffer, "%d", value);
-	setParam(paramName, buffer);
+void ICHIPWIFI::setParam(const char *paramName, uint8_t value) {
+	sendFormattedCmd(SET_PARAM, "%s=\"%d\"", paramName, value);
 }
 /*
  * Set a parameter to the given float value
  */
-void ICHIPWIFI::setParam(String paramName, float value, int precision) {
-	char format[10];
-	sprintf(format, "%%.%df", precision);
-	sprintf(buffer, format, value);
-	setParam(paramName, buffer);
+void ICHIPWIFI::setParam(const char *paramName, float value, int precision) {
+	sendFormattedCmd(SET_PARAM, "%s=\"%.*f\"", paramName, precision, value);
 }
 
 /*
- * Called in the main loop (hopefully) in order to process serial input waiting for us
+ * Called by the LoopHandler in order to process serial input waiting for us
  * from the wifi module. It should always terminate its answers with 13 so buffer
  * until we get 13 (CR) and then process it.
  * 
  */
 
-void ICHIPWIFI::loop() {
+void ICHIPWIFI::handleLoop() {
 	int incoming;
-	char buff[6];
 	while (serialInterface->available()) {
 		incoming = serialInterface->read();
 		if (incoming != -1) { //and there is no reason it should be -1
@@ -552,19 +565,28 @@ void ICHIPWIFI::loop() {
 				incomingBuffer[ibWritePtr] = 0; //null terminate the string
 				ibWritePtr = 0; //reset the write pointer
 				//what we do with the input depends on what state the ICHIP comm was set to.
-				if (Logger::isDebug()) {
-					sprintf(buff, "%u", state);
-					String temp = "In Data, state: " + String(buff);
-					Logger::debug(ICHIP2128, (char *)temp.c_str());
-					temp = "Data from ichip: " + String(incomingBuffer);
-					Logger::debug(ICHIP2128, (char *)temp.c_str());
-
-				}
-
-				//The ichip echoes our commands back at us. The safer option might be to verify that the command
-				//we think we're about to process is really proper by validating the echo here. But, for now
-				//just ignore echoes.
-				if (strncmp(incomingBuffer, Constants::ichipCommandPrefix, 4) != 0) {
+				LOG_DEBUG(ICHIP2128, "In Data, state: %d", state);
+				LOG_DEBUG(ICHIP2128, "Data from ichip: %s", incomingBuffer);
+
+				//The ichip echoes our commands back at us. If the echo doesn't match the command in flight,
+				//it belongs to a command which timed out before and its reply must not be taken for ours.
+				if (strncmp(incomingBuffer, Constants::ichipCommandPrefix, 4) == 0) {
+					char *echo = &incomingBuffer[4];
+					if (lateEchoes > 0 && isEcho(echo, previousCmd, previousState)) {
+						lateEchoes--; // an earlier transmission of the previous command
+						staleReply = true;
+					} else {
+						lateEchoes = 0; // the replies come in order, so the ones still missing are lost
+						staleReply = (state == IDLE || !isEcho(echo, lastSentCmd, lastSentState));
+						if (!staleReply)
+							echoes++;
+					}
+					if (staleReply)
+						LOG_DEBUG(ICHIP2128, "ignoring reply of previous cmd: %s", echo);
+				} else if (staleReply) {
+					if (strstr(incomingBuffer, "I/") != NULL)
+						staleReply = false; // the stale reply is complete, the next one is ours
+				} else {
 					switch (state) {
 					case GET_PARAM: //reply from an attempt to read changed parameters from ichip
 						if (strchr(incomingBuffer, '='))
@@ -578,10 +600,7 @@ void ICHIPWIFI::loop() {
 						   listeningSocket = atoi(&incomingBuffer[2]);
 						   if (listeningSocket < 10) listeningSocket = 0;
 						   if (listeningSocket > 11) listeningSocket = 0;
-						   if (Logger::isDebug()) {
-							   sprintf(buff, "%u", listeningSocket);
-							   Logger::debug(ICHIP2128, buff);
-						   }
+						   LOG_DEBUG(ICHIP2128, "listening socket: %d", listeningSocket);
 					   }
 						break;
 					case GET_ACTIVE_SOCKETS: //reply from asking for active connections
@@ -590,22 +609,26 @@ void ICHIPWIFI::loop() {
 						   activeSockets[1] = atoi(strtok(NULL, ","));
 						   activeSockets[2] = atoi(strtok(NULL, ","));
 						   activeSockets[3] = atoi(strtok(NULL, ","));
-						   if (Logger::isDebug()) {
-							   sprintf(buff, "%i", activeSockets[0]);
-							   Logger::debug(ICHIP2128, buff);
-							   sprintf(buff, "%i", activeSockets[1]);
-							   Logger::debug(ICHIP2128, buff);
-							   sprintf(buff, "%i", activeSockets[2]);
-							   Logger::debug(ICHIP2128, buff);
-							   sprintf(buff, "%i", activeSockets[3]);
-							   Logger::debug(ICHIP2128, buff);
-						   }
+						   LOG_DEBUG(ICHIP2128, "active sockets: %d, %d, %d, %d", activeSockets[0], activeSockets[1], activeSockets[2], activeSockets[3]);
 					    }
 					    break;
 					case POLL_SOCKET: //reply from asking about state of socket and how much data it has
 
 						break;
 					case SEND_SOCKET: //reply from sending data over a socket
+						//an error on the telemetry socket means the receiver closed the connection
+						if (!strcmp(incomingBuffer, Constants::ichipErrorString) && telemetrySocket != -1 && atoi(&lastSentCmd[7]) == telemetrySocket) {
+							Logger::info(ICHIP2128, "telemetry connection closed");
+							telemetrySocket = -1;
+							lastTelemetryTime = millis();
+						}
+						break;
+					case OPEN_TELEMETRY: //reply from connecting to the telemetry receiver, hopefully has the socket #
+						if (strcmp(incomingBuffer, Constants::ichipErrorString) && !strncmp(incomingBuffer, "I/", 2)) {
+							telemetrySocket = atoi(&incomingBuffer[2]);
+							telemetry.reset();
+							Logger::info(ICHIP2128, "telemetry connected (socket %d)", telemetrySocket);
+						}
 						break;
 					case GET_SOCKET: //reply requesting the data pending on a socket
 						//reply is I/<size>:data
@@ -614,10 +637,13 @@ void ICHIPWIFI::loop() {
 						if (strstr(incomingBuffer, "ERROR") == NULL) {
 							if (strcmp(incomingBuffer, Constants::ichipErrorString)) {
 								dLen = atoi( strtok(&incomingBuffer[2], ":") );
-								String datastr = strtok(0, ":"); //get the rest of the string
-								datastr.toLowerCase();
-								String ret = elmProc->processELMCmd((char *)datastr.c_str());
-								sendToSocket(0, ret); //TODO: need to actually track which socket requested this data
+								char *datastr = strtok(0, ":"); //get the rest of the string
+								if (datastr != NULL) {
+									for (char *c = datastr; *c; c++)
+										*c = tolower(*c);
+									String ret = elmProc->processELMCmd(datastr);
+									sendToSocket(0, ret.c_str()); //TODO: need to actually track which socket requested this data
+								}
 							}
 						}
 						break;
@@ -629,15 +655,8 @@ void ICHIPWIFI::loop() {
 					}
 
 					//if we got an I/ reply then the command is done sending data. So, see if there is a buffered cmd to send.
-					if (strstr(incomingBuffer, "I/") != NULL) {
-						state = IDLE;
-						if (psReadPtr != psWritePtr) { //if there is a parameter to send then do it
-							String temp = "Sending buffered cmd: " + sendingBuffer[psReadPtr].cmd;
-							if (Logger::isDebug()) Logger::debug(ICHIP2128, (char *)temp.c_str());
-							sendCmd(sendingBuffer[psReadPtr].cmd, sendingBuffer[psReadPtr].state);
-							psReadPtr = (psReadPtr + 1) & 63;
-						}
-					}
+					if (strstr(incomingBuffer, "I/") != NULL)
+						completeCmd();
 				}
 			} else { // add more characters
 				if (incoming != 10) // don't add a LF character
@@ -647,11 +666,38 @@ void ICHIPWIFI::loop() {
 		else return;
 	}
 	
-	if (millis() > lastSentTime + 1000) { //if the last sent command hasn't gotten a reply in 1 second
-		state = IDLE; //something went wrong so reset state
-		//sendCmd(lastSentCmd, lastSentState); //try to resend it
-		//The sendCmd call resets lastSentTime so this will at most be called every second until the iChip interface decides to cooperate.
+	sendTelemetry();
+	checkReplyTimeout();
+}
+
+/*
+ * Stream telemetry records to the configured receiver (TELEMETRY=<ip>:<port>).
+ * The connection is (re-)opened if necessary. A record is only created if the
+ * command queue is empty, so the stream adapts its rate to what the ichip can
+ * take and never delays other commands by more than one record.
+ */
+void ICHIPWIFI::sendTelemetry() {
+	char record[TELEMETRY_RECORD_LENGTH];
+	uint32_t ms = millis();
+
+	if (telemetryPort == 0 || !didTCPListener) // not configured or not started up yet
+		return;
+
+	if (telemetrySocket == -1) {
+		if (state == IDLE && (lastTelemetryTime == 0 || ms - lastTelemetryTime > CFG_TELEMETRY_RECONNECT)) {
+			lastTelemetryTime = ms;
+			sendFormattedCmd(OPEN_TELEMETRY, "STCP:%d.%d.%d.%d,%d", (int) (telemetryAddress & 0xFF), (int) ((telemetryAddress >> 8) & 0xFF),
+					(int) ((telemetryAddress >> 16) & 0xFF), (int) ((telemetryAddress >> 24) & 0xFF), telemetryPort);
+		}
+		return;
 	}
+
+	if (ms - lastTelemetryTime < telemetryInterval || psReadPtr != psWritePtr)
+		return;
+	lastTelemetryTime = ms;
+
+	telemetry.encode(record);
+	sendToSocket(telemetrySocket, record);
 }
 
 /*
@@ -660,26 +706,12 @@ void ICHIPWIFI::loop() {
  * by looking for the '=' sign and the leading/trailing '"' have to be ignored.
  */
 void ICHIPWIFI::processParameterChange(char *key) {
-	PotThrottleConfiguration *acceleratorConfig = NULL;
-	PotThrottleConfiguration *brakeConfig = NULL;
-	MotorControllerConfiguration *motorConfig = NULL;
 	bool parameterFound = true;
 
 	char *value = strchr(key, '=');
 	if (!value)
 		return;
 
-	Throttle *accelerator = DeviceManager::getInstance()->getAccelerator();
-	Throttle *brake = DeviceManager::getInstance()->getBrake();
-	MotorController *motorController = DeviceManager::getInstance()->getMotorController();
-
-	if (accelerator)
-		acceleratorConfig = (PotThrottleConfiguration *)accelerator->getConfiguration();
-	if (brake)
-		brakeConfig = (PotThrottleConfiguration *)brake->getConfiguration();
-	if(motorController)
-		motorConfig = (MotorControllerConfiguration *)motorController->getConfiguration();
-
 	value[0] = 0; // replace the '=' sign with a 0
 	value++;
 	if (value[0] == '"')
@@ -687,189 +719,29 @@ void ICHIPWIFI::processParameterChange(char *key) {
 	if (value[strlen(value) - 1] == '"')
 		value[strlen(value) - 1] = 0; // if the value ends with a '"' character, replace it with 0
 
-	if (!strcmp(key, Constants::numThrottlePots) && acceleratorConfig) {
-		acceleratorConfig->numberPotMeters = atol(value);
-		accelerator->saveConfiguration();
-	} else if (!strcmp(key, Constants::throttleSubType) && acceleratorConfig) {
-		acceleratorConfig->throttleSubType = atol(value);
-		accelerator->saveConfiguration();
-	} else if (!strcmp(key, Constants::throttleMin1) && acceleratorConfig) {
-		acceleratorConfig->minimumLevel1 = atol(value);
-		accelerator->saveConfiguration();
-	} else if (!strcmp(key, Constants::throttleMin2) && acceleratorConfig) {
-		acceleratorConfig->minimumLevel2 = atol(value);
-		accelerator->saveConfiguration();
-	} else if (!strcmp(key, Constants::throttleMax1) && acceleratorConfig) {
-		acceleratorConfig->maximumLevel1 = atol(value);
-		accelerator->saveConfiguration();
-	} else if (!strcmp(key, Constants::throttleMax2) && acceleratorConfig) {
-		acceleratorConfig->maximumLevel2 = atol(value);
-		accelerator->saveConfiguration();
-	} else if (!strcmp(key, Constants::throttleRegenMax) && acceleratorConfig) {
-		acceleratorConfig->positionRegenMaximum = atol(value) * 10;
-	} else if (!strcmp(key, Constants::throttleRegenMin) && acceleratorConfig) {
-		acceleratorConfig->positionRegenMinimum = atol(value) * 10;
-		accelerator->saveConfiguration();
-	} else if (!strcmp(key, Constants::throttleFwd) && acceleratorConfig) {
-		acceleratorConfig->positionForwardMotionStart = atol(value) * 10;
-		accelerator->saveConfiguration();
-	} else if (!strcmp(key, Constants::throttleMap) && acceleratorConfig) {
-		acceleratorConfig->positionHalfPower = atol(value) * 10;
-		accelerator->saveConfiguration();
-	} else if (!strcmp(key, Constants::throttleMinRegen) && acceleratorConfig) {
-		acceleratorConfig->minimumRegen = atol(value);
-		accelerator->saveConfiguration();
-	} else if (!strcmp(key, Constants::throttleMaxRegen) && acceleratorConfig) {
-		acceleratorConfig->maximumRegen = atol(value);
-		accelerator->saveConfiguration();
-	} else if (!strcmp(key, Constants::throttleCreep) && acceleratorConfig) {
-		acceleratorConfig->creep = atol(value);
-		accelerator->saveConfiguration();
-	} else if (!strcmp(key, Constants::brakeMin) && brakeConfig) {
-		brakeConfig->minimumLevel1 = atol(value);
-		brake->saveConfiguration();
-	} else if (!strcmp(key, Constants::brakeMax) && brakeConfig) {
-		brakeConfig->maximumLevel1 = atol(value);
-		brake->saveConfiguration();
-	} else if (!strcmp(key, Constants::brakeMinRegen) && brakeConfig) {
-		brakeConfig->minimumRegen = atol(value);
-		brake->saveConfiguration();
-	} else if (!strcmp(key, Constants::brakeMaxRegen) && brakeConfig) {
-		brakeConfig->maximumRegen = atol(value);
-		brake->saveConfiguration();
-	} else if (!strcmp(key, Constants::speedMax) && motorConfig) {
-		motorConfig->speedMax = atol(value);
-		motorController->saveConfiguration();
-	} else if (!strcmp(key, Constants::torqueMax) && motorConfig) {
-		motorConfig->torqueMax = atol(value) * 10;
-		motorController->saveConfiguration();
-    } else if (!strcmp(key, Constants::coolFan) && motorConfig) {
-		motorConfig->coolFan = atol(value);
-		motorController->saveConfiguration();
-	} else if (!strcmp(key, Constants::coolOn) && motorConfig) {
-		motorConfig->coolOn = (atol(value));
-		motorController->saveConfiguration();
-	} else if (!strcmp(key, Constants::coolOff) && motorConfig) {
-		motorConfig->coolOff = (atol(value));
-		motorController->saveConfiguration();
-      } else if (!strcmp(key, Constants::prechargeR) && motorConfig) {
-		motorConfig->prechargeR = atol(value);
-		motorController->saveConfiguration(); 
-      } else if (!strcmp(key, Constants::prechargeRelay) && motorConfig) {
-		motorConfig->prechargeRelay = atol(value);
-		motorController->saveConfiguration();
-      } else if (!strcmp(key, Constants::nominalVolt) && motorConfig) {
-		motorConfig->nominalVolt = (atol(value))*10;
-                motorController->saveConfiguration();
-    
-      } else if (!strcmp(key, Constants::mainContactorRelay) && motorConfig) {
-		motorConfig->mainContactorRelay = atol(value);
-		motorController->saveConfiguration();
-	} else if (!strcmp(key, Constants::brakeLight) && motorConfig) {
-		motorConfig->brakeLight = atol(value);
-		motorController->saveConfiguration();
-	} else if (!strcmp(key, Constants::revLight) && motorConfig) {
-		motorConfig->revLight = atol(value);
-		motorController->saveConfiguration();
-	} else if (!strcmp(key, Constants::enableIn) && motorConfig) {
-		motorConfig->enableIn = atol(value);
-		motorController->saveConfiguration();
-	} else if (!strcmp(key, Constants::reverseIn) && motorConfig) {
-		motorConfig->reverseIn = atol(value);  
-		motorController->saveConfiguration();
-      /*  } else if (!strcmp(key, Constants::motorMode) && motorConfig) {
-		motorConfig->motorMode = (MotorController::PowerMode)atoi(value);
-		motorController->saveConfiguration();	
-	*/
-
-
-
-        } else if (!strcmp(key, "x1000")){
-                if (255==atol(value)){sysPrefs->setDeviceStatus(strtol(key+1, 0, 16),true);}
-                  else {sysPrefs->setDeviceStatus(strtol(key+1, 0, 16), false);}
-                //sysPrefs->forceCacheWrite();
-            } else if (!strcmp(key, "x1001")){
-                if (255==atol(value)){sysPrefs->setDeviceStatus(strtol(key+1, 0, 16),true);}
-                  else {sysPrefs->setDeviceStatus(strtol(key+1, 0, 16), false);}
-               //sysPrefs->forceCacheWrite();
-         } else if (!strcmp(key, "x1002")){
-                if (255==atol(value)){sysPrefs->setDeviceStatus(strtol(key+1, 0, 16),true);}
-                  else {sysPrefs->setDeviceStatus(strtol(key+1, 0, 16), false);}
-              // sysPrefs->forceCacheWrite();
-         } else if (!strcmp(key, "x1031")){
-                if (255==atol(value)){sysPrefs->setDeviceStatus(strtol(key+1, 0, 16), true);}
-                  else {sysPrefs->setDeviceStatus(strtol(key+1, 0, 16), false);}
-               //sysPrefs->forceCacheWrite();
-         } else if (!strcmp(key, "x1032")){
-                if (255==atol(value)){sysPrefs->setDeviceStatus(strtol(key+1, 0, 16), true);}
-                  else {sysPrefs->setDeviceStatus(strtol(key+1, 0, 16), false);}
-              //sysPrefs->forceCacheWrite();
-         } else if (!strcmp(key, "x1033")){
-                if (255==atol(value)){sysPrefs->setDeviceStatus(strtol(key+1, 0, 16), true);}
-                  else {sysPrefs->setDeviceStatus(strtol(key+1, 0, 16), false);}
-               //sysPrefs->forceCacheWrite();
-         } else if (!strcmp(key, "x1034")){
-                if (255==atol(value)){sysPrefs->setDeviceStatus(strtol(key+1, 0, 16), true);}
-                  else {sysPrefs->setDeviceStatus(strtol(key+1, 0, 16), false);}
-              // sysPrefs->forceCacheWrite();
-         } else if (!strcmp(key, "x1010")){
-                if (255==atol(value)){sysPrefs->setDeviceStatus(strtol(key+1, 0, 16), true);}
-                  else {sysPrefs->setDeviceStatus(strtol(key+1, 0, 16), false);}
-              // sysPrefs->forceCacheWrite();
-           } else if (!strcmp(key, "x1011")){
-                if (255==atol(value)){sysPrefs->setDeviceStatus(strtol(key+1, 0, 16), true);}
-                  else {sysPrefs->setDeviceStatus(strtol(key+1, 0, 16), false);}
-              //sysPrefs->forceCacheWrite();
-         } else if (!strcmp(key, "x1012")){
-                if (255==atol(value)){sysPrefs->setDeviceStatus(strtol(key+1, 0, 16), true);}
-                  else {sysPrefs->setDeviceStatus(strtol(key+1, 0, 16), false);}
-               //sysPrefs->forceCacheWrite();
-       } else if (!strcmp(key, "x1020")){
-                if (255==atol(value)){sysPrefs->setDeviceStatus(strtol(key+1, 0, 16), true);}
-                  else {sysPrefs->setDeviceStatus(strtol(key+1, 0, 16), false);}
-               sysPrefs->forceCacheWrite();
-        } else if (!strcmp(key, "x1040")){
-                if (255==atol(value)){sysPrefs->setDeviceStatus(strtol(key+1, 0, 16), true);}
-                  else {sysPrefs->setDeviceStatus(strtol(key+1, 0, 16), false);}
-             // sysPrefs->forceCacheWrite();
-        } else if (!strcmp(key, "x1050")){
-                if (255==atol(value)){sysPrefs->setDeviceStatus(strtol(key+1, 0, 16), true);}
-                  else {sysPrefs->setDeviceStatus(strtol(key+1, 0, 16), false);}
-              // sysPrefs->forceCacheWrite();
-        } else if (!strcmp(key, "x2000")){
-                if (255==atol(value)){sysPrefs->setDeviceStatus(strtol(key+1, 0, 16), true);}
-                  else {sysPrefs->setDeviceStatus(strtol(key+1, 0, 16), false);}
-               sysPrefs->forceCacheWrite();
-         } else if (!strcmp(key, "x4400")){
-                if (255==atol(value)){sysPrefs->setDeviceStatus(strtol(key+1, 0, 16), true);}
-                  else {sysPrefs->setDeviceStatus(strtol(key+1, 0, 16), false);}
-               // sysPrefs->forceCacheWrite();
-     sysPrefs->forceCacheWrite();
-        } else if (!strcmp(key, "x6000")){
-                if (255==atol(value)){sysPrefs->setDeviceStatus(strtol(key+1, 0, 16), true);}
-                  else {sysPrefs->setDeviceStatus(strtol(key+1, 0, 16), false);}
-             //   sysPrefs->forceCacheWrite();
-        } else if (!strcmp(key, "x650")){
-                if (255==atol(value)){sysPrefs->setDeviceStatus(strtol(key+1, 0, 16), true);}
-                  else {sysPrefs->setDeviceStatus(strtol(key+1, 0, 16), false);}
-                        // sysPrefs->forceCacheWrite();
-	
-	} else if (!strcmp(key, Constants::logLevel)) {
-		extern PrefHandler *sysPrefs;
-		uint8_t loglevel = atoi(value);
-		Logger::setLoglevel((Logger::LogLevel)loglevel);
-		sysPrefs->write(EESYS_LOG_LEVEL, loglevel);
+	if (key[0] == 'x') { // enable/disable a device, e.g. x1031="255"
+		sysPrefs->setDeviceStatus(strtol(key + 1, 0, 16), (atol(value) == 255));
+		sysPrefs->forceCacheWrite();
+		DeviceManager::getInstance()->invalidateIndex();
 	} else {
-		parameterFound = false;
+		switch (ParameterTable::set(ParameterTable::find(key), atol(value))) {
+		case PARAM_OK:
+			break;
+		case PARAM_OUT_OF_RANGE:
+			Logger::warn(ICHIP2128, "value out of range: %s=%s", key, value);
+			break;
+		default:
+			parameterFound = false;
+			break;
+		}
 	}
 	if (parameterFound) {
 		Logger::info(ICHIP2128, "parameter change: %s", key);
 		getNextParam(); // try to get another one immediately
+	} else {
+		sysPrefs->forceCacheWrite();
+		DeviceManager::getInstance()->updateWifi();
 	}
-        else {
-              sysPrefs->forceCacheWrite();
-              DeviceManager::getInstance()->updateWifi();
-            }
 }
 
 /*
@@ -949,7 +821,7 @@ void ICHIPWIFI::loadConfiguration() {
 	WifiConfiguration *config = (WifiConfiguration *)getConfiguration();
 
 	if (prefsHandler->checksumValid()) { //checksum is good, read in the values stored in EEPROM
-		Logger::debug(ICHIP2128, "Valid checksum so using stored wifi config values");
+		LOG_DEBUG(ICHIP2128, "Valid checksum so using stored wifi config values");
 		//TODO: implement processing of config params for WIFI
 //		prefsHandler->read(EESYS_WIFI0_SSID, &config->ssid);
 	}
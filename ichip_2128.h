@@ -84,12 +84,20 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "Sys_Messages.h"
 #include "DeviceTypes.h"
 #include "ELM327Processor.h"
+#include "EnergyMeter.h"
+#include "Telemetry.h"
+#include "SignalRegistry.h"
+#include "ParameterTable.h"
+#include "LoopHandler.h"
+#include "MessageBus.h"
 //#include "sys_io.h"
 
 
 extern PrefHandler *sysPrefs;
 
-enum ICHIP_COMM_STATE {IDLE, GET_PARAM, SET_PARAM, START_TCP_LISTENER, GET_ACTIVE_SOCKETS, POLL_SOCKET, SEND_SOCKET, GET_SOCKET};
+#define DASHBOARD_VALUES 9 // number of values bundled in the dashValues parameter
+
+enum ICHIP_COMM_STATE {IDLE, GET_PARAM, SET_PARAM, START_TCP_LISTENER, GET_ACTIVE_SOCKETS, POLL_SOCKET, SEND_SOCKET, GET_SOCKET, OPEN_TELEMETRY};
 
 /*
  * The extended configuration class with additional parameters for ichip WLAN
@@ -99,69 +107,32 @@ public:
 };
 
 /**
- * Cache of param values to avoid sending an update unless changed
+ * A slot of the command queue, the command is formatted directly into it
  */
-struct ParamCache {
-	uint32_t timeRunning;
-	int16_t torqueRequested;
-	int16_t torqueActual;
-	int16_t throttle;
-	int16_t brake;
-	bool brakeNotAvailable;
-	int16_t speedRequested;
-	int16_t speedActual;
-	MotorController::PowerMode powerMode;
-	int16_t dcVoltage;
-	int16_t dcCurrent;
-	int16_t acCurrent;
-	int16_t nominalVolt;
-	int16_t kiloWattHours;
-	uint32_t bitfield1;
-	uint32_t bitfield2;
-	uint32_t bitfield3;
-	uint32_t bitfield4;
-	bool running;
-	bool faulted;
-	bool warning;
-	MotorController::Gears gear;
-	int16_t tempMotor;
-	int16_t tempInverter;
-	int16_t tempSystem;
-	int16_t mechPower;
-    int16_t prechargeR;
-    int8_t prechargeRelay;
-    int8_t mainContactorRelay;
-    int8_t coolFan;
-    int8_t coolOn;
-    int8_t coolOff;
-    int8_t brakeLight;
-    int8_t revLight;
-    int8_t enableIn;
-    int8_t reverseIn;
-};
-
 struct SendBuff {
-	String cmd;
+	char cmd[CFG_WIFI_CMD_LENGTH];
 	ICHIP_COMM_STATE state; 
 };
 
-class ICHIPWIFI : public Device {
+class ICHIPWIFI : public Device, SignalObserver, LoopObserver, MessageObserver {
     public:
     
     ICHIPWIFI();
     ICHIPWIFI(USARTClass *which);
     void setup(); //initialization on start up
     void handleTick(); //periodic processes
-    void handleMessage(uint32_t messageType, void* message);
+    void handleSignal(uint8_t signal, int32_t value); //a subscribed status value changed
+    void handleBusMessage(const Message *message); //a message of the MessageBus was received
 	DeviceType getType();
     DeviceId getId();
-    void loop();
+    void handleLoop(); //process the replies of the ichip
     char *getTimeRunning();
 	
 
 	void loadConfiguration();
 	void saveConfiguration();
         void loadParameters();
+    void printStatistics();
        
 
     private:
@@ -169,34 +140,64 @@ class ICHIPWIFI : public Device {
     USARTClass* serialInterface; //Allows for retargetting which serial port we use
     char incomingBuffer[128]; //storage for one incoming line
     int ibWritePtr; //write position into above buffer
-	SendBuff sendingBuffer[64];
+	SendBuff sendingBuffer[CFG_WIFI_BUFFER_SIZE];
 	int psWritePtr;
 	int psReadPtr;
+	uint32_t droppedCommands; // commands lost because the queue was full or they were too long
 	int tickCounter;
 	int currReply;
 	char buffer[30]; // a buffer for various string conversions
-	ParamCache paramCache;
+	uint8_t dashboardSignals[DASHBOARD_VALUES]; // registry index of the values in the dashValues parameter
+	bool dashboardChanged; // one of the dashboard values changed since it was sent the last time
 	ICHIP_COMM_STATE state;
 	bool didParamLoad;
 	bool didTCPListener;
 	int listeningSocket;
 	int activeSockets[4]; //support for four sockets. Lowest byte is socket #, next byte is size of data waiting in that socket
+	Telemetry telemetry;
+	int telemetrySocket; // socket of the telemetry connection, -1 if not connected
+	uint32_t telemetryAddress; // IP address of the telemetry receiver, first octet in the lowest byte
+	uint16_t telemetryPort;
+	uint16_t telemetryInterval; // ms between two records
+	uint32_t lastTelemetryTime;
 	uint32_t lastSentTime;
-	String lastSentCmd;
+	uint32_t lastSentMicros; // time of the last transmission, to measure the round trip time
+	char lastSentCmd[CFG_WIFI_CMD_LENGTH]; // the command in flight (stop-and-wait, there's only one)
 	ICHIP_COMM_STATE lastSentState;
+	uint8_t retries; // how often the command in flight was repeated
+	uint8_t echoes; // how many transmissions of the command in flight were echoed so far
+	uint32_t replyTimeout; // ms to wait for the reply, doubled with every retry
+	bool staleReply; // the iChip echoed a command that already timed out, ignore its reply
+	char previousCmd[CFG_WIFI_CMD_LENGTH]; // the last finished command
+	ICHIP_COMM_STATE previousState;
+	uint8_t lateEchoes; // transmissions of previousCmd which may still be echoed and answered
+	uint32_t cmdsCompleted;
+	uint32_t cmdsRetried;
+	uint32_t cmdsFailed;
+	uint32_t rttMin, rttMax, rttAverage; // round trip time in microseconds
 
     void getNextParam(); //get next changed parameter
-    void getParamById(String paramName); //try to retrieve the value of the given parameter
-    void setParam(String paramName, String value); //set the given parameter with the given string
-    void setParam(String paramName, int32_t value);
-    void setParam(String paramName, int16_t value);
-    void setParam(String paramName, uint32_t value);
-    void setParam(String paramName, uint16_t value);
-    void setParam(String paramName, uint8_t value);
-    void setParam(String paramName, float value, int precision);
-    void sendCmd(String cmd);
-	void sendCmd(String cmd, ICHIP_COMM_STATE cmdstate);
-	void sendToSocket(int socket, String data);
+    void subscribeSignals(); //register for changes of the status values
+    void publishDashboard(); //send all dashboard values in one parameter
+    void getParamById(const char *paramName); //try to retrieve the value of the given parameter
+    void setParam(const char *paramName, const char *value); //set the given parameter with the given string
+    void setParam(const char *paramName, int32_t value);
+    void setParam(const char *paramName, int16_t value);
+    void setParam(const char *paramName, uint32_t value);
+    void setParam(const char *paramName, uint16_t value);
+    void setParam(const char *paramName, uint8_t value);
+    void setParam(const char *paramName, float value, int precision);
+    void sendCmd(const char *cmd);
+	void sendCmd(const char *cmd, ICHIP_COMM_STATE cmdstate);
+	void sendFormattedCmd(ICHIP_COMM_STATE cmdstate, const char *format, ...);
+	void sendNextCmd();
+	void transmitCmd(ICHIP_COMM_STATE cmdstate);
+	void completeCmd();
+	void finishCmd();
+	bool isEcho(const char *echo, const char *cmd, ICHIP_COMM_STATE cmdState);
+	void checkReplyTimeout();
+	void sendTelemetry();
+	void sendToSocket(int socket, const char *data);
     void processParameterChange(char *response);
 
     
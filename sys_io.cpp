@@ -31,6 +31,7 @@ by stimmer
 */ 
 
 #include "sys_io.h"
+#include "SignalRegistry.h"
 
 #undef HID_ENABLED
 
@@ -38,11 +39,51 @@ uint8_t dig[NUM_DIGITAL];
 uint8_t adc[NUM_ANALOG][2];
 uint8_t out[NUM_OUTPUT];
 
+/*
+Digital I/O is done at port level. The pin tables above are resolved once into PIO controller / bit mask pairs.
+Inputs are sampled with one PDSR read per port into a cached bitmask. Outputs are kept in a shadow register and
+all pending changes are applied with a single SODR and CODR write per port in sys_io_dio_poll().
+*/
+#define DIO_MAX_PORTS 4 //PIOA - PIOD
+
+typedef struct {
+  Pio *port;
+  uint32_t inputMask; //bits of this port used by digital inputs
+  uint32_t setMask; //output bits to drive high with the next flush
+  uint32_t clearMask; //output bits to drive low with the next flush
+} DIO_PORT;
+
+DIO_PORT dioPorts[DIO_MAX_PORTS];
+uint8_t numDioPorts;
+uint8_t digPort[NUM_DIGITAL], outPort[NUM_OUTPUT]; //index into dioPorts
+uint32_t digMask[NUM_DIGITAL], outMask[NUM_OUTPUT];
+uint8_t digState, digChanged, outShadow; //digState and digChanged hold the debounced input state
+
+/*
+Inputs are sampled every CFG_DIO_SAMPLE_INTERVAL. A change of the raw level is only accepted into digState once
+the input stayed at the new level for its debounce time. Accepted changes are reported as edge events.
+*/
+uint8_t digRaw; //raw input levels as of the last sample
+uint32_t digRawTime[NUM_DIGITAL]; //millis() when the raw level last changed
+uint16_t digDebounce[NUM_DIGITAL]; //debounce time in ms
+uint32_t lastDioSample;
+
+struct {
+  DigitalInputObserver *observer;
+  uint8_t mask;
+} dioObservers[CFG_DIO_NUM_OBSERVERS];
+
 volatile int bufn,obufn;
 volatile uint16_t adc_buf[NUM_ANALOG][256];   // 4 buffers of 256 readings
 uint16_t adc_values[NUM_ANALOG * 2];
 uint16_t adc_out_vals[NUM_ANALOG];
 
+volatile uint32_t adc_window_time; //micros() at the end of the last completed DMA window
+
+//seqlock protected copy of adc_out_vals. adc_seq is odd while the poller is writing
+ADC_SNAPSHOT adc_snapshot;
+volatile uint32_t adc_seq;
+
 
 
 int NumADCSamples;
@@ -57,6 +98,108 @@ ADC_COMP adc_comp[NUM_ANALOG];
 
 bool useRawADC = false;
 
+static const char *analogSignals[NUM_ANALOG] = { "analogIn0", "analogIn1", "analogIn2", "analogIn3" };
+
+/*
+Find (or add) the dioPorts entry for the PIO controller of an arduino pin and return its index
+*/
+uint8_t getDioPort(uint8_t pin) {
+	Pio *port = g_APinDescription[pin].pPort;
+
+	for (uint8_t i = 0; i < numDioPorts; i++)
+		if (dioPorts[i].port == port) return i;
+
+	dioPorts[numDioPorts].port = port;
+	dioPorts[numDioPorts].inputMask = 0;
+	dioPorts[numDioPorts].setMask = 0;
+	dioPorts[numDioPorts].clearMask = 0;
+	return numDioPorts++;
+}
+
+/*
+Resolve the dig[] and out[] pin tables to port / mask pairs and reset the cached state
+*/
+void setupDioPorts() {
+	numDioPorts = 0;
+	for (int i = 0; i < NUM_DIGITAL; i++) {
+		digPort[i] = getDioPort(dig[i]);
+		digMask[i] = g_APinDescription[dig[i]].ulPin;
+		dioPorts[digPort[i]].inputMask |= digMask[i];
+	}
+	for (int i = 0; i < NUM_OUTPUT; i++) {
+		if (out[i] == 255) continue;
+		outPort[i] = getDioPort(out[i]);
+		outMask[i] = g_APinDescription[out[i]].ulPin;
+	}
+	digState = 0;
+	digChanged = 0;
+	digRaw = 0;
+	outShadow = 0;
+	for (int i = 0; i < NUM_DIGITAL; i++) {
+		digRawTime[i] = 0;
+		digDebounce[i] = CFG_DIO_DEBOUNCE_TIME;
+	}
+}
+
+/*
+Sample all digital inputs with one read per port and return the raw levels. Inputs are active low.
+*/
+uint8_t readDigitalInputs() {
+	uint32_t portState[DIO_MAX_PORTS];
+	uint8_t state = 0;
+
+	for (uint8_t i = 0; i < numDioPorts; i++)
+		if (dioPorts[i].inputMask) portState[i] = dioPorts[i].port->PIO_PDSR;
+
+	for (int i = 0; i < NUM_DIGITAL; i++)
+		if (!(portState[digPort[i]] & digMask[i])) state |= (1 << i);
+
+	return state;
+}
+
+/*
+Sample the inputs, run the debounce filter and send edge events for every accepted change
+*/
+void sampleDigitalInputs() {
+	uint32_t now = millis();
+	uint8_t raw = readDigitalInputs();
+	uint8_t state = digState;
+
+	for (int i = 0; i < NUM_DIGITAL; i++) {
+		uint8_t bit = (1 << i);
+		if ((raw ^ digRaw) & bit) digRawTime[i] = now; //level changed, restart the stability timer
+		if (((raw ^ state) & bit) && (now - digRawTime[i]) >= digDebounce[i]) state ^= bit;
+	}
+	digRaw = raw;
+	digChanged = state ^ digState;
+	digState = state;
+
+	if (digChanged == 0) return;
+
+	for (int j = 0; j < CFG_DIO_NUM_OBSERVERS; j++) {
+		if (dioObservers[j].observer == NULL) continue;
+		uint8_t edges = digChanged & dioObservers[j].mask;
+		for (int i = 0; edges != 0; i++, edges >>= 1)
+			if (edges & 1) dioObservers[j].observer->handleDigitalEdge(i, (digState & (1 << i)) != 0);
+	}
+}
+
+/*
+Apply all pending output changes, one set and one clear register write per port
+*/
+void flushOutputs() {
+	for (uint8_t i = 0; i < numDioPorts; i++) {
+		if (dioPorts[i].setMask) {
+			dioPorts[i].port->PIO_SODR = dioPorts[i].setMask;
+			dioPorts[i].setMask = 0;
+		}
+		if (dioPorts[i].clearMask) {
+			dioPorts[i].port->PIO_CODR = dioPorts[i].clearMask;
+			dioPorts[i].clearMask = 0;
+		}
+	}
+}
+
 /*
 There have been problems where the digital outputs of GEVCU aren't set to digital outputs with low state early enough and for some
 people this triggers their connected relays. This code doesn't need EEPROM and so can execute very early in initialization. It assumes
@@ -140,6 +283,9 @@ void sys_early_setup() {
 		}
 	}
 
+	setupDioPorts();
+	digRaw = digState = readDigitalInputs(); //the levels present at start up are accepted without debounce
+	lastDioSample = micros();
 }
 
 /*
@@ -154,12 +300,26 @@ void setup_sys_io() {
   for (i = 0; i < NUM_ANALOG; i++) {
     sysPrefs->read(EESYS_ADC0_GAIN + 4*i, &adc_comp[i].gain);
     sysPrefs->read(EESYS_ADC0_OFFSET + 4*i, &adc_comp[i].offset);
-	//Logger::debug("ADC:%d GAIN: %d Offset: %d", i, adc_comp[i].gain, adc_comp[i].offset);
+	//LOG_DEBUG("ADC:%d GAIN: %d Offset: %d", i, adc_comp[i].gain, adc_comp[i].offset);
     for (int j = 0; j < NumADCSamples; j++) adc_buffer[i][j] = 0;
     adc_pointer[i] = 0;
     adc_values[i] = 0;
 	adc_out_vals[i] = 0;
+	adc_snapshot.values[i] = 0;
+  }
+  adc_snapshot.sequence = 0;
+  adc_snapshot.timestamp = 0;
+  adc_seq = 0;
+
+  for (i = 0; i < NUM_ANALOG; i++) {
+    SignalRegistry::getInstance()->publish(analogSignals[i], "", 0, &adc_out_vals[i]);
   }
+  SignalRegistry::getInstance()->publish(Constants::digitalInputs, "", 0, &digState);
+  SignalRegistry::getInstance()->publish(Constants::digitalOutputs, "", 0, &outShadow);
+
+  //both check for flags set during an interrupt, so they must run often
+  LoopHandler::getInstance()->attach(sys_io_adc_poll, LOOP_PRIORITY_HIGH, CFG_LOOP_BUDGET_IO, "ADC");
+  LoopHandler::getInstance()->attach(sys_io_dio_poll, LOOP_PRIORITY_HIGH, CFG_LOOP_BUDGET_IO, "DIO");
 }
 
 /*
@@ -252,28 +412,119 @@ uint16_t getAnalog(uint8_t which) {
 	return adc_out_vals[which];
 }
 
-//get value of one of the 4 digital inputs
+/*
+Copy all analog inputs, the window sequence number and its timestamp in one go. Readers never block the
+poller: if sys_io_adc_poll() publishes a new window while we copy (adc_seq odd or changed) we simply retry.
+*/
+void getAnalogSnapshot(ADC_SNAPSHOT *snapshot) {
+	uint32_t seq;
+
+	do {
+		seq = adc_seq;
+		__asm__ volatile ("" ::: "memory");
+		*snapshot = adc_snapshot;
+		__asm__ volatile ("" ::: "memory");
+	} while ((seq & 1) || seq != adc_seq);
+}
+
+//get value of one of the 4 digital inputs (as of the last sample, no hardware access)
 boolean getDigital(uint8_t which) {
 	if (which >= NUM_DIGITAL) which = 0;
-	return !(digitalRead(dig[which]));
+	return (digState & (1 << which)) != 0;
 }
 
-//set output high or not
+//get all digital inputs as bitmask, bit n set = input n active
+uint8_t getDigitalInputs() {
+	return digState;
+}
+
+//get the inputs which changed state with the last sample
+uint8_t getDigitalChanges() {
+	return digChanged;
+}
+
+//set the time in ms an input must be stable before a change of its level is accepted
+void setDigitalDebounce(uint8_t which, uint16_t time) {
+	if (which >= NUM_DIGITAL) return;
+	digDebounce[which] = time;
+}
+
+/*
+Register an observer for edge events of the inputs set in mask. Attaching an already registered
+observer again only updates its mask.
+*/
+void attachDigitalInput(DigitalInputObserver *observer, uint8_t mask) {
+	int freeSlot = -1;
+
+	for (int i = 0; i < CFG_DIO_NUM_OBSERVERS; i++) {
+		if (dioObservers[i].observer == observer) {
+			dioObservers[i].mask = mask;
+			return;
+		}
+		if (freeSlot == -1 && dioObservers[i].observer == NULL) freeSlot = i;
+	}
+	if (freeSlot == -1) {
+		Logger::error("no free digital input observer slot left");
+		return;
+	}
+	dioObservers[freeSlot].observer = observer;
+	dioObservers[freeSlot].mask = mask;
+}
+
+void detachDigitalInput(DigitalInputObserver *observer) {
+	for (int i = 0; i < CFG_DIO_NUM_OBSERVERS; i++) {
+		if (dioObservers[i].observer == observer) {
+			dioObservers[i].observer = NULL;
+			dioObservers[i].mask = 0;
+		}
+	}
+}
+
+/*
+Default implementation of the DigitalInputObserver method. Must be overwritten by every sub-class.
+*/
+void DigitalInputObserver::handleDigitalEdge(uint8_t which, boolean active) {
+	Logger::error("DigitalInputObserver does not implement handleDigitalEdge(), input=%d", which);
+}
+
+//set output high or not. The change is applied to the port with the next sys_io_dio_poll()
 void setOutput(uint8_t which, boolean active) {
 	if (which >= NUM_OUTPUT) return;
 	if (out[which] == 255) return;
-	if (active)
-		digitalWrite(out[which], HIGH);
-	else digitalWrite(out[which], LOW);
-   
-       
+	if (active) {
+		outShadow |= (1 << which);
+		dioPorts[outPort[which]].setMask |= outMask[which];
+		dioPorts[outPort[which]].clearMask &= ~outMask[which];
+	} else {
+		outShadow &= ~(1 << which);
+		dioPorts[outPort[which]].clearMask |= outMask[which];
+		dioPorts[outPort[which]].setMask &= ~outMask[which];
+	}
 }
 
 //get current value of output state (high?)
 boolean getOutput(uint8_t which) {
 	if (which >= NUM_OUTPUT) return false;
 	if (out[which] == 255) return false;
-	return digitalRead(out[which]);
+	return (outShadow & (1 << which)) != 0;
+}
+
+//get all outputs as bitmask, bit n set = output n high
+uint8_t getOutputs() {
+	return outShadow;
+}
+
+/*
+Sample the digital inputs (every CFG_DIO_SAMPLE_INTERVAL) and apply pending output changes. Called once per
+loop() so all outputs changed during one pass switch together.
+*/
+void sys_io_dio_poll() {
+	if ((micros() - lastDioSample) >= CFG_DIO_SAMPLE_INTERVAL) {
+		lastDioSample += CFG_DIO_SAMPLE_INTERVAL;
+		if ((micros() - lastDioSample) >= CFG_DIO_SAMPLE_INTERVAL) lastDioSample = micros(); //don't try to catch up after a stall
+		sampleDigitalInputs();
+	}
+	flushOutputs();
 }
 
 
@@ -292,6 +543,7 @@ void ADC_Handler(){     // move DMA pointers to next buffer
   int f=ADC->ADC_ISR;
   if (f & (1<<27)){ //receive counter end of buffer
    bufn=(bufn+1)&3;
+   adc_window_time = micros();
    ADC->ADC_RNPR=(uint32_t)adc_buf[bufn];
    ADC->ADC_RNCR=256;  
   } 
@@ -340,7 +592,7 @@ void setupFastADC(){
   ADC->ADC_PTCR=1; //enable dma mode
   ADC->ADC_CR=2; //start conversions
 
-  Logger::debug("Fast ADC Mode Enabled");
+  LOG_DEBUG("Fast ADC Mode Enabled");
 }
 
 //polls	for the end of an adc conversion event. Then processe buffer to extract the averaged
@@ -374,7 +626,7 @@ void sys_io_adc_poll() {
 			}
 		}
 
-		//for (int i = 0; i < 256;i++) Logger::debug("%i - %i", i, adc_buf[obufn][i]);
+		//for (int i = 0; i < 256;i++) LOG_DEBUG("%i - %i", i, adc_buf[obufn][i]);
 
 		//now, all of the ADC values are summed over 32/64 readings. So, divide by 32/64 (shift by 5/6) to get the average
 		//then add that to the old value we had stored and divide by two to average those. Lots of averaging going on.
@@ -388,7 +640,7 @@ void sys_io_adc_poll() {
 			for (int j = 0; j < 8; j++) {
 				adc_values[j] += (tempbuff[j] >> 5);
 				adc_values[j] = adc_values[j] >> 1;
-				//Logger::debug("A%i: %i", j, adc_values[j]);
+				//LOG_DEBUG("A%i: %i", j, adc_values[j]);
 			}
 		}
     
@@ -401,6 +653,15 @@ void sys_io_adc_poll() {
 			adc_out_vals[i] = val;
 		}
 
+		//publish the new window for getAnalogSnapshot()
+		adc_seq++;
+		__asm__ volatile ("" ::: "memory");
+		for (int i = 0; i < NUM_ANALOG; i++) adc_snapshot.values[i] = adc_out_vals[i];
+		adc_snapshot.sequence++;
+		adc_snapshot.timestamp = adc_window_time;
+		__asm__ volatile ("" ::: "memory");
+		adc_seq++;
+
 		obufn = bufn;    
 	}
 }
@@ -34,21 +34,49 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "config.h"
 #include "eeprom_layout.h"
 #include "PrefHandler.h"
+#include "LoopHandler.h"
 
 typedef struct {
   uint16_t offset;
   uint16_t gain;
 } ADC_COMP;
 
+/*
+ * A consistent view of all analog inputs taken from the same DMA window.
+ * sequence increments once per processed window, timestamp is micros() at
+ * the end of that window.
+ */
+typedef struct {
+  uint16_t values[NUM_ANALOG];
+  uint32_t sequence;
+  uint32_t timestamp;
+} ADC_SNAPSHOT;
+
+/*
+ * Interface for devices which want to be told about debounced edges of the digital inputs
+ */
+class DigitalInputObserver {
+public:
+	virtual void handleDigitalEdge(uint8_t which, boolean active);
+};
+
 void setup_sys_io();
 uint16_t getAnalog(uint8_t which); //get value of one of the 4 analog inputs
+void getAnalogSnapshot(ADC_SNAPSHOT *snapshot); //get all analog inputs from the same DMA window
 uint16_t getDiffADC(uint8_t which);
 uint16_t getRawADC(uint8_t which);
 boolean getDigital(uint8_t which); //get value of one of the 4 digital inputs
+uint8_t getDigitalInputs(); //bitmask of all digital inputs as of the last sample (bit set = active)
+uint8_t getDigitalChanges(); //bitmask of digital inputs which changed with the last sample
+void setDigitalDebounce(uint8_t which, uint16_t time); //time (ms) an input must be stable before a change is accepted
+void attachDigitalInput(DigitalInputObserver *observer, uint8_t mask); //get edge events for the inputs in mask
+void detachDigitalInput(DigitalInputObserver *observer);
 void setOutput(uint8_t which, boolean active); //set output high or not
 boolean getOutput(uint8_t which); //get current value of output state (high?)
+uint8_t getOutputs(); //bitmask of all outputs (shadow state)
 void setupFastADC();
 void sys_io_adc_poll();
+void sys_io_dio_poll();
 void sys_early_setup();
 void sys_boot_setup();
 
@@ -0,0 +1,162 @@
+/*
+ * dmocsim.cpp - Replays recorded DMOC645 command frames through the DmocSimulator on a PC.
+ *
+ * The input is a log of candump (can-utils, "candump -l can0"), only the command
+ * frames 0x232, 0x233 and 0x234 are used. The simulator is stepped with the time
+ * stamps of the recording. With every 0x232 frame (a new command cycle) the status
+ * frames of the simulated inverter are written to stdout in the same log format,
+ * or with -c the simulated values as CSV. The statistics are printed to stderr.
+ *
+ *   make -C util/dmocsim
+ *   util/dmocsim/dmocsim util/dmocsim/sample.log
+ *   util/dmocsim/dmocsim -c -v 3600 drive.log > drive.csv
+ *
+Copyright (c) 2013-14 Collin Kidder, Michael Neuweiler, Charles Galpin
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "DmocSimulator.h"
+
+#define DEFAULT_VOLTAGE 3300 // open circuit voltage of the pack in 0.1V
+
+static const char *stateNames[] = { "initializing", "disabled", "standby", "enabled", "powerdown", "fault" };
+
+/*
+ * Parse a line like "(1436509052.249713) can0 232#4E2000000001025A".
+ * Returns false if the line isn't a frame.
+ */
+static bool parseFrame(const char *line, uint64_t *time, DmocSimFrame *frame) {
+	unsigned long seconds, micros;
+	unsigned int id;
+	char interface[32], data[32];
+
+	if (sscanf(line, "(%lu.%lu) %31s %x#%31s", &seconds, &micros, interface, &id, data) != 5)
+		return false;
+	*time = (uint64_t) seconds * 1000000 + micros;
+	frame->id = id;
+	frame->length = strlen(data) / 2;
+	if (frame->length > 8)
+		return false;
+	memset(frame->data, 0, sizeof(frame->data));
+	for (int i = 0; i < frame->length; i++) {
+		unsigned int byte;
+		if (sscanf(&data[i * 2], "%2x", &byte) != 1)
+			return false;
+		frame->data[i] = byte;
+	}
+	return true;
+}
+
+static void printStatus(DmocSimulator *simulator, uint64_t time, bool csv) {
+	DmocSimFrame status[DMOC_SIM_STATUS_FRAMES];
+
+	if (csv) {
+		printf("%lu.%03lu,%s,%.1f,%d,%.1f,%.1f,%d\n", (unsigned long) (time / 1000000), (unsigned long) (time % 1000000 / 1000),
+				stateNames[simulator->getState()], simulator->getTorque() / 10.0, simulator->getSpeed(),
+				simulator->getVoltage() / 10.0, simulator->getCurrent() / 10.0, simulator->getTemperature());
+		return;
+	}
+
+	uint8_t count = simulator->getStatus(status);
+	for (int i = 0; i < count; i++) {
+		printf("(%lu.%06lu) dmoc %03X#", (unsigned long) (time / 1000000), (unsigned long) (time % 1000000),
+				(unsigned int) status[i].id);
+		for (int j = 0; j < status[i].length; j++)
+			printf("%02X", status[i].data[j]);
+		printf("\n");
+	}
+}
+
+static void usage() {
+	fprintf(stderr, "usage: dmocsim [-c] [-v voltage] [candump log]\n"
+			"  -c          write the simulated values as CSV instead of the status frames\n"
+			"  -v voltage  open circuit voltage of the pack in 0.1V (default %d)\n"
+			"  the log is read from stdin if no file is given\n", DEFAULT_VOLTAGE);
+	exit(2);
+}
+
+int main(int argc, char **argv) {
+	bool csv = false;
+	uint16_t voltage = DEFAULT_VOLTAGE;
+	FILE *input = stdin;
+	char line[256];
+	uint64_t time, lastTime = 0;
+	bool first = true;
+	int option;
+
+	while ((option = getopt(argc, argv, "cv:")) != -1) {
+		switch (option) {
+		case 'c':
+			csv = true;
+			break;
+		case 'v':
+			voltage = atoi(optarg);
+			break;
+		default:
+			usage();
+		}
+	}
+	if (optind < argc) {
+		input = fopen(argv[optind], "r");
+		if (input == NULL) {
+			perror(argv[optind]);
+			return 1;
+		}
+	}
+
+	DmocSimulator simulator(voltage);
+	if (csv)
+		printf("time,state,torque,speed,voltage,current,temperature\n");
+
+	while (fgets(line, sizeof(line), input)) {
+		DmocSimFrame frame;
+
+		if (!parseFrame(line, &time, &frame) || frame.id < 0x232 || frame.id > 0x234)
+			continue;
+		if (first) {
+			lastTime = time;
+			first = false;
+		}
+		if (time > lastTime) { // the recording may not be sorted exactly
+			uint64_t dt = time - lastTime;
+			for (; dt > 1000000; dt -= 1000000) // step() takes 32 bits of microseconds, pauses may be longer
+				simulator.step(1000000);
+			simulator.step(dt);
+			lastTime = time;
+		}
+		if (frame.id == 0x232)
+			printStatus(&simulator, lastTime, csv);
+		simulator.processFrame(&frame);
+	}
+
+	fprintf(stderr, "state %s, %lu frames, %lu rejected, max command interval %lums, %lu command timeouts\n",
+			stateNames[simulator.getState()], (unsigned long) simulator.getFramesReceived(),
+			(unsigned long) simulator.getFramesRejected(), (unsigned long) simulator.getMaxCommandInterval(),
+			(unsigned long) simulator.getCommandTimeouts());
+	if (input != stdin)
+		fclose(input);
+	return 0;
+}
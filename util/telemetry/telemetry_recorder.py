@@ -0,0 +1,153 @@
+#!/usr/bin/env python3
+"""
+Receiver for the GEVCU telemetry stream (see Telemetry.h).
+
+The GEVCU connects to this script via its wifi module once it was configured
+with TELEMETRY=<ip of this host>:<port> (and optionally TELRATE=<ms>) on the
+serial console. The decoded records are written to a CSV file and optionally
+printed to the console.
+
+  python3 telemetry_recorder.py --port 5000 --csv drive.csv --raw drive.raw --print
+
+A raw recording can be decoded again later:
+
+  python3 telemetry_recorder.py --decode drive.raw --csv drive.csv
+"""
+
+import argparse
+import base64
+import csv
+import socket
+import struct
+import sys
+
+VERSION = 1
+KEYFRAME = 0
+DELTA = 1
+
+# the signals of schema version 1, in the order of Telemetry::Signal
+SIGNALS = ["throttle", "brake", "torqueRequested", "torqueActual", "speedRequested", "speedActual",
+           "dcVoltage", "dcCurrent", "acCurrent", "tempMotor", "tempInverter", "mechPower",
+           "status", "bmsVoltage", "bmsCurrent", "io"]
+
+
+def to_int16(value):
+    value &= 0xFFFF
+    return value - 0x10000 if value & 0x8000 else value
+
+
+class Decoder:
+    # util/test/test_telemetry.cpp checks the encoder against a C++ copy of this class, keep the two in sync
+    def __init__(self):
+        self.values = None
+        self.time = 0
+        self.sequence = None
+        self.records = 0
+        self.lost = 0
+
+    def decode(self, line):
+        """Decode one base64 line, returns (time in ms, list of values) or None."""
+        try:
+            data = base64.b64decode(line.strip(), validate=True)
+        except ValueError:
+            return None
+        if len(data) < 2 or (data[0] >> 4) != VERSION:
+            return None
+
+        record_type = data[0] & 0x0F
+        sequence = data[1]
+        if self.sequence is not None and sequence != (self.sequence + 1) & 0xFF:
+            self.lost += (sequence - self.sequence - 1) & 0xFF
+            self.values = None  # wait for the next keyframe
+        self.sequence = sequence
+        self.records += 1
+
+        if record_type == KEYFRAME:
+            if len(data) != 6 + 2 * len(SIGNALS):
+                return None
+            self.time = struct.unpack_from("<I", data, 2)[0]
+            self.values = list(struct.unpack_from("<%dh" % len(SIGNALS), data, 6))
+        elif record_type == DELTA:
+            if self.values is None or len(data) < 5:
+                return None
+            self.time += data[2]
+            changed = data[3] | (data[4] << 8)
+            pos = 5
+            for i in range(len(SIGNALS)):
+                if changed & (1 << i):
+                    zigzag, shift = 0, 0
+                    while True:
+                        byte = data[pos]
+                        pos += 1
+                        zigzag |= (byte & 0x7F) << shift
+                        shift += 7
+                        if not byte & 0x80:
+                            break
+                    delta = (zigzag >> 1) ^ -(zigzag & 1)
+                    self.values[i] = to_int16(self.values[i] + delta)
+        else:
+            return None
+        return self.time, list(self.values)
+
+
+def lines_from_socket(port):
+    server = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+    server.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+    server.bind(("", port))
+    server.listen(1)
+    while True:
+        print("waiting for GEVCU on port %d" % port, file=sys.stderr)
+        connection, address = server.accept()
+        print("connected to %s:%d" % address, file=sys.stderr)
+        buffer = b""
+        with connection:
+            while True:
+                data = connection.recv(4096)
+                if not data:
+                    break
+                buffer += data
+                while b"\n" in buffer:
+                    line, buffer = buffer.split(b"\n", 1)
+                    yield line.decode("ascii", "ignore")
+        print("connection closed", file=sys.stderr)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Record and decode the GEVCU telemetry stream")
+    parser.add_argument("--port", type=int, default=5000, help="TCP port to listen on")
+    parser.add_argument("--decode", help="decode a raw recording instead of listening")
+    parser.add_argument("--csv", help="write the decoded values to this CSV file")
+    parser.add_argument("--raw", help="store the received lines in this file")
+    parser.add_argument("--print", action="store_true", help="print the decoded values")
+    args = parser.parse_args()
+
+    decoder = Decoder()
+    lines = open(args.decode) if args.decode else lines_from_socket(args.port)
+    raw = open(args.raw, "a") if args.raw else None
+    csv_file = open(args.csv, "w", newline="") if args.csv else None
+    writer = csv.writer(csv_file) if csv_file else None
+    if writer:
+        writer.writerow(["time"] + SIGNALS)
+
+    try:
+        for line in lines:
+            if raw:
+                raw.write(line.strip() + "\n")
+            result = decoder.decode(line)
+            if result is None:
+                continue
+            if writer:
+                writer.writerow([result[0]] + result[1])
+            if args.print:
+                print(result[0], " ".join("%s=%d" % item for item in zip(SIGNALS, result[1])))
+    except KeyboardInterrupt:
+        pass
+    finally:
+        for f in (raw, csv_file):
+            if f:
+                f.close()
+        print("%d records, %d lost" % (decoder.records, decoder.lost), file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
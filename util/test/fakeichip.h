@@ -0,0 +1,98 @@
+/*
+ * fakeichip.h
+ *
+ * A scripted fake of the iChip for the tests in util/test, it sits on the other
+ * end of the serial port the ICHIPWIFI driver writes to.
+ *
+Copyright (c) 2013-14 Collin Kidder, Michael Neuweiler, Charles Galpin
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+ */
+
+#ifndef FAKEICHIP_H_
+#define FAKEICHIP_H_
+
+#include <Arduino.h>
+
+/*
+ * The module on the other side of the serial port. It parses what the driver writes
+ * ("AT+i<command>\r", SSND data is taken by its length as it may contain CR/LF)
+ * and lets the test decide how to answer: echo the command, reply or keep silent.
+ */
+class FakeIChip {
+public:
+	USARTClass *port;
+
+	FakeIChip(USARTClass *port) {
+		this->port = port;
+	}
+
+	/*
+	 * Take the next complete command the driver sent (without the AT+i and the CR)
+	 */
+	bool receive(std::string &command) {
+		std::string &output = port->output;
+		size_t start = output.find("AT+i");
+
+		if (start == std::string::npos)
+			return false;
+		size_t end = output.find('\r', start);
+		if (output.compare(start + 4, 7, "SSND%%:") == 0) {
+			size_t colon = output.find(':', output.find(',', start));
+			if (colon == std::string::npos)
+				return false;
+			end = colon + 1 + atoi(output.c_str() + output.find(',', start) + 1);
+		}
+		if (end == std::string::npos || end >= output.length() || output[end] != '\r')
+			return false;
+		command = output.substr(start + 4, end - start - 4);
+		output.erase(0, end + 1);
+		return true;
+	}
+
+	/*
+	 * Number of commands waiting for the fake
+	 */
+	int pending() {
+		std::string saved = port->output, command;
+		int count = 0;
+
+		while (receive(command))
+			count++;
+		port->output = saved;
+		return count;
+	}
+
+	void echo(const std::string &command) {
+		port->input += "AT+i" + command + "\r\n";
+	}
+
+	void reply(const std::string &text) {
+		port->input += text + "\r\n";
+	}
+
+	void answer(const std::string &command, const std::string &text) {
+		echo(command);
+		reply(text);
+	}
+};
+
+#endif /* FAKEICHIP_H_ */
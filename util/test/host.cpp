@@ -0,0 +1,450 @@
+/*
+ * host.cpp
+ *
+ * Implementation of the Arduino core, the hardware libraries and sys_io for the
+ * tests in util/test, plus the globals which GEVCU.ino defines on the target.
+ *
+Copyright (c) 2013-14 Collin Kidder, Michael Neuweiler, Charles Galpin
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+ */
+
+#include "host.h"
+#include "GEVCU.h"
+
+/*
+ * The globals of GEVCU.ino
+ */
+CanHandler *canHandlerEV;
+CanHandler *canHandlerCar;
+TickHandler *tickHandler;
+PrefHandler *sysPrefs;
+MemCache *memCache;
+Heartbeat *heartbeat;
+SerialConsole *serialConsole;
+LoopHandler *loopHandler;
+bool runThrottle = false;
+
+/*
+ * The tests set up what they need themselves, so there's nothing to do when the
+ * serial console asks for a restart.
+ */
+void setup() {
+}
+
+void loop() {
+	LoopHandler::getInstance()->process();
+}
+
+void hostSetupPrefs() {
+	memCache = new MemCache();
+	memCache->setup();
+	sysPrefs = new PrefHandler(SYSTEM);
+}
+
+/*
+ * Time
+ */
+static uint64_t hostTime = 0; // simulated time in microseconds since start-up
+
+void hostAdvance(uint32_t microseconds) {
+	hostTime += microseconds;
+}
+
+void hostSetTime(uint32_t microseconds) {
+	hostTime = microseconds;
+}
+
+uint32_t millis() {
+	return (uint32_t) (hostTime / 1000);
+}
+
+uint32_t micros() {
+	return (uint32_t) hostTime;
+}
+
+void delay(uint32_t ms) {
+	hostTime += (uint64_t) ms * 1000;
+}
+
+void delayMicroseconds(uint32_t us) {
+	hostTime += us;
+}
+
+long map(long x, long inMin, long inMax, long outMin, long outMax) {
+	return (x - inMin) * (outMax - outMin) / (inMax - inMin) + outMin;
+}
+
+void pinMode(uint32_t pin, uint32_t mode) {
+}
+
+void digitalWrite(uint32_t pin, uint32_t value) {
+}
+
+int digitalRead(uint32_t pin) {
+	return LOW;
+}
+
+uint32_t analogRead(uint32_t pin) {
+	return 0;
+}
+
+void analogWrite(uint32_t pin, uint32_t value) {
+}
+
+/*
+ * String
+ */
+static std::string toString(unsigned long value, unsigned char base, bool negative) {
+	char digits[sizeof(unsigned long) * 8 + 2];
+	char *p = &digits[sizeof(digits) - 1];
+
+	*p = 0;
+	do {
+		unsigned long digit = value % base;
+		*--p = (char) (digit < 10 ? '0' + digit : 'A' + digit - 10);
+		value /= base;
+	} while (value);
+	if (negative)
+		*--p = '-';
+	return p;
+}
+
+/*
+ * The String of the Arduino core always keeps its text on the heap, std::string
+ * stores short ones within the object. Reserving more than fits in there makes
+ * every String allocate, so the tests see the heap use of the target.
+ */
+void String::allocate() {
+	value.reserve(sizeof(std::string) + value.length());
+}
+
+String::String(const char *cstr) : value(cstr ? cstr : "") {
+	allocate();
+}
+
+String::String(char c) : value(1, c) {
+	allocate();
+}
+
+String::String(int value, unsigned char base) :
+		value(base == DEC && value < 0 ? toString(-(long) value, base, true) : toString((unsigned int) value, base, false)) {
+	allocate();
+}
+
+String::String(unsigned int value, unsigned char base) : value(toString(value, base, false)) {
+	allocate();
+}
+
+String::String(long value, unsigned char base) :
+		value(base == DEC && value < 0 ? toString(-value, base, true) : toString((unsigned long) value, base, false)) {
+	allocate();
+}
+
+String::String(unsigned long value, unsigned char base) : value(toString(value, base, false)) {
+	allocate();
+}
+
+String::String(const String &s) : value(s.value) {
+	allocate();
+}
+
+String &String::operator=(const String &rhs) {
+	value = rhs.value;
+	allocate();
+	return *this;
+}
+
+unsigned char String::concat(const String &s) {
+	value += s.value;
+	return 1;
+}
+
+unsigned char String::concat(const char *cstr) {
+	if (cstr == NULL)
+		return 0;
+	value += cstr;
+	return 1;
+}
+
+unsigned char String::concat(char c) {
+	value += c;
+	return 1;
+}
+
+String operator+(const String &lhs, const String &rhs) {
+	String result(lhs);
+	result.concat(rhs);
+	return result;
+}
+
+void String::toCharArray(char *buffer, unsigned int size) const {
+	if (size == 0)
+		return;
+	strncpy(buffer, value.c_str(), size - 1);
+	buffer[size - 1] = 0;
+}
+
+void String::toUpperCase() {
+	for (size_t i = 0; i < value.length(); i++)
+		value[i] = toupper(value[i]);
+}
+
+void String::toLowerCase() {
+	for (size_t i = 0; i < value.length(); i++)
+		value[i] = tolower(value[i]);
+}
+
+/*
+ * Print, formats like the Arduino core does
+ */
+size_t Print::write(const uint8_t *buffer, size_t size) {
+	size_t n = 0;
+
+	while (size--)
+		n += write(*buffer++);
+	return n;
+}
+
+size_t Print::print(long value, int base) {
+	if (base == DEC && value < 0)
+		return write(toString(-value, base, true).c_str());
+	return print((unsigned long) value, base);
+}
+
+size_t Print::print(unsigned long value, int base) {
+	return write(toString(value, base, false).c_str());
+}
+
+size_t Print::print(double value, int digits) {
+	char buffer[64];
+
+	if (isnan(value))
+		return write("nan");
+	if (isinf(value))
+		return write("inf");
+	snprintf(buffer, sizeof(buffer), "%.*f", digits, value);
+	return write(buffer);
+}
+
+/*
+ * Serial ports
+ */
+USARTClass Serial, Serial1, Serial2, Serial3, SerialUSB;
+
+int USARTClass::available() {
+	return input.length() - inputPosition;
+}
+
+int USARTClass::read() {
+	if (inputPosition >= input.length())
+		return -1;
+	return (uint8_t) input[inputPosition++];
+}
+
+int USARTClass::peek() {
+	if (inputPosition >= input.length())
+		return -1;
+	return (uint8_t) input[inputPosition];
+}
+
+size_t USARTClass::write(uint8_t c) {
+	output += (char) c;
+	return 1;
+}
+
+/*
+ * CAN, timers and I2C
+ */
+CANRaw CAN, CAN2;
+DueTimer Timer0, Timer1, Timer2, Timer3, Timer4, Timer5, Timer6, Timer7, Timer8;
+TwoWire Wire;
+
+TwoWire::TwoWire() : pageWrites(0), length(0), device(0), address(0), remaining(0) {
+	memset(eeprom, 0xff, sizeof(eeprom)); // like an erased chip
+}
+
+void TwoWire::beginTransmission(uint8_t address) {
+	device = address;
+	length = 0;
+}
+
+size_t TwoWire::write(uint8_t data) {
+	return write(&data, 1);
+}
+
+size_t TwoWire::write(const uint8_t *data, size_t quantity) {
+	if (quantity > sizeof(buffer) - length)
+		quantity = sizeof(buffer) - length;
+	memcpy(&buffer[length], data, quantity);
+	length += quantity;
+	return quantity;
+}
+
+/*
+ * The first two bytes of a transmission are the address within the 64k block
+ * selected by the i2c id, the rest is data to be stored.
+ */
+uint8_t TwoWire::endTransmission(uint8_t sendStop) {
+	if (length < 2)
+		return 2; // address not acknowledged
+	address = ((device & 0x03) << 16) | (buffer[0] << 8) | buffer[1];
+	if (length > 2)
+		pageWrites++;
+	for (size_t i = 2; i < length; i++)
+		eeprom[(address + i - 2) % HOST_EEPROM_SIZE] = buffer[i];
+	return 0;
+}
+
+uint8_t TwoWire::requestFrom(int address, int quantity) {
+	remaining = quantity;
+	return quantity;
+}
+
+int TwoWire::available() {
+	return remaining;
+}
+
+int TwoWire::read() {
+	if (remaining <= 0)
+		return -1;
+	remaining--;
+	return eeprom[address++ % HOST_EEPROM_SIZE];
+}
+
+/*
+ * sys_io
+ */
+uint16_t hostAnalogInputs[NUM_ANALOG];
+uint8_t hostDigitalInputs = 0;
+uint8_t hostOutputs = 0;
+
+static uint8_t lastDigitalInputs = 0;
+static uint8_t digitalChanges = 0;
+static struct {
+	DigitalInputObserver *observer;
+	uint8_t mask;
+} dioObservers[CFG_DIO_NUM_OBSERVERS];
+static uint32_t adcSequence = 0;
+
+void sys_boot_setup() {
+}
+
+void sys_early_setup() {
+}
+
+void setup_sys_io() {
+}
+
+void setupFastADC() {
+}
+
+uint16_t getAnalog(uint8_t which) {
+	return (which < NUM_ANALOG ? hostAnalogInputs[which] : 0);
+}
+
+void getAnalogSnapshot(ADC_SNAPSHOT *snapshot) {
+	for (int i = 0; i < NUM_ANALOG; i++)
+		snapshot->values[i] = hostAnalogInputs[i];
+	snapshot->sequence = adcSequence;
+	snapshot->timestamp = micros();
+}
+
+uint16_t getDiffADC(uint8_t which) {
+	return getAnalog(which);
+}
+
+uint16_t getRawADC(uint8_t which) {
+	return getAnalog(which);
+}
+
+void sys_io_adc_poll() {
+	adcSequence++;
+}
+
+boolean getDigital(uint8_t which) {
+	return (which < NUM_DIGITAL && (hostDigitalInputs & (1 << which)) != 0);
+}
+
+uint8_t getDigitalInputs() {
+	return lastDigitalInputs;
+}
+
+uint8_t getDigitalChanges() {
+	return digitalChanges;
+}
+
+void setDigitalDebounce(uint8_t which, uint16_t time) {
+}
+
+void attachDigitalInput(DigitalInputObserver *observer, uint8_t mask) {
+	for (int i = 0; i < CFG_DIO_NUM_OBSERVERS; i++) {
+		if (dioObservers[i].observer == NULL || dioObservers[i].observer == observer) {
+			dioObservers[i].observer = observer;
+			dioObservers[i].mask = mask;
+			return;
+		}
+	}
+}
+
+void detachDigitalInput(DigitalInputObserver *observer) {
+	for (int i = 0; i < CFG_DIO_NUM_OBSERVERS; i++) {
+		if (dioObservers[i].observer == observer)
+			dioObservers[i].observer = NULL;
+	}
+}
+
+void DigitalInputObserver::handleDigitalEdge(uint8_t which, boolean active) {
+}
+
+/*
+ * Take over hostDigitalInputs (without debouncing) and report the edges
+ */
+void sys_io_dio_poll() {
+	digitalChanges = hostDigitalInputs ^ lastDigitalInputs;
+	lastDigitalInputs = hostDigitalInputs;
+
+	for (int i = 0; i < NUM_DIGITAL; i++) {
+		if (!(digitalChanges & (1 << i)))
+			continue;
+		for (int j = 0; j < CFG_DIO_NUM_OBSERVERS; j++) {
+			if (dioObservers[j].observer && (dioObservers[j].mask & (1 << i)))
+				dioObservers[j].observer->handleDigitalEdge(i, (lastDigitalInputs & (1 << i)) != 0);
+		}
+	}
+}
+
+void setOutput(uint8_t which, boolean active) {
+	if (which >= NUM_OUTPUT)
+		return;
+	if (active)
+		hostOutputs |= (1 << which);
+	else
+		hostOutputs &= ~(1 << which);
+}
+
+boolean getOutput(uint8_t which) {
+	return (which < NUM_OUTPUT && (hostOutputs & (1 << which)) != 0);
+}
+
+uint8_t getOutputs() {
+	return hostOutputs;
+}
@@ -0,0 +1,51 @@
+/*
+ * host.h
+ *
+ * Host side of the Arduino core and of the GEVCU hardware for the tests in util/test.
+ *
+ * Nothing happens by itself on the host: the simulated time only advances
+ * with hostAdvance() (or a delay() of the firmware), the inputs are set via
+ * the variables below and the serial ports, CAN buses and timers are the
+ * stubs in util/test/stub.
+ *
+Copyright (c) 2013-14 Collin Kidder, Michael Neuweiler, Charles Galpin
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+ */
+
+#ifndef HOST_H_
+#define HOST_H_
+
+#include <Arduino.h>
+#include <due_can.h>
+#include <due_wire.h>
+#include <DueTimer.h>
+#include "config.h"
+
+void hostAdvance(uint32_t microseconds); // let the simulated time pass
+void hostSetTime(uint32_t microseconds); // jump to an absolute time (e.g. to test the wrap-around)
+void hostSetupPrefs(); // create memCache and sysPrefs like setup() of GEVCU.ino does (on an erased EEPROM)
+
+extern uint16_t hostAnalogInputs[NUM_ANALOG]; // returned by getAnalog(), getRawADC(), ...
+extern uint8_t hostDigitalInputs; // bitmask returned by getDigitalInputs(), bit set = active
+extern uint8_t hostOutputs; // bitmask of the outputs set via setOutput()
+
+#endif /* HOST_H_ */
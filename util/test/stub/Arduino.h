@@ -0,0 +1,188 @@
+/*
+ * Arduino.h - Host replacement of the Arduino Due core for the tests in util/test.
+ *
+ * Provides just enough of the Arduino API to compile the firmware sources with
+ * a regular gcc on Linux. The time (millis(), micros()) is simulated and only
+ * advances when a test tells it to, the serial ports are memory buffers (see host.h).
+ *
+Copyright (c) 2013-14 Collin Kidder, Michael Neuweiler, Charles Galpin
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+ */
+
+#ifndef ARDUINO_H_
+#define ARDUINO_H_
+
+// the C++ library must be included before min() and max() are defined as macros
+#include <string>
+#include <deque>
+#include <vector>
+#include <algorithm>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <math.h>
+
+typedef uint8_t byte;
+typedef bool boolean;
+typedef uint8_t U8;
+typedef int16_t S16;
+typedef uint16_t U16;
+typedef int32_t S32;
+typedef uint32_t U32;
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+
+#define DEC 10
+#define HEX 16
+#define OCT 8
+#define BIN 2
+
+#define min(a,b) ((a)<(b)?(a):(b))
+#define max(a,b) ((a)>(b)?(a):(b))
+#define constrain(amt,low,high) ((amt)<(low)?(low):((amt)>(high)?(high):(amt)))
+#define lowByte(w) ((uint8_t) ((w) & 0xff))
+#define highByte(w) ((uint8_t) ((w) >> 8))
+#define word(h, l) ((uint16_t) (((h) << 8) | (l)))
+
+extern "C" {
+void setup();
+void loop();
+}
+
+long map(long x, long inMin, long inMax, long outMin, long outMax);
+
+uint32_t millis();
+uint32_t micros();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+
+void pinMode(uint32_t pin, uint32_t mode);
+void digitalWrite(uint32_t pin, uint32_t value);
+int digitalRead(uint32_t pin);
+uint32_t analogRead(uint32_t pin);
+void analogWrite(uint32_t pin, uint32_t value);
+
+inline void noInterrupts() {}
+inline void interrupts() {}
+
+// the exclusive load/store of the Cortex-M3, there is no concurrency on the host
+inline uint32_t __LDREXW(volatile uint32_t *address) { return *address; }
+inline uint32_t __STREXW(uint32_t value, volatile uint32_t *address) { *address = value; return 0; }
+inline void __CLREX() {}
+
+class String {
+public:
+	String(const char *cstr = "");
+	String(char c);
+	String(int value, unsigned char base = DEC);
+	String(unsigned int value, unsigned char base = DEC);
+	String(long value, unsigned char base = DEC);
+	String(unsigned long value, unsigned char base = DEC);
+	String(const String &s);
+	String &operator=(const String &rhs);
+	unsigned char concat(const String &s);
+	unsigned char concat(const char *cstr);
+	unsigned char concat(char c);
+	String &operator+=(const String &s) { concat(s); return *this; }
+	String &operator+=(const char *cstr) { concat(cstr); return *this; }
+	String &operator+=(char c) { concat(c); return *this; }
+	friend String operator+(const String &lhs, const String &rhs);
+	unsigned char operator==(const String &rhs) const { return value == rhs.value; }
+	unsigned char operator==(const char *cstr) const { return value == cstr; }
+	char operator[](unsigned int index) const { return index < value.length() ? value[index] : 0; }
+	unsigned int length() const { return value.length(); }
+	const char *c_str() const { return value.c_str(); }
+	void toCharArray(char *buffer, unsigned int size) const;
+	void toUpperCase();
+	void toLowerCase();
+
+private:
+	std::string value;
+
+	void allocate();
+};
+
+class Print {
+public:
+	virtual ~Print() {}
+	virtual size_t write(uint8_t) = 0;
+	virtual size_t write(const uint8_t *buffer, size_t size);
+	size_t write(const char *str) { return write((const uint8_t *) str, strlen(str)); }
+
+	size_t print(const char *str) { return write(str); }
+	size_t print(const String &str) { return write(str.c_str()); }
+	size_t print(char c) { return write((uint8_t) c); }
+	size_t print(unsigned char value, int base = DEC) { return print((unsigned long) value, base); }
+	size_t print(int value, int base = DEC) { return print((long) value, base); }
+	size_t print(unsigned int value, int base = DEC) { return print((unsigned long) value, base); }
+	size_t print(long value, int base = DEC);
+	size_t print(unsigned long value, int base = DEC);
+	size_t print(double value, int digits = 2);
+
+	size_t println() { return write("\r\n"); }
+	template<class T> size_t println(T value) { size_t n = print(value); return n + println(); }
+	template<class T> size_t println(T value, int format) { size_t n = print(value, format); return n + println(); }
+};
+
+class Stream: public Print {
+public:
+	virtual int available() = 0;
+	virtual int read() = 0;
+	virtual int peek() = 0;
+	virtual void flush() {}
+};
+
+/*
+ * A serial port: Everything written is appended to output, read() takes the characters
+ * from input which the test fills in (see host.h).
+ */
+class USARTClass: public Stream {
+public:
+	void begin(uint32_t baudRate) {}
+	void end() {}
+	int available();
+	int read();
+	int peek();
+	size_t write(uint8_t c);
+	using Print::write;
+
+	std::string input;
+	std::string output;
+	size_t inputPosition;
+
+	USARTClass() : inputPosition(0) {}
+};
+
+typedef USARTClass UARTClass;
+
+extern USARTClass Serial, Serial1, Serial2, Serial3, SerialUSB;
+
+#endif /* ARDUINO_H_ */
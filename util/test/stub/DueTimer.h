@@ -0,0 +1,55 @@
+/*
+ * DueTimer.h - Host replacement of the DueTimer library for the tests in util/test.
+ *
+ * The timers never fire by themselves, a test calls the attached
+ * interrupt function via fire() when it wants a tick to happen.
+ *
+Copyright (c) 2013-14 Collin Kidder, Michael Neuweiler, Charles Galpin
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+ */
+
+#ifndef DUETIMER_H_
+#define DUETIMER_H_
+
+#include <Arduino.h>
+
+class DueTimer {
+public:
+	DueTimer() : callback(NULL), period(0), running(false) {}
+	DueTimer &attachInterrupt(void (*isr)()) { callback = isr; return *this; }
+	DueTimer &detachInterrupt() { callback = NULL; return *this; }
+	DueTimer &start(long microseconds = -1) { running = true; return *this; }
+	DueTimer &stop() { running = false; return *this; }
+	DueTimer &setPeriod(long microseconds) { period = microseconds; return *this; }
+	DueTimer &setFrequency(double frequency) { period = (long) (1000000 / frequency); return *this; }
+	long getPeriod() { return period; }
+	void fire() { if (running && callback) callback(); }
+
+private:
+	void (*callback)();
+	long period;
+	bool running;
+};
+
+extern DueTimer Timer0, Timer1, Timer2, Timer3, Timer4, Timer5, Timer6, Timer7, Timer8;
+
+#endif /* DUETIMER_H_ */
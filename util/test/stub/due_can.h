@@ -0,0 +1,76 @@
+/*
+ * due_can.h - Host replacement of the due_can library for the tests in util/test.
+ *
+ * Received frames are taken from a queue which the test fills in, sent frames
+ * are recorded so the test can inspect them.
+ *
+Copyright (c) 2013-14 Collin Kidder, Michael Neuweiler, Charles Galpin
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+ */
+
+#ifndef DUE_CAN_H_
+#define DUE_CAN_H_
+
+#include <Arduino.h>
+#include <deque>
+
+#define CAN_BPS_1000K 1000000
+#define CAN_BPS_500K 500000
+#define CAN_BPS_250K 250000
+#define CAN_BPS_125K 125000
+
+typedef union {
+	uint64_t value;
+	uint8_t bytes[8];
+	uint8_t byte[8];
+} BytesUnion;
+
+typedef struct {
+	uint32_t id;
+	uint32_t fid;
+	uint8_t rtr;
+	uint8_t priority;
+	uint8_t extended;
+	uint8_t length;
+	BytesUnion data;
+} CAN_FRAME;
+
+class CANRaw {
+public:
+	CANRaw() : mailboxes(0) {}
+	uint32_t begin(uint32_t baudRate, uint8_t enablePin) { return 1; }
+	int findFreeRXMailbox() { return (mailboxes < 7 ? mailboxes++ : -1); }
+	int setRXFilter(uint8_t mailbox, uint32_t id, uint32_t mask, bool extended) { return mailbox; }
+	bool rx_avail() { return !received.empty(); }
+	uint32_t get_rx_buff(CAN_FRAME &frame) { frame = received.front(); received.pop_front(); return 1; }
+	bool sendFrame(CAN_FRAME &frame) { sent.push_back(frame); return true; }
+
+	std::deque<CAN_FRAME> received; // frames which the test wants to be received
+	std::deque<CAN_FRAME> sent; // frames which were sent by the firmware
+
+private:
+	int mailboxes;
+};
+
+extern CANRaw CAN, CAN2;
+
+#endif /* DUE_CAN_H_ */
@@ -0,0 +1,65 @@
+/*
+ * due_wire.h - Host replacement of the Wire (I2C) library for the tests in util/test.
+ *
+ * Simulates the EEPROM which MemCache talks to: a write
+ * transmission starts with the two address bytes followed by the data,
+ * a read is an address-only write followed by requestFrom().
+ *
+Copyright (c) 2013-14 Collin Kidder, Michael Neuweiler, Charles Galpin
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+ */
+
+#ifndef DUE_WIRE_H_
+#define DUE_WIRE_H_
+
+#include <Arduino.h>
+
+#define HOST_EEPROM_SIZE 0x40000 // four 64k blocks selected by the two lowest bits of the i2c id
+
+class TwoWire {
+public:
+	TwoWire();
+	void begin() {}
+	void setClock(uint32_t frequency) {}
+	void beginTransmission(uint8_t address);
+	void beginTransmission(int address) { beginTransmission((uint8_t) address); }
+	size_t write(uint8_t data);
+	size_t write(const uint8_t *data, size_t quantity);
+	uint8_t endTransmission(uint8_t sendStop = true);
+	uint8_t requestFrom(int address, int quantity);
+	int available();
+	int read();
+
+	uint8_t eeprom[HOST_EEPROM_SIZE];
+	uint32_t pageWrites; // number of transmissions which stored data (MemCache writes a page per transmission)
+
+private:
+	uint8_t buffer[260];
+	size_t length;
+	uint8_t device;
+	uint32_t address;
+	int remaining;
+};
+
+extern TwoWire Wire;
+
+#endif /* DUE_WIRE_H_ */
@@ -0,0 +1,69 @@
+/*
+ * test.h
+ *
+ * Minimal checks for the host tests in util/test. Every test is a program of its
+ * own (so it starts with fresh singletons) which returns testResult() from main().
+ *
+Copyright (c) 2013-14 Collin Kidder, Michael Neuweiler, Charles Galpin
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+ */
+
+#ifndef TEST_H_
+#define TEST_H_
+
+#include <stdio.h>
+#include <string.h>
+
+static int testChecks = 0;
+static int testFailures = 0;
+
+#define CHECK(condition) testCheck((condition), #condition, __FILE__, __LINE__)
+#define CHECK_EQUAL(expected, actual) testCheckEqual((long) (expected), (long) (actual), #actual, __FILE__, __LINE__)
+#define CHECK_CONTAINS(text, part) testCheck(strstr((text), (part)) != NULL, "\"" part "\" in " #text, __FILE__, __LINE__)
+
+static bool testCheck(bool condition, const char *expression, const char *file, int line) {
+	testChecks++;
+	if (!condition) {
+		testFailures++;
+		printf("%s:%d: check failed: %s\n", file, line, expression);
+	}
+	return condition;
+}
+
+static bool testCheckEqual(long expected, long actual, const char *expression, const char *file, int line) {
+	testChecks++;
+	if (expected != actual) {
+		testFailures++;
+		printf("%s:%d: check failed: %s is %ld, expected %ld\n", file, line, expression, actual, expected);
+	}
+	return expected == actual;
+}
+
+/*
+ * Print the summary, returns the exit code of the test program
+ */
+static int testResult(const char *name) {
+	printf("%s: %d checks, %d failed\n", name, testChecks, testFailures);
+	return (testFailures ? 1 : 0);
+}
+
+#endif /* TEST_H_ */
@@ -0,0 +1,183 @@
+/*
+ * test_crc.cpp
+ *
+ * The check bytes of the motor controller command frames are not calculated the
+ * straight way any more: the Coda security CRC uses two lookup tables instead of
+ * looping over the bits of the torque value and the DMOC checksum is updated with
+ * the difference of each changed byte. Both have to give the same result as the
+ * original calculation for every input.
+ *
+Copyright (c) 2013-14 Collin Kidder, Michael Neuweiler, Charles Galpin
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+ */
+
+#include "host.h"
+#include "test.h"
+#include "CodaMotorController.h"
+#include "DmocMotorController.h"
+
+#define STEP 10000 // the main loop passes every 10ms
+
+/*
+ * Access to the check byte calculations of the drivers. Like all devices they
+ * register with the DeviceManager, so they must never be deleted.
+ */
+class CrcCoda: public CodaMotorController {
+public:
+	uint8_t crc(uint8_t cmd, uint8_t torqueLsb, uint8_t torqueMsb) {
+		return genCodaCRC(cmd, torqueLsb, torqueMsb);
+	}
+};
+
+class ChecksumDmoc: public DmocMotorController {
+public:
+	int16_t pedal;
+
+	ChecksumDmoc() {
+		pedal = 0;
+		prefsHandler = new PrefHandler(DMOC645);
+	}
+
+	void handleTick() {
+		throttleRequested = pedal;
+		DmocMotorController::handleTick();
+	}
+
+	uint8_t checksum(CAN_FRAME &frame) {
+		return calcChecksum(frame);
+	}
+
+	void init(CAN_FRAME &frame, uint32_t id) {
+		initFrame(frame, id);
+	}
+
+	void patch(CAN_FRAME &frame, uint8_t index, uint8_t value) {
+		patchByte(frame, index, value);
+	}
+};
+
+/*
+ * The security CRC as it was calculated before the tables were introduced
+ */
+static uint8_t referenceCodaCrc(uint8_t cmd, uint8_t torqueLsb, uint8_t torqueMsb) {
+	static const uint8_t swizzleTable[] = { 0xAA, 0x7F, 0xFE, 0x29, 0x52, 0xA4, 0x9D, 0xEF, 0xB, 0x16, 0x2C, 0x58, 0xB0, 0x60, 0xC0, 1 };
+	uint16_t torque = torqueLsb + (256 * torqueMsb);
+	uint8_t crc = 0x7F;
+
+	if (((cmd & 0xA0) == 0xA0) || ((cmd & 0x60) == 0x60))
+		torque += 1;
+	if ((torque % 4) == 3)
+		torque += 4;
+	for (int bit = 0; bit < 16; bit++) {
+		if ((torque & (1 << bit)) == (1 << bit))
+			crc = (uint8_t) (crc ^ swizzleTable[bit]);
+	}
+	return crc;
+}
+
+/*
+ * Every torque value with every control byte (both command modes and all bits which
+ * shouldn't matter)
+ */
+static void testCodaCrc() {
+	CrcCoda *coda = new CrcCoda();
+	long mismatches = 0;
+
+	for (int cmd = 0; cmd < 256; cmd++) {
+		for (uint32_t torque = 0; torque < 65536; torque++) {
+			uint8_t crc = coda->crc(cmd, torque & 0xFF, torque >> 8);
+			uint8_t expected = referenceCodaCrc(cmd, torque & 0xFF, torque >> 8);
+			if (crc != expected && mismatches++ < 5)
+				printf("  cmd %02X torque %04X: crc %02X, expected %02X\n", cmd, torque, crc, expected);
+		}
+	}
+	CHECK_EQUAL(0, mismatches);
+	CHECK_EQUAL(0x7F, coda->crc(0, 0, 0));
+}
+
+/*
+ * Changing any byte from any value to any other keeps the checksum of the template
+ * equal to the full calculation, for each of the command frame ids
+ */
+static void testDmocPatch(ChecksumDmoc *dmoc) {
+	static const uint32_t ids[] = { 0x232, 0x233, 0x234 };
+	CAN_FRAME frame;
+	long mismatches = 0;
+
+	for (uint8_t i = 0; i < 3; i++) {
+		dmoc->init(frame, ids[i]);
+		CHECK_EQUAL(dmoc->checksum(frame), frame.data.bytes[7]);
+		for (uint8_t index = 0; index < 7; index++) {
+			for (int from = 0; from < 256; from++) {
+				for (int to = 0; to < 256; to++) {
+					dmoc->patch(frame, index, from);
+					dmoc->patch(frame, index, to);
+					if (frame.data.bytes[7] != dmoc->checksum(frame) && mismatches++ < 5)
+						printf("  id %X byte %d %02X -> %02X: checksum %02X, expected %02X\n", ids[i], index, from, to,
+								frame.data.bytes[7], dmoc->checksum(frame));
+				}
+			}
+			dmoc->patch(frame, index, index * 37); // leave some data in the frame for the next byte
+		}
+	}
+	CHECK_EQUAL(0, mismatches);
+}
+
+/*
+ * The frames which are sent while the driver runs carry the checksum of the full
+ * calculation
+ */
+static void testDmocFrames(ChecksumDmoc *dmoc) {
+	long frames = 0, mismatches = 0;
+
+	dmoc->setup();
+	CAN.sent.clear();
+	for (int i = 0; i < 2000; i++) {
+		dmoc->pedal = (i * 7) % 2001 - 1000;
+		hostAdvance(STEP);
+		dmoc->handleTick();
+		while (!CAN.sent.empty()) {
+			CAN_FRAME frame = CAN.sent.front();
+			CAN.sent.pop_front();
+			if (frame.id < 0x232 || frame.id > 0x234)
+				continue;
+			frames++;
+			if (frame.data.bytes[7] != dmoc->checksum(frame) && mismatches++ < 5)
+				printf("  tick %d id %X: checksum %02X, expected %02X\n", i, (int) frame.id, frame.data.bytes[7], dmoc->checksum(frame));
+		}
+	}
+	CHECK(frames >= 2000);
+	CHECK_EQUAL(0, mismatches);
+}
+
+int main() {
+	hostSetupPrefs();
+	Logger::setLoglevel(Logger::Off);
+
+	ChecksumDmoc *dmoc = new ChecksumDmoc();
+
+	testCodaCrc();
+	testDmocPatch(dmoc);
+	testDmocFrames(dmoc);
+
+	return testResult("test_crc");
+}
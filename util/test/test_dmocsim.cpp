@@ -0,0 +1,253 @@
+/*
+ * test_dmocsim.cpp
+ *
+ * Closed loop of the DmocMotorController and the DmocSimulator: the command frames
+ * the driver sends on the (stubbed) CAN bus are fed into the simulator, its status
+ * frames go back to the driver. The simulator is stepped with the simulated time
+ * like DmocMotorController::simulateFrame() does it with CFG_DMOC_SIMULATION.
+ *
+ * If a file name is given, the command frames are written to it in the log format
+ * of candump (can-utils). util/dmocsim/sample.log was recorded this way.
+ *
+Copyright (c) 2013-14 Collin Kidder, Michael Neuweiler, Charles Galpin
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+ */
+
+#include "host.h"
+#include "test.h"
+#include "DmocMotorController.h"
+#include "DmocSimulator.h"
+
+#define STEP 10000 // the main loop passes every 10ms
+
+/*
+ * The DMOC driver with the pedal under control of the test. As there's no accelerator
+ * registered, the level set before handleTick() is taken as the pedal position.
+ * Like all devices it registers with the DeviceManager, so it must never be deleted.
+ */
+class BenchDmoc: public DmocMotorController {
+public:
+	int16_t pedal;
+
+	BenchDmoc() {
+		pedal = 0;
+		prefsHandler = new PrefHandler(DMOC645);
+	}
+
+	void handleTick() {
+		throttleRequested = pedal;
+		DmocMotorController::handleTick();
+	}
+};
+
+static BenchDmoc *controller;
+static DmocSimulator *simulator;
+static FILE *recording = NULL;
+static uint32_t lastStep = 0;
+static uint32_t rejected = 0;
+static uint16_t nominalVoltage;
+
+/*
+ * Deliver the frames the driver sent to the simulator, a 0x232 frame starts a new cycle
+ */
+static void transferFrames() {
+	DmocSimFrame command, status[DMOC_SIM_STATUS_FRAMES];
+	CAN_FRAME reply;
+
+	while (!CAN.sent.empty()) {
+		CAN_FRAME frame = CAN.sent.front();
+		CAN.sent.pop_front();
+
+		if (recording) {
+			fprintf(recording, "(%lu.%06lu) can0 %03X#", (unsigned long) (micros() / 1000000), (unsigned long) (micros() % 1000000),
+					(unsigned int) frame.id);
+			for (int i = 0; i < frame.length; i++)
+				fprintf(recording, "%02X", frame.data.bytes[i]);
+			fprintf(recording, "\n");
+		}
+
+		if (frame.id == 0x232) {
+			simulator->step(micros() - lastStep);
+			lastStep = micros();
+
+			uint8_t count = simulator->getStatus(status);
+			memset(&reply, 0, sizeof(reply));
+			for (int i = 0; i < count; i++) {
+				reply.id = status[i].id;
+				reply.length = status[i].length;
+				memcpy(reply.data.bytes, status[i].data, 8);
+				controller->handleCanFrame(&reply);
+			}
+		}
+
+		command.id = frame.id;
+		command.length = frame.length;
+		memcpy(command.data, frame.data.bytes, 8);
+		if (!simulator->processFrame(&command))
+			rejected++;
+	}
+}
+
+/*
+ * Run the main loop for the given time with the pedal at the given position
+ */
+static void drive(int16_t pedal, uint32_t ms) {
+	static uint32_t sinceTick = 0;
+
+	controller->pedal = pedal;
+	for (uint32_t t = 0; t < ms * 1000; t += STEP) {
+		hostAdvance(STEP);
+		sinceTick += STEP;
+		if (sinceTick >= CFG_TICK_INTERVAL_MOTOR_CONTROLLER_DMOC) {
+			sinceTick = 0;
+			controller->handleTick();
+		}
+		transferFrames();
+	}
+}
+
+/*
+ * After the precharge both sides have to end up enabled: the inverter initializes,
+ * the driver requests standby and then enable once the inverter reports to be ready.
+ */
+static void testStartUp() {
+	drive(0, 500);
+	CHECK(simulator->getState() == DmocSimulator::INITIALIZING);
+	CHECK(controller->getControllerState() != MotorController::CS_ENABLED);
+
+	drive(0, 4000);
+	CHECK(simulator->getState() == DmocSimulator::ENABLED);
+	CHECK(controller->getControllerState() == MotorController::CS_ENABLED);
+	CHECK_EQUAL(0, controller->getTorqueActual());
+	CHECK_EQUAL(0, rejected);
+}
+
+/*
+ * Pedal down: torque and speed go up and the pack voltage sags. The driver sees what
+ * the simulator reports.
+ */
+static void testAcceleration() {
+	drive(500, 5000);
+	CHECK(simulator->getTorque() > 0);
+	CHECK(simulator->getSpeed() > 500);
+	CHECK(simulator->getCurrent() > 0);
+	CHECK(simulator->getVoltage() < nominalVoltage);
+	CHECK_EQUAL(simulator->getTorque(), controller->getTorqueActual());
+	CHECK_EQUAL(simulator->getSpeed(), controller->getSpeedActual());
+	CHECK_EQUAL(simulator->getVoltage(), controller->getDcVoltage());
+	CHECK_EQUAL(simulator->getCurrent(), controller->getDcCurrent());
+}
+
+/*
+ * Regen: negative torque slows down and charges the pack
+ */
+static void testRegen() {
+	int16_t speed = simulator->getSpeed();
+
+	drive(-300, 2000);
+	CHECK(simulator->getTorque() < 0);
+	CHECK(simulator->getSpeed() < speed);
+	CHECK(simulator->getCurrent() < 0);
+
+	drive(0, 2000);
+	CHECK_EQUAL(0, rejected);
+	CHECK(simulator->getMaxCommandInterval() <= CFG_TICK_INTERVAL_MOTOR_CONTROLLER_DMOC / 1000);
+	CHECK_EQUAL(0, simulator->getCommandTimeouts());
+}
+
+/*
+ * The driver stops sending: the simulator disables itself after SIM_COMMAND_TIMEOUT,
+ * also if it's stepped with one long interval.
+ */
+static void testCommandTimeout() {
+	simulator->step(400000);
+	CHECK(simulator->getState() == DmocSimulator::ENABLED);
+	simulator->step(200000);
+	CHECK(simulator->getState() == DmocSimulator::DISABLED);
+	CHECK_EQUAL(1, simulator->getCommandTimeouts());
+}
+
+/*
+ * LOGLEVEL=0x1000,1 silences the debug output of every frame the DMOC645 driver
+ * sends or receives, without changing the level of the other devices
+ */
+static void testDeviceLogLevel() {
+	Logger::setLoglevel(Logger::Debug);
+	SerialUSB.output.clear();
+	drive(0, 100);
+	CHECK_CONTAINS(SerialUSB.output.c_str(), "DEBUG: DMOC645 - DMOC CAN received");
+	CHECK_CONTAINS(SerialUSB.output.c_str(), "DEBUG: DMOC645 - Torque command");
+
+	Logger::setLoglevel(DMOC645, Logger::Info);
+	SerialUSB.output.clear();
+	drive(0, 100);
+	CHECK(SerialUSB.output.find("DMOC645") == std::string::npos);
+	CHECK(SerialUSB.output.find("DEBUG") != std::string::npos); // the other devices still log
+
+	Logger::setLoglevel(Logger::Info);
+	SerialUSB.output.clear();
+}
+
+/*
+ * Frames with a wrong checksum or an alive counter which didn't change are rejected
+ */
+static void testRejectedFrames() {
+	DmocSimulator plant(3300);
+	DmocSimFrame frame;
+
+	memset(&frame, 0, sizeof(frame));
+	frame.id = 0x232;
+	frame.length = 8;
+	frame.data[6] = 0x42; // alive 2, enable
+	frame.data[7] = (uint8_t) (256 - (uint8_t) (0x32 + 0x42 + 3));
+	CHECK(plant.processFrame(&frame));
+	CHECK(!plant.processFrame(&frame)); // same alive counter
+	frame.data[6] = 0x44;
+	CHECK(!plant.processFrame(&frame)); // checksum doesn't match any more
+	frame.data[7] -= 2;
+	CHECK(plant.processFrame(&frame));
+	CHECK_EQUAL(4, plant.getFramesReceived());
+	CHECK_EQUAL(2, plant.getFramesRejected());
+}
+
+int main(int argc, char **argv) {
+	if (argc > 1)
+		recording = fopen(argv[1], "w");
+
+	hostSetupPrefs();
+	controller = new BenchDmoc();
+	controller->setup();
+	nominalVoltage = ((MotorControllerConfiguration *) controller->getConfiguration())->nominalVolt;
+	simulator = new DmocSimulator(nominalVoltage);
+	lastStep = micros();
+
+	testStartUp();
+	testAcceleration();
+	testRegen();
+	testDeviceLogLevel();
+	testCommandTimeout();
+	testRejectedFrames();
+
+	if (recording)
+		fclose(recording);
+	return testResult("test_dmocsim");
+}
@@ -0,0 +1,311 @@
+/*
+ * test_faulthandler.cpp
+ *
+ * The index of the FaultHandler (the most recent record of every fault in the
+ * history): raising and cancelling faults whose keys collide in the hash table,
+ * random churn with the index checked after every change (every overwritten record
+ * removes an entry by backward shift), a benchmark of raise / cancel with an empty
+ * and a full history and the EEPROM writes of a fault storm.
+ *
+Copyright (c) 2013-14 Collin Kidder, Michael Neuweiler, Charles Galpin
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+ */
+
+#include <time.h>
+#include "host.h"
+#include "test.h"
+#include "FaultHandler.h"
+
+#define BUCKET_STRIDE	CFG_FAULT_INDEX_SIZE // codes of one device which differ by this end up in the same bucket
+#define BENCH_ROUNDS	200000
+#define STORM_INPUTS	20 // flapping inputs in the fault storm
+
+static uint32_t randomState = 12345;
+
+static uint32_t nextRandom() {
+	randomState = randomState * 1103515245 + 12345;
+	return (randomState >> 8);
+}
+
+static bool isOngoing(uint16_t slot) {
+	FAULT fault;
+	return faultHandler.getFault(slot, &fault) && fault.ongoing;
+}
+
+static uint8_t occurrences(uint16_t slot) {
+	FAULT fault;
+	faultHandler.getFault(slot, &fault);
+	return fault.occurrences;
+}
+
+/*
+ * Three groups of eight faults, all faults of a group share one bucket. They are
+ * cancelled in a shuffled order, so entries are removed from the start, the middle
+ * and the end of long probe chains which also run into each other.
+ */
+static void testCollisions() {
+	const int count = 24;
+	uint16_t devices[count], codes[count], slots[count];
+	int order[count];
+
+	for (int i = 0; i < count; i++) {
+		devices[i] = 0x1000 + (i % 3);
+		codes[i] = 0x100 + (i % 3) + (i / 3) * BUCKET_STRIDE;
+		slots[i] = faultHandler.raiseFault(devices[i], codes[i], true);
+		CHECK(faultHandler.checkIndex());
+		order[i] = i;
+	}
+
+	// raising an ongoing fault again finds its record, it isn't counted as a new occurrence
+	for (int i = 0; i < count; i++) {
+		CHECK_EQUAL(slots[i], faultHandler.raiseFault(devices[i], codes[i], true));
+		CHECK_EQUAL(1, occurrences(slots[i]));
+	}
+
+	for (int i = count - 1; i > 0; i--) {
+		int j = nextRandom() % (i + 1);
+		int swap = order[i];
+		order[i] = order[j];
+		order[j] = swap;
+	}
+
+	int failures = 0;
+	for (int i = 0; i < count; i++) {
+		faultHandler.cancelOngoingFault(devices[order[i]], codes[order[i]]);
+		if (!faultHandler.checkIndex()) {
+			failures++;
+			break;
+		}
+		for (int j = 0; j < count; j++) {
+			if (isOngoing(slots[order[j]]) != (j > i))
+				failures++;
+		}
+	}
+	CHECK_EQUAL(0, failures);
+}
+
+/*
+ * Random raises, cancels and acknowledges of faults out of a set which collides
+ * heavily. Acknowledged faults get a new record when raised again, so the history
+ * wraps around and ongoing records are overwritten too.
+ */
+static void testChurn() {
+	const int keys = 28;
+	int failures = 0;
+
+	for (int i = 0; i < 100000; i++) {
+		uint16_t device = 0x2000 + (nextRandom() % 2);
+		uint16_t code = 0x200 + (nextRandom() % (keys / 2)) * (BUCKET_STRIDE / 2);
+		uint32_t action = nextRandom() % 8;
+
+		if (action < 4) {
+			uint16_t slot = faultHandler.raiseFault(device, code, true);
+			if (!isOngoing(slot))
+				failures++;
+		} else if (action < 7) {
+			faultHandler.cancelOngoingFault(device, code);
+		} else {
+			faultHandler.setFaultACK(nextRandom() % CFG_FAULT_HISTORY_SIZE);
+		}
+		if (!faultHandler.checkIndex()) { // stop, further operations could run into an endless probe chain
+			printf("  index broken after operation %d\n", i);
+			failures++;
+			break;
+		}
+	}
+	CHECK_EQUAL(0, failures);
+
+	for (int i = 0; i < keys; i++) // leave nothing ongoing for the next test
+		faultHandler.cancelOngoingFault(0x2000 + (i % 2), 0x200 + (i / 2) * (BUCKET_STRIDE / 2));
+	CHECK(faultHandler.checkIndex());
+}
+
+/*
+ * A fault which isn't ongoing any more is counted on its most recent record until
+ * that is acknowledged, then it gets a new record which the index points to.
+ */
+static void testRepeat() {
+	uint16_t slot = faultHandler.raiseFault(0x3000, 0x300, false);
+	CHECK_EQUAL(1, occurrences(slot));
+	CHECK_EQUAL(slot, faultHandler.raiseFault(0x3000, 0x300, true));
+	CHECK_EQUAL(2, occurrences(slot));
+	faultHandler.cancelOngoingFault(0x3000, 0x300);
+	CHECK_EQUAL(slot, faultHandler.raiseFault(0x3000, 0x300, false));
+	CHECK_EQUAL(3, occurrences(slot));
+
+	faultHandler.setFaultACK(slot);
+	uint16_t newSlot = faultHandler.raiseFault(0x3000, 0x300, false);
+	CHECK(newSlot != slot);
+	CHECK_EQUAL(1, occurrences(newSlot));
+	CHECK_EQUAL(newSlot, faultHandler.raiseFault(0x3000, 0x300, false));
+	CHECK_EQUAL(2, occurrences(newSlot));
+	CHECK_EQUAL(3, occurrences(slot));
+	CHECK(faultHandler.checkIndex());
+}
+
+/*
+ * A history full of different faults which all collide, half of them ongoing. New
+ * faults overwrite the oldest records one by one, the survivors are still found.
+ */
+static void testFullHistory() {
+	int failures = 0;
+
+	for (int i = 0; i < CFG_FAULT_HISTORY_SIZE; i++)
+		faultHandler.raiseFault(0x3001, 0x310 + i * BUCKET_STRIDE, (i & 1));
+	CHECK(faultHandler.checkIndex());
+
+	for (int i = 0; i < CFG_FAULT_HISTORY_SIZE; i++) {
+		faultHandler.raiseFault(0x3002, 0x310 + i * BUCKET_STRIDE, false);
+		if (!faultHandler.checkIndex()) {
+			failures++;
+			break;
+		}
+		// the next older fault which survived counts another occurrence instead of getting a new record
+		if (i + 1 < CFG_FAULT_HISTORY_SIZE) {
+			uint16_t survivor = faultHandler.raiseFault(0x3001, 0x310 + (i + 1) * BUCKET_STRIDE, ((i + 1) & 1));
+			if (occurrences(survivor) != (((i + 1) & 1) ? 1 : 2)) // ongoing ones aren't counted again
+				failures++;
+		}
+	}
+	CHECK_EQUAL(0, failures);
+	CHECK_EQUAL(1, occurrences(faultHandler.raiseFault(0x3001, 0x310, false))); // the oldest was overwritten, it's new again
+}
+
+/*
+ * Raise and cancel one fault, returns nanoseconds per pair
+ */
+static double benchmark(uint16_t device, uint16_t code) {
+	clock_t start = clock();
+	for (int i = 0; i < BENCH_ROUNDS; i++) {
+		faultHandler.raiseFault(device, code, true);
+		faultHandler.cancelOngoingFault(device, code);
+		faultHandler.cancelOngoingFault(device, code + 1); // the usual case of a device whose input is fine
+	}
+	return (double) (clock() - start) * 1e9 / CLOCKS_PER_SEC / BENCH_ROUNDS;
+}
+
+/*
+ * The cost of raise / cancel doesn't depend on how many other faults are in the
+ * history or ongoing, also if they collide with the benchmarked one.
+ */
+static void testBenchmark() {
+	for (int i = 0; i < CFG_FAULT_HISTORY_SIZE; i++) // ack everything, the benchmark gets a new record
+		faultHandler.setFaultACK(i);
+	faultHandler.raiseFault(0x4000, 0x400, false);
+	double alone = benchmark(0x4000, 0x400);
+
+	for (int i = 1; i < CFG_FAULT_HISTORY_SIZE; i++)
+		faultHandler.raiseFault(0x4000, 0x400 + i * BUCKET_STRIDE, false);
+	double history = benchmark(0x4000, 0x400);
+
+	for (int i = 1; i < CFG_FAULT_HISTORY_SIZE; i++)
+		faultHandler.raiseFault(0x4000, 0x400 + i * BUCKET_STRIDE, true);
+	double ongoing = benchmark(0x4000, 0x400);
+	CHECK(faultHandler.checkIndex());
+
+	printf("raise + cancel: %.0fns alone, %.0fns with %d colliding faults in the history, %.0fns with them ongoing\n",
+			alone, history, CFG_FAULT_HISTORY_SIZE - 1, ongoing);
+	for (int i = 1; i < CFG_FAULT_HISTORY_SIZE; i++)
+		faultHandler.cancelOngoingFault(0x4000, 0x400 + i * BUCKET_STRIDE);
+}
+
+/*
+ * A minute of flapping inputs: raise and cancel only change RAM, the records are
+ * committed with the FaultHandler ticks and MemCache writes at most one page per
+ * tick. Without batching, every change of a record was a synchronous page write.
+ * Afterwards the EEPROM holds the same fault log as the RAM.
+ */
+static void testStorm() {
+	uint32_t changes = 0, writesDuringRaise = 0, maxPerCacheTick = 0, maxPerFaultTick = 0;
+	uint32_t start = Wire.pageWrites;
+	bool active[STORM_INPUTS];
+
+	memset(active, 0, sizeof(active));
+	for (uint32_t ms = 10; ms <= 60000; ms += 10) {
+		hostAdvance(10000);
+
+		uint32_t before = Wire.pageWrites;
+		for (int i = 0; i < STORM_INPUTS; i++) {
+			if (nextRandom() % 5 != 0)
+				continue;
+			active[i] = !active[i];
+			if (active[i])
+				faultHandler.raiseFault(0x5000 + (i % 4), 0x500 + i, true);
+			else
+				faultHandler.cancelOngoingFault(0x5000 + (i % 4), 0x500 + i);
+			changes++;
+		}
+		writesDuringRaise += Wire.pageWrites - before;
+
+		if (ms % (CFG_TICK_INTERVAL_FAULT_HANDLER / 1000) == 0) {
+			before = Wire.pageWrites;
+			faultHandler.handleTick();
+			maxPerFaultTick = max(maxPerFaultTick, Wire.pageWrites - before);
+		}
+		if (ms % (CFG_TICK_INTERVAL_MEM_CACHE / 1000) == 0) {
+			before = Wire.pageWrites;
+			memCache->handleTick();
+			maxPerCacheTick = max(maxPerCacheTick, Wire.pageWrites - before);
+		}
+	}
+	uint32_t pageWrites = Wire.pageWrites - start;
+	printf("fault storm: %u changes of fault records in 60s, %u EEPROM page writes (max %u per MemCache tick, "
+			"%u per FaultHandler tick, %u during raise / cancel)\n", changes, pageWrites, maxPerCacheTick,
+			maxPerFaultTick, writesDuringRaise);
+	CHECK_EQUAL(0, writesDuringRaise);
+	CHECK(maxPerCacheTick <= 1);
+	CHECK_EQUAL(0, maxPerFaultTick);
+	CHECK(pageWrites * 20 < changes);
+	CHECK(faultHandler.checkIndex());
+
+	faultHandler.commit();
+	memCache->FlushAllPages();
+	memCache->InvalidateAll(); // read everything back from the EEPROM
+	FaultHandler *reloaded = new FaultHandler();
+	reloaded->setup();
+	int failures = 0;
+	for (int i = 0; i < CFG_FAULT_HISTORY_SIZE; i++) {
+		FAULT stored, expected;
+		reloaded->getFault(i, &stored);
+		faultHandler.getFault(i, &expected);
+		if (stored.device != expected.device || stored.faultCode != expected.faultCode || stored.ongoing != expected.ongoing
+				|| stored.ack != expected.ack || stored.occurrences != expected.occurrences)
+			failures++;
+	}
+	CHECK_EQUAL(0, failures);
+	CHECK(reloaded->checkIndex());
+}
+
+int main() {
+	hostSetupPrefs();
+	Logger::setLoglevel(Logger::Off); // every new fault is logged as error
+	faultHandler.setup();
+
+	testCollisions();
+	testChurn();
+	testRepeat();
+	testFullHistory();
+	testBenchmark();
+	testStorm();
+
+	return testResult("test_faulthandler");
+}
@@ -0,0 +1,281 @@
+/*
+ * test_heapsoak.cpp
+ *
+ * Soak test of the wifi path: a motor controller with changing values, the
+ * SignalRegistry and the iChip driver (dashboard, parameters, socket polls and
+ * telemetry) run for some hours of simulated time against the fake iChip.
+ * Every allocation within the drivers is counted, there must be none.
+ *
+ * The firmware only uses the heap via new and String (which allocates with new
+ * on the host), so replacing the global operator new is enough to see them.
+ * OBD2 requests are not sent, their replies are still built as String by the
+ * ELM327Processor.
+ *
+Copyright (c) 2013-14 Collin Kidder, Michael Neuweiler, Charles Galpin
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+ */
+
+#include <new>
+#include "host.h"
+#include "test.h"
+#include "fakeichip.h"
+#include "ichip_2128.h"
+#include "MotorController.h"
+#include "SignalRegistry.h"
+#include "MemCache.h"
+
+#define SOAK_HOURS 3
+#define SERIAL_RESERVE 65536 // the buffers of the serial ports are allocated up front, they're not part of the firmware
+
+/*
+ * Counting replacement of the global operator new, only the calls while a driver runs are counted
+ */
+static bool counting = false;
+static const char *runningDriver = "";
+static uint32_t allocations = 0;
+
+static void countAllocation(size_t size) {
+	if (!counting)
+		return;
+	if (allocations++ < 5)
+		printf("  %lu bytes allocated in %s at %lums\n", (unsigned long) size, runningDriver, (unsigned long) millis());
+}
+
+void *operator new(size_t size) throw (std::bad_alloc) {
+	countAllocation(size);
+	void *p = malloc(size ? size : 1);
+	if (p == NULL)
+		throw std::bad_alloc();
+	return p;
+}
+
+void *operator new[](size_t size) throw (std::bad_alloc) {
+	return operator new(size);
+}
+
+void *operator new(size_t size, const std::nothrow_t &) throw () {
+	countAllocation(size);
+	return malloc(size ? size : 1);
+}
+
+void *operator new[](size_t size, const std::nothrow_t &) throw () {
+	return operator new(size, std::nothrow);
+}
+
+__attribute__((noinline)) void operator delete(void *p) throw () {
+	free(p);
+}
+
+__attribute__((noinline)) void operator delete[](void *p) throw () {
+	free(p);
+}
+
+__attribute__((noinline)) void operator delete(void *p, const std::nothrow_t &) throw () {
+	free(p);
+}
+
+__attribute__((noinline)) void operator delete[](void *p, const std::nothrow_t &) throw () {
+	free(p);
+}
+
+/*
+ * A motor controller without a real one behind it, its values follow a drive
+ * cycle of one minute so the signals, the dashboard and the telemetry change.
+ * Like all devices it registers with the DeviceManager, so it must never be deleted.
+ */
+class SoakController: public MotorController {
+public:
+	MotorControllerConfiguration configuration;
+
+	SoakController() {
+		memset(&configuration, 0, sizeof(configuration));
+		configuration.speedMax = 6000;
+		configuration.torqueMax = 3000;
+		configuration.torqueSlewRate = 6000;
+		configuration.slewRampTime = 100;
+		configuration.nominalVolt = 3300;
+		configuration.prechargeR = 1000;
+		configuration.prechargeRelay = 0;
+		configuration.mainContactorRelay = 1;
+		configuration.coolFan = configuration.brakeLight = configuration.revLight = 255;
+		configuration.enableIn = configuration.reverseIn = 255;
+		setConfiguration(&configuration);
+		prefsHandler = new PrefHandler(DMOC645);
+	}
+
+	DeviceId getId() {
+		return DMOC645;
+	}
+
+	void simulate(uint32_t ms) {
+		int32_t phase = (ms / 100) % 600;
+		int32_t level = (phase < 300 ? phase : 600 - phase) * 4 - 200;
+
+		reportActivity();
+		throttleRequested = level;
+		speedActual = phase * 10;
+		torqueActual = level * 3;
+		dcVoltage = 3300 - level / 4;
+		dcCurrent = level;
+		acCurrent = abs(level) * 2;
+		mechanicalPower = (int32_t) speedActual * torqueActual / 95490;
+		temperatureMotor = 300 + (ms / 10000) % 400;
+		temperatureInverter = 300 + (ms / 20000) % 300;
+		temperatureSystem = 250 + (ms / 60000) % 100;
+	}
+};
+
+static ICHIPWIFI *ichip;
+static SoakController *controller;
+static FakeIChip fake(&Serial2);
+static int parameterChanges = 0;
+static int dashboardUpdates = 0;
+static int telemetryRecords = 0;
+
+/*
+ * Answer everything the driver sent like the module would. Socket 0 is active
+ * but never has data, every 10 minutes the web site changes a parameter.
+ */
+static void serve() {
+	std::string command;
+
+	while (fake.receive(command)) {
+		if (command.compare(0, strlen(Constants::dashValues), Constants::dashValues) == 0)
+			dashboardUpdates++;
+		if (command.compare(0, 11, "SSND%%:005,") == 0)
+			telemetryRecords++;
+
+		if (command == "LTCP:2000,4")
+			fake.answer(command, "I/10");
+		else if (command.compare(0, 5, "LSST:") == 0)
+			fake.answer(command, "I/(0,-1,-1,-1)");
+		else if (command.compare(0, 5, "SRCV:") == 0)
+			fake.answer(command, "I/0");
+		else if (command.compare(0, 5, "STCP:") == 0)
+			fake.answer(command, "I/5");
+		else if (command == "WNXT") {
+			fake.echo(command);
+			if (millis() >= parameterChanges * 600000UL) {
+				fake.reply(parameterChanges % 2 ? "speedMax=\"6000\"" : "speedMax=\"5000\"");
+				parameterChanges++;
+			}
+			fake.reply("I/OK");
+		} else
+			fake.answer(command, "I/OK");
+	}
+}
+
+/*
+ * Run one driver with the allocations counted
+ */
+static void run(const char *name, TickObserver *observer) {
+	runningDriver = name;
+	counting = true;
+	observer->handleTick();
+	counting = false;
+}
+
+static void run(const char *name, LoopObserver *observer) {
+	runningDriver = name;
+	counting = true;
+	observer->handleLoop();
+	counting = false;
+}
+
+/*
+ * The tick of a driver is due if its interval passed since the last one
+ */
+static bool due(uint32_t *elapsed, uint32_t step, uint32_t interval) {
+	*elapsed += step;
+	if (*elapsed < interval)
+		return false;
+	*elapsed %= interval;
+	return true;
+}
+
+static void testSoak() {
+	uint32_t controllerElapsed = 0, signalsElapsed = 0, wifiElapsed = 0, cacheElapsed = 0;
+	uint32_t steps = 0;
+
+	srand(1);
+	while (millis() < SOAK_HOURS * 3600000UL) {
+		uint32_t step = (10 + rand() % 41) * 1000; // 10-50ms per pass of the main loop
+
+		hostAdvance(step);
+		controller->simulate(millis());
+		if (due(&controllerElapsed, step, CFG_TICK_INTERVAL_MOTOR_CONTROLLER))
+			run("MotorController::handleTick", (TickObserver *) controller);
+		if (due(&signalsElapsed, step, CFG_TICK_INTERVAL_SIGNALS))
+			run("SignalRegistry::handleTick", SignalRegistry::getInstance());
+		if (due(&wifiElapsed, step, CFG_TICK_INTERVAL_WIFI))
+			run("ICHIPWIFI::handleTick", (TickObserver *) ichip);
+		if (due(&cacheElapsed, step, CFG_TICK_INTERVAL_MEM_CACHE))
+			run("MemCache::handleTick", memCache);
+		run("MessageBus::handleLoop", MessageBus::getInstance());
+		run("ICHIPWIFI::handleLoop", (LoopObserver *) ichip);
+
+		// outside of the counted region: the module answers and the serial buffers are emptied
+		serve();
+		if (Serial2.inputPosition >= Serial2.input.length()) {
+			Serial2.input.clear();
+			Serial2.inputPosition = 0;
+		}
+		SerialUSB.output.clear();
+		steps++;
+	}
+
+	CHECK(steps > SOAK_HOURS * 3600 * 20);
+	CHECK_EQUAL(SOAK_HOURS * 6, parameterChanges);
+	CHECK(dashboardUpdates > SOAK_HOURS * 3600);
+	CHECK(telemetryRecords > SOAK_HOURS * 3600);
+	CHECK_EQUAL(0, fake.pending());
+	CHECK_EQUAL(0, allocations);
+
+	// the traffic really went through the queue
+	SerialUSB.output.clear();
+	ichip->printStatistics();
+	CHECK_CONTAINS(SerialUSB.output.c_str(), " 0 dropped");
+	CHECK(SerialUSB.output.find(" 0 completed") == std::string::npos);
+}
+
+int main() {
+	uint32_t address = 10 | (0 << 8) | (0 << 16) | (2 << 24);
+	uint16_t port = 9000;
+
+	Serial2.input.reserve(SERIAL_RESERVE);
+	Serial2.output.reserve(SERIAL_RESERVE);
+	SerialUSB.output.reserve(SERIAL_RESERVE);
+
+	hostSetupPrefs();
+	sysPrefs->write(EESYS_TELEMETRY_IPADDR, address);
+	sysPrefs->write(EESYS_TELEMETRY_PORT, port);
+	PrefHandler registration(DMOC645); // place the controller in the device table to enable it
+	PrefHandler::setDeviceStatus(DMOC645, true);
+
+	controller = new SoakController();
+	controller->setup();
+	ichip = new ICHIPWIFI(&Serial2);
+	ichip->setup();
+
+	testSoak();
+	return testResult("test_heapsoak");
+}
@@ -0,0 +1,254 @@
+/*
+ * test_ichip.cpp
+ *
+ * Tests of the command transport to the iChip (stop-and-wait with retries)
+ * against a scripted fake of the module on the other end of the serial port.
+ *
+Copyright (c) 2013-14 Collin Kidder, Michael Neuweiler, Charles Galpin
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+ */
+
+#include "host.h"
+#include "test.h"
+#include "fakeichip.h"
+#include "ichip_2128.h"
+
+static ICHIPWIFI *ichip;
+static FakeIChip fake(&Serial2);
+
+/*
+ * Let the driver process the input (it also checks its timeouts)
+ */
+static void process() {
+	ichip->handleLoop();
+}
+
+static std::string expectCommand() {
+	std::string command;
+
+	process();
+	if (!CHECK(fake.receive(command)))
+		printf("  no command was sent\n");
+	return command;
+}
+
+static void queue(const char *command) {
+	MessageBus::getInstance()->send(MSG_COMMAND, ICHIP2128, command);
+}
+
+/*
+ * Print the statistics to the console and return the line
+ */
+static std::string statistics() {
+	SerialUSB.output.clear();
+	ichip->printStatistics();
+	return SerialUSB.output;
+}
+
+/*
+ * One command at a time: the next one is only sent when the reply ("I/...") of the
+ * previous one arrived.
+ */
+static void testStopAndWait() {
+	queue("A=\"1\"");
+	queue("B=\"2\"");
+	CHECK(expectCommand() == "A=\"1\"");
+	CHECK_EQUAL(0, fake.pending());
+
+	fake.echo("A=\"1\"");
+	process();
+	CHECK_EQUAL(0, fake.pending()); // the echo alone doesn't complete it
+	fake.reply("I/OK");
+	CHECK(expectCommand() == "B=\"2\"");
+	fake.answer("B=\"2\"", "I/OK");
+	process();
+	CHECK_EQUAL(0, fake.pending());
+	CHECK_CONTAINS(statistics().c_str(), "2 completed, 0 retried, 0 failed");
+}
+
+/*
+ * No reply: the command is repeated after the timeout, the time doubles with every retry.
+ * After CFG_WIFI_MAX_RETRIES the command is given up and the next one is sent.
+ */
+static void testRetries() {
+	queue("C=\"3\"");
+	queue("D=\"4\"");
+	CHECK(expectCommand() == "C=\"3\"");
+
+	hostAdvance((CFG_WIFI_REPLY_TIMEOUT - 10) * 1000);
+	process();
+	CHECK_EQUAL(0, fake.pending());
+	hostAdvance(20 * 1000);
+	CHECK(expectCommand() == "C=\"3\""); // 1st retry
+
+	hostAdvance((2 * CFG_WIFI_REPLY_TIMEOUT - 10) * 1000);
+	process();
+	CHECK_EQUAL(0, fake.pending());
+	hostAdvance(20 * 1000);
+	CHECK(expectCommand() == "C=\"3\""); // 2nd retry
+
+	hostAdvance((4 * CFG_WIFI_REPLY_TIMEOUT + 10) * 1000);
+	CHECK(expectCommand() == "D=\"4\""); // C given up
+	fake.answer("D=\"4\"", "I/OK");
+	process();
+	CHECK_CONTAINS(statistics().c_str(), "3 completed, 2 retried, 1 failed");
+}
+
+/*
+ * The first transmission was only slow: its reply arrives after the retry was sent.
+ * The reply of the retry must not be taken for the reply of the next command, even
+ * if that's the very same command (e.g. WNXT).
+ */
+static void testLateReplyOfIdenticalCommand() {
+	queue("WNXT");
+	queue("WNXT");
+	queue("E=\"5\"");
+	CHECK(expectCommand() == "WNXT");
+	hostAdvance((CFG_WIFI_REPLY_TIMEOUT + 10) * 1000);
+	CHECK(expectCommand() == "WNXT"); // retry of the 1st
+
+	fake.answer("WNXT", "I/DONE"); // reply to the 1st transmission
+	CHECK(expectCommand() == "WNXT"); // the 2nd WNXT of the queue
+	fake.answer("WNXT", "I/DONE"); // late reply to the retry of the 1st
+	process();
+	CHECK_EQUAL(0, fake.pending()); // still waiting for the reply to the 2nd WNXT
+	fake.answer("WNXT", "I/DONE");
+	CHECK(expectCommand() == "E=\"5\"");
+	fake.answer("E=\"5\"", "I/OK");
+	process();
+	CHECK_EQUAL(0, fake.pending());
+}
+
+/*
+ * The first transmission was lost, only the retry is answered. The next command
+ * must be completed by its own reply right away.
+ */
+static void testLostTransmission() {
+	queue("F=\"6\"");
+	queue("G=\"7\"");
+	CHECK(expectCommand() == "F=\"6\"");
+	hostAdvance((CFG_WIFI_REPLY_TIMEOUT + 10) * 1000);
+	CHECK(expectCommand() == "F=\"6\"");
+	fake.answer("F=\"6\"", "I/OK");
+	CHECK(expectCommand() == "G=\"7\"");
+	fake.answer("G=\"7\"", "I/OK");
+	queue("H=\"8\"");
+	CHECK(expectCommand() == "H=\"8\"");
+	fake.answer("H=\"8\"", "I/OK");
+	process();
+	CHECK_EQUAL(0, fake.pending());
+}
+
+/*
+ * Answer everything the driver sends like the module would until it's quiet
+ */
+static void serve(int *socketData) {
+	std::string command;
+
+	process();
+	while (fake.receive(command)) {
+		if (command == "LTCP:2000,4")
+			fake.answer(command, "I/10");
+		else if (command.compare(0, 5, "LSST:") == 0)
+			fake.answer(command, "I/(0,-1,-1,-1)");
+		else if (command.compare(0, 5, "SRCV:") == 0)
+			fake.answer(command, ((*socketData)-- > 0 ? "I/4:010d" : "I/0"));
+		else if (command.compare(0, 5, "STCP:") == 0)
+			fake.answer(command, "I/5");
+		else if (command.find('=') != std::string::npos || command == "WNXT")
+			fake.answer(command, "I/OK");
+		else
+			fake.answer(command, "I/ERROR");
+		process();
+	}
+}
+
+/*
+ * Socket data may contain CR/LF: ELM327 replies use CR as line end, telemetry
+ * records end with LF. Only the header of the echo is checked, so the reply
+ * completes the command and the queue doesn't stall until the timeout.
+ */
+static void testSocketData() {
+	std::string command;
+	int socketData = 0;
+
+	// start up: parameters are loaded, the listener opened and the telemetry connection established
+	for (int i = 0; i < 140; i++) {
+		hostAdvance(100000);
+		ichip->handleTick();
+		serve(&socketData);
+	}
+	CHECK_EQUAL(0, fake.pending());
+
+	// an OBD2 request on socket 0, the answer is sent back via SSND
+	socketData = 1;
+	ichip->handleTick();
+	CHECK(expectCommand().compare(0, 9, "SRCV:000,") == 0);
+	fake.answer("SRCV:000,80", "I/4:010d");
+	command = expectCommand();
+	CHECK(command.compare(0, 11, "SSND%%:000,") == 0);
+	CHECK(command.find('\r', 11) != std::string::npos);
+
+	queue("I=\"9\"");
+	fake.answer(command, "I/OK");
+	CHECK(expectCommand() == "I=\"9\""); // right away, no timeout
+	fake.answer("I=\"9\"", "I/OK");
+
+	// a telemetry record
+	hostAdvance(CFG_TELEMETRY_INTERVAL * 1000);
+	command = expectCommand();
+	CHECK(command.compare(0, 11, "SSND%%:005,") == 0);
+	CHECK(command[command.length() - 1] == '\n');
+	queue("J=\"10\"");
+	fake.answer(command, "I/OK");
+	CHECK(expectCommand() == "J=\"10\"");
+	fake.answer("J=\"10\"", "I/OK");
+	CHECK_CONTAINS(statistics().c_str(), "0 dropped");
+
+	// the receiver went away
+	hostAdvance(CFG_TELEMETRY_INTERVAL * 1000);
+	command = expectCommand();
+	fake.answer(command, "I/ERROR");
+	hostAdvance(CFG_TELEMETRY_INTERVAL * 1000);
+	process();
+	CHECK_EQUAL(0, fake.pending()); // no more records until reconnected
+	hostAdvance((CFG_TELEMETRY_RECONNECT + 10) * 1000);
+	CHECK(expectCommand().compare(0, 5, "STCP:") == 0);
+}
+
+int main() {
+	uint32_t address = 10 | (0 << 8) | (0 << 16) | (2 << 24);
+	uint16_t port = 9000;
+
+	hostSetupPrefs();
+	sysPrefs->write(EESYS_TELEMETRY_IPADDR, address);
+	sysPrefs->write(EESYS_TELEMETRY_PORT, port);
+	ichip = new ICHIPWIFI(&Serial2);
+	ichip->setup();
+
+	testStopAndWait();
+	testRetries();
+	testLateReplyOfIdenticalCommand();
+	testLostTransmission();
+	testSocketData();
+	return testResult("test_ichip");
+}
@@ -0,0 +1,148 @@
+/*
+ * test_logger.cpp
+ *
+ * Tests of the deferred logging: the ring buffer, its overrun path and the
+ * copies of %s parameters.
+ *
+Copyright (c) 2013-14 Collin Kidder, Michael Neuweiler, Charles Galpin
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+ */
+
+#include "host.h"
+#include "test.h"
+#include "Logger.h"
+
+static std::string takeOutput() {
+	std::string output = SerialUSB.output;
+	SerialUSB.output.clear();
+	return output;
+}
+
+static int countLines(const std::string &text) {
+	int lines = 0;
+	for (size_t i = 0; i < text.length(); i++)
+		if (text[i] == '\n')
+			lines++;
+	return lines;
+}
+
+static void drain() {
+	for (int i = 0; i < CFG_LOG_BUFFER_SIZE; i++)
+		Logger::loop();
+}
+
+/*
+ * Without deferred mode the message is printed right away
+ */
+static void testDirect() {
+	char name[] = "direct";
+
+	Logger::info("%s %d %X", name, -5, 0xab);
+	CHECK(takeOutput() == "0 - INFO: direct -5 0xAB\r\n");
+}
+
+/*
+ * In deferred mode nothing is printed until loop(), strings are copied when queued
+ */
+static void testDeferred() {
+	char buffer[16];
+
+	Logger::setDeferred(true);
+	strcpy(buffer, "first");
+	Logger::info("%s=%d", buffer, 1);
+	strcpy(buffer, "overwritten");
+	CHECK(takeOutput().empty());
+
+	Logger::loop();
+	CHECK(takeOutput() == "0 - INFO: first=1\r\n");
+}
+
+/*
+ * Long strings are cut to what fits into the record
+ */
+static void testLongString() {
+	char text[CFG_LOG_STRING_SIZE * 2];
+
+	memset(text, 'a', sizeof(text) - 1);
+	text[sizeof(text) - 1] = 0;
+	Logger::info("[%s] [%s]", text, "b");
+	Logger::loop();
+
+	std::string expected = "0 - INFO: [" + std::string(CFG_LOG_STRING_SIZE - 1, 'a') + "] []\r\n";
+	CHECK(takeOutput() == expected);
+}
+
+/*
+ * Filling the ring beyond its capacity drops the newest messages, counts them
+ * and reports them once after the queued ones were printed.
+ */
+static void testOverrun() {
+	const int extra = 5;
+	char name[8];
+
+	for (int i = 0; i < CFG_LOG_BUFFER_SIZE + extra; i++) {
+		sprintf(name, "m%d", i);
+		Logger::info("%s", name);
+	}
+	CHECK_EQUAL(extra, Logger::getOverruns());
+
+	Logger::loop(); // prints CFG_LOG_DRAIN_RECORDS records, not yet the overrun
+	std::string output = takeOutput();
+	CHECK_EQUAL(CFG_LOG_DRAIN_RECORDS, countLines(output));
+	CHECK(output.find("lost") == std::string::npos);
+
+	drain();
+	output = takeOutput();
+	CHECK_EQUAL(CFG_LOG_BUFFER_SIZE - CFG_LOG_DRAIN_RECORDS + 1, countLines(output));
+	sprintf(name, "m%d\r", CFG_LOG_BUFFER_SIZE - 1);
+	CHECK(output.find(name) != std::string::npos);
+	sprintf(name, "m%d\r", CFG_LOG_BUFFER_SIZE);
+	CHECK(output.find(name) == std::string::npos);
+	CHECK_CONTAINS(output.c_str(), "5 log messages lost (buffer overrun)");
+
+	// the ring is usable again and the overrun isn't reported twice
+	Logger::info("after %d", 1);
+	drain();
+	CHECK(takeOutput() == "0 - INFO: after 1\r\n");
+	CHECK_EQUAL(extra, Logger::getOverruns());
+}
+
+/*
+ * Switching deferred mode off prints what's queued
+ */
+static void testFlush() {
+	Logger::info("queued %d", 1);
+	Logger::info("queued %d", 2);
+	Logger::setDeferred(false);
+	CHECK(takeOutput() == "0 - INFO: queued 1\r\n0 - INFO: queued 2\r\n");
+	Logger::info("immediate");
+	CHECK(takeOutput() == "0 - INFO: immediate\r\n");
+}
+
+int main() {
+	testDirect();
+	testDeferred();
+	testLongString();
+	testOverrun();
+	testFlush();
+	return testResult("test_logger");
+}
@@ -0,0 +1,283 @@
+/*
+ * test_obd2.cpp
+ *
+ * Replay of a fault storm: faults are raised, repeated and cancelled in a burst
+ * while the drive train state changes. Afterwards the freeze frames have to hold
+ * the state of the moment each new fault was raised and the OBD2 mode 2 / 3 replies
+ * (directly, over CAN via CanPIDListener and as text via the ELM327 emulator) have
+ * to match them.
+ *
+Copyright (c) 2013-14 Collin Kidder, Michael Neuweiler, Charles Galpin
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+ */
+
+#include "host.h"
+#include "test.h"
+#include "FaultHandler.h"
+#include "OBD2Handler.h"
+#include "CanPIDListener.h"
+#include "ELM327Processor.h"
+
+#define NEW_FAULTS	12 // more than CFG_FREEZE_FRAME_COUNT, so the ring wraps
+
+/*
+ * A motor controller whose state is set by the test. Like all devices it registers
+ * with the DeviceManager, so it must never be deleted.
+ */
+class BenchController: public MotorController {
+public:
+	BenchController() {
+		prefsHandler = new PrefHandler(DMOC645);
+	}
+
+	DeviceId getId() {
+		return DMOC645;
+	}
+
+	void set(int16_t throttle, int16_t speed, int16_t temperature) {
+		throttleRequested = throttle;
+		speedActual = speed;
+		temperatureInverter = temperature;
+	}
+};
+
+static BenchController *controller;
+static CanPIDListener *pidListener;
+
+static uint16_t faultCode(int i) {
+	return 0x0A00 + i; // P0A00.. - hybrid / EV propulsion system codes
+}
+
+// the state of the drive train at the time fault i was raised
+static int16_t speedOf(int i) {
+	return 1000 + i * 250;
+}
+
+static int16_t throttleOf(int i) {
+	return 100 + i * 50;
+}
+
+static int16_t temperatureOf(int i) {
+	return 200 + i * 30; // 0.1 deg C
+}
+
+/*
+ * Every new fault is raised with its own drive train state. Each one is repeated and
+ * cancelled a few times and the new faults are interleaved with repeats of older
+ * ones, those must neither capture a freeze frame nor change one.
+ */
+static void replayStorm() {
+	for (int i = 0; i < NEW_FAULTS; i++) {
+		controller->set(throttleOf(i), speedOf(i), temperatureOf(i));
+		faultHandler.raiseFault(DMOC645, faultCode(i), true);
+
+		controller->set(-500, 9999, 1500); // whatever happens afterwards isn't part of the freeze frame
+		for (int j = 0; j < 5; j++) {
+			faultHandler.cancelOngoingFault(DMOC645, faultCode(i));
+			hostAdvance(20000);
+			faultHandler.raiseFault(DMOC645, faultCode(i), true);
+			faultHandler.raiseFault(DMOC645, faultCode(i / 2), false);
+		}
+		if (i % 3 == 0)
+			faultHandler.cancelOngoingFault(DMOC645, faultCode(i));
+	}
+}
+
+/*
+ * Frame 0 is the newest, the ring only keeps the last CFG_FREEZE_FRAME_COUNT
+ */
+static void testFreezeFrames() {
+	FREEZE_FRAME frame;
+	int failures = 0;
+
+	for (int n = 0; n < CFG_FREEZE_FRAME_COUNT; n++) {
+		int i = NEW_FAULTS - 1 - n;
+		if (!faultHandler.getFreezeFrame(n, &frame) || frame.faultCode != faultCode(i) || frame.device != DMOC645
+				|| frame.speedActual != speedOf(i) || frame.throttle != throttleOf(i)
+				|| frame.temperatureInverter != temperatureOf(i)) {
+			printf("  freeze frame %d doesn't match fault %d\n", n, i);
+			failures++;
+		}
+	}
+	CHECK_EQUAL(0, failures);
+	CHECK(!faultHandler.getFreezeFrame(CFG_FREEZE_FRAME_COUNT, &frame));
+}
+
+/*
+ * Mode 2 replies are "42 PID FRNO data", the frame number is echoed
+ */
+static void testMode2() {
+	char out[8], frameNumber;
+	int i;
+
+	frameNumber = 0;
+	CHECK(OBD2Handler::getInstance()->processRequest(2, 0x0C, &frameNumber, out));
+	i = NEW_FAULTS - 1;
+	CHECK_EQUAL(3, out[0]);
+	CHECK_EQUAL(0x42, out[1]);
+	CHECK_EQUAL(0x0C, out[2]);
+	CHECK_EQUAL(0, out[3]);
+	CHECK_EQUAL(speedOf(i) * 4, ((uint8_t) out[4] << 8) | (uint8_t) out[5]);
+
+	frameNumber = 3;
+	i = NEW_FAULTS - 1 - 3;
+	CHECK(OBD2Handler::getInstance()->processRequest(2, 0x02, &frameNumber, out));
+	CHECK_EQUAL(3, out[0]);
+	CHECK_EQUAL(3, out[3]);
+	CHECK_EQUAL(faultCode(i), ((uint8_t) out[4] << 8) | (uint8_t) out[5]);
+
+	CHECK(OBD2Handler::getInstance()->processRequest(2, 0x05, &frameNumber, out));
+	CHECK_EQUAL(2, out[0]);
+	CHECK_EQUAL(3, out[3]);
+	CHECK_EQUAL(temperatureOf(i) / 10 + 40, (uint8_t) out[4]);
+
+	CHECK(OBD2Handler::getInstance()->processRequest(2, 0x11, &frameNumber, out));
+	CHECK_EQUAL(2, out[0]);
+	CHECK_EQUAL(255 * (throttleOf(i) / 10) / 100, (uint8_t) out[4]);
+
+	CHECK(OBD2Handler::getInstance()->processRequest(2, 0x00, &frameNumber, out));
+	CHECK_EQUAL(5, out[0]);
+	CHECK_EQUAL(3, out[3]);
+	CHECK_EQUAL(0x48, (uint8_t) out[4]);
+
+	// without a frame number the newest one is used
+	CHECK(OBD2Handler::getInstance()->processRequest(2, 0x02, NULL, out));
+	CHECK_EQUAL(0, out[3]);
+	CHECK_EQUAL(faultCode(NEW_FAULTS - 1), ((uint8_t) out[4] << 8) | (uint8_t) out[5]);
+
+	frameNumber = CFG_FREEZE_FRAME_COUNT;
+	CHECK(!OBD2Handler::getInstance()->processRequest(2, 0x0C, &frameNumber, out));
+	CHECK(!OBD2Handler::getInstance()->processRequest(2, 0x0D, NULL, out)); // not supported
+}
+
+/*
+ * Mode 3 reports all un-acknowledged faults but only carries the newest two codes
+ */
+static void testMode3() {
+	char out[8];
+
+	CHECK(OBD2Handler::getInstance()->processRequest(3, 0, NULL, out));
+	CHECK_EQUAL(2 * OBD2_MAX_DTCS, out[0]);
+	CHECK_EQUAL(0x43, out[1]);
+	CHECK_EQUAL(NEW_FAULTS, out[2]); // the repeats were counted on the existing records
+	CHECK_EQUAL(faultCode(NEW_FAULTS - 1), ((uint8_t) out[3] << 8) | (uint8_t) out[4]);
+	CHECK_EQUAL(faultCode(NEW_FAULTS - 2), ((uint8_t) out[5] << 8) | (uint8_t) out[6]);
+}
+
+static CAN_FRAME request(uint8_t length, uint8_t mode, uint8_t pid, uint8_t frameNumber) {
+	CAN_FRAME frame;
+
+	memset(&frame, 0x55, sizeof(frame)); // the padding of the request mustn't be taken as data
+	frame.id = 0x7DF;
+	frame.length = 8;
+	frame.extended = 0;
+	frame.data.bytes[0] = length;
+	frame.data.bytes[1] = mode;
+	frame.data.bytes[2] = pid;
+	if (length >= 3)
+		frame.data.bytes[3] = frameNumber;
+	return frame;
+}
+
+/*
+ * The replies are sent as single CAN frames with the number of bytes in byte 0
+ */
+static void testCan() {
+	CAN_FRAME frame;
+
+	CAN.sent.clear();
+	frame = request(3, 2, 0x0C, 1);
+	pidListener->handleCanFrame(&frame);
+	CHECK_EQUAL(1, CAN.sent.size());
+	frame = CAN.sent.front();
+	CAN.sent.pop_front();
+	CHECK_EQUAL(0x7E8, frame.id);
+	CHECK_EQUAL(5, frame.data.bytes[0]);
+	CHECK_EQUAL(0x42, frame.data.bytes[1]);
+	CHECK_EQUAL(0x0C, frame.data.bytes[2]);
+	CHECK_EQUAL(1, frame.data.bytes[3]);
+	CHECK_EQUAL(speedOf(NEW_FAULTS - 2) * 4, (frame.data.bytes[4] << 8) | frame.data.bytes[5]);
+
+	frame = request(2, 2, 0x00, 0); // no frame number, the largest reply fills the frame
+	pidListener->handleCanFrame(&frame);
+	CHECK_EQUAL(1, CAN.sent.size());
+	frame = CAN.sent.front();
+	CAN.sent.pop_front();
+	CHECK_EQUAL(7, frame.data.bytes[0]);
+	CHECK_EQUAL(0, frame.data.bytes[3]);
+	CHECK_EQUAL(0x48, frame.data.bytes[4]);
+	CHECK_EQUAL(0x00, frame.data.bytes[7]);
+
+	frame = request(1, 3, 0, 0);
+	pidListener->handleCanFrame(&frame);
+	CHECK_EQUAL(1, CAN.sent.size());
+	frame = CAN.sent.front();
+	CAN.sent.pop_front();
+	CHECK_EQUAL(6, frame.data.bytes[0]);
+	CHECK_EQUAL(0x43, frame.data.bytes[1]);
+	CHECK_EQUAL(NEW_FAULTS, frame.data.bytes[2]);
+	CHECK_EQUAL(faultCode(NEW_FAULTS - 1) >> 8, frame.data.bytes[3]);
+	CHECK_EQUAL(faultCode(NEW_FAULTS - 1) & 0xFF, frame.data.bytes[4]);
+}
+
+/*
+ * The ELM327 emulator takes the frame number as third byte of a mode 2 request
+ */
+static void testElm327() {
+	ELM327Processor elm;
+	char buffer[16];
+	String reply;
+
+	strcpy(buffer, "020c02");
+	reply = elm.processELMCmd(buffer);
+	sprintf(buffer, "420C02%04X", speedOf(NEW_FAULTS - 3) * 4);
+	CHECK(strstr(reply.c_str(), buffer) != NULL);
+
+	strcpy(buffer, "0202");
+	reply = elm.processELMCmd(buffer);
+	sprintf(buffer, "420200%04X", faultCode(NEW_FAULTS - 1));
+	CHECK(strstr(reply.c_str(), buffer) != NULL);
+
+	strcpy(buffer, "03");
+	reply = elm.processELMCmd(buffer);
+	sprintf(buffer, "43%02X%04X%04X", NEW_FAULTS, faultCode(NEW_FAULTS - 1), faultCode(NEW_FAULTS - 2));
+	CHECK(strstr(reply.c_str(), buffer) != NULL);
+}
+
+int main() {
+	hostSetupPrefs();
+	Logger::setLoglevel(Logger::Off); // every new fault is logged as error
+	delete new PrefHandler(DMOC645); // creates the entry in the device table
+	PrefHandler::setDeviceStatus(DMOC645, true);
+	controller = new BenchController();
+	pidListener = new CanPIDListener();
+	faultHandler.setup();
+
+	replayStorm();
+	testFreezeFrames();
+	testMode2();
+	testMode3();
+	testCan();
+	testElm327();
+
+	return testResult("test_obd2");
+}
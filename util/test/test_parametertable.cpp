@@ -0,0 +1,129 @@
+/*
+ * test_parametertable.cpp
+ *
+ * Tests of the parameter lookup: the table must be sorted for the binary search
+ * and find() must agree with a plain linear search for any name.
+ *
+Copyright (c) 2013-14 Collin Kidder, Michael Neuweiler, Charles Galpin
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+ */
+
+#include "host.h"
+#include "test.h"
+#include "ParameterTable.h"
+
+/*
+ * The reference: compare the name with every entry
+ */
+static const Parameter *linearFind(const char *name) {
+	for (uint8_t i = 0; i < ParameterTable::getCount(); i++) {
+		if (!strcasecmp(name, ParameterTable::get(i)->name))
+			return ParameterTable::get(i);
+	}
+	return NULL;
+}
+
+/*
+ * Every entry must be bigger than its predecessor, this also rules out duplicates
+ */
+static void testSortOrder() {
+	CHECK(ParameterTable::getCount() > 0);
+	CHECK(ParameterTable::get(ParameterTable::getCount()) == NULL);
+
+	for (uint8_t i = 1; i < ParameterTable::getCount(); i++) {
+		const char *previous = ParameterTable::get(i - 1)->name, *name = ParameterTable::get(i)->name;
+		if (!CHECK(strcasecmp(previous, name) < 0))
+			printf("  \"%s\" must be sorted after \"%s\"\n", previous, name);
+	}
+}
+
+static void testKnownNames() {
+	char name[32];
+
+	for (uint8_t i = 0; i < ParameterTable::getCount(); i++) {
+		const Parameter *parameter = ParameterTable::get(i);
+		CHECK(ParameterTable::find(parameter->name) == parameter);
+
+		strncpy(name, parameter->name, sizeof(name) - 1);
+		name[sizeof(name) - 1] = 0;
+		for (char *c = name; *c; c++)
+			*c = (islower(*c) ? toupper(*c) : tolower(*c));
+		CHECK(ParameterTable::find(name) == parameter);
+	}
+	CHECK(ParameterTable::find("") == NULL);
+	CHECK(ParameterTable::find("notAParameter") == NULL);
+}
+
+/*
+ * Names close to the real ones (one character changed, added or removed) and
+ * random ones must give the same result as the linear search.
+ */
+static void testFuzz() {
+	static const char characters[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789_=?~ ";
+	char name[40];
+	int mismatches = 0;
+
+	srand(1);
+	for (int round = 0; round < 20000; round++) {
+		size_t length;
+
+		if (round % 2) {
+			const char *base = ParameterTable::get(rand() % ParameterTable::getCount())->name;
+			strcpy(name, base);
+			length = strlen(name);
+			size_t position = rand() % (length + 1);
+			char c = characters[rand() % (sizeof(characters) - 1)];
+			switch (rand() % 3) {
+			case 0: // replace
+				if (position < length)
+					name[position] = c;
+				break;
+			case 1: // insert
+				memmove(&name[position + 1], &name[position], length - position + 1);
+				name[position] = c;
+				break;
+			case 2: // remove
+				if (position < length)
+					memmove(&name[position], &name[position + 1], length - position);
+				break;
+			}
+		} else {
+			length = rand() % 20;
+			for (size_t i = 0; i < length; i++)
+				name[i] = characters[rand() % (sizeof(characters) - 1)];
+			name[length] = 0;
+		}
+
+		if (ParameterTable::find(name) != linearFind(name)) {
+			if (mismatches++ < 10)
+				printf("  find(\"%s\") differs from the linear search\n", name);
+		}
+	}
+	CHECK_EQUAL(0, mismatches);
+}
+
+int main() {
+	testSortOrder();
+	testKnownNames();
+	testFuzz();
+	return testResult("test_parametertable");
+}
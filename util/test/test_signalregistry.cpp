@@ -0,0 +1,119 @@
+/*
+ * test_signalregistry.cpp
+ *
+ * Subscribers of the SignalRegistry are only notified if a value moved further
+ * than their deadband, this has to hold over the whole range of the 32 bit types
+ * (the difference of two int32 values doesn't fit into an int32 and uint32 values
+ * above 0x7FFFFFFF are negative when read as int32).
+ *
+Copyright (c) 2013-14 Collin Kidder, Michael Neuweiler, Charles Galpin
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+ */
+
+#include "host.h"
+#include "test.h"
+#include "SignalRegistry.h"
+
+#define DEADBAND 100
+
+/*
+ * Counts the notifications and keeps the last value
+ */
+class CountingObserver: public SignalObserver {
+public:
+	int notifications;
+	int32_t value;
+
+	CountingObserver() {
+		notifications = 0;
+		value = 0;
+	}
+
+	void handleSignal(uint8_t signal, int32_t value) {
+		notifications++;
+		this->value = value;
+	}
+};
+
+static int32_t signedValue;
+static uint32_t unsignedValue;
+static CountingObserver signedObserver, unsignedObserver;
+
+/*
+ * Set both values, run the registry and return whether the observer was notified
+ */
+static bool changeSigned(int32_t value) {
+	int notifications = signedObserver.notifications;
+
+	signedValue = value;
+	hostAdvance(10000);
+	SignalRegistry::getInstance()->handleTick();
+	return signedObserver.notifications != notifications;
+}
+
+static bool changeUnsigned(uint32_t value) {
+	int notifications = unsignedObserver.notifications;
+
+	unsignedValue = value;
+	hostAdvance(10000);
+	SignalRegistry::getInstance()->handleTick();
+	return unsignedObserver.notifications != notifications;
+}
+
+static void testSigned() {
+	CHECK(changeSigned(-0x7FFFFFFF - 1)); // notified
+	CHECK(!changeSigned(-0x7FFFFFFF - 1 + DEADBAND));
+	CHECK(changeSigned(0x7FFFFFFF)); // the difference overflowed to -1
+	CHECK_EQUAL(0x7FFFFFFF, signedObserver.value);
+	CHECK(!changeSigned(0x7FFFFFFF - DEADBAND));
+	CHECK(changeSigned(-1)); // the difference is -2^31, abs() of which is negative
+	CHECK(!changeSigned(DEADBAND - 1));
+	CHECK(changeSigned(DEADBAND + 1));
+}
+
+static void testUnsigned() {
+	CHECK(!changeUnsigned(DEADBAND)); // 0 was notified initially
+	CHECK(changeUnsigned(0xFFFFFFFF)); // -1 as int32, so the distance looked like 1
+	CHECK_EQUAL(0xFFFFFFFF, (uint32_t) unsignedObserver.value);
+	CHECK(!changeUnsigned(0xFFFFFFFF - DEADBAND));
+	CHECK(changeUnsigned(0x80000000));
+	CHECK(!changeUnsigned(0x7FFFFFFFu + DEADBAND)); // across the sign bit of int32
+	CHECK(!changeUnsigned(0x80000000u - DEADBAND));
+	CHECK(changeUnsigned(0x80000000u + DEADBAND + 1));
+}
+
+int main() {
+	SignalRegistry *registry = SignalRegistry::getInstance();
+
+	registry->publish("signedTest", "", 0, &signedValue);
+	registry->publish("unsignedTest", "", 0, &unsignedValue);
+	registry->subscribe(&signedObserver, "signedTest", 0, DEADBAND);
+	registry->subscribe(&unsignedObserver, "unsignedTest", 0, DEADBAND);
+	registry->handleTick(); // initial notification
+	CHECK_EQUAL(1, signedObserver.notifications);
+	CHECK_EQUAL(1, unsignedObserver.notifications);
+
+	testSigned();
+	testUnsigned();
+
+	return testResult("test_signalregistry");
+}
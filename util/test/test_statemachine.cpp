@@ -0,0 +1,270 @@
+/*
+ * test_statemachine.cpp
+ *
+ * Walks the controller state machine of MotorController through its transition
+ * table: precharge, communication loss, controller ready / lost, faults, standby
+ * timeout and power down. The controller is simulated, its CAN frames, readiness
+ * and fault flag are set by the test.
+ *
+Copyright (c) 2013-14 Collin Kidder, Michael Neuweiler, Charles Galpin
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+ */
+
+#include "host.h"
+#include "test.h"
+#include "MotorController.h"
+
+#define TICK		10 // ms, the motor controllers tick every 10ms
+#define PRECHARGE	1000 // ms
+#define PRECHARGE_RELAY	0
+#define MAIN_CONTACTOR	1
+#define TIMEOUT		0xff // cause of a transition by timeout in the state log
+
+typedef MotorController::ControllerState State;
+typedef MotorController::OperationState Request;
+
+/*
+ * A motor controller whose CAN frames, readiness and faults are simulated.
+ * Like all devices it registers with the DeviceManager, so it must never be deleted.
+ */
+class StateController: public MotorController {
+public:
+	MotorControllerConfiguration configuration;
+	bool sending; // the controller sends CAN frames
+	bool controllerReady; // the controller reports it is ready to enable the power stage
+
+	StateController() {
+		memset(&configuration, 0, sizeof(configuration));
+		configuration.speedMax = 6000;
+		configuration.torqueMax = 3000;
+		configuration.torqueSlewRate = 6000;
+		configuration.slewRampTime = 100;
+		configuration.nominalVolt = 3000;
+		configuration.prechargeR = PRECHARGE;
+		configuration.prechargeRelay = PRECHARGE_RELAY;
+		configuration.mainContactorRelay = MAIN_CONTACTOR;
+		configuration.coolFan = configuration.brakeLight = configuration.revLight = 255;
+		configuration.enableIn = configuration.reverseIn = 255;
+		setConfiguration(&configuration);
+		prefsHandler = new PrefHandler(DMOC645);
+		sending = false;
+		controllerReady = false;
+	}
+
+	DeviceId getId() {
+		return DMOC645;
+	}
+
+	bool isControllerReady() {
+		return controllerReady;
+	}
+
+	void setFaulted(bool fault) {
+		faulted = fault;
+	}
+
+	void run(uint32_t milliseconds) {
+		for (uint32_t time = 0; time < milliseconds; time += TICK) {
+			hostAdvance(TICK * 1000);
+			if (sending)
+				reportActivity();
+			handleTick();
+		}
+	}
+
+	/*
+	 * Was the transition taken since the log was last cleared? cause is the index
+	 * in the transition table or TIMEOUT, -1 accepts any cause.
+	 */
+	bool logged(State from, State to, int cause) {
+		for (int i = 0; i < CFG_STATE_LOG_SIZE; i++) {
+			StateLogEntry *entry = &stateLog[i];
+			if (entry->timestamp != 0 && entry->from == from && entry->to == to && (cause == -1 || entry->cause == cause))
+				return true;
+		}
+		return false;
+	}
+
+	void clearLog() {
+		memset(stateLog, 0, sizeof(stateLog));
+	}
+
+	int loggedTransitions() {
+		int count = 0;
+
+		for (int i = 0; i < CFG_STATE_LOG_SIZE; i++) {
+			if (stateLog[i].timestamp != 0)
+				count++;
+		}
+		return count;
+	}
+};
+
+/*
+ * One row of the scenario: the inputs are applied for the given time, afterwards
+ * the state machine has to be in the expected state and stay there (no oscillation
+ * between states whose conditions are true at the same time).
+ */
+struct Step {
+	const char *description;
+	Request request;
+	bool sending;
+	bool ready;
+	bool faulted;
+	uint32_t duration; // ms
+	State expected;
+};
+
+static const Step steps[] = {
+	{ "precharging", MotorController::DISABLED, true, false, false, PRECHARGE - 100, MotorController::CS_PRECHARGE },
+	{ "precharge done", MotorController::DISABLED, true, false, false, 200, MotorController::CS_DISABLED },
+	{ "standby requested", MotorController::ENABLE, true, false, false, 100, MotorController::CS_STANDBY },
+	{ "controller gets ready", MotorController::ENABLE, true, true, false, 100, MotorController::CS_ENABLED },
+	{ "controller lost", MotorController::ENABLE, true, false, false, 100, MotorController::CS_STANDBY },
+	{ "controller back", MotorController::ENABLE, true, true, false, 100, MotorController::CS_ENABLED },
+	{ "only standby", MotorController::STANDBY, true, true, false, 100, MotorController::CS_STANDBY },
+	{ "enable again", MotorController::ENABLE, true, true, false, 100, MotorController::CS_ENABLED },
+	{ "CAN still alive", MotorController::ENABLE, false, true, false, CFG_STATE_OFFLINE_TIMEOUT - 100, MotorController::CS_ENABLED },
+	{ "CAN lost", MotorController::ENABLE, false, true, false, 200, MotorController::CS_OFFLINE },
+	{ "stays offline", MotorController::ENABLE, false, true, true, 1000, MotorController::CS_OFFLINE },
+	{ "CAN back", MotorController::ENABLE, true, true, false, 100, MotorController::CS_ENABLED },
+	{ "fault", MotorController::ENABLE, true, true, true, 100, MotorController::CS_FAULTED },
+	{ "stays faulted", MotorController::ENABLE, true, true, true, 1000, MotorController::CS_FAULTED },
+	{ "fault cleared", MotorController::ENABLE, true, true, false, 100, MotorController::CS_ENABLED },
+	{ "disable", MotorController::DISABLED, true, true, false, 100, MotorController::CS_DISABLED },
+	{ "power down", MotorController::POWERDOWN, true, true, false, 100, MotorController::CS_POWERDOWN },
+	{ "stays powered down", MotorController::POWERDOWN, true, true, false, 1000, MotorController::CS_POWERDOWN },
+	{ "fault while powered down", MotorController::POWERDOWN, true, true, true, 100, MotorController::CS_FAULTED },
+	{ "power down again", MotorController::POWERDOWN, true, true, false, 100, MotorController::CS_POWERDOWN },
+	{ "power down released", MotorController::DISABLED, true, true, false, 100, MotorController::CS_DISABLED },
+	{ "enable", MotorController::ENABLE, true, true, false, 100, MotorController::CS_ENABLED },
+	{ "CAN lost while powering down", MotorController::POWERDOWN, false, true, false, CFG_STATE_OFFLINE_TIMEOUT + 100, MotorController::CS_OFFLINE }
+};
+
+static void testTransitionTable() {
+	StateController *controller = new StateController();
+	int failures = 0;
+
+	controller->setup(); // starts over with its own precharge
+	for (uint8_t i = 0; i < sizeof(steps) / sizeof(Step); i++) {
+		const Step *step = &steps[i];
+
+		controller->setOpState(step->request);
+		controller->sending = step->sending;
+		controller->controllerReady = step->ready;
+		controller->setFaulted(step->faulted);
+		controller->run(step->duration);
+		controller->clearLog();
+		controller->run(5 * TICK);
+		if (controller->getControllerState() != step->expected || controller->loggedTransitions() != 0) {
+			printf("  %s: state %s, expected %s (%d transitions)\n", step->description,
+					MotorController::getStateName(controller->getControllerState()), MotorController::getStateName(step->expected),
+					controller->loggedTransitions());
+			failures++;
+		}
+	}
+	CHECK_EQUAL(0, failures);
+}
+
+/*
+ * The main contactor is closed when leaving the precharge state, not before
+ */
+static void testPrecharge(StateController *controller) {
+	CHECK_EQUAL(MotorController::CS_PRECHARGE, controller->getControllerState());
+	CHECK(getOutput(PRECHARGE_RELAY));
+	CHECK(!getOutput(MAIN_CONTACTOR));
+
+	controller->sending = true;
+	controller->run(PRECHARGE - 100);
+	CHECK_EQUAL(MotorController::CS_PRECHARGE, controller->getControllerState());
+	CHECK(!getOutput(MAIN_CONTACTOR));
+	controller->run(200);
+	CHECK(controller->logged(MotorController::CS_PRECHARGE, MotorController::CS_OFFLINE, 0));
+	CHECK(controller->logged(MotorController::CS_OFFLINE, MotorController::CS_DISABLED, -1));
+	CHECK(getOutput(MAIN_CONTACTOR));
+	CHECK(getOutput(PRECHARGE_RELAY)); // stays on
+}
+
+/*
+ * If the controller doesn't get ready in time, the standby state times out and
+ * starts over from disabled
+ */
+static void testStandbyTimeout(StateController *controller) {
+	controller->setOpState(MotorController::DISABLED);
+	controller->sending = true;
+	controller->controllerReady = false;
+	controller->setFaulted(false);
+	controller->run(100);
+	CHECK_EQUAL(MotorController::CS_DISABLED, controller->getControllerState());
+
+	controller->clearLog();
+	controller->setOpState(MotorController::ENABLE);
+	controller->run(CFG_STATE_STANDBY_TIMEOUT - 100);
+	CHECK_EQUAL(MotorController::CS_STANDBY, controller->getControllerState());
+	CHECK(!controller->logged(MotorController::CS_STANDBY, MotorController::CS_DISABLED, TIMEOUT));
+	controller->run(200);
+	CHECK(controller->logged(MotorController::CS_STANDBY, MotorController::CS_DISABLED, TIMEOUT));
+	CHECK_EQUAL(MotorController::CS_STANDBY, controller->getControllerState()); // the request is still there
+
+	controller->controllerReady = true;
+	controller->run(100);
+	CHECK_EQUAL(MotorController::CS_ENABLED, controller->getControllerState());
+}
+
+/*
+ * Commands are only passed on in the enabled state
+ */
+static void testThrottleHeld(StateController *controller) {
+	controller->setOpState(MotorController::ENABLE);
+	controller->sending = true;
+	controller->controllerReady = true;
+	controller->run(1000);
+	CHECK_EQUAL(MotorController::CS_ENABLED, controller->getControllerState());
+
+	controller->setFaulted(true);
+	controller->run(100);
+	CHECK_EQUAL(MotorController::CS_FAULTED, controller->getControllerState());
+	CHECK_EQUAL(0, controller->getThrottle());
+	controller->setFaulted(false);
+}
+
+static void testStateNames() {
+	CHECK(!strcmp("precharge", MotorController::getStateName(MotorController::CS_PRECHARGE)));
+	CHECK(!strcmp("powerdown", MotorController::getStateName(MotorController::CS_POWERDOWN)));
+	CHECK(!strcmp("unknown", MotorController::getStateName(MotorController::CS_ANY)));
+	CHECK(!strcmp("unknown", MotorController::getStateName((State) 42)));
+}
+
+int main() {
+	hostSetupPrefs();
+	Logger::setLoglevel(Logger::Off); // every transition is logged
+
+	StateController *controller = new StateController();
+	controller->setup(); // starts the precharge
+	testPrecharge(controller);
+	testStandbyTimeout(controller);
+	testThrottleHeld(controller);
+	testTransitionTable();
+	testStateNames();
+
+	return testResult("test_statemachine");
+}
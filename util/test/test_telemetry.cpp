@@ -0,0 +1,337 @@
+/*
+ * test_telemetry.cpp
+ *
+ * Round trip of the telemetry records: the values published in the SignalRegistry
+ * are encoded by Telemetry and decoded again like util/telemetry/telemetry_recorder.py
+ * does it. Keyframes, deltas of all sizes, sequence gaps and the longest possible
+ * record are covered.
+ *
+Copyright (c) 2013-14 Collin Kidder, Michael Neuweiler, Charles Galpin
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+ */
+
+#include "host.h"
+#include "test.h"
+#include "Telemetry.h"
+
+/*
+ * The Decoder class of telemetry_recorder.py, keep the two in sync
+ */
+class Decoder {
+public:
+	int16_t values[Telemetry::NUM_SIGNALS];
+	bool valid; // values holds a complete set (a keyframe was received since the last gap)
+	uint32_t time;
+	int sequence; // of the last record, -1 before the first one
+	int records;
+	int lost;
+	int recordType;
+
+	Decoder() {
+		valid = false;
+		time = 0;
+		sequence = -1;
+		records = lost = 0;
+	}
+
+	/*
+	 * Decode one line, returns false if it doesn't result in a set of values
+	 */
+	bool decode(const char *line) {
+		uint8_t data[TELEMETRY_RECORD_LENGTH];
+		int length = decodeBase64(line, data);
+
+		if (length < 2 || (data[0] >> 4) != TELEMETRY_VERSION)
+			return false;
+
+		recordType = data[0] & 0x0F;
+		if (sequence != -1 && data[1] != ((sequence + 1) & 0xFF)) {
+			lost += (data[1] - sequence - 1) & 0xFF;
+			valid = false; // wait for the next keyframe
+		}
+		sequence = data[1];
+		records++;
+
+		if (recordType == Telemetry::KEYFRAME) {
+			if (length != 6 + 2 * Telemetry::NUM_SIGNALS)
+				return false;
+			time = data[2] | (data[3] << 8) | (data[4] << 16) | ((uint32_t) data[5] << 24);
+			for (int i = 0; i < Telemetry::NUM_SIGNALS; i++)
+				values[i] = (int16_t) (data[6 + 2 * i] | (data[7 + 2 * i] << 8));
+			valid = true;
+		} else if (recordType == Telemetry::DELTA) {
+			if (!valid || length < 5)
+				return false;
+			time += data[2];
+			uint16_t changed = data[3] | (data[4] << 8);
+			int pos = 5;
+			for (int i = 0; i < Telemetry::NUM_SIGNALS; i++) {
+				if (changed & (1 << i)) {
+					uint32_t zigzag = 0;
+					int shift = 0;
+					uint8_t byte;
+					do {
+						byte = data[pos++];
+						zigzag |= (uint32_t) (byte & 0x7F) << shift;
+						shift += 7;
+					} while (byte & 0x80);
+					int32_t delta = (int32_t) (zigzag >> 1) ^ -(int32_t) (zigzag & 1);
+					values[i] = (int16_t) (values[i] + delta);
+				}
+			}
+		} else
+			return false;
+		return true;
+	}
+
+private:
+	/*
+	 * Strict base64 like b64decode(validate=True), the trailing newline is stripped.
+	 * Returns the number of bytes or -1 if the line isn't valid base64.
+	 */
+	static int decodeBase64(const char *line, uint8_t *data) {
+		static const char chars[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+		int characters = strlen(line), length = 0;
+
+		while (characters > 0 && isspace(line[characters - 1]))
+			characters--;
+		if (characters % 4 != 0 || characters / 4 * 3 > TELEMETRY_RECORD_LENGTH)
+			return -1;
+		for (int i = 0; i < characters; i += 4) {
+			uint32_t triple = 0;
+			int padding = 0;
+			for (int j = 0; j < 4; j++) {
+				const char *c = strchr(chars, line[i + j]);
+				if (line[i + j] == '=' && i + 4 == characters && j >= 2)
+					padding++;
+				else if (c == NULL || line[i + j] == 0 || padding)
+					return -1;
+				else
+					triple |= (uint32_t) (c - chars) << (18 - 6 * j);
+			}
+			data[length++] = triple >> 16;
+			if (padding < 2)
+				data[length++] = (triple >> 8) & 0xFF;
+			if (padding < 1)
+				data[length++] = triple & 0xFF;
+		}
+		return length;
+	}
+};
+
+/*
+ * The variables behind the signals, like the devices publish them
+ */
+static int16_t levels[Telemetry::NUM_SIGNALS];
+static uint8_t controllerState, gear, stateOfCharge, digitalInputs, digitalOutputs;
+
+static Telemetry *telemetry;
+static char record[TELEMETRY_RECORD_LENGTH];
+
+static void publish() {
+	static const char *names[Telemetry::NUM_SIGNALS] = { Constants::throttleLevel, Constants::brakeLevel,
+			Constants::torqueRequested, Constants::torqueActual, Constants::speedRequested, Constants::speedActual,
+			Constants::dcVoltage, Constants::dcCurrent, Constants::acCurrent, Constants::tempMotor, Constants::tempInverter,
+			Constants::mechPower, NULL, Constants::bmsVoltage, Constants::bmsCurrent, NULL };
+	SignalRegistry *registry = SignalRegistry::getInstance();
+
+	for (int i = 0; i < Telemetry::NUM_SIGNALS; i++) {
+		if (names[i])
+			registry->publish(names[i], "", 0, &levels[i]);
+	}
+	registry->publish(Constants::controllerState, "", 0, &controllerState);
+	registry->publish(Constants::gear, "", 0, &gear);
+	registry->publish(Constants::stateOfCharge, "%", 0, &stateOfCharge);
+	registry->publish(Constants::digitalInputs, "", 0, &digitalInputs);
+	registry->publish(Constants::digitalOutputs, "", 0, &digitalOutputs);
+}
+
+/*
+ * The values the receiver should get, STATUS and IO are composed like in Telemetry::sample()
+ */
+static void expectedValues(int16_t *values) {
+	memcpy(values, levels, sizeof(levels));
+	values[Telemetry::STATUS] = controllerState | (gear << 4) | (stateOfCharge << 8);
+	values[Telemetry::IO] = digitalInputs | (digitalOutputs << 8);
+}
+
+/*
+ * Let the time pass, sample the signals and encode a record. Returns its length.
+ */
+static uint8_t encode(uint32_t ms) {
+	hostAdvance(ms * 1000);
+	SignalRegistry::getInstance()->handleTick();
+	return telemetry->encode(record);
+}
+
+/*
+ * Check that the decoder got exactly what was published
+ */
+static bool matches(Decoder *decoder) {
+	int16_t values[Telemetry::NUM_SIGNALS];
+
+	expectedValues(values);
+	if (decoder->time != millis()) {
+		printf("  time %lu, expected %lu\n", (unsigned long) decoder->time, (unsigned long) millis());
+		return false;
+	}
+	for (int i = 0; i < Telemetry::NUM_SIGNALS; i++) {
+		if (decoder->values[i] != values[i]) {
+			printf("  value %d is %d, expected %d\n", i, decoder->values[i], values[i]);
+			return false;
+		}
+	}
+	return true;
+}
+
+static int16_t randomValue() {
+	return (int16_t) (rand() & 0xFFFF);
+}
+
+/*
+ * Records must be a single line which the iChip and the receiver can take as it is
+ */
+static bool isLine(uint8_t length) {
+	return length < TELEMETRY_RECORD_LENGTH && strlen(record) == length && record[length - 1] == '\n'
+			&& strchr(record, '\r') == NULL && strchr(record, '\n') == &record[length - 1];
+}
+
+/*
+ * Random walks, jumps and pauses of all values: every record must decode to the
+ * published values. Longer pauses than 255ms (and every CFG_TELEMETRY_KEYFRAME
+ * records) require a keyframe.
+ */
+static void testRoundTrip() {
+	Decoder decoder;
+	int keyframes = 0, deltas = 0, failures = 0, invalidLines = 0;
+
+	telemetry->reset();
+	for (int n = 0; n < 20000; n++) {
+		for (int i = 0; i < Telemetry::NUM_SIGNALS; i++) {
+			int dice = rand() % 100;
+			if (dice < 30)
+				levels[i] += rand() % 7 - 3;
+			else if (dice < 32)
+				levels[i] = randomValue();
+		}
+		controllerState = rand() % 16;
+		gear = rand() % 4;
+		if (rand() % 50 == 0)
+			stateOfCharge = rand() % 101;
+		digitalInputs = rand() % 16;
+		digitalOutputs = rand() % 256;
+
+		uint8_t length = encode(rand() % 100 == 0 ? 256 + rand() % 1000 : 1 + rand() % 100);
+		if (!isLine(length))
+			invalidLines++;
+		if (!decoder.decode(record) || !matches(&decoder)) {
+			if (failures++ < 5)
+				printf("  record %d failed: %s", n, record);
+		}
+		if (decoder.recordType == Telemetry::KEYFRAME)
+			keyframes++;
+		else
+			deltas++;
+	}
+	CHECK_EQUAL(0, failures);
+	CHECK_EQUAL(0, invalidLines);
+	CHECK_EQUAL(0, decoder.lost); // the sequence number wraps around without a gap
+	CHECK(keyframes >= 20000 / (CFG_TELEMETRY_KEYFRAME + 1));
+	CHECK(deltas > keyframes);
+}
+
+/*
+ * Every value jumps across the whole int16 range, the deltas need three bytes each.
+ * The record must still fit into TELEMETRY_RECORD_LENGTH.
+ */
+static void testLongestRecord() {
+	Decoder decoder;
+	uint8_t length;
+
+	telemetry->reset();
+	for (int n = 0; n < 4; n++) {
+		for (int i = 0; i < Telemetry::NUM_SIGNALS; i++)
+			levels[i] = (n % 2 ? 32767 : -32768);
+		controllerState = 15;
+		gear = 3;
+		stateOfCharge = (n % 2 ? 127 : 128);
+		digitalInputs = (n % 2 ? 0 : 255);
+		digitalOutputs = (n % 2 ? 127 : 128);
+
+		length = encode(10);
+		CHECK(isLine(length));
+		CHECK(decoder.decode(record) && matches(&decoder));
+		CHECK_EQUAL(n == 0 ? Telemetry::KEYFRAME : Telemetry::DELTA, decoder.recordType);
+	}
+}
+
+/*
+ * A lost record: the following deltas can't be applied, the receiver waits for the next keyframe
+ */
+static void testGap() {
+	Decoder decoder;
+	int skipped = 0;
+
+	telemetry->reset();
+	encode(10);
+	CHECK(decoder.decode(record) && matches(&decoder));
+	levels[Telemetry::SPEED_ACTUAL] += 100;
+	encode(10); // lost on its way
+	for (int n = 0; n < CFG_TELEMETRY_KEYFRAME * 2; n++) {
+		levels[Telemetry::SPEED_ACTUAL] += 100;
+		encode(10);
+		if (decoder.decode(record))
+			break;
+		skipped++;
+	}
+	CHECK_EQUAL(1, decoder.lost);
+	CHECK_EQUAL(Telemetry::KEYFRAME, decoder.recordType);
+	CHECK(skipped > 0 && skipped < CFG_TELEMETRY_KEYFRAME);
+	CHECK(matches(&decoder));
+}
+
+/*
+ * Nothing changed: a delta record only holds the header
+ */
+static void testUnchanged() {
+	Decoder decoder;
+
+	telemetry->reset();
+	encode(10);
+	CHECK(decoder.decode(record));
+	CHECK_EQUAL(9, encode(20)); // 5 bytes are 8 characters in base64, plus the newline
+	CHECK(decoder.decode(record) && matches(&decoder));
+	CHECK_EQUAL(Telemetry::DELTA, decoder.recordType);
+}
+
+int main() {
+	srand(1);
+	hostSetTime(1000000);
+	publish();
+	telemetry = new Telemetry();
+
+	testRoundTrip();
+	testLongestRecord();
+	testGap();
+	testUnchanged();
+	return testResult("test_telemetry");
+}
@@ -0,0 +1,267 @@
+/*
+ * test_throttlecurve.cpp
+ *
+ * The throttle maps the pedal position with a lookup table which is built from the
+ * configuration. For every pedal position (0-1000) it has to return the same level
+ * as the calculation it replaced, for the throttle parameters as well as for user
+ * defined curves, and invalid curves must be refused.
+ *
+Copyright (c) 2013-14 Collin Kidder, Michael Neuweiler, Charles Galpin
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+ */
+
+#include "host.h"
+#include "test.h"
+#include "Throttle.h"
+
+/*
+ * A throttle without pedal, the position is passed to map() directly.
+ * Like all devices it registers with the DeviceManager, so it must never be deleted.
+ */
+class CurveThrottle: public Throttle {
+public:
+	ThrottleConfiguration configuration;
+
+	CurveThrottle() {
+		memset(&configuration, 0, sizeof(configuration));
+		setConfiguration(&configuration);
+		prefsHandler = new PrefHandler(POTACCELPEDAL);
+	}
+
+	DeviceId getId() {
+		return POTACCELPEDAL;
+	}
+
+	int16_t map(int16_t pedalPosition) {
+		return mapPedalPosition(pedalPosition);
+	}
+
+	PrefHandler *prefs() {
+		return prefsHandler;
+	}
+};
+
+/*
+ * The mapping as it was calculated on every tick before the lookup table was introduced
+ */
+static int16_t referenceLevel(ThrottleConfiguration *config, int16_t pedalPosition) {
+	int16_t throttleLevel, range, value;
+
+	throttleLevel = 0;
+
+	if (pedalPosition == 0 && config->creep > 0) {
+		throttleLevel = 10 * config->creep;
+	} else if (pedalPosition <= config->positionRegenMinimum) {
+		if (pedalPosition >= config->positionRegenMaximum) {
+			range = config->positionRegenMinimum - config->positionRegenMaximum;
+			value = pedalPosition - config->positionRegenMaximum;
+			if (range != 0)
+				throttleLevel = -10 * config->minimumRegen + (config->maximumRegen - config->minimumRegen) * (100 - value * 100 / range) / -10;
+		}
+	}
+
+	if (pedalPosition >= config->positionForwardMotionStart) {
+		if (pedalPosition <= config->positionHalfPower) {
+			range = config->positionHalfPower - config->positionForwardMotionStart;
+			value = pedalPosition - config->positionForwardMotionStart;
+			if (range != 0)
+				throttleLevel = 500 * value / range;
+		} else {
+			range = 1000 - config->positionHalfPower;
+			value = pedalPosition - config->positionHalfPower;
+			throttleLevel = 500 + 500 * value / range;
+		}
+	}
+
+	if (throttleLevel > 979) throttleLevel = 1000;
+
+	return throttleLevel;
+}
+
+/*
+ * Straight lines between the points, flat before the first and after the last one
+ */
+static int16_t referenceCurve(const int16_t *points, int count, int16_t pedalPosition) {
+	if (pedalPosition <= points[0])
+		return points[1];
+	for (int i = 1; i < count; i++) {
+		int32_t x0 = points[2 * i - 2], y0 = points[2 * i - 1], x1 = points[2 * i], y1 = points[2 * i + 1];
+		if (pedalPosition <= x1)
+			return y0 + (y1 - y0) * (pedalPosition - x0) / (x1 - x0);
+	}
+	return points[2 * count - 1];
+}
+
+static int compareParameters(CurveThrottle *throttle) {
+	int mismatches = 0;
+
+	for (int16_t position = 0; position <= 1000; position++) {
+		int16_t expected = referenceLevel(&throttle->configuration, position);
+		int16_t level = throttle->map(position);
+		if (level != expected && mismatches++ < 5)
+			printf("  position %d: level %d, expected %d\n", position, level, expected);
+	}
+	return mismatches;
+}
+
+static void setParameters(CurveThrottle *throttle, uint16_t regenMax, uint16_t regenMin, uint16_t forward, uint16_t halfPower,
+		uint8_t maximumRegen, uint8_t minimumRegen, uint8_t creep) {
+	ThrottleConfiguration *config = &throttle->configuration;
+
+	config->positionRegenMaximum = regenMax;
+	config->positionRegenMinimum = regenMin;
+	config->positionForwardMotionStart = forward;
+	config->positionHalfPower = halfPower;
+	config->maximumRegen = maximumRegen;
+	config->minimumRegen = minimumRegen;
+	config->creep = creep;
+	throttle->saveConfiguration(); // rebuilds the lookup table like a parameter change via the console
+}
+
+/*
+ * The defaults and the corner cases of the parameters: creep, no gap between regen and
+ * forward, min == max regen position, forward == half power and half power at 1000
+ */
+static void testParameters(CurveThrottle *throttle) {
+	throttle->loadConfiguration(); // erased EEPROM -> defaults
+	CHECK_EQUAL(0, compareParameters(throttle));
+	CHECK_EQUAL(0, throttle->map(ThrottleFwdValue));
+	CHECK_EQUAL(500, throttle->map(ThrottleMapValue));
+	CHECK_EQUAL(1000, throttle->map(1000));
+
+	setParameters(throttle, 0, 0, 0, 500, 0, 0, 0);
+	CHECK_EQUAL(0, compareParameters(throttle));
+	setParameters(throttle, 50, 250, 250, 600, 70, 10, 0);
+	CHECK_EQUAL(0, compareParameters(throttle));
+	setParameters(throttle, 100, 100, 150, 150, 30, 0, 5);
+	CHECK_EQUAL(0, compareParameters(throttle));
+	setParameters(throttle, 0, 400, 500, 1000, 100, 100, 20);
+	CHECK_EQUAL(0, compareParameters(throttle));
+	CHECK_EQUAL(200, throttle->map(0));
+
+	// positions outside 0-1000 are constrained
+	CHECK_EQUAL(throttle->map(0), throttle->map(-5));
+	CHECK_EQUAL(throttle->map(1000), throttle->map(1200));
+}
+
+static int compareCurve(CurveThrottle *throttle, const char *curve, const int16_t *points, int count) {
+	char buffer[80];
+	int mismatches = 0;
+
+	strcpy(buffer, curve);
+	if (!throttle->setCurve(buffer)) {
+		printf("  curve %s refused\n", curve);
+		return 1;
+	}
+	for (int16_t position = 0; position <= 1000; position++) {
+		int16_t expected = referenceCurve(points, count, position);
+		int16_t level = throttle->map(position);
+		if (level != expected && mismatches++ < 5)
+			printf("  curve %s, position %d: level %d, expected %d\n", curve, position, level, expected);
+	}
+	return mismatches;
+}
+
+static void testCurves(CurveThrottle *throttle) {
+	static const int16_t regen[] = { 0, -300, 250, 0, 300, 0, 600, 400, 1000, 1000 };
+	static const int16_t linear[] = { 0, 0, 1000, 1000 };
+	static const int16_t late[] = { 100, 0, 900, 1000 };
+	static const int16_t steps[] = { 0, 0, 1, 1000, 2, -1000, 500, -1000, 501, 700, 998, 0, 999, 1000, 1000, -1000 };
+	char buffer[40];
+
+	CHECK_EQUAL(0, compareCurve(throttle, "0:-300,250:0,300:0,600:400,1000:1000", regen, 5));
+	CHECK_EQUAL(0, compareCurve(throttle, "0:0,1000:1000", linear, 2));
+	CHECK_EQUAL(0, compareCurve(throttle, "100:0,900:1000", late, 2));
+	CHECK_EQUAL(0, compareCurve(throttle, "0:0,1:1000,2:-1000,500:-1000,501:700,998:0,999:1000,1000:-1000", steps, 8));
+
+	// removing the curve brings back the parameters
+	strcpy(buffer, "0");
+	CHECK(throttle->setCurve(buffer));
+	CHECK_EQUAL(0, compareParameters(throttle));
+}
+
+static bool refused(CurveThrottle *throttle, const char *curve) {
+	char buffer[120];
+
+	strcpy(buffer, curve);
+	return !throttle->setCurve(buffer) && throttle->configuration.curvePoints == 2 && throttle->map(500) == 250;
+}
+
+/*
+ * Invalid curves are refused by setCurve() and ignored when loaded from EEPROM,
+ * the previous mapping stays in effect
+ */
+static void testInvalidCurves(CurveThrottle *throttle) {
+	char buffer[40];
+
+	strcpy(buffer, "0:0,1000:500");
+	CHECK(throttle->setCurve(buffer));
+	CHECK(refused(throttle, "0:0,1001:1000"));
+	CHECK(refused(throttle, "-1:0,1000:1000"));
+	CHECK(refused(throttle, "0:0,1000:1001"));
+	CHECK(refused(throttle, "0:-1001,1000:1000"));
+	CHECK(refused(throttle, "0:0,500:100,400:200,1000:1000"));
+	CHECK(refused(throttle, "0:0,500:100,500:200,1000:1000"));
+	CHECK(refused(throttle, "500:100"));
+	CHECK(refused(throttle, "0:0,100:1,200:2,300:3,400:4,500:5,600:6,700:7,800:8"));
+	CHECK(refused(throttle, "0:0;1000:1000"));
+	CHECK(refused(throttle, "0:0,1000"));
+
+	// a saved curve is loaded again
+	setParameters(throttle, 0, 0, 0, 500, 0, 0, 0);
+	CHECK_EQUAL(2, throttle->configuration.curvePoints);
+	throttle->configuration.curvePoints = 0;
+	throttle->loadConfiguration();
+	CHECK_EQUAL(2, throttle->configuration.curvePoints);
+	CHECK_EQUAL(250, throttle->map(500));
+
+	// a level out of range in EEPROM discards the curve
+	throttle->prefs()->write(EETH_CURVE_START + 6, (uint16_t) 1500);
+	throttle->prefs()->saveChecksum();
+	throttle->loadConfiguration();
+	CHECK_EQUAL(0, throttle->configuration.curvePoints);
+	CHECK_EQUAL(0, compareParameters(throttle));
+
+	// as does a position which isn't ascending
+	strcpy(buffer, "200:0,700:1000");
+	CHECK(throttle->setCurve(buffer));
+	throttle->saveConfiguration();
+	throttle->prefs()->write(EETH_CURVE_START + 4, (uint16_t) 200);
+	throttle->prefs()->saveChecksum();
+	throttle->loadConfiguration();
+	CHECK_EQUAL(0, throttle->configuration.curvePoints);
+	CHECK_EQUAL(0, compareParameters(throttle));
+}
+
+int main() {
+	hostSetupPrefs();
+	Logger::setLoglevel(Logger::Off); // the invalid curves are logged as warning
+
+	CurveThrottle *throttle = new CurveThrottle();
+	throttle->setup();
+
+	testParameters(throttle);
+	testCurves(throttle);
+	testInvalidCurves(throttle);
+
+	return testResult("test_throttlecurve");
+}
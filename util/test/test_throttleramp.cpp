@@ -0,0 +1,185 @@
+/*
+ * test_throttleramp.cpp
+ *
+ * Step response of the throttle slew rate / jerk limiter of the MotorController
+ * and its behaviour while the controller is precharging or not enabled.
+ *
+Copyright (c) 2013-14 Collin Kidder, Michael Neuweiler, Charles Galpin
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+ */
+
+#include "host.h"
+#include "test.h"
+#include "MotorController.h"
+
+#define TICK 10000 // the motor controllers tick every 10ms
+
+/*
+ * A motor controller without a real one behind it. As there's no accelerator
+ * registered, the level set before handleTick() is taken as the pedal position.
+ * Like all devices it registers with the DeviceManager, so it must never be deleted.
+ */
+class RampController: public MotorController {
+public:
+	MotorControllerConfiguration configuration;
+
+	RampController() {
+		memset(&configuration, 0, sizeof(configuration));
+		configuration.speedMax = 6000;
+		configuration.torqueMax = 3000; // 300Nm
+		configuration.torqueSlewRate = 6000; // 600Nm/s -> full throttle in 0.5s
+		configuration.slewRampTime = 100;
+		configuration.nominalVolt = 3000;
+		configuration.prechargeR = 1000; // ms
+		configuration.prechargeRelay = 0;
+		configuration.mainContactorRelay = 1;
+		configuration.coolFan = configuration.brakeLight = configuration.revLight = 255;
+		configuration.enableIn = configuration.reverseIn = 255;
+		setConfiguration(&configuration);
+		prefsHandler = new PrefHandler(DMOC645);
+	}
+
+	DeviceId getId() {
+		return DMOC645;
+	}
+
+	int16_t ramp(int16_t target) {
+		hostAdvance(TICK);
+		limitThrottle(target);
+		return throttleRequested;
+	}
+
+	int16_t tick(int16_t pedal) {
+		hostAdvance(TICK);
+		reportActivity(); // the controller is alive
+		throttleRequested = pedal;
+		handleTick();
+		return throttleRequested;
+	}
+};
+
+/*
+ * Follow a step until the target is reached, the level must move monotonically,
+ * not faster than the slew rate and must not overshoot. Returns the number of ticks.
+ */
+static int followStep(RampController *controller, int16_t from, int16_t to, int32_t maxPerTick) {
+	int16_t previous = from;
+	int32_t previousDelta = 0;
+	int ticks = 0, violations = 0;
+
+	while (previous != to && ticks < 1000) {
+		int16_t level = controller->ramp(to);
+		int32_t delta = level - previous;
+
+		if ((to > from && (delta < 0 || level > to)) || (to < from && (delta > 0 || level < to))
+				|| abs(delta) > maxPerTick + 1) {
+			if (violations++ < 5)
+				printf("  tick %d: %d -> %d\n", ticks, previous, level);
+		}
+		if (abs(delta - previousDelta) > maxPerTick / 10 + 1) { // the rate changes by at most 1/10 per tick (100ms ramp time)
+			if (violations++ < 5)
+				printf("  tick %d: rate %d -> %d\n", ticks, previousDelta, delta);
+		}
+		previousDelta = delta;
+		previous = level;
+		ticks++;
+	}
+	CHECK_EQUAL(0, violations);
+	CHECK_EQUAL(to, previous);
+	return ticks;
+}
+
+static void testStepResponse() {
+	RampController &controller = *new RampController();
+	int ticks;
+
+	// 2000 per mille per second = 20 per tick, plus up to 100ms ramp up and down
+	ticks = followStep(&controller, 0, 1000, 20);
+	CHECK(ticks >= 50 && ticks <= 65);
+	ticks = followStep(&controller, 1000, -500, 20);
+	CHECK(ticks >= 75 && ticks <= 90);
+
+	// a long gap (e.g. a blocked loop) counts as CFG_SLEW_MAX_DT only
+	hostAdvance(5000000);
+	controller.ramp(1000);
+	int16_t level = controller.ramp(1000);
+	CHECK(level - (-500) <= (int32_t) 2000 * (CFG_SLEW_MAX_DT + TICK) / 1000000 + 1);
+
+	// without a slew rate the level follows immediately
+	controller.configuration.torqueSlewRate = 0;
+	CHECK_EQUAL(-1000, controller.ramp(-1000));
+	CHECK_EQUAL(700, controller.ramp(700));
+}
+
+/*
+ * Tick with the pedal held down until the controller is enabled. Until then the
+ * request must stay at zero, returns the first request once enabled.
+ */
+static int16_t tickUntilEnabled(RampController *controller, int *ticks) {
+	int16_t level;
+
+	for (*ticks = 0; *ticks < 1000; (*ticks)++) {
+		level = controller->tick(1000);
+		if (controller->getControllerState() == MotorController::CS_ENABLED)
+			break;
+		CHECK_EQUAL(0, level);
+	}
+	CHECK(controller->getControllerState() == MotorController::CS_ENABLED);
+	return level;
+}
+
+/*
+ * While precharging (and until the power stage is enabled) the pedal is held down.
+ * The ramp must not build up in the mean time, the first request once enabled is
+ * a small step only.
+ */
+static void testRampAfterPrecharge() {
+	RampController &controller = *new RampController();
+	int ticks;
+	int16_t level;
+
+	controller.setup(); // starts the precharge
+	level = tickUntilEnabled(&controller, &ticks);
+	CHECK(ticks >= 100); // precharge takes 1s
+	CHECK(level >= 0 && level <= 2);
+	level = controller.tick(1000);
+	CHECK(level > 0 && level <= 20);
+
+	// power stage disabled while the pedal is down: the request drops to zero and ramps up again
+	for (int i = 0; i < 50; i++)
+		level = controller.tick(1000);
+	CHECK(level > 500);
+	controller.setOpState(MotorController::DISABLED);
+	CHECK_EQUAL(0, controller.tick(1000));
+	for (int i = 0; i < 30; i++)
+		CHECK_EQUAL(0, controller.tick(1000));
+	controller.setOpState(MotorController::ENABLE);
+	level = tickUntilEnabled(&controller, &ticks);
+	CHECK(level >= 0 && level <= 2);
+}
+
+int main() {
+	hostSetupPrefs();
+	testStepResponse();
+	testRampAfterPrecharge();
+	return testResult("test_throttleramp");
+}
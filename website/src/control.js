@@ -86,30 +86,13 @@ function loadData(pageId) {
 					if (node.nodeType == 1 && node.childNodes[0]) {
 						var name = node.nodeName;
 						var value = node.childNodes[0].nodeValue;
-						refreshGaugeValue(name, value);
-						if (name.indexOf('bitfield') == -1) { // a normal div/span to update
-							var target = document.getElementById(name);
-							if (!target) { // id not found, try to find by name
-								var namedElements = document.getElementsByName(name);
-								if (namedElements && namedElements.length)
-									target = namedElements[0];
-							}
-							if (target) { // found an element, update according to its type
-								if (target.nodeName.toUpperCase() == 'DIV' || target.nodeName.toUpperCase() == 'SPAN')
-									target.innerHTML = value;
-								if (target.nodeName.toUpperCase() == 'INPUT') {
-									target.value = value;
-									var slider = document.getElementById(name + "Level");
-									if (slider)
-										slider.value = value;
-								}
-								if (target.nodeName.toUpperCase() == 'SELECT') {
-									selectItemByValue(target, value);
-								}
-							}
-						} else { // an annunciator field of a bitfield value
-							updateAnnunciatorFields(name, value);
-	//						updateAnnunciatorFields(name, Math.round(Math.random() * 100000));
+						if (name == 'values') { // comma separated values, the names are in the "names" attribute
+							var names = node.getAttribute('names').split(',');
+							var values = value.split(',');
+							for (var j = 0; j < names.length && j < values.length; j++)
+								refreshValue(names[j], values[j]);
+						} else {
+							refreshValue(name, value);
 						}
 					}
 				}
@@ -126,6 +109,34 @@ function loadData(pageId) {
 }
 
 // scan through the options of a select input field and activate the one with the given value
+// update a gauge and the div/span/input/select or annunciator field of a value
+function refreshValue(name, value) {
+	refreshGaugeValue(name, value);
+	if (name.indexOf('bitfield') == -1) { // a normal div/span to update
+		var target = document.getElementById(name);
+		if (!target) { // id not found, try to find by name
+			var namedElements = document.getElementsByName(name);
+			if (namedElements && namedElements.length)
+				target = namedElements[0];
+		}
+		if (target) { // found an element, update according to its type
+			if (target.nodeName.toUpperCase() == 'DIV' || target.nodeName.toUpperCase() == 'SPAN')
+				target.innerHTML = value;
+			if (target.nodeName.toUpperCase() == 'INPUT') {
+				target.value = value;
+				var slider = document.getElementById(name + "Level");
+				if (slider)
+					slider.value = value;
+			}
+			if (target.nodeName.toUpperCase() == 'SELECT') {
+				selectItemByValue(target, value);
+			}
+		}
+	} else { // an annunciator field of a bitfield value
+		updateAnnunciatorFields(name, value);
+	}
+}
+
 function selectItemByValue(node, value) {
 	for (var i = 0; i < node.options.length; i++) {
 		if (node.options[i].value === value) {